@@ -0,0 +1,263 @@
+/**
+
+ Appigo Third Party Integration - AppigoBinaryCoding.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoBinaryCoding.h
+ @brief A compact binary encoding for AppigoTask and AppigoNote objects.
+
+ The binary encoding is an alternative to the NSKeyedArchiver payloads placed
+ on the Appigo Pasteboard. A payload starts with a four byte magic value, a
+ version byte and a kind byte, followed by a single record. Task payloads
+ (since version 2) put a table of the action images used by the task and its
+ subtasks between the preamble and the record:
+
+ @code
+ task    := preamble, varint imageCount, data * imageCount, record
+ note    := preamble, record
+ record  := uint32 headerLength, header, uint32 bodyLength, body
+ string  := varint (byteLength + 1), UTF-8 bytes     (0 means nil)
+ data    := varint (byteLength + 1), bytes           (0 means nil)
+ date    := int64 milliseconds since the reference date
+ @endcode
+
+ All fixed width integers are little endian and varints are unsigned LEB128.
+ Task headers only hold the fields needed to show a task in a list (name,
+ type, priority, flags and dates); everything else, including subtasks, lives
+ in the body. Readers skip to the end of each section using its length, so
+ newer writers may append fields without breaking older readers.
+
+ A task body refers to its action image by its position in the image table
+ plus one (0 means no image), so an image shared by many subtasks is stored
+ once and decoded into a single UIImage. Version 1 bodies hold the PNG data
+ inline instead.
+
+ Task trees are written and read with an explicit stack, so the depth of a
+ tree is only limited by memory. Large trees are split at the first task with
+ more than one subtask, and its subtask trees are encoded or decoded on
+ several threads (see AppigoBinarySetCodingConcurrency). The encoded trees are
+ joined in order, so the payload is the same for any number of threads.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "AppigoTask.h"
+#import "AppigoNote.h"
+
+@class AppigoStringPool;
+
+
+#define kAppigoBinaryCodingMagic			"APGB"
+#define kAppigoBinaryCodingVersion			2
+
+#define kAppigoBinaryCodingKindTask			1
+#define kAppigoBinaryCodingKindNote			2
+#define kAppigoBinaryCodingKindTaskDelta	3	// see AppigoTaskDelta.h
+
+// Task header flags
+#define kAppigoBinaryTaskFlagDueDateHasTime		0x01
+#define kAppigoBinaryTaskFlagHasDueDate			0x02
+#define kAppigoBinaryTaskFlagHasStartDate		0x04
+#define kAppigoBinaryTaskFlagHasCompletionDate	0x08
+
+// The smallest possible record is two empty section lengths
+#define kAppigoBinaryMinimumRecordLength		8
+
+
+#pragma mark -
+#pragma mark Writing
+
+
+/** Append a single byte. */
+void AppigoBinaryWriteUInt8(NSMutableData *data, uint8_t value);
+
+/** Append a little endian 32-bit unsigned integer. */
+void AppigoBinaryWriteUInt32(NSMutableData *data, uint32_t value);
+
+/** Overwrite a little endian 32-bit unsigned integer previously written at offset. */
+void AppigoBinaryPatchUInt32(NSMutableData *data, NSUInteger offset, uint32_t value);
+
+/** Append a little endian 64-bit signed integer. */
+void AppigoBinaryWriteInt64(NSMutableData *data, int64_t value);
+
+/** Append an unsigned LEB128 varint. */
+void AppigoBinaryWriteVarint(NSMutableData *data, uint64_t value);
+
+/** Append a zigzag encoded signed varint. */
+void AppigoBinaryWriteSignedVarint(NSMutableData *data, int64_t value);
+
+/** Append a date as int64 milliseconds since the reference date. */
+void AppigoBinaryWriteDate(NSMutableData *data, NSDate *date);
+
+/** Append an optional string as raw UTF-8 bytes (nil is preserved). */
+void AppigoBinaryWriteString(NSMutableData *data, NSString *string);
+
+/** Append optional raw bytes (nil is preserved). */
+void AppigoBinaryWriteData(NSMutableData *data, NSData *bytes);
+
+/** Append the payload preamble (magic, version and kind). */
+void AppigoBinaryWritePreamble(NSMutableData *data, uint8_t kind);
+
+
+#pragma mark -
+#pragma mark Reading
+
+
+/**
+ A cursor over an encoded payload. Once a read runs past the end of the buffer
+ or finds malformed data, failed is set and all later reads return zero/nil.
+ */
+typedef struct
+{
+	const uint8_t	*bytes;
+	NSUInteger		length;
+	NSUInteger		offset;
+	BOOL			failed;
+
+	uint8_t			version;			///< the payload version, set by AppigoBinaryReadPreamble
+	NSUInteger		imageTableOffset;	///< the offset of the first image table entry
+	NSUInteger		imageCount;			///< the number of image table entries
+	NSMutableArray	*images;			///< autoreleased, filled in on the first image read
+	AppigoStringPool *strings;			///< not retained, interns lists, contexts, tags and notebooks when set
+} AppigoBinaryReader;
+
+
+/** Start reading data, with the calling thread's current string pool (see AppigoStringPool.h). */
+void AppigoBinaryReaderInit(AppigoBinaryReader *reader, NSData *data);
+uint8_t AppigoBinaryReadUInt8(AppigoBinaryReader *reader);
+uint32_t AppigoBinaryReadUInt32(AppigoBinaryReader *reader);
+int64_t AppigoBinaryReadInt64(AppigoBinaryReader *reader);
+uint64_t AppigoBinaryReadVarint(AppigoBinaryReader *reader);
+int64_t AppigoBinaryReadSignedVarint(AppigoBinaryReader *reader);
+NSDate *AppigoBinaryReadDate(AppigoBinaryReader *reader);
+NSString *AppigoBinaryReadString(AppigoBinaryReader *reader);
+NSData *AppigoBinaryReadData(AppigoBinaryReader *reader);
+
+/** Read a task body's action image, shared with every other reference to the same table entry. */
+UIImage *AppigoBinaryReadImage(AppigoBinaryReader *reader);
+
+/** Read a section length and return the offset where the section ends. */
+NSUInteger AppigoBinaryReadSectionEnd(AppigoBinaryReader *reader);
+
+/** Move the cursor to an absolute offset (fails if it is out of range). */
+void AppigoBinaryReaderSeek(AppigoBinaryReader *reader, NSUInteger offset);
+
+/**
+ Check the payload preamble.
+
+ @return Returns YES if the magic matches, the version is supported and the kind matches.
+ */
+BOOL AppigoBinaryReadPreamble(AppigoBinaryReader *reader, uint8_t kind);
+
+/** Returns YES if data starts with the binary encoding magic. */
+BOOL AppigoBinaryDataHasPreamble(NSData *data);
+
+
+#pragma mark -
+#pragma mark Image Table
+
+
+/**
+ Collects the action images of the tasks being encoded. Images are matched
+ by instance first and then by the contents of their PNG data.
+ */
+@interface AppigoBinaryImageTable : NSObject
+{
+@private
+	NSMutableArray			*_images;			// PNG data in table order
+	CFMutableDictionaryRef	_referencesByImage;	// UIImage * (not retained) -> reference
+	NSMutableDictionary		*_referencesByHash;	// FNV-1a hash -> NSMutableArray of references
+}
+
+/** Returns the table position of an image plus one, adding it if needed, or 0 for no image. */
+- (NSUInteger)referenceForImage:(UIImage *)image;
+
+/** Append the image count and the PNG data of every image. */
+- (void)writeToData:(NSMutableData *)data;
+
+@end
+
+
+#pragma mark -
+#pragma mark Concurrency
+
+
+/**
+ Set how many threads may encode or decode the subtask trees of one large
+ task payload at the same time.
+
+ @param concurrency The number of threads, 1 to only use the calling thread or
+ 0 (the default) to use every active processor.
+ */
+void AppigoBinarySetCodingConcurrency(NSUInteger concurrency);
+
+/** The number of threads used for one large task payload. */
+NSUInteger AppigoBinaryCodingConcurrency(void);
+
+/** The fewest tasks in a tree before encoding it is split over several threads. */
+#define kAppigoBinaryParallelMinimumTasks		256
+
+/** The smallest remaining payload, in bytes, before decoding it is split over several threads. */
+#define kAppigoBinaryParallelMinimumLength		(64 * 1024)
+
+/**
+ Set how large a task tree has to be before it is split over several
+ threads. Below these sizes starting the threads costs more than it saves.
+ tests/device/AppigoBinaryCodingBenchmark.m measures where that happens on a
+ device and prints the values to pass here.
+
+ @param minimumTasks The fewest tasks to split an encode, by default
+ kAppigoBinaryParallelMinimumTasks.
+ @param minimumLength The smallest payload to split a decode, by default
+ kAppigoBinaryParallelMinimumLength.
+ */
+void AppigoBinarySetParallelThresholds(NSUInteger minimumTasks, NSUInteger minimumLength);
+
+
+#pragma mark -
+@interface AppigoTask (AppigoBinaryCoding)
+
+/**
+ Initialize a task from a binary payload created by binaryRepresentation.
+
+ @param data The encoded payload.
+ @return Returns nil if the payload is not a supported binary task payload.
+ */
+- (id)initWithBinaryData:(NSData *)data;
+
+/**
+ Encode the task and all of its subtasks using the binary encoding.
+
+ @return Returns the encoded payload, or nil if memory ran out.
+ */
+- (NSData *)binaryRepresentation;
+
+@end
+
+
+#pragma mark -
+@interface AppigoNote (AppigoBinaryCoding)
+
+/**
+ Initialize a note from a binary payload created by binaryRepresentation.
+
+ @param data The encoded payload.
+ @return Returns nil if the payload is not a supported binary note payload.
+ */
+- (id)initWithBinaryData:(NSData *)data;
+
+/**
+ Encode the note using the binary encoding.
+
+ @return Returns the encoded payload.
+ */
+- (NSData *)binaryRepresentation;
+
+@end
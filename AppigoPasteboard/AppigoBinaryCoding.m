@@ -0,0 +1,1374 @@
+/**
+
+ Appigo Third Party Integration - AppigoBinaryCoding.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoBinaryCoding.h"
+#import "AppigoChecksum.h"
+#import "AppigoImageCoding.h"
+#import "AppigoStringPool.h"
+#import "AppigoStringTrimming.h"
+
+#include <libkern/OSAtomic.h>
+#include <math.h>
+
+
+#define kAppigoBinaryChunkLength				(256 * 1024)
+
+
+#pragma mark -
+@interface AppigoTask (AppigoBinaryCodingPrivate)
+
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader;
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader headerOnly:(BOOL)headerOnly;
+- (void)_decodeBinaryBodyWithReader:(AppigoBinaryReader *)reader;
+- (void)_decodeBinaryBodyWithReader:(AppigoBinaryReader *)reader parallel:(BOOL)parallel;
+- (uint64_t)_decodeBinaryBodyFieldsWithReader:(AppigoBinaryReader *)reader bodyEnd:(NSUInteger *)bodyEnd;
+- (void)_decodeBinarySubtasks:(uint64_t)subtaskCount bodyEnd:(NSUInteger)bodyEnd withReader:(AppigoBinaryReader *)reader parallel:(BOOL)parallel;
+- (void)_decodeBinarySubtaskTrees:(uint64_t)subtaskCount withReader:(AppigoBinaryReader *)reader concurrency:(NSUInteger)concurrency;
+- (NSUInteger)_appendBinaryRecordStartToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable;
+- (void)_appendBinaryRecordToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable;
+
+@end
+
+
+// A task whose body stays open while its subtasks are written
+typedef struct
+{
+	NSArray		*subtasks;
+	NSUInteger	index;
+	NSUInteger	bodyOffset;
+} AppigoBinaryWriteFrame;
+
+
+// A task whose subtasks are still being read
+typedef struct
+{
+	AppigoTask	*task;
+	uint64_t	remaining;
+	NSUInteger	bodyEnd;
+} AppigoBinaryReadFrame;
+
+
+#pragma mark -
+#pragma mark Writing
+
+
+void AppigoBinaryWriteUInt8(NSMutableData *data, uint8_t value)
+{
+	[data appendBytes:&value length:1];
+}
+
+
+void AppigoBinaryWriteUInt32(NSMutableData *data, uint32_t value)
+{
+	uint8_t bytes[4];
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+	[data appendBytes:bytes length:4];
+}
+
+
+void AppigoBinaryPatchUInt32(NSMutableData *data, NSUInteger offset, uint32_t value)
+{
+	uint8_t *bytes = (uint8_t *)[data mutableBytes] + offset;
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+}
+
+
+void AppigoBinaryWriteInt64(NSMutableData *data, int64_t value)
+{
+	uint64_t bits = (uint64_t)value;
+	uint8_t bytes[8];
+	for (int i = 0; i < 8; i++)
+		bytes[i] = (uint8_t)(bits >> (8 * i));
+	[data appendBytes:bytes length:8];
+}
+
+
+void AppigoBinaryWriteVarint(NSMutableData *data, uint64_t value)
+{
+	uint8_t bytes[10];
+	NSUInteger count = 0;
+
+	while (value >= 0x80)
+	{
+		bytes[count++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[count++] = (uint8_t)value;
+
+	[data appendBytes:bytes length:count];
+}
+
+
+void AppigoBinaryWriteSignedVarint(NSMutableData *data, int64_t value)
+{
+	AppigoBinaryWriteVarint(data, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+void AppigoBinaryWriteDate(NSMutableData *data, NSDate *date)
+{
+	AppigoBinaryWriteInt64(data, (int64_t)llround([date timeIntervalSinceReferenceDate] * 1000.0));
+}
+
+
+void AppigoBinaryWriteString(NSMutableData *data, NSString *string)
+{
+	if (string == nil)
+	{
+		AppigoBinaryWriteVarint(data, 0);
+		return;
+	}
+
+	// Write the UTF-8 bytes straight into the payload without an intermediate
+	// C string.
+	NSUInteger byteLength = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	AppigoBinaryWriteVarint(data, byteLength + 1);
+
+	NSUInteger offset = [data length];
+	[data increaseLengthBy:byteLength];
+	[string getBytes:(uint8_t *)[data mutableBytes] + offset
+		   maxLength:byteLength
+		  usedLength:NULL
+			encoding:NSUTF8StringEncoding
+			 options:0
+			   range:NSMakeRange(0, [string length])
+	  remainingRange:NULL];
+}
+
+
+void AppigoBinaryWriteData(NSMutableData *data, NSData *bytes)
+{
+	if (bytes == nil)
+	{
+		AppigoBinaryWriteVarint(data, 0);
+		return;
+	}
+
+	AppigoBinaryWriteVarint(data, [bytes length] + 1);
+	[data appendData:bytes];
+}
+
+
+void AppigoBinaryWritePreamble(NSMutableData *data, uint8_t kind)
+{
+	[data appendBytes:kAppigoBinaryCodingMagic length:4];
+	AppigoBinaryWriteUInt8(data, kAppigoBinaryCodingVersion);
+	AppigoBinaryWriteUInt8(data, kind);
+}
+
+
+// Writes UTF-8 bytes in the string format a chunk at a time, so text backed
+// by a mapped file is paged in gradually rather than all at once
+static void AppigoBinaryWriteUTF8Chunks(NSMutableData *data, const uint8_t *bytes, NSUInteger length)
+{
+	AppigoBinaryWriteVarint(data, length + 1);
+
+	for (NSUInteger offset = 0; offset < length; offset += kAppigoBinaryChunkLength)
+		[data appendBytes:bytes + offset length:MIN(length - offset, (NSUInteger)kAppigoBinaryChunkLength)];
+}
+
+
+static void AppigoBinaryWriteStringArray(NSMutableData *data, NSArray *strings)
+{
+	if (strings == nil)
+	{
+		AppigoBinaryWriteVarint(data, 0);
+		return;
+	}
+
+	AppigoBinaryWriteVarint(data, [strings count] + 1);
+	for (NSString *string in strings)
+		AppigoBinaryWriteString(data, string);
+}
+
+
+#pragma mark -
+#pragma mark Reading
+
+
+void AppigoBinaryReaderInit(AppigoBinaryReader *reader, NSData *data)
+{
+	reader->bytes = (const uint8_t *)[data bytes];
+	reader->length = [data length];
+	reader->offset = 0;
+	reader->failed = NO;
+
+	reader->version = kAppigoBinaryCodingVersion;
+	reader->imageTableOffset = 0;
+	reader->imageCount = 0;
+	reader->images = nil;
+	reader->strings = [AppigoStringPool currentPool];
+}
+
+
+static inline BOOL AppigoBinaryReaderCanRead(AppigoBinaryReader *reader, NSUInteger count)
+{
+	if ( (reader->failed == YES) || (count > reader->length - reader->offset) )
+	{
+		reader->failed = YES;
+		return NO;
+	}
+
+	return YES;
+}
+
+
+uint8_t AppigoBinaryReadUInt8(AppigoBinaryReader *reader)
+{
+	if (AppigoBinaryReaderCanRead(reader, 1) == NO)
+		return 0;
+
+	return reader->bytes[reader->offset++];
+}
+
+
+uint32_t AppigoBinaryReadUInt32(AppigoBinaryReader *reader)
+{
+	if (AppigoBinaryReaderCanRead(reader, 4) == NO)
+		return 0;
+
+	const uint8_t *bytes = reader->bytes + reader->offset;
+	reader->offset += 4;
+
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+int64_t AppigoBinaryReadInt64(AppigoBinaryReader *reader)
+{
+	if (AppigoBinaryReaderCanRead(reader, 8) == NO)
+		return 0;
+
+	const uint8_t *bytes = reader->bytes + reader->offset;
+	reader->offset += 8;
+
+	uint64_t bits = 0;
+	for (int i = 7; i >= 0; i--)
+		bits = (bits << 8) | bytes[i];
+
+	return (int64_t)bits;
+}
+
+
+uint64_t AppigoBinaryReadVarint(AppigoBinaryReader *reader)
+{
+	uint64_t value = 0;
+
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (AppigoBinaryReaderCanRead(reader, 1) == NO)
+			return 0;
+
+		uint8_t byte = reader->bytes[reader->offset++];
+		value |= (uint64_t)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+
+	// More than ten bytes is not a valid varint
+	reader->failed = YES;
+	return 0;
+}
+
+
+int64_t AppigoBinaryReadSignedVarint(AppigoBinaryReader *reader)
+{
+	uint64_t value = AppigoBinaryReadVarint(reader);
+	return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+
+NSDate *AppigoBinaryReadDate(AppigoBinaryReader *reader)
+{
+	int64_t milliseconds = AppigoBinaryReadInt64(reader);
+	if (reader->failed == YES)
+		return nil;
+
+	return [NSDate dateWithTimeIntervalSinceReferenceDate:(NSTimeInterval)milliseconds / 1000.0];
+}
+
+
+NSString *AppigoBinaryReadString(AppigoBinaryReader *reader)
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return nil;
+
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	NSUInteger byteLength = (NSUInteger)(prefix - 1);
+
+	NSString *string = [[NSString alloc] initWithBytes:reader->bytes + reader->offset length:byteLength encoding:NSUTF8StringEncoding];
+	reader->offset += byteLength;
+
+	if (string == nil)
+		reader->failed = YES;
+
+	return [string autorelease];
+}
+
+
+NSData *AppigoBinaryReadData(AppigoBinaryReader *reader)
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return nil;
+
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	NSUInteger byteLength = (NSUInteger)(prefix - 1);
+
+	NSData *bytes = [NSData dataWithBytes:reader->bytes + reader->offset length:byteLength];
+	reader->offset += byteLength;
+
+	return bytes;
+}
+
+
+void AppigoBinaryReaderSeek(AppigoBinaryReader *reader, NSUInteger offset)
+{
+	if (offset > reader->length)
+		reader->failed = YES;
+	else
+		reader->offset = offset;
+}
+
+
+BOOL AppigoBinaryReadPreamble(AppigoBinaryReader *reader, uint8_t kind)
+{
+	if (AppigoBinaryReaderCanRead(reader, 6) == NO)
+		return NO;
+
+	if (memcmp(reader->bytes + reader->offset, kAppigoBinaryCodingMagic, 4) != 0)
+	{
+		reader->failed = YES;
+		return NO;
+	}
+	reader->offset += 4;
+
+	uint8_t version = AppigoBinaryReadUInt8(reader);
+	uint8_t payloadKind = AppigoBinaryReadUInt8(reader);
+
+	if ( (version == 0) || (version > kAppigoBinaryCodingVersion) || (payloadKind != kind) )
+	{
+		reader->failed = YES;
+		return NO;
+	}
+
+	reader->version = version;
+
+	// Skip over the image table, its entries are only decoded when a body
+	// refers to one of them
+	if ( ((kind == kAppigoBinaryCodingKindTask) || (kind == kAppigoBinaryCodingKindTaskDelta)) && (version >= 2) )
+	{
+		uint64_t imageCount = AppigoBinaryReadVarint(reader);
+		if (imageCount > reader->length - reader->offset)
+			reader->failed = YES;
+
+		reader->imageTableOffset = reader->offset;
+		reader->imageCount = (reader->failed == YES) ? 0 : (NSUInteger)imageCount;
+
+		for (NSUInteger i = 0; (i < reader->imageCount) && (reader->failed == NO); i++)
+		{
+			uint64_t prefix = AppigoBinaryReadVarint(reader);
+			if ( (prefix > 0) && (prefix - 1 <= (uint64_t)(reader->length - reader->offset)) )
+				reader->offset += (NSUInteger)(prefix - 1);
+			else if (prefix > 0)
+				reader->failed = YES;
+		}
+
+		if (reader->failed == YES)
+			return NO;
+	}
+
+	return YES;
+}
+
+
+// Decode every image of the table. Readers copied afterwards share the
+// images without changing the reader.
+static void AppigoBinaryReaderLoadImages(AppigoBinaryReader *reader)
+{
+	if ( (reader->images != nil) || (reader->imageCount == 0) )
+		return;
+
+	AppigoBinaryReader tableReader = *reader;
+	tableReader.offset = reader->imageTableOffset;
+
+	NSMutableArray *images = [NSMutableArray arrayWithCapacity:reader->imageCount];
+	for (NSUInteger i = 0; i < reader->imageCount; i++)
+	{
+		UIImage *image = AppigoImageWithPNGData(AppigoBinaryReadData(&tableReader));
+		[images addObject:(image != nil) ? (id)image : (id)[NSNull null]];
+	}
+
+	reader->images = images;
+}
+
+
+UIImage *AppigoBinaryReadImage(AppigoBinaryReader *reader)
+{
+	if (reader->version < 2)
+		return AppigoImageWithPNGData(AppigoBinaryReadData(reader));
+
+	uint64_t reference = AppigoBinaryReadVarint(reader);
+	if (reference == 0)
+		return nil;
+
+	if (reference > reader->imageCount)
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	AppigoBinaryReaderLoadImages(reader);
+
+	UIImage *image = [reader->images objectAtIndex:(NSUInteger)(reference - 1)];
+	return (image == (id)[NSNull null]) ? nil : image;
+}
+
+
+BOOL AppigoBinaryDataHasPreamble(NSData *data)
+{
+	if ([data length] < 6)
+		return NO;
+
+	return (memcmp([data bytes], kAppigoBinaryCodingMagic, 4) == 0);
+}
+
+
+static NSArray *AppigoBinaryReadStringArray(AppigoBinaryReader *reader)
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return nil;
+
+	// Every string takes at least one byte, so a count larger than what is
+	// left in the buffer can only come from a corrupt payload.
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	NSUInteger count = (NSUInteger)(prefix - 1);
+
+	NSMutableArray *strings = [NSMutableArray arrayWithCapacity:count];
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		NSString *string = AppigoBinaryReadString(reader);
+		if (reader->failed == YES)
+			return nil;
+
+		[strings addObject:(string != nil) ? string : @""];
+	}
+
+	return strings;
+}
+
+
+NSUInteger AppigoBinaryReadSectionEnd(AppigoBinaryReader *reader)
+{
+	uint32_t sectionLength = AppigoBinaryReadUInt32(reader);
+	if ( (reader->failed == YES) || (sectionLength > reader->length - reader->offset) )
+	{
+		reader->failed = YES;
+		return reader->length;
+	}
+
+	return reader->offset + sectionLength;
+}
+
+
+// Returns a retained, whitespace trimmed copy of the next string (or nil).
+// The bytes are trimmed before the string is created, so only one string is,
+// and none when strings already holds the value.
+static NSString *AppigoBinaryCopyTrimmedStringFromPool(AppigoBinaryReader *reader, AppigoStringPool *strings)
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return nil;
+
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	NSUInteger byteLength = (NSUInteger)(prefix - 1);
+	const uint8_t *bytes = reader->bytes + reader->offset;
+	reader->offset += byteLength;
+
+	NSRange range = AppigoUTF8RangeByTrimmingWhitespace(bytes, byteLength);
+
+	NSString *string;
+	if (strings != nil)
+		string = [strings copyStringWithUTF8Bytes:bytes + range.location length:range.length];
+	else
+		string = [[NSString alloc] initWithBytes:bytes + range.location length:range.length encoding:NSUTF8StringEncoding];
+
+	if (string == nil)
+		reader->failed = YES;
+
+	return string;
+}
+
+
+static inline NSString *AppigoBinaryCopyTrimmedString(AppigoBinaryReader *reader)
+{
+	return AppigoBinaryCopyTrimmedStringFromPool(reader, nil);
+}
+
+
+// For values that repeat across many records
+static inline NSString *AppigoBinaryCopyInternedString(AppigoBinaryReader *reader)
+{
+	return AppigoBinaryCopyTrimmedStringFromPool(reader, reader->strings);
+}
+
+
+#pragma mark -
+@implementation AppigoBinaryImageTable
+
+
+- (id)init
+{
+	if (self = [super init])
+	{
+		_images = [[NSMutableArray alloc] init];
+		_referencesByImage = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+		_referencesByHash = [[NSMutableDictionary alloc] init];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	[_images release];
+	CFRelease(_referencesByImage);
+	[_referencesByHash release];
+
+	[super dealloc];
+}
+
+
+- (NSUInteger)referenceForImage:(UIImage *)image
+{
+	if (image == nil)
+		return 0;
+
+	// The images are retained by their tasks for as long as the table is used.
+	// Images without PNG data are remembered as 0, so once every image was
+	// seen a lookup never changes the table.
+	const void *reference = NULL;
+	if (CFDictionaryGetValueIfPresent(_referencesByImage, image, &reference) == true)
+		return (NSUInteger)(uintptr_t)reference;
+
+	NSData *pngData = AppigoImagePNGRepresentation(image);
+	if (pngData == nil)
+	{
+		CFDictionarySetValue(_referencesByImage, image, NULL);
+		return 0;
+	}
+
+	NSNumber *hash = [NSNumber numberWithUnsignedLongLong:AppigoFNV1a64([pngData bytes], [pngData length])];
+	NSMutableArray *candidates = [_referencesByHash objectForKey:hash];
+
+	NSUInteger imageReference = 0;
+	for (NSNumber *candidate in candidates)
+	{
+		if ([[_images objectAtIndex:[candidate unsignedIntegerValue] - 1] isEqualToData:pngData] == YES)
+		{
+			imageReference = [candidate unsignedIntegerValue];
+			break;
+		}
+	}
+
+	if (imageReference == 0)
+	{
+		[_images addObject:pngData];
+		imageReference = [_images count];
+
+		if (candidates == nil)
+		{
+			candidates = [NSMutableArray arrayWithCapacity:1];
+			[_referencesByHash setObject:candidates forKey:hash];
+		}
+		[candidates addObject:[NSNumber numberWithUnsignedInteger:imageReference]];
+	}
+
+	CFDictionarySetValue(_referencesByImage, image, (const void *)(uintptr_t)imageReference);
+	return imageReference;
+}
+
+
+- (void)writeToData:(NSMutableData *)data
+{
+	AppigoBinaryWriteVarint(data, [_images count]);
+	for (NSData *pngData in _images)
+		AppigoBinaryWriteData(data, pngData);
+}
+
+
+@end
+
+
+#pragma mark -
+#pragma mark Concurrency
+
+
+// 0 means every active processor
+static volatile NSUInteger _codingConcurrency = 0;
+
+// Task trees are only split over several threads past these sizes
+static volatile NSUInteger _parallelMinimumTasks = kAppigoBinaryParallelMinimumTasks;
+static volatile NSUInteger _parallelMinimumLength = kAppigoBinaryParallelMinimumLength;
+
+
+void AppigoBinarySetCodingConcurrency(NSUInteger concurrency)
+{
+	_codingConcurrency = concurrency;
+}
+
+
+NSUInteger AppigoBinaryCodingConcurrency(void)
+{
+	NSUInteger concurrency = _codingConcurrency;
+	if (concurrency == 0)
+		concurrency = [[NSProcessInfo processInfo] activeProcessorCount];
+
+	return MAX(concurrency, (NSUInteger)1);
+}
+
+
+void AppigoBinarySetParallelThresholds(NSUInteger minimumTasks, NSUInteger minimumLength)
+{
+	_parallelMinimumTasks = minimumTasks;
+	_parallelMinimumLength = minimumLength;
+}
+
+
+// Write a task and all of its subtasks depth first with an explicit stack.
+// Every frame is a task whose body stays open until its last subtask was
+// written.
+static BOOL AppigoBinaryAppendTaskTree(AppigoTask *root, NSMutableData *data, AppigoBinaryImageTable *imageTable)
+{
+	NSUInteger rootBodyOffset = [root _appendBinaryRecordStartToData:data imageTable:imageTable];
+
+	NSArray *subtasks = root.subtasks;
+	if ([subtasks count] == 0)
+	{
+		AppigoBinaryPatchUInt32(data, rootBodyOffset, (uint32_t)([data length] - rootBodyOffset - 4));
+		return YES;
+	}
+
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoBinaryWriteFrame *stack = malloc(sizeof(AppigoBinaryWriteFrame) * capacity);
+	if (stack == NULL)
+		return NO;
+
+	stack[0].subtasks = subtasks;
+	stack[0].index = 0;
+	stack[0].bodyOffset = rootBodyOffset;
+
+	BOOL written = YES;
+
+	while (depth > 0)
+	{
+		AppigoBinaryWriteFrame *frame = &stack[depth - 1];
+		if (frame->index >= [frame->subtasks count])
+		{
+			AppigoBinaryPatchUInt32(data, frame->bodyOffset, (uint32_t)([data length] - frame->bodyOffset - 4));
+			depth--;
+			continue;
+		}
+
+		AppigoTask *subtask = [frame->subtasks objectAtIndex:frame->index++];
+		NSUInteger bodyOffset = [subtask _appendBinaryRecordStartToData:data imageTable:imageTable];
+
+		NSArray *children = subtask.subtasks;
+		if ([children count] == 0)
+		{
+			AppigoBinaryPatchUInt32(data, bodyOffset, (uint32_t)([data length] - bodyOffset - 4));
+			continue;
+		}
+
+		if (depth == capacity)
+		{
+			AppigoBinaryWriteFrame *grownStack = realloc(stack, sizeof(AppigoBinaryWriteFrame) * capacity * 2);
+			if (grownStack == NULL)
+			{
+				written = NO;
+				break;
+			}
+
+			stack = grownStack;
+			capacity *= 2;
+		}
+
+		stack[depth].subtasks = children;
+		stack[depth].index = 0;
+		stack[depth].bodyOffset = bodyOffset;
+		depth++;
+	}
+
+	free(stack);
+	return written;
+}
+
+
+// Walk every task in the order they are written and add their images to the
+// table, so that the table is complete before subtask trees are written on
+// several threads. Returns the number of tasks, 0 if the walk failed.
+static NSUInteger AppigoBinaryRegisterImages(AppigoTask *root, AppigoBinaryImageTable *imageTable)
+{
+	[imageTable referenceForImage:root.actionImage];
+
+	NSUInteger count = 1;
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoBinaryWriteFrame *stack = malloc(sizeof(AppigoBinaryWriteFrame) * capacity);
+	if (stack == NULL)
+		return 0;
+
+	stack[0].subtasks = root.subtasks;
+	stack[0].index = 0;
+
+	while (depth > 0)
+	{
+		AppigoBinaryWriteFrame *frame = &stack[depth - 1];
+		if (frame->index >= [frame->subtasks count])
+		{
+			depth--;
+			continue;
+		}
+
+		AppigoTask *subtask = [frame->subtasks objectAtIndex:frame->index++];
+		[imageTable referenceForImage:subtask.actionImage];
+		count++;
+
+		NSArray *children = subtask.subtasks;
+		if ([children count] == 0)
+			continue;
+
+		if (depth == capacity)
+		{
+			AppigoBinaryWriteFrame *grownStack = realloc(stack, sizeof(AppigoBinaryWriteFrame) * capacity * 2);
+			if (grownStack == NULL)
+			{
+				count = 0;
+				break;
+			}
+
+			stack = grownStack;
+			capacity *= 2;
+		}
+
+		stack[depth].subtasks = children;
+		stack[depth].index = 0;
+		depth++;
+	}
+
+	free(stack);
+	return count;
+}
+
+
+// Write the subtask trees of a task on several threads, each into its own
+// buffer, and append the buffers in order. Workers take the next tree as
+// soon as they are free, so one large tree does not hold up the others.
+static BOOL AppigoBinaryAppendSubtaskTreesInParallel(NSArray *subtasks, NSMutableData *data, AppigoBinaryImageTable *imageTable, NSUInteger concurrency)
+{
+	NSUInteger count = [subtasks count];
+	NSMutableData **records = calloc(count, sizeof(NSMutableData *));
+	if (records == NULL)
+		return NO;
+
+	int32_t nextIndex = 0;
+	int32_t *nextIndexPointer = &nextIndex;
+	volatile BOOL failed = NO;
+	volatile BOOL *failedPointer = &failed;
+
+	dispatch_apply(MIN(concurrency, count), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t worker) {
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+		for (;;)
+		{
+			NSUInteger index = (NSUInteger)(OSAtomicIncrement32(nextIndexPointer) - 1);
+			if (index >= count)
+				break;
+
+			NSMutableData *record = [[NSMutableData alloc] initWithCapacity:256];
+			if (AppigoBinaryAppendTaskTree([subtasks objectAtIndex:index], record, imageTable) == NO)
+				*failedPointer = YES;
+
+			records[index] = record;
+		}
+
+		[pool drain];
+	});
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		if (failed == NO)
+			[data appendData:records[i]];
+		[records[i] release];
+	}
+
+	free(records);
+	return (failed == NO);
+}
+
+
+// Write the tasks that have a single subtask on this thread until the first
+// task with several subtasks, then write its subtask trees in parallel
+static BOOL AppigoBinaryAppendTaskTreeInParallel(AppigoTask *root, NSMutableData *data, AppigoBinaryImageTable *imageTable, NSUInteger concurrency)
+{
+	NSUInteger capacity = 16;
+	NSUInteger depth = 0;
+	NSUInteger *bodyOffsets = malloc(sizeof(NSUInteger) * capacity);
+	if (bodyOffsets == NULL)
+		return NO;
+
+	BOOL written = YES;
+	AppigoTask *task = root;
+
+	for (;;)
+	{
+		if (depth == capacity)
+		{
+			NSUInteger *grownOffsets = realloc(bodyOffsets, sizeof(NSUInteger) * capacity * 2);
+			if (grownOffsets == NULL)
+			{
+				written = NO;
+				break;
+			}
+
+			bodyOffsets = grownOffsets;
+			capacity *= 2;
+		}
+
+		bodyOffsets[depth++] = [task _appendBinaryRecordStartToData:data imageTable:imageTable];
+
+		NSArray *subtasks = task.subtasks;
+		if ([subtasks count] == 1)
+		{
+			task = [subtasks objectAtIndex:0];
+			continue;
+		}
+
+		if ([subtasks count] > 1)
+			written = AppigoBinaryAppendSubtaskTreesInParallel(subtasks, data, imageTable, concurrency);
+
+		break;
+	}
+
+	// Every task above the split has a single subtask, so all of their
+	// bodies end here
+	while (depth > 0)
+	{
+		depth--;
+		AppigoBinaryPatchUInt32(data, bodyOffsets[depth], (uint32_t)([data length] - bodyOffsets[depth] - 4));
+	}
+
+	free(bodyOffsets);
+	return written;
+}
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoBinaryCoding)
+
+
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader
+{
+	return [self _initWithBinaryReader:reader headerOnly:NO];
+}
+
+
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader headerOnly:(BOOL)headerOnly
+{
+	if (self = [super init])
+	{
+		NSUInteger headerEnd = AppigoBinaryReadSectionEnd(reader);
+
+		NSString *aName = AppigoBinaryCopyTrimmedString(reader);
+		if (aName == nil)
+			name = [[NSString alloc] initWithString:@"Unknown"];
+		else
+			name = aName;
+
+		type = (AppigoTaskType)AppigoBinaryReadUInt8(reader);
+
+		uint8_t pri = AppigoBinaryReadUInt8(reader);
+		if ( (pri >= AppigoTaskPriorityHigh) && (pri <= AppigoTaskPriorityNone) )
+			priority = (AppigoTaskPriority)pri;
+		else
+			priority = AppigoTaskPriorityNone;
+
+		uint8_t flags = AppigoBinaryReadUInt8(reader);
+		dueDateHasTime = ((flags & kAppigoBinaryTaskFlagDueDateHasTime) != 0);
+
+		if ((flags & kAppigoBinaryTaskFlagHasDueDate) != 0)
+			dueDate = [AppigoBinaryReadDate(reader) retain];
+
+		if ((flags & kAppigoBinaryTaskFlagHasStartDate) != 0)
+			startDate = [AppigoBinaryReadDate(reader) retain];
+
+		if ((flags & kAppigoBinaryTaskFlagHasCompletionDate) != 0)
+			completionDate = [AppigoBinaryReadDate(reader) retain];
+
+		repeat = (NSInteger)AppigoBinaryReadSignedVarint(reader);
+
+		AppigoBinaryReaderSeek(reader, headerEnd);
+
+		// A header only decode leaves the reader at the start of the body so
+		// that it can be decoded later on.
+		if (headerOnly == NO)
+			[self _decodeBinaryBodyWithReader:reader];
+
+		if (reader->failed == YES)
+		{
+			[self release];
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+
+- (void)_decodeBinaryBodyWithReader:(AppigoBinaryReader *)reader
+{
+	[self _decodeBinaryBodyWithReader:reader parallel:YES];
+}
+
+
+- (void)_decodeBinaryBodyWithReader:(AppigoBinaryReader *)reader parallel:(BOOL)parallel
+{
+	NSUInteger bodyEnd = reader->length;
+	uint64_t subtaskCount = [self _decodeBinaryBodyFieldsWithReader:reader bodyEnd:&bodyEnd];
+
+	if (subtaskCount > 0)
+		[self _decodeBinarySubtasks:subtaskCount bodyEnd:bodyEnd withReader:reader parallel:parallel];
+	else
+		AppigoBinaryReaderSeek(reader, bodyEnd);
+}
+
+
+- (uint64_t)_decodeBinaryBodyFieldsWithReader:(AppigoBinaryReader *)reader bodyEnd:(NSUInteger *)bodyEnd
+{
+	*bodyEnd = AppigoBinaryReadSectionEnd(reader);
+
+	typeKeys = [AppigoBinaryReadStringArray(reader) retain];
+	typeValues = [AppigoBinaryReadStringArray(reader) retain];
+
+	advancedRepeat = AppigoBinaryCopyTrimmedString(reader);
+	note = AppigoBinaryCopyTrimmedString(reader);
+	list = AppigoBinaryCopyInternedString(reader);
+	context = AppigoBinaryCopyInternedString(reader);
+	tags = AppigoBinaryCopyInternedString(reader);
+
+	actionImage = [AppigoBinaryReadImage(reader) retain];
+
+	uint64_t subtaskCount = AppigoBinaryReadVarint(reader);
+	if (subtaskCount > (reader->length - reader->offset) / kAppigoBinaryMinimumRecordLength)
+		reader->failed = YES;
+
+	if (reader->failed == YES)
+		subtaskCount = 0;
+
+	_subtasks = [[NSMutableArray alloc] initWithCapacity:(NSUInteger)subtaskCount];
+
+	return subtaskCount;
+}
+
+
+- (void)_decodeBinarySubtasks:(uint64_t)subtaskCount bodyEnd:(NSUInteger)bodyEnd withReader:(AppigoBinaryReader *)reader parallel:(BOOL)parallel
+{
+	NSUInteger concurrency = (parallel == YES) ? AppigoBinaryCodingConcurrency() : 1;
+
+	// Read the records depth first with an explicit stack, every frame
+	// counts down the subtasks of a task that are still to be read
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoBinaryReadFrame *stack = malloc(sizeof(AppigoBinaryReadFrame) * capacity);
+	if (stack == NULL)
+	{
+		reader->failed = YES;
+		return;
+	}
+
+	stack[0].task = self;
+	stack[0].remaining = subtaskCount;
+	stack[0].bodyEnd = bodyEnd;
+
+	while ( (depth > 0) && (reader->failed == NO) )
+	{
+		AppigoBinaryReadFrame *frame = &stack[depth - 1];
+		if (frame->remaining == 0)
+		{
+			AppigoBinaryReaderSeek(reader, frame->bodyEnd);
+			depth--;
+			continue;
+		}
+
+		// Split at the first task with several subtasks, if what is left of
+		// the payload is worth spreading over several threads
+		if ( (concurrency > 1) && (frame->remaining > 1) )
+		{
+			BOOL worthSplitting = (frame->bodyEnd - reader->offset >= _parallelMinimumLength);
+			NSUInteger threads = concurrency;
+			concurrency = 1;
+
+			if (worthSplitting == YES)
+			{
+				[frame->task _decodeBinarySubtaskTrees:frame->remaining withReader:reader concurrency:threads];
+				frame->remaining = 0;
+				continue;
+			}
+		}
+
+		frame->remaining--;
+
+		AppigoTask *subtask = [[AppigoTask alloc] _initWithBinaryReader:reader headerOnly:YES];
+		if (subtask == nil)
+			break;
+
+		NSUInteger subtaskBodyEnd = reader->length;
+		uint64_t count = [subtask _decodeBinaryBodyFieldsWithReader:reader bodyEnd:&subtaskBodyEnd];
+		if (reader->failed == YES)
+		{
+			[subtask release];
+			break;
+		}
+
+		[frame->task->_subtasks addObject:subtask];
+		[subtask release];
+
+		if (count == 0)
+		{
+			AppigoBinaryReaderSeek(reader, subtaskBodyEnd);
+			continue;
+		}
+
+		if (depth == capacity)
+		{
+			AppigoBinaryReadFrame *grownStack = realloc(stack, sizeof(AppigoBinaryReadFrame) * capacity * 2);
+			if (grownStack == NULL)
+			{
+				reader->failed = YES;
+				break;
+			}
+
+			stack = grownStack;
+			capacity *= 2;
+		}
+
+		// The parent's subtask array keeps the subtask alive
+		stack[depth].task = subtask;
+		stack[depth].remaining = count;
+		stack[depth].bodyEnd = subtaskBodyEnd;
+		depth++;
+	}
+
+	free(stack);
+}
+
+
+- (void)_decodeBinarySubtaskTrees:(uint64_t)subtaskCount withReader:(AppigoBinaryReader *)reader concurrency:(NSUInteger)concurrency
+{
+	NSUInteger *offsets = malloc(sizeof(NSUInteger) * (NSUInteger)subtaskCount);
+	AppigoTask **subtasks = calloc((NSUInteger)subtaskCount, sizeof(AppigoTask *));
+	if ( (offsets == NULL) || (subtasks == NULL) )
+	{
+		free(offsets);
+		free(subtasks);
+		reader->failed = YES;
+		return;
+	}
+
+	// Find where every subtask record starts from the section lengths alone.
+	// Records before a damaged one are still decoded, like they would be on
+	// a single thread.
+	NSUInteger found = 0;
+	while ( (found < subtaskCount) && (reader->failed == NO) )
+	{
+		NSUInteger recordOffset = reader->offset;
+
+		AppigoBinaryReaderSeek(reader, AppigoBinaryReadSectionEnd(reader));
+		AppigoBinaryReaderSeek(reader, AppigoBinaryReadSectionEnd(reader));
+
+		if (reader->failed == NO)
+			offsets[found++] = recordOffset;
+	}
+
+	// The copies of the reader share the decoded images
+	AppigoBinaryReaderLoadImages(reader);
+
+	AppigoBinaryReader baseReader = *reader;
+	baseReader.failed = NO;
+
+	int32_t nextIndex = 0;
+	int32_t *nextIndexPointer = &nextIndex;
+
+	if (found > 0)
+	{
+		dispatch_apply(MIN(concurrency, found), dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t worker) {
+			NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+			for (;;)
+			{
+				NSUInteger index = (NSUInteger)(OSAtomicIncrement32(nextIndexPointer) - 1);
+				if (index >= found)
+					break;
+
+				AppigoBinaryReader subtaskReader = baseReader;
+				subtaskReader.offset = offsets[index];
+
+				AppigoTask *subtask = [[AppigoTask alloc] _initWithBinaryReader:&subtaskReader headerOnly:YES];
+				[subtask _decodeBinaryBodyWithReader:&subtaskReader parallel:NO];
+
+				if (subtaskReader.failed == YES)
+				{
+					[subtask release];
+					subtask = nil;
+				}
+
+				subtasks[index] = subtask;
+			}
+
+			[pool drain];
+		});
+	}
+
+	// Add the subtasks in payload order, up to the first one that failed
+	BOOL complete = (found == subtaskCount);
+	for (NSUInteger i = 0; i < found; i++)
+	{
+		if (subtasks[i] == nil)
+			complete = NO;
+		else if (complete == YES)
+			[_subtasks addObject:subtasks[i]];
+
+		[subtasks[i] release];
+	}
+
+	if (complete == NO)
+		reader->failed = YES;
+
+	free(offsets);
+	free(subtasks);
+}
+
+
+- (id)initWithBinaryData:(NSData *)data
+{
+	AppigoBinaryReader reader;
+	AppigoBinaryReaderInit(&reader, data);
+
+	if (AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindTask) == NO)
+	{
+		[self release];
+		return nil;
+	}
+
+	return [self _initWithBinaryReader:&reader];
+}
+
+
+- (NSUInteger)_appendBinaryRecordStartToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable
+{
+	// Header
+	NSUInteger headerOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+
+	AppigoBinaryWriteString(data, name);
+	AppigoBinaryWriteUInt8(data, (uint8_t)type);
+	AppigoBinaryWriteUInt8(data, (uint8_t)priority);
+
+	uint8_t flags = 0;
+	if (dueDateHasTime == YES)
+		flags |= kAppigoBinaryTaskFlagDueDateHasTime;
+	if (dueDate != nil)
+		flags |= kAppigoBinaryTaskFlagHasDueDate;
+	if (startDate != nil)
+		flags |= kAppigoBinaryTaskFlagHasStartDate;
+	if (completionDate != nil)
+		flags |= kAppigoBinaryTaskFlagHasCompletionDate;
+	AppigoBinaryWriteUInt8(data, flags);
+
+	if (dueDate != nil)
+		AppigoBinaryWriteDate(data, dueDate);
+	if (startDate != nil)
+		AppigoBinaryWriteDate(data, startDate);
+	if (completionDate != nil)
+		AppigoBinaryWriteDate(data, completionDate);
+
+	AppigoBinaryWriteSignedVarint(data, repeat);
+
+	AppigoBinaryPatchUInt32(data, headerOffset, (uint32_t)([data length] - headerOffset - 4));
+
+	// Body, closed by the caller once the subtasks were written
+	NSUInteger bodyOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+
+	AppigoBinaryWriteStringArray(data, typeKeys);
+	AppigoBinaryWriteStringArray(data, typeValues);
+
+	AppigoBinaryWriteString(data, advancedRepeat);
+	AppigoBinaryWriteString(data, note);
+	AppigoBinaryWriteString(data, list);
+	AppigoBinaryWriteString(data, context);
+	AppigoBinaryWriteString(data, tags);
+
+	AppigoBinaryWriteVarint(data, [imageTable referenceForImage:actionImage]);
+
+	AppigoBinaryWriteVarint(data, [_subtasks count]);
+
+	return bodyOffset;
+}
+
+
+- (void)_appendBinaryRecordToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable
+{
+	AppigoBinaryAppendTaskTree(self, data, imageTable);
+}
+
+
+- (NSData *)binaryRepresentation
+{
+	// The image table has to come first but is only complete once every
+	// task was written, so the record is written on its own first
+	AppigoBinaryImageTable *imageTable = [[AppigoBinaryImageTable alloc] init];
+	NSMutableData *record = [[NSMutableData alloc] initWithCapacity:256];
+
+	// Large trees are split over several threads once every image is in
+	// the table, which gives the same payload as writing them in one go
+	BOOL written;
+	NSUInteger concurrency = AppigoBinaryCodingConcurrency();
+	if ( (concurrency > 1) && (AppigoBinaryRegisterImages(self, imageTable) >= _parallelMinimumTasks) )
+		written = AppigoBinaryAppendTaskTreeInParallel(self, record, imageTable, concurrency);
+	else
+		written = AppigoBinaryAppendTaskTree(self, record, imageTable);
+
+	NSMutableData *data = nil;
+	if (written == YES)
+	{
+		data = [NSMutableData dataWithCapacity:[record length] + 16];
+		AppigoBinaryWritePreamble(data, kAppigoBinaryCodingKindTask);
+		[imageTable writeToData:data];
+		[data appendData:record];
+	}
+
+	[record release];
+	[imageTable release];
+
+	return data;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoNote (AppigoBinaryCoding)
+
+
+- (id)initWithBinaryData:(NSData *)data
+{
+	AppigoBinaryReader reader;
+	AppigoBinaryReaderInit(&reader, data);
+
+	if (AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindNote) == NO)
+	{
+		[self release];
+		return nil;
+	}
+
+	if (self = [super init])
+	{
+		// Header
+		NSUInteger headerEnd = AppigoBinaryReadSectionEnd(&reader);
+
+		NSString *aName = AppigoBinaryCopyTrimmedString(&reader);
+		if (aName == nil)
+			name = [[NSString alloc] initWithString:@"Unknown"];
+		else
+			name = aName;
+
+		AppigoBinaryReaderSeek(&reader, headerEnd);
+
+		// Body
+		NSUInteger bodyEnd = AppigoBinaryReadSectionEnd(&reader);
+
+		text = AppigoBinaryCopyTrimmedString(&reader);
+		notebook = AppigoBinaryCopyInternedString(&reader);
+
+		AppigoBinaryReaderSeek(&reader, bodyEnd);
+
+		if (reader.failed == YES)
+		{
+			[self release];
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+
+- (NSData *)binaryRepresentation
+{
+	// Sized up front so that large text is not copied again while the
+	// payload grows
+	NSUInteger textLength = (textData != nil) ? textRange.length : [text lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	NSMutableData *data = [NSMutableData dataWithCapacity:64 + textLength + [name length] * 3 + [notebook length] * 3];
+
+	AppigoBinaryWritePreamble(data, kAppigoBinaryCodingKindNote);
+
+	// Header
+	NSUInteger headerOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+	AppigoBinaryWriteString(data, name);
+	AppigoBinaryPatchUInt32(data, headerOffset, (uint32_t)([data length] - headerOffset - 4));
+
+	// Body
+	NSUInteger bodyOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+	if (textData != nil)
+		AppigoBinaryWriteUTF8Chunks(data, (const uint8_t *)[textData bytes] + textRange.location, textRange.length);
+	else
+		AppigoBinaryWriteString(data, text);
+	AppigoBinaryWriteString(data, notebook);
+	AppigoBinaryPatchUInt32(data, bodyOffset, (uint32_t)([data length] - bodyOffset - 4));
+
+	return data;
+}
+
+
+@end
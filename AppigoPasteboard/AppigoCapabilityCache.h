@@ -0,0 +1,96 @@
+/**
+
+ Appigo Third Party Integration - AppigoCapabilityCache.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoCapabilityCache.h
+ @brief Remembers which Appigo apps can be launched.
+
+ @class AppigoCapabilityCache AppigoCapabilityCache.h
+ @brief Remembers which Appigo apps can be launched.
+
+ Checking whether an Appigo app is installed means asking UIApplication's
+ canOpenURL: about its URL scheme, which is a round trip to another process.
+ The cache asks once per scheme and keeps the answer until an app is
+ installed or removed (the com.apple.mobile.application_installed and
+ com.apple.mobile.application_uninstalled notifications) or until the app
+ returns to the foreground, after which the next check asks again.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+
+/**
+ The capabilities tracked by the cache, one per URL scheme.
+ */
+typedef enum
+{
+	AppigoCapabilityTodo = 0,	///< appigotodo://
+	AppigoCapabilityTodoV2,		///< appigotodov2://, Todo with @2x graphics support
+	AppigoCapabilityNotebook,	///< appigonotebook://
+	AppigoCapabilityCount
+} AppigoCapability;
+
+
+/**
+ Posted on the main thread after the cache was invalidated because an app
+ was installed or removed. The object is the cache.
+ */
+extern NSString *const AppigoCapabilityCacheApplicationsDidChangeNotification;
+
+
+#pragma mark -
+@interface AppigoCapabilityCache : NSObject
+{
+@private
+	int8_t		_states[AppigoCapabilityCount];
+	NSUInteger	_generation;
+
+	NSUInteger	_hitCount;
+	NSUInteger	_missCount;
+	NSUInteger	_invalidationCount;
+}
+
+/** The number of checks answered from the cache. */
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/** The number of checks that had to call canOpenURL:. */
+@property (nonatomic, readonly) NSUInteger missCount;
+
+/** The number of times the cache was invalidated. */
+@property (nonatomic, readonly) NSUInteger invalidationCount;
+
+
+/**
+ Get the shared capability cache.
+
+ @return Returns the shared capability cache.
+ */
++ (AppigoCapabilityCache *)sharedCache;
+
+/**
+ Check whether the app handling a capability's URL scheme is installed.
+
+ @param capability The capability to check.
+ @return Returns YES if the URL scheme can be opened.
+ */
+- (BOOL)isAvailable:(AppigoCapability)capability;
+
+/**
+ Forget all cached answers so that the next checks call canOpenURL: again.
+ */
+- (void)invalidate;
+
+/**
+ Reset all of the counters to zero.
+ */
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,193 @@
+/**
+
+ Appigo Third Party Integration - AppigoCapabilityCache.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoCapabilityCache.h"
+
+
+// Posted when apps are installed or removed
+#define kAppigoApplicationInstalledNotification		CFSTR("com.apple.mobile.application_installed")
+#define kAppigoApplicationUninstalledNotification	CFSTR("com.apple.mobile.application_uninstalled")
+
+// Cached states
+#define kAppigoCapabilityUnknown		0
+#define kAppigoCapabilityAvailable		1
+#define kAppigoCapabilityUnavailable	2
+
+
+NSString *const AppigoCapabilityCacheApplicationsDidChangeNotification = @"AppigoCapabilityCacheApplicationsDidChangeNotification";
+
+
+static AppigoCapabilityCache *_sharedCache = nil;
+
+static NSString *const _capabilityURLStrings[AppigoCapabilityCount] = {
+	@"appigotodo://",
+	@"appigotodov2://",
+	@"appigonotebook://"
+};
+
+
+#pragma mark -
+@interface AppigoCapabilityCache (Private)
+
+- (void)_applicationsDidChange;
+- (void)_applicationWillEnterForeground:(NSNotification *)notification;
+
+@end
+
+
+static void AppigoCapabilityCacheApplicationsChanged(CFNotificationCenterRef center, void *observer, CFStringRef name, const void *object, CFDictionaryRef userInfo)
+{
+	[(AppigoCapabilityCache *)observer _applicationsDidChange];
+}
+
+
+#pragma mark -
+@implementation AppigoCapabilityCache
+
+
+@synthesize hitCount = _hitCount;
+@synthesize missCount = _missCount;
+@synthesize invalidationCount = _invalidationCount;
+
+
++ (AppigoCapabilityCache *)sharedCache
+{
+	@synchronized(self)
+	{
+		if (_sharedCache == nil)
+			_sharedCache = [[AppigoCapabilityCache alloc] init];
+	}
+
+	return _sharedCache;
+}
+
+
+- (id)init
+{
+	if (self = [super init])
+	{
+		CFNotificationCenterRef darwinCenter = CFNotificationCenterGetDarwinNotifyCenter();
+		CFNotificationCenterAddObserver(darwinCenter, self, AppigoCapabilityCacheApplicationsChanged, kAppigoApplicationInstalledNotification, NULL, CFNotificationSuspensionBehaviorDeliverImmediately);
+		CFNotificationCenterAddObserver(darwinCenter, self, AppigoCapabilityCacheApplicationsChanged, kAppigoApplicationUninstalledNotification, NULL, CFNotificationSuspensionBehaviorDeliverImmediately);
+
+		// Apps can not be notified while they are suspended, so anything
+		// may have changed by the time they come back
+		[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(_applicationWillEnterForeground:) name:UIApplicationWillEnterForegroundNotification object:nil];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	CFNotificationCenterRemoveEveryObserver(CFNotificationCenterGetDarwinNotifyCenter(), self);
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+
+	[super dealloc];
+}
+
+
+- (BOOL)isAvailable:(AppigoCapability)capability
+{
+	if ( (capability < 0) || (capability >= AppigoCapabilityCount) )
+		return NO;
+
+	NSUInteger generation;
+
+	@synchronized(self)
+	{
+		int8_t state = _states[capability];
+		if (state != kAppigoCapabilityUnknown)
+		{
+			_hitCount++;
+			return (state == kAppigoCapabilityAvailable);
+		}
+
+		_missCount++;
+		generation = _generation;
+	}
+
+	// Ask outside of the lock, two threads missing at once just ask twice
+	NSURL *testURL = [[NSURL alloc] initWithString:_capabilityURLStrings[capability]];
+	BOOL available = [[UIApplication sharedApplication] canOpenURL:testURL];
+	[testURL release];
+
+	// Do not keep the answer if the cache was invalidated in the meantime
+	@synchronized(self)
+	{
+		if (generation == _generation)
+			_states[capability] = (available == YES) ? kAppigoCapabilityAvailable : kAppigoCapabilityUnavailable;
+	}
+
+	return available;
+}
+
+
+- (void)invalidate
+{
+	@synchronized(self)
+	{
+		memset(_states, kAppigoCapabilityUnknown, sizeof(_states));
+		_generation++;
+		_invalidationCount++;
+	}
+}
+
+
+- (void)resetStatistics
+{
+	@synchronized(self)
+	{
+		_hitCount = 0;
+		_missCount = 0;
+		_invalidationCount = 0;
+	}
+}
+
+
+- (NSString *)description
+{
+	@synchronized(self)
+	{
+		return [NSString stringWithFormat:@"<%@: %lu hits, %lu misses, %lu invalidations>",
+				NSStringFromClass([self class]),
+				(unsigned long)_hitCount,
+				(unsigned long)_missCount,
+				(unsigned long)_invalidationCount];
+	}
+}
+
+
+@end
+
+
+#pragma mark -
+
+
+@implementation AppigoCapabilityCache (Private)
+
+
+- (void)_applicationsDidChange
+{
+	[self invalidate];
+
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[[NSNotificationCenter defaultCenter] postNotificationName:AppigoCapabilityCacheApplicationsDidChangeNotification object:self];
+	});
+}
+
+
+- (void)_applicationWillEnterForeground:(NSNotification *)notification
+{
+	[self invalidate];
+}
+
+
+@end
@@ -0,0 +1,56 @@
+/**
+
+ Appigo Third Party Integration - AppigoChecksum.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoChecksum.h
+ @brief Checksums used to detect damaged records and payloads.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host.
+ */
+
+
+#ifndef APPIGO_CHECKSUM_H
+#define APPIGO_CHECKSUM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ Compute the CRC-32 (IEEE 802.3, the zlib polynomial) of a buffer.
+
+ @param crc The CRC of the preceding bytes when checksumming in pieces, 0 to start.
+ @param bytes The bytes to checksum.
+ @param length The number of bytes.
+ @return Returns the updated CRC.
+ */
+uint32_t AppigoCRC32(uint32_t crc, const void *bytes, size_t length);
+
+/**
+ Compute the 64-bit FNV-1a hash of a buffer. Used to find identical content
+ quickly, not to detect damage.
+
+ @param bytes The bytes to hash.
+ @param length The number of bytes.
+ @return Returns the hash.
+ */
+uint64_t AppigoFNV1a64(const void *bytes, size_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,58 @@
+/**
+
+ Appigo Third Party Integration - AppigoCompression.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoCompression.h
+ @brief A fast LZ compressor for large pasteboard payloads.
+
+ Persistent pasteboards are written to disk and copied into every process
+ that reads them, so a note of several megabytes or a big project is slow to
+ hand over. Task and note payloads repeat a lot (keyed archive class names and
+ keys, lists, contexts, and text), and a byte-oriented LZ77 codec in the style
+ of LZ4 removes most of that at a cost far below the pasteboard copy itself.
+
+ A compressed payload is framed so that it can be recognized and checked:
+
+ @code
+ frame := "APLZ", uint32 originalLength, uint32 crc32, sequence *
+ @endcode
+
+ The lengths are little-endian and the checksum is the AppigoCRC32 of the
+ original bytes. The sequences are an AppigoLZ.h block.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+
+/** The length of the frame header. */
+#define kAppigoCompressionHeaderLength	12
+
+
+/**
+ Compress a payload.
+
+ @param data The bytes to compress.
+ @return Returns the framed compressed data, or nil if data is empty, larger
+ than 4 GB, or would not get smaller.
+ */
+NSData *AppigoCompressData(NSData *data);
+
+/**
+ Decompress a framed payload.
+
+ @param data The framed compressed data.
+ @return Returns the original bytes, or nil if data is not a frame, is
+ damaged, or does not match its checksum.
+ */
+NSData *AppigoDecompressData(NSData *data);
+
+/** Returns YES if data starts with a compression frame header. */
+BOOL AppigoDataIsCompressed(NSData *data);
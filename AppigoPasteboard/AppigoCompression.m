@@ -0,0 +1,103 @@
+/**
+
+ Appigo Third Party Integration - AppigoCompression.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoCompression.h"
+#import "AppigoChecksum.h"
+#import "AppigoLZ.h"
+
+
+static const uint8_t kAppigoCompressionMagic[4] = { 'A', 'P', 'L', 'Z' };
+
+
+static inline void AppigoCompressionWriteLittleEndian32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+}
+
+
+static inline uint32_t AppigoCompressionReadLittleEndian32(const uint8_t *bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+NSData *AppigoCompressData(NSData *data)
+{
+	NSUInteger length = [data length];
+	if ( (length == 0) || (length > UINT32_MAX) )
+		return nil;
+
+	// Anything that does not save at least a header's worth is not worth it
+	if (length <= kAppigoCompressionHeaderLength * 2)
+		return nil;
+
+	NSUInteger capacity = length - kAppigoCompressionHeaderLength - 1;
+	NSMutableData *compressed = [NSMutableData dataWithLength:kAppigoCompressionHeaderLength + capacity];
+	if (compressed == nil)
+		return nil;
+
+	uint8_t *bytes = [compressed mutableBytes];
+	NSUInteger compressedLength = AppigoLZEncode([data bytes], length, bytes + kAppigoCompressionHeaderLength, capacity);
+	if (compressedLength == 0)
+		return nil;
+
+	memcpy(bytes, kAppigoCompressionMagic, 4);
+	AppigoCompressionWriteLittleEndian32(bytes + 4, (uint32_t)length);
+	AppigoCompressionWriteLittleEndian32(bytes + 8, AppigoCRC32(0, [data bytes], length));
+
+	[compressed setLength:kAppigoCompressionHeaderLength + compressedLength];
+
+	return compressed;
+}
+
+
+NSData *AppigoDecompressData(NSData *data)
+{
+	if (AppigoDataIsCompressed(data) == NO)
+		return nil;
+
+	const uint8_t *bytes = [data bytes];
+	NSUInteger length = [data length] - kAppigoCompressionHeaderLength;
+	NSUInteger originalLength = AppigoCompressionReadLittleEndian32(bytes + 4);
+	uint32_t checksum = AppigoCompressionReadLittleEndian32(bytes + 8);
+
+	// Refuse to allocate for a length the input could never produce
+	if ( (originalLength == 0) || (originalLength / kAppigoLZMaximumRatio > length) )
+		return nil;
+
+	NSMutableData *original = [NSMutableData dataWithLength:originalLength];
+	if (original == nil)
+		return nil;
+
+	if (AppigoLZDecode(bytes + kAppigoCompressionHeaderLength, length, [original mutableBytes], originalLength) == 0)
+	{
+		NSLog(@"Compressed payload is damaged");
+		return nil;
+	}
+
+	if (AppigoCRC32(0, [original bytes], originalLength) != checksum)
+	{
+		NSLog(@"Compressed payload does not match its checksum");
+		return nil;
+	}
+
+	return original;
+}
+
+
+BOOL AppigoDataIsCompressed(NSData *data)
+{
+	if ([data length] <= kAppigoCompressionHeaderLength)
+		return NO;
+
+	return (memcmp([data bytes], kAppigoCompressionMagic, 4) == 0);
+}
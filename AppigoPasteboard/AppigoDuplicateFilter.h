@@ -0,0 +1,125 @@
+/**
+
+ Appigo Third Party Integration - AppigoDuplicateFilter.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoDuplicateFilter.h
+ @brief Recognizes imports that repeat one that just happened.
+
+ @class AppigoDuplicateFilter AppigoDuplicateFilter.h
+ @brief Recognizes imports that repeat one that just happened.
+
+ A repeated gesture, a double tap or a retry easily imports the same task or
+ note twice in a row, and every import costs a pasteboard write and an app
+ switch. The filter keeps the content hashes of the last
+ kAppigoDuplicateFilterCapacity imports in a ring, and AppigoPasteboard
+ skips an import whose hash was recorded less than window seconds ago.
+ Checking is a scan of the fixed size ring, after hashing the content once.
+ Imports that fail are forgotten again, so they can be retried right away.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+
+@class AppigoNote;
+
+
+/** The number of recent imports remembered, a power of two. */
+#define kAppigoDuplicateFilterCapacity	16
+
+
+/**
+ Hash the content of tasks, including their subtasks, for the filter.
+
+ @param tasks An array of AppigoTask objects.
+ @return Returns the hash.
+ */
+uint64_t AppigoDuplicateFilterHashTasks(NSArray *tasks);
+
+/**
+ Hash the content of a note for the filter.
+
+ @param note The note.
+ @return Returns the hash.
+ */
+uint64_t AppigoDuplicateFilterHashNote(AppigoNote *note);
+
+/**
+ Hash an encoded task, such as the archive of a task template, for the filter.
+ Equal tasks hash differently as AppigoTask objects and as archives.
+
+ @param data The encoded task.
+ @return Returns the hash.
+ */
+uint64_t AppigoDuplicateFilterHashTaskData(NSData *data);
+
+
+#pragma mark -
+@interface AppigoDuplicateFilter : NSObject
+{
+@private
+	uint64_t		_hashes[kAppigoDuplicateFilterCapacity];
+	uint64_t		_times[kAppigoDuplicateFilterCapacity];	// mach_absolute_time(), 0 for an empty slot
+	NSUInteger		_next;
+	NSTimeInterval	_window;
+	uint64_t		_windowTime;								// the window in mach_absolute_time() units
+
+	NSUInteger		_checkCount;
+	NSUInteger		_suppressedCount;
+}
+
+/**
+ How long, in seconds, an import suppresses identical ones. By default, this
+ is set to 2 seconds. Set to 0 to import every time.
+ */
+@property (nonatomic, assign) NSTimeInterval window;
+
+/** The number of imports checked. */
+@property (nonatomic, readonly) NSUInteger checkCount;
+
+/** The number of imports suppressed as duplicates. */
+@property (nonatomic, readonly) NSUInteger suppressedCount;
+
+
+/**
+ Get the shared duplicate filter.
+
+ @return Returns the shared duplicate filter.
+ */
++ (AppigoDuplicateFilter *)sharedFilter;
+
+/**
+ Check an import against the recent ones. An import that is not a duplicate
+ is recorded.
+
+ @param hash The content hash of the import.
+ @return Returns YES if the same content was imported within the window, in
+ which case the import should be skipped.
+ */
+- (BOOL)isDuplicateImportWithHash:(uint64_t)hash;
+
+/**
+ Forget an import that failed, so that it is not taken for a duplicate.
+
+ @param hash The content hash of the import.
+ */
+- (void)forgetImportWithHash:(uint64_t)hash;
+
+/**
+ Forget all recent imports.
+ */
+- (void)removeAllImports;
+
+/**
+ Reset all of the counters to zero.
+ */
+- (void)resetStatistics;
+
+@end
@@ -0,0 +1,200 @@
+/**
+
+ Appigo Third Party Integration - AppigoDuplicateFilter.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoDuplicateFilter.h"
+#import "AppigoChecksum.h"
+#import "AppigoTaskDelta.h"
+#import "AppigoNote.h"
+
+#include <mach/mach_time.h>
+
+
+#define kAppigoDuplicateFilterMask			(kAppigoDuplicateFilterCapacity - 1)
+#define kAppigoDuplicateFilterDefaultWindow	2.0
+
+// Keep tasks, notes and encoded tasks apart
+#define kAppigoDuplicateFilterKindTasks		1
+#define kAppigoDuplicateFilterKindNote		2
+#define kAppigoDuplicateFilterKindTaskData	3
+
+
+static AppigoDuplicateFilter *_sharedFilter = nil;
+
+
+static uint64_t AppigoDuplicateFilterHashString(NSString *string)
+{
+	const char *utf8 = [string UTF8String];
+	if (utf8 == NULL)
+		return 0;
+
+	return AppigoFNV1a64(utf8, strlen(utf8));
+}
+
+
+uint64_t AppigoDuplicateFilterHashTasks(NSArray *tasks)
+{
+	uint64_t hash = kAppigoDuplicateFilterKindTasks;
+	for (AppigoTask *task in tasks)
+	{
+		AppigoTaskSnapshot *snapshot = [[AppigoTaskSnapshot alloc] initWithTask:task];
+		uint64_t parts[2] = { hash, snapshot.fingerprint };
+		[snapshot release];
+
+		hash = AppigoFNV1a64(parts, sizeof(parts));
+	}
+
+	return hash;
+}
+
+
+uint64_t AppigoDuplicateFilterHashNote(AppigoNote *note)
+{
+	// Hash the data a note was created from rather than creating its text
+	NSData *textData = note.textData;
+	uint64_t parts[4] = {
+		kAppigoDuplicateFilterKindNote,
+		AppigoDuplicateFilterHashString(note.name),
+		AppigoDuplicateFilterHashString(note.notebook),
+		(textData != nil) ? AppigoFNV1a64([textData bytes], [textData length]) : AppigoDuplicateFilterHashString(note.text)
+	};
+
+	return AppigoFNV1a64(parts, sizeof(parts));
+}
+
+
+uint64_t AppigoDuplicateFilterHashTaskData(NSData *data)
+{
+	uint64_t parts[2] = { kAppigoDuplicateFilterKindTaskData, AppigoFNV1a64([data bytes], [data length]) };
+
+	return AppigoFNV1a64(parts, sizeof(parts));
+}
+
+
+#pragma mark -
+@implementation AppigoDuplicateFilter
+
+
+@synthesize window = _window;
+@synthesize checkCount = _checkCount;
+@synthesize suppressedCount = _suppressedCount;
+
+
++ (AppigoDuplicateFilter *)sharedFilter
+{
+	@synchronized(self)
+	{
+		if (_sharedFilter == nil)
+			_sharedFilter = [[AppigoDuplicateFilter alloc] init];
+	}
+
+	return _sharedFilter;
+}
+
+
+- (id)init
+{
+	if (self = [super init])
+	{
+		self.window = kAppigoDuplicateFilterDefaultWindow;
+	}
+
+	return self;
+}
+
+
+- (void)setWindow:(NSTimeInterval)window
+{
+	mach_timebase_info_data_t timebase;
+	mach_timebase_info(&timebase);
+
+	@synchronized(self)
+	{
+		_window = (window > 0.0) ? window : 0.0;
+		_windowTime = (uint64_t)(_window * NSEC_PER_SEC * timebase.denom / timebase.numer);
+	}
+}
+
+
+- (BOOL)isDuplicateImportWithHash:(uint64_t)hash
+{
+	uint64_t now = mach_absolute_time();
+
+	@synchronized(self)
+	{
+		if (_windowTime == 0)
+			return NO;
+
+		_checkCount++;
+
+		for (NSUInteger i = 0; i < kAppigoDuplicateFilterCapacity; i++)
+		{
+			if ( (_times[i] != 0) && (_hashes[i] == hash) && (now - _times[i] < _windowTime) )
+			{
+				_suppressedCount++;
+				return YES;
+			}
+		}
+
+		// The original import keeps its time, so a steady stream of repeats
+		// is only suppressed for one window
+		NSUInteger slot = _next++ & kAppigoDuplicateFilterMask;
+		_hashes[slot] = hash;
+		_times[slot] = now;
+	}
+
+	return NO;
+}
+
+
+- (void)forgetImportWithHash:(uint64_t)hash
+{
+	@synchronized(self)
+	{
+		for (NSUInteger i = 0; i < kAppigoDuplicateFilterCapacity; i++)
+		{
+			if (_hashes[i] == hash)
+				_times[i] = 0;
+		}
+	}
+}
+
+
+- (void)removeAllImports
+{
+	@synchronized(self)
+	{
+		memset(_times, 0, sizeof(_times));
+	}
+}
+
+
+- (void)resetStatistics
+{
+	@synchronized(self)
+	{
+		_checkCount = 0;
+		_suppressedCount = 0;
+	}
+}
+
+
+- (NSString *)description
+{
+	@synchronized(self)
+	{
+		return [NSString stringWithFormat:@"<%@: %.1f second window, %lu checked, %lu suppressed>",
+				NSStringFromClass([self class]),
+				_window,
+				(unsigned long)_checkCount,
+				(unsigned long)_suppressedCount];
+	}
+}
+
+
+@end
@@ -0,0 +1,52 @@
+/**
+
+ Appigo Third Party Integration - AppigoImageCoding.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoImageCoding.h
+ @brief Encodes action images to PNG once per image.
+
+ UIImagePNGRepresentation() compresses the whole image every time it is
+ called. The PNG data of an action image is remembered on the UIImage itself,
+ so validating an image, archiving it and archiving every subtask that shares
+ it all reuse the same bytes. Because every task sharing an image also shares
+ the same NSData instance, NSKeyedArchiver stores that image only once per
+ archive.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+
+/**
+ Get the PNG representation of an image, encoding it only the first time.
+
+ @param image The image.
+ @return Returns the PNG data, or nil if image is nil or can not be encoded.
+ */
+NSData *AppigoImagePNGRepresentation(UIImage *image);
+
+/**
+ Create an image from PNG data. The data is remembered as the image's PNG
+ representation so that it is not encoded again.
+
+ @param data The PNG data.
+ @return Returns the image, or nil if data is not a valid image.
+ */
+UIImage *AppigoImageWithPNGData(NSData *data);
+
+/**
+ Create an image from PNG data decoded by a coder. Every object reference to
+ the same data within one archive results in the same UIImage instance.
+
+ @param data The PNG data.
+ @param aDecoder The decoder that returned data.
+ @return Returns the image, or nil if data is not a valid image.
+ */
+UIImage *AppigoImageWithPNGDataFromCoder(NSData *data, NSCoder *aDecoder);
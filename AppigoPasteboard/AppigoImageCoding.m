@@ -0,0 +1,78 @@
+/**
+
+ Appigo Third Party Integration - AppigoImageCoding.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoImageCoding.h"
+
+#include <objc/runtime.h>
+
+
+// Keys for associated objects, only their addresses matter
+static char _pngRepresentationKey;
+static char _decodedImagesKey;
+
+
+NSData *AppigoImagePNGRepresentation(UIImage *image)
+{
+	if (image == nil)
+		return nil;
+
+	NSData *data = objc_getAssociatedObject(image, &_pngRepresentationKey);
+	if (data == nil)
+	{
+		data = UIImagePNGRepresentation(image);
+		if (data != nil)
+			objc_setAssociatedObject(image, &_pngRepresentationKey, data, OBJC_ASSOCIATION_RETAIN);
+	}
+
+	return data;
+}
+
+
+UIImage *AppigoImageWithPNGData(NSData *data)
+{
+	if (data == nil)
+		return nil;
+
+	UIImage *image = [UIImage imageWithData:data];
+	if (image != nil)
+		objc_setAssociatedObject(image, &_pngRepresentationKey, data, OBJC_ASSOCIATION_RETAIN);
+
+	return image;
+}
+
+
+UIImage *AppigoImageWithPNGDataFromCoder(NSData *data, NSCoder *aDecoder)
+{
+	if (data == nil)
+		return nil;
+
+	if (aDecoder == nil)
+		return AppigoImageWithPNGData(data);
+
+	// Keyed archives return the same NSData instance for every reference to
+	// it, and the decoder keeps that instance alive while it decodes, so the
+	// instance's address identifies the image for the lifetime of the decoder.
+	NSMutableDictionary *decodedImages = objc_getAssociatedObject(aDecoder, &_decodedImagesKey);
+	if (decodedImages == nil)
+	{
+		decodedImages = [NSMutableDictionary dictionary];
+		objc_setAssociatedObject(aDecoder, &_decodedImagesKey, decodedImages, OBJC_ASSOCIATION_RETAIN);
+	}
+
+	NSValue *key = [NSValue valueWithNonretainedObject:data];
+	UIImage *image = [decodedImages objectForKey:key];
+	if (image == nil)
+	{
+		image = AppigoImageWithPNGData(data);
+		if (image != nil)
+			[decodedImages setObject:image forKey:key];
+	}
+
+	return image;
+}
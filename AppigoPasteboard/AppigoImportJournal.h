@@ -0,0 +1,133 @@
+/**
+
+ Appigo Third Party Integration - AppigoImportJournal.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoImportJournal.h
+ @brief Keeps tasks that could not be imported until Todo can take them.
+
+ @class AppigoImportJournal AppigoImportJournal.h
+ @brief Keeps tasks that could not be imported until Todo can take them.
+
+ When openTodoWithTask: or openTodoWithTasks: can not launch Todo, the tasks
+ are appended to the journal instead of being dropped. The next import that
+ does launch Todo carries every pending task along in the same batch, so the
+ tasks arrive together with a single app switch. Call replay to send the
+ pending tasks on their own. The shared journal replays by itself when an
+ app is installed and isTodoInstalled then returns YES.
+
+ The journal is an append-only memory mapped file. Every record is a binary
+ encoded task (see AppigoBinaryCoding.h) preceded by its length and CRC-32,
+ and is synced to disk before appendTasks: returns. When the journal is
+ opened, records are read until the first one that is missing or damaged, so
+ a record cut short by a crash is dropped. The file header remembers how far
+ the journal has been imported. Once most of the file has been imported, it
+ is compacted on a background queue into a new file that replaces the old
+ one atomically.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "AppigoTask.h"
+
+
+/**
+ A position in the journal, used to mark exactly the tasks that were
+ imported as done. Checkpoints stay valid when the journal is compacted, 0 is
+ never a checkpoint.
+ */
+typedef uint64_t AppigoImportJournalCheckpoint;
+
+
+#pragma mark -
+@interface AppigoImportJournal : NSObject
+{
+@private
+	NSString			*_path;
+	dispatch_queue_t	_queue;
+
+	int					_fileDescriptor;
+	uint8_t				*_map;
+	size_t				_capacity;
+	size_t				_end;
+	NSUInteger			_pendingCount;
+
+	uint64_t			_compactedLength;		// bytes dropped by compaction since the file was opened
+	uint64_t			_outstandingCheckpoint;	// returned, but not yet marked or released, 0 for none
+}
+
+/** The path of the journal file. */
+@property (nonatomic, readonly) NSString *path;
+
+/** The number of tasks waiting to be imported. */
+@property (nonatomic, readonly) NSUInteger pendingTaskCount;
+
+
+/**
+ Get the shared journal, stored in the app's Library directory.
+
+ @return Returns the shared journal.
+ */
++ (AppigoImportJournal *)sharedJournal;
+
+/**
+ Open or create a journal file.
+
+ @param path The path of the journal file.
+ @return Returns nil if the file could not be opened or mapped.
+ */
+- (id)initWithPath:(NSString *)path;
+
+/**
+ Append tasks to the journal. The tasks are on disk when this returns.
+
+ @param tasks An array of AppigoTask objects.
+ @return Returns NO if the tasks could not be written.
+ */
+- (BOOL)appendTasks:(NSArray *)tasks;
+
+/**
+ Get the tasks waiting to be imported, oldest first. Until the checkpoint is
+ passed to markImportedThroughCheckpoint: or releaseCheckpoint:, the tasks
+ are not returned again, so two imports in flight never both carry them.
+
+ @param checkpoint Receives the position after the last returned task, or 0 if
+ no tasks are returned. Pass it to markImportedThroughCheckpoint: once the
+ tasks were imported, or to releaseCheckpoint: if they were not.
+ @return Returns an array of AppigoTask objects, empty if nothing is pending
+ or the pending tasks go along with another import.
+ */
+- (NSArray *)pendingTasksWithCheckpoint:(AppigoImportJournalCheckpoint *)checkpoint;
+
+/**
+ Mark the tasks returned with a checkpoint as imported. Tasks appended after
+ the checkpoint stay pending.
+
+ @param checkpoint A checkpoint returned by pendingTasksWithCheckpoint:.
+ */
+- (void)markImportedThroughCheckpoint:(AppigoImportJournalCheckpoint)checkpoint;
+
+/**
+ Give back the tasks returned with a checkpoint that could not be imported.
+ They stay pending, and the next import carries them.
+
+ @param checkpoint A checkpoint returned by pendingTasksWithCheckpoint:.
+ */
+- (void)releaseCheckpoint:(AppigoImportJournalCheckpoint)checkpoint;
+
+/**
+ Import all pending tasks into Todo as a single batch.
+
+ @return Returns NO if nothing was pending or Todo could not be launched. The
+ tasks stay in the journal in that case.
+ */
+- (BOOL)replay;
+
+@end
@@ -0,0 +1,567 @@
+/**
+
+ Appigo Third Party Integration - AppigoImportJournal.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoImportJournal.h"
+#import "AppigoPasteboard.h"
+#import "AppigoBinaryCoding.h"
+#import "AppigoCapabilityCache.h"
+#import "AppigoChecksum.h"
+#import "AppigoStringPool.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+// File header: magic, version and the offset of the first record that was
+// not imported yet
+#define kAppigoImportJournalMagic			"APGJ"
+#define kAppigoImportJournalVersion			1
+#define kAppigoImportJournalHeaderLength	16
+#define kAppigoImportJournalOffsetPosition	8
+
+// Every record starts with its payload length and the CRC-32 of the payload
+#define kAppigoImportJournalRecordHeader	8
+
+// The file grows in steps of this size
+#define kAppigoImportJournalGrowth			(64 * 1024)
+
+#define kAppigoImportJournalFileName		@"com.appigo.import-journal"
+
+
+static AppigoImportJournal *_sharedJournal = nil;
+
+
+#pragma mark -
+@interface AppigoPasteboard (Private)
+
++ (BOOL)_openTodoWithTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal;
+
+@end
+
+
+#pragma mark -
+@interface AppigoImportJournal (Private)
+
+- (BOOL)_mapFileWithCapacity:(size_t)capacity;
+- (void)_unmapFile;
+- (BOOL)_ensureCapacity:(size_t)capacity;
+- (void)_syncBytesAtOffset:(size_t)offset length:(size_t)length;
+- (size_t)_importedOffset;
+- (void)_setImportedOffset:(size_t)offset;
+- (size_t)_offsetOfCheckpoint:(AppigoImportJournalCheckpoint)checkpoint;
+- (size_t)_lengthOfRecordAtOffset:(size_t)offset;
+- (void)_scanRecords;
+- (void)_compactIfNeeded;
+- (void)_applicationsDidChange:(NSNotification *)notification;
+
+@end
+
+
+static inline uint32_t AppigoImportJournalReadUInt32(const uint8_t *bytes)
+{
+	return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+static inline void AppigoImportJournalWriteUInt32(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+}
+
+
+#pragma mark -
+@implementation AppigoImportJournal
+
+
+@synthesize path = _path;
+
+
++ (AppigoImportJournal *)sharedJournal
+{
+	@synchronized(self)
+	{
+		if (_sharedJournal == nil)
+		{
+			NSString *libraryPath = [NSSearchPathForDirectoriesInDomains(NSLibraryDirectory, NSUserDomainMask, YES) lastObject];
+			_sharedJournal = [[AppigoImportJournal alloc] initWithPath:[libraryPath stringByAppendingPathComponent:kAppigoImportJournalFileName]];
+
+			// Replay as soon as Todo is installed, rather than waiting for the next import
+			[[NSNotificationCenter defaultCenter] addObserver:_sharedJournal selector:@selector(_applicationsDidChange:) name:AppigoCapabilityCacheApplicationsDidChangeNotification object:nil];
+			[AppigoCapabilityCache sharedCache];
+		}
+	}
+
+	return _sharedJournal;
+}
+
+
+- (id)initWithPath:(NSString *)path
+{
+	if (self = [super init])
+	{
+		_path = [path copy];
+		_queue = dispatch_queue_create("com.appigo.import-journal", DISPATCH_QUEUE_SERIAL);
+		_fileDescriptor = -1;
+
+		if ([self _mapFileWithCapacity:0] == NO)
+		{
+			[self release];
+			return nil;
+		}
+
+		[self _scanRecords];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	[self _unmapFile];
+
+	if (_queue != NULL)
+		dispatch_release(_queue);
+
+	[_path release];
+
+	[super dealloc];
+}
+
+
+- (NSUInteger)pendingTaskCount
+{
+	__block NSUInteger count;
+
+	dispatch_sync(_queue, ^{
+		count = _pendingCount;
+	});
+
+	return count;
+}
+
+
+- (BOOL)appendTasks:(NSArray *)tasks
+{
+	if ([tasks count] == 0)
+		return YES;
+
+	// Encode outside of the queue, only the copy into the file is serialized
+	NSMutableArray *records = [NSMutableArray arrayWithCapacity:[tasks count]];
+	size_t totalLength = 0;
+	for (AppigoTask *task in tasks)
+	{
+		NSData *record = [task binaryRepresentation];
+		if ( (record == nil) || ([record length] > UINT32_MAX) )
+			continue;
+
+		[records addObject:record];
+		totalLength += kAppigoImportJournalRecordHeader + [record length];
+	}
+
+	__block BOOL result = NO;
+
+	dispatch_sync(_queue, ^{
+		// Leave room for the zero length that terminates the records
+		if ([self _ensureCapacity:_end + totalLength + sizeof(uint32_t)] == NO)
+			return;
+
+		size_t start = _end;
+		uint8_t *cursor = _map + _end;
+
+		for (NSData *record in records)
+		{
+			uint32_t length = (uint32_t)[record length];
+
+			AppigoImportJournalWriteUInt32(cursor, length);
+			AppigoImportJournalWriteUInt32(cursor + 4, AppigoCRC32(0, [record bytes], length));
+			memcpy(cursor + kAppigoImportJournalRecordHeader, [record bytes], length);
+
+			cursor += kAppigoImportJournalRecordHeader + length;
+		}
+
+		// A damaged record left behind by a crash may follow, cut it off
+		AppigoImportJournalWriteUInt32(cursor, 0);
+
+		_end = (size_t)(cursor - _map);
+		_pendingCount += [records count];
+
+		[self _syncBytesAtOffset:start length:_end - start + sizeof(uint32_t)];
+		result = YES;
+	});
+
+	return result;
+}
+
+
+- (NSArray *)pendingTasksWithCheckpoint:(AppigoImportJournalCheckpoint *)checkpoint
+{
+	NSMutableArray *tasks = [NSMutableArray array];
+	__block AppigoImportJournalCheckpoint end = 0;
+
+	dispatch_sync(_queue, ^{
+		// The pending tasks already go along with an import in flight
+		if (_outstandingCheckpoint != 0)
+			return;
+
+		size_t offset = [self _importedOffset];
+
+		// Pending tasks usually share their lists, contexts and tags
+		AppigoStringPool *strings = [[AppigoStringPool alloc] init];
+		[strings activate];
+
+		while (offset < _end)
+		{
+			size_t length = [self _lengthOfRecordAtOffset:offset];
+			if (length == 0)
+				break;
+
+			NSData *record = [[NSData alloc] initWithBytesNoCopy:(_map + offset + kAppigoImportJournalRecordHeader) length:length freeWhenDone:NO];
+
+			AppigoTask *task = [[AppigoTask alloc] initWithBinaryData:record];
+			if (task != nil)
+				[tasks addObject:task];
+
+			[task release];
+			[record release];
+
+			offset += kAppigoImportJournalRecordHeader + length;
+		}
+
+		[strings deactivate];
+		[strings release];
+
+		if (offset > [self _importedOffset])
+		{
+			end = _compactedLength + offset;
+			_outstandingCheckpoint = end;
+		}
+	});
+
+	if (checkpoint != NULL)
+		*checkpoint = end;
+
+	return tasks;
+}
+
+
+- (void)markImportedThroughCheckpoint:(AppigoImportJournalCheckpoint)checkpoint
+{
+	if (checkpoint == 0)
+		return;
+
+	dispatch_sync(_queue, ^{
+		if (checkpoint == _outstandingCheckpoint)
+			_outstandingCheckpoint = 0;
+
+		size_t offset = [self _importedOffset];
+		size_t end = [self _offsetOfCheckpoint:checkpoint];
+		if ( (end <= offset) || (end > _end) )
+			return;
+
+		// Count the records being marked so pendingTaskCount stays exact, and
+		// only accept a checkpoint that falls between two records
+		NSUInteger count = 0;
+		while (offset < end)
+		{
+			size_t length = [self _lengthOfRecordAtOffset:offset];
+			if (length == 0)
+				break;
+
+			offset += kAppigoImportJournalRecordHeader + length;
+			count++;
+		}
+
+		if (offset != end)
+		{
+			NSLog(@"Ignoring an import journal checkpoint that does not end a record: %llu", (unsigned long long)checkpoint);
+			return;
+		}
+
+		[self _setImportedOffset:end];
+		_pendingCount -= MIN(count, _pendingCount);
+	});
+
+	dispatch_async(_queue, ^{
+		[self _compactIfNeeded];
+	});
+}
+
+
+- (void)releaseCheckpoint:(AppigoImportJournalCheckpoint)checkpoint
+{
+	if (checkpoint == 0)
+		return;
+
+	dispatch_sync(_queue, ^{
+		if (checkpoint == _outstandingCheckpoint)
+			_outstandingCheckpoint = 0;
+	});
+}
+
+
+- (BOOL)replay
+{
+	AppigoImportJournalCheckpoint checkpoint;
+	NSArray *tasks = [self pendingTasksWithCheckpoint:&checkpoint];
+	if ([tasks count] == 0)
+		return NO;
+
+	if ([AppigoPasteboard _openTodoWithTasks:tasks fromJournal:YES] == NO)
+	{
+		[self releaseCheckpoint:checkpoint];
+		return NO;
+	}
+
+	[self markImportedThroughCheckpoint:checkpoint];
+	return YES;
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %@, %lu pending>", NSStringFromClass([self class]), _path, (unsigned long)[self pendingTaskCount]];
+}
+
+
+@end
+
+
+#pragma mark -
+
+
+@implementation AppigoImportJournal (Private)
+
+
+- (BOOL)_mapFileWithCapacity:(size_t)capacity
+{
+	if (_fileDescriptor < 0)
+	{
+		_fileDescriptor = open([_path fileSystemRepresentation], O_RDWR | O_CREAT, 0644);
+		if (_fileDescriptor < 0)
+			return NO;
+	}
+
+	struct stat fileStatus;
+	if (fstat(_fileDescriptor, &fileStatus) != 0)
+		return NO;
+
+	BOOL isNewFile = (fileStatus.st_size < kAppigoImportJournalHeaderLength);
+	size_t fileSize = isNewFile ? 0 : (size_t)fileStatus.st_size;
+
+	if (capacity < fileSize)
+		capacity = fileSize;
+	if (capacity < kAppigoImportJournalGrowth)
+		capacity = kAppigoImportJournalGrowth;
+
+	if ( (capacity > fileSize) && (ftruncate(_fileDescriptor, (off_t)capacity) != 0) )
+		return NO;
+
+	void *map = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fileDescriptor, 0);
+	if (map == MAP_FAILED)
+		return NO;
+
+	_map = map;
+	_capacity = capacity;
+
+	if ( (isNewFile == YES) || (memcmp(_map, kAppigoImportJournalMagic, 4) != 0) )
+	{
+		memset(_map, 0, kAppigoImportJournalHeaderLength + sizeof(uint32_t));
+		memcpy(_map, kAppigoImportJournalMagic, 4);
+		AppigoImportJournalWriteUInt32(_map + 4, kAppigoImportJournalVersion);
+		[self _setImportedOffset:kAppigoImportJournalHeaderLength];
+	}
+
+	return YES;
+}
+
+
+- (void)_unmapFile
+{
+	if (_map != NULL)
+	{
+		munmap(_map, _capacity);
+		_map = NULL;
+		_capacity = 0;
+	}
+
+	if (_fileDescriptor >= 0)
+	{
+		close(_fileDescriptor);
+		_fileDescriptor = -1;
+	}
+}
+
+
+- (BOOL)_ensureCapacity:(size_t)capacity
+{
+	if (capacity <= _capacity)
+		return YES;
+
+	size_t newCapacity = _capacity * 2;
+	if (newCapacity < capacity)
+		newCapacity = (capacity + kAppigoImportJournalGrowth - 1) / kAppigoImportJournalGrowth * kAppigoImportJournalGrowth;
+
+	// The old mapping stays valid until the new one exists, so a failure
+	// leaves the journal usable at its old size
+	uint8_t *oldMap = _map;
+	size_t oldCapacity = _capacity;
+
+	if ([self _mapFileWithCapacity:newCapacity] == NO)
+		return NO;
+
+	munmap(oldMap, oldCapacity);
+	return YES;
+}
+
+
+- (void)_syncBytesAtOffset:(size_t)offset length:(size_t)length
+{
+	size_t pageSize = (size_t)getpagesize();
+	size_t start = offset / pageSize * pageSize;
+
+	msync(_map + start, MIN(offset + length, _capacity) - start, MS_SYNC);
+}
+
+
+- (size_t)_importedOffset
+{
+	uint64_t offset;
+	memcpy(&offset, _map + kAppigoImportJournalOffsetPosition, sizeof(offset));
+
+	if ( (offset < kAppigoImportJournalHeaderLength) || (offset > _capacity) )
+		return kAppigoImportJournalHeaderLength;
+
+	return (size_t)offset;
+}
+
+
+- (void)_setImportedOffset:(size_t)offset
+{
+	uint64_t value = offset;
+	memcpy(_map + kAppigoImportJournalOffsetPosition, &value, sizeof(value));
+	[self _syncBytesAtOffset:kAppigoImportJournalOffsetPosition length:sizeof(value)];
+}
+
+
+// Checkpoints count from the start of the journal as it was opened, so they
+// still point at the same record after compaction. A checkpoint within the
+// compacted part was imported already.
+- (size_t)_offsetOfCheckpoint:(AppigoImportJournalCheckpoint)checkpoint
+{
+	if (checkpoint < _compactedLength + kAppigoImportJournalHeaderLength)
+		return kAppigoImportJournalHeaderLength;
+
+	return (size_t)(checkpoint - _compactedLength);
+}
+
+
+// Returns 0 unless a whole record starts at offset, before the end of the
+// intact records
+- (size_t)_lengthOfRecordAtOffset:(size_t)offset
+{
+	if ( (offset > _end) || (_end - offset < kAppigoImportJournalRecordHeader) )
+		return 0;
+
+	size_t length = AppigoImportJournalReadUInt32(_map + offset);
+	if (length > _end - offset - kAppigoImportJournalRecordHeader)
+		return 0;
+
+	return length;
+}
+
+
+// Find the end of the intact records and count the pending ones
+- (void)_scanRecords
+{
+	size_t importedOffset = [self _importedOffset];
+	size_t offset = kAppigoImportJournalHeaderLength;
+	NSUInteger pendingCount = 0;
+
+	while (offset + kAppigoImportJournalRecordHeader <= _capacity)
+	{
+		uint32_t length = AppigoImportJournalReadUInt32(_map + offset);
+		if ( (length == 0) || (length > _capacity - offset - kAppigoImportJournalRecordHeader) )
+			break;
+
+		uint32_t checksum = AppigoImportJournalReadUInt32(_map + offset + 4);
+		if (AppigoCRC32(0, _map + offset + kAppigoImportJournalRecordHeader, length) != checksum)
+			break;
+
+		if (offset >= importedOffset)
+			pendingCount++;
+
+		offset += kAppigoImportJournalRecordHeader + length;
+	}
+
+	_end = offset;
+	_pendingCount = pendingCount;
+
+	// The imported offset can never be past the intact records
+	if (importedOffset > _end)
+		[self _setImportedOffset:_end];
+}
+
+
+// Rewrite the journal without the imported records once they take up most
+// of it. Runs on the journal queue.
+- (void)_compactIfNeeded
+{
+	size_t importedOffset = [self _importedOffset];
+	size_t importedLength = importedOffset - kAppigoImportJournalHeaderLength;
+	size_t pendingLength = _end - importedOffset;
+
+	if ( (importedLength == 0) || (importedLength < pendingLength) )
+		return;
+
+	NSString *temporaryPath = [_path stringByAppendingString:@".compact"];
+	int fileDescriptor = open([temporaryPath fileSystemRepresentation], O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fileDescriptor < 0)
+		return;
+
+	uint8_t header[kAppigoImportJournalHeaderLength];
+	memcpy(header, _map, kAppigoImportJournalHeaderLength);
+	uint64_t offset = kAppigoImportJournalHeaderLength;
+	memcpy(header + kAppigoImportJournalOffsetPosition, &offset, sizeof(offset));
+
+	uint32_t terminator = 0;
+	BOOL written = (write(fileDescriptor, header, sizeof(header)) == (ssize_t)sizeof(header))
+				&& ( (pendingLength == 0) || (write(fileDescriptor, _map + importedOffset, pendingLength) == (ssize_t)pendingLength) )
+				&& (write(fileDescriptor, &terminator, sizeof(terminator)) == (ssize_t)sizeof(terminator))
+				&& (fsync(fileDescriptor) == 0);
+	close(fileDescriptor);
+
+	if ( (written == NO) || (rename([temporaryPath fileSystemRepresentation], [_path fileSystemRepresentation]) != 0) )
+	{
+		unlink([temporaryPath fileSystemRepresentation]);
+		return;
+	}
+
+	// Switch over to the compacted file
+	_compactedLength += importedLength;
+	[self _unmapFile];
+	if ([self _mapFileWithCapacity:0] == YES)
+		[self _scanRecords];
+}
+
+
+- (void)_applicationsDidChange:(NSNotification *)notification
+{
+	if ( ([self pendingTaskCount] > 0) && ([AppigoPasteboard isTodoInstalled] == YES) )
+		[self replay];
+}
+
+
+@end
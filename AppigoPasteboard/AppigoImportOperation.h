@@ -0,0 +1,83 @@
+/**
+
+ Appigo Third Party Integration - AppigoImportOperation.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoImportOperation.h
+ @brief Tracks an asynchronous import.
+
+ @class AppigoImportOperation AppigoImportOperation.h
+ @brief Tracks an asynchronous import.
+
+ openTodoWithTasks:completion: and openNotebookWithNote:completion: encode
+ the import and write the pasteboard on a background serial queue, and only
+ open the import URL on the main thread. They return an operation that can
+ cancel the import until the URL is opened, and that reports how long the
+ import took on the main thread once it finished.
+
+ @code
+ AppigoImportOperation *operation = [AppigoPasteboard openTodoWithTask:task completion:^(BOOL imported) {
+	 NSLog(@"Imported: %d", imported);
+ }];
+ @endcode
+ */
+
+
+#import <Foundation/Foundation.h>
+
+
+/**
+ Called on the main thread when an import finished.
+
+ @param imported YES if the app was launched to import, NO if the import
+ failed or was cancelled.
+ */
+typedef void (^AppigoImportCompletion)(BOOL imported);
+
+
+#pragma mark -
+@interface AppigoImportOperation : NSObject
+{
+@private
+	volatile int32_t		_cancelled;
+	BOOL					_finished;
+	BOOL					_imported;
+	uint64_t				_startTime;
+	NSTimeInterval			_duration;
+	NSTimeInterval			_mainThreadTime;
+	AppigoImportCompletion	_completion;
+}
+
+/** YES once cancel was called. */
+@property (nonatomic, readonly, getter=isCancelled) BOOL cancelled;
+
+/** YES once the import finished and the completion was called. */
+@property (nonatomic, readonly, getter=isFinished) BOOL finished;
+
+/** YES if the import launched the app, valid once finished. */
+@property (nonatomic, readonly) BOOL imported;
+
+/** The time from starting the import until it finished, valid once finished. */
+@property (nonatomic, readonly) NSTimeInterval duration;
+
+/**
+ The time the import spent on the main thread opening the URL, not counting
+ the completion, valid once finished.
+ */
+@property (nonatomic, readonly) NSTimeInterval mainThreadTime;
+
+/**
+ Cancel the import. An import that is still being encoded is abandoned and
+ its pasteboard removed; once the URL was opened, cancel has no effect. A
+ cancelled import still calls its completion, with NO. Safe to call from any
+ thread.
+ */
+- (void)cancel;
+
+@end
@@ -0,0 +1,118 @@
+/**
+
+ Appigo Third Party Integration - AppigoImportOperation.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoImportOperation.h"
+#import "AppigoTrace.h"
+
+#include <libkern/OSAtomic.h>
+#include <mach/mach_time.h>
+
+
+static NSTimeInterval AppigoImportOperationSeconds(uint64_t start, uint64_t end)
+{
+	static mach_timebase_info_data_t timebase;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		mach_timebase_info(&timebase);
+	});
+
+	return (NSTimeInterval)(end - start) * timebase.numer / timebase.denom / NSEC_PER_SEC;
+}
+
+
+@interface AppigoImportOperation (Private)
+
+- (id)_initWithCompletion:(AppigoImportCompletion)completion;
+- (void)_finishImported:(BOOL)imported mainThreadStart:(uint64_t)mainThreadStart;
+
+@end
+
+
+#pragma mark -
+@implementation AppigoImportOperation
+
+
+@synthesize finished = _finished;
+@synthesize imported = _imported;
+@synthesize duration = _duration;
+@synthesize mainThreadTime = _mainThreadTime;
+
+
+- (void)dealloc
+{
+	[_completion release];
+
+	[super dealloc];
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %@, %.1f ms on the main thread, %.1f ms in total>",
+			NSStringFromClass([self class]),
+			(_finished == NO) ? @"running" : ((_imported == YES) ? @"imported" : (([self isCancelled] == YES) ? @"cancelled" : @"failed")),
+			_mainThreadTime * 1000.0,
+			_duration * 1000.0];
+}
+
+
+- (BOOL)isCancelled
+{
+	return (_cancelled != 0);
+}
+
+
+- (void)cancel
+{
+	OSAtomicCompareAndSwap32Barrier(0, 1, &_cancelled);
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoImportOperation (Private)
+
+
+- (id)_initWithCompletion:(AppigoImportCompletion)completion
+{
+	if (self = [super init])
+	{
+		_completion = [completion copy];
+		_startTime = mach_absolute_time();
+	}
+
+	return self;
+}
+
+
+// Called on the main thread once the URL was opened, or the import failed
+// or was cancelled
+- (void)_finishImported:(BOOL)imported mainThreadStart:(uint64_t)mainThreadStart
+{
+	uint64_t end = mach_absolute_time();
+	APPIGO_TRACE_SPAN(AppigoTraceEventImportMainThread, mainThreadStart, imported);
+
+	_imported = imported;
+	_mainThreadTime = AppigoImportOperationSeconds(mainThreadStart, end);
+	_duration = AppigoImportOperationSeconds(_startTime, end);
+	_finished = YES;
+
+	AppigoImportCompletion completion = _completion;
+	_completion = nil;
+
+	if (completion != nil)
+		completion(imported);
+
+	[completion release];
+}
+
+
+@end
@@ -0,0 +1,193 @@
+/**
+
+ Appigo Third Party Integration - AppigoLZ.c
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#include "AppigoLZ.h"
+
+#include <string.h>
+
+
+#define kAppigoLZHashBits		12
+#define kAppigoLZMinimumMatch	4
+#define kAppigoLZEndLiterals	5		// the last bytes are always literals
+#define kAppigoLZMaximumOffset	65535
+
+
+static inline uint32_t AppigoLZRead32(const uint8_t *bytes)
+{
+	uint32_t value;
+	memcpy(&value, bytes, sizeof(value));
+
+	return value;
+}
+
+
+static inline size_t AppigoLZMin(size_t a, size_t b)
+{
+	return (a < b) ? a : b;
+}
+
+
+// Knuth's multiplicative hash of four bytes
+static inline uint32_t AppigoLZHash(uint32_t sequence)
+{
+	return (sequence * 2654435761U) >> (32 - kAppigoLZHashBits);
+}
+
+
+static inline void AppigoLZWriteLength(uint8_t *bytes, size_t *offset, size_t length)
+{
+	while (length >= 255)
+	{
+		bytes[(*offset)++] = 255;
+		length -= 255;
+	}
+
+	bytes[(*offset)++] = (uint8_t)length;
+}
+
+
+// Appends one sequence, returns 0 if it does not fit. A match length of 0
+// writes the final, literals only sequence.
+static int AppigoLZAppendSequence(uint8_t *output, size_t capacity, size_t *offset,
+								  const uint8_t *literals, size_t literalLength,
+								  size_t matchOffset, size_t matchLength)
+{
+	size_t needed = 1 + (literalLength / 255 + 1) + literalLength + 2 + (matchLength / 255 + 1);
+	if (*offset + needed > capacity)
+		return 0;
+
+	size_t matchCode = (matchLength > 0) ? matchLength - kAppigoLZMinimumMatch : 0;
+	output[(*offset)++] = (uint8_t)((AppigoLZMin(literalLength, 15) << 4) | AppigoLZMin(matchCode, 15));
+
+	if (literalLength >= 15)
+		AppigoLZWriteLength(output, offset, literalLength - 15);
+
+	memcpy(output + *offset, literals, literalLength);
+	*offset += literalLength;
+
+	if (matchLength == 0)
+		return 1;
+
+	output[(*offset)++] = (uint8_t)matchOffset;
+	output[(*offset)++] = (uint8_t)(matchOffset >> 8);
+
+	if (matchCode >= 15)
+		AppigoLZWriteLength(output, offset, matchCode - 15);
+
+	return 1;
+}
+
+
+size_t AppigoLZEncode(const uint8_t *input, size_t length, uint8_t *output, size_t capacity)
+{
+	uint32_t table[1 << kAppigoLZHashBits];
+	memset(table, 0, sizeof(table));
+
+	size_t offset = 0;
+	size_t anchor = 0;
+	size_t position = 0;
+	size_t limit = (length > kAppigoLZEndLiterals) ? length - kAppigoLZEndLiterals : 0;
+
+	while (position + kAppigoLZMinimumMatch <= limit)
+	{
+		uint32_t sequence = AppigoLZRead32(input + position);
+		uint32_t hash = AppigoLZHash(sequence);
+		size_t candidate = table[hash];
+		table[hash] = (uint32_t)position;
+
+		if ( (candidate >= position)
+			|| (position - candidate > kAppigoLZMaximumOffset)
+			|| (AppigoLZRead32(input + candidate) != sequence) )
+		{
+			position++;
+			continue;
+		}
+
+		size_t matchLength = kAppigoLZMinimumMatch;
+		while ( (position + matchLength < limit) && (input[candidate + matchLength] == input[position + matchLength]) )
+			matchLength++;
+
+		if (AppigoLZAppendSequence(output, capacity, &offset, input + anchor, position - anchor, position - candidate, matchLength) == 0)
+			return 0;
+
+		position += matchLength;
+		anchor = position;
+	}
+
+	if (AppigoLZAppendSequence(output, capacity, &offset, input + anchor, length - anchor, 0, 0) == 0)
+		return 0;
+
+	return offset;
+}
+
+
+// Reads an extra length, returns 0 if the input ends first
+static inline int AppigoLZReadLength(const uint8_t *input, size_t length, size_t *offset, size_t *value)
+{
+	uint8_t byte;
+	do
+	{
+		if (*offset >= length)
+			return 0;
+
+		byte = input[(*offset)++];
+		*value += byte;
+	} while (byte == 255);
+
+	return 1;
+}
+
+
+int AppigoLZDecode(const uint8_t *input, size_t length, uint8_t *output, size_t outputLength)
+{
+	size_t in = 0;
+	size_t out = 0;
+
+	while (in < length)
+	{
+		uint8_t token = input[in++];
+
+		size_t literalLength = token >> 4;
+		if ( (literalLength == 15) && (AppigoLZReadLength(input, length, &in, &literalLength) == 0) )
+			return 0;
+
+		if ( (literalLength > length - in) || (literalLength > outputLength - out) )
+			return 0;
+
+		memcpy(output + out, input + in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence has no match
+		if (in == length)
+			break;
+
+		if (length - in < 2)
+			return 0;
+
+		size_t matchOffset = (size_t)input[in] | ((size_t)input[in + 1] << 8);
+		in += 2;
+
+		size_t matchLength = token & 0x0F;
+		if ( (matchLength == 15) && (AppigoLZReadLength(input, length, &in, &matchLength) == 0) )
+			return 0;
+		matchLength += kAppigoLZMinimumMatch;
+
+		if ( (matchOffset == 0) || (matchOffset > out) || (matchLength > outputLength - out) )
+			return 0;
+
+		// Matches may overlap the bytes they produce
+		const uint8_t *match = output + out - matchOffset;
+		for (size_t i = 0; i < matchLength; i++)
+			output[out + i] = match[i];
+		out += matchLength;
+	}
+
+	return (out == outputLength);
+}
@@ -0,0 +1,67 @@
+/**
+
+ Appigo Third Party Integration - AppigoLZ.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoLZ.h
+ @brief The LZ77 block codec behind AppigoCompression.h.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host. A block is a run of sequences, each a token byte holding the literal
+ length in its high and the match length minus 4 in its low nibble, extra
+ length bytes for either nibble at 15, the literals, and a 16-bit
+ little-endian match offset. The last sequence holds only literals.
+ */
+
+
+#ifndef APPIGO_LZ_H
+#define APPIGO_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** Every block byte expands to at most this many bytes. */
+#define kAppigoLZMaximumRatio	255
+
+
+/**
+ Compress bytes into a block.
+
+ @param input The bytes to compress, at most 4 GB.
+ @param length The number of bytes.
+ @param output Receives the block.
+ @param capacity The room in output.
+ @return Returns the length of the block, or 0 if it does not fit in capacity.
+ */
+size_t AppigoLZEncode(const uint8_t *input, size_t length, uint8_t *output, size_t capacity);
+
+/**
+ Decompress a block. Never reads or writes outside the buffers, whatever the
+ input holds.
+
+ @param input The block.
+ @param length The length of the block.
+ @param output Receives the original bytes.
+ @param outputLength The exact length of the original bytes.
+ @return Returns 1 if the block decoded to exactly outputLength bytes, 0 if it
+ is damaged.
+ */
+int AppigoLZDecode(const uint8_t *input, size_t length, uint8_t *output, size_t outputLength);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -48,14 +48,27 @@
 	NSString	*name;
 	NSString	*text;
 	NSString	*notebook;
+	
+	NSData		*textData;		// UTF-8 text backing a note without text
+	NSRange		textRange;		// of the trimmed text in textData
 }
 
 /** The name/title of the note. */
 @property (nonatomic, readonly) NSString *name;
 
-/** The note's text which does not include the name. */
+/**
+ The note's text which does not include the name. For a note created from
+ UTF-8 data, a string is created over that data every time text is read, so
+ prefer passing the note around to reading its text.
+ */
 @property (nonatomic, retain) NSString *text;
 
+/**
+ The UTF-8 data the text of the note is read from, or nil if the text was set
+ as a string. Setting text releases the data.
+ */
+@property (nonatomic, readonly) NSData *textData;
+
 /**
  A case-insensitive notebook name that the note belongs to.  If a
  matching notebook is found in Notebook, the note will be placed inside
@@ -74,6 +87,31 @@
  */
 - (id)initWithName:(NSString *)noteName;
 
+/**
+ Initialize a note whose text is UTF-8 data, such as a memory-mapped file.
+ 
+ The data is kept instead of being copied into a string, and it is written in
+ chunks straight into the payloads of binaryRepresentation and the pasteboard,
+ so large notes (logs, transcripts) are not copied several times on the way.
+ Surrounding whitespace of the text is ignored.
+ 
+ @param noteName The note name, see initWithName:.
+ @param data The UTF-8 text. The data must not change while the note uses it.
+ @return Returns nil if data is not valid UTF-8.
+ */
+- (id)initWithName:(NSString *)noteName textUTF8Data:(NSData *)data;
+
+/**
+ Initialize a note whose text is the contents of a UTF-8 file. The file is
+ memory-mapped, so its pages are read when the note is encoded and can be
+ dropped again by the system at any time.
+ 
+ @param noteName The note name, see initWithName:.
+ @param path The path of the file. The file must not change while the note uses it.
+ @return Returns nil if the file can not be read or is not valid UTF-8.
+ */
+- (id)initWithName:(NSString *)noteName textContentsOfFile:(NSString *)path;
+
 /**
  Get a plain text representation of a note.
  
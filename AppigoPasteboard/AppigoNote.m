@@ -27,6 +27,8 @@
 #import "AppigoNote.h"
 
 #import "AppigoTask.h"
+#import "AppigoStringPool.h"
+#import "AppigoStringTrimming.h"
 
 
 #pragma mark Note Properties
@@ -37,13 +39,121 @@
 #define kAppigoNoteNotebookKey			@"com.appigo.note.notebook"				// NSString *
 
 
+// Nothing to free, the data the bytes belong to is released with the
+// allocator's info
+static void *AppigoNoteAllocateNothing(CFIndex size, CFOptionFlags hint, void *info)
+{
+	return NULL;
+}
+
+
+static void AppigoNoteDeallocateNothing(void *pointer, void *info)
+{
+}
+
+
+// Creates a string over UTF-8 bytes of data that keeps the data alive for as
+// long as it needs the bytes. ASCII text is not copied at all.
+static NSString *AppigoNoteCopyStringWithData(NSData *data, NSRange range)
+{
+	if (range.length == 0)
+		return [[NSString alloc] init];
+
+	CFAllocatorContext context = { 0, data, CFRetain, CFRelease, NULL, AppigoNoteAllocateNothing, NULL, AppigoNoteDeallocateNothing, NULL };
+	CFAllocatorRef deallocator = CFAllocatorCreate(kCFAllocatorDefault, &context);
+
+	CFStringRef string = CFStringCreateWithBytesNoCopy(kCFAllocatorDefault,
+													   (const UInt8 *)[data bytes] + range.location,
+													   (CFIndex)range.length,
+													   kCFStringEncodingUTF8,
+													   false,
+													   deallocator);
+	CFRelease(deallocator);
+
+	return (NSString *)string;
+}
+
+
+static BOOL AppigoNoteIsValidUTF8(const uint8_t *bytes, NSUInteger length)
+{
+	NSUInteger i = 0;
+	while (i < length)
+	{
+		// Skip ASCII eight bytes at a time
+		if (length - i >= 8)
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			if ((word & 0x8080808080808080ULL) == 0)
+			{
+				i += 8;
+				continue;
+			}
+		}
+
+		uint8_t lead = bytes[i];
+		if (lead < 0x80)
+		{
+			i++;
+			continue;
+		}
+
+		NSUInteger count;
+		uint32_t value;
+		uint32_t minimum;
+		if ((lead & 0xE0) == 0xC0)
+		{
+			count = 1;
+			value = lead & 0x1F;
+			minimum = 0x80;
+		}
+		else if ((lead & 0xF0) == 0xE0)
+		{
+			count = 2;
+			value = lead & 0x0F;
+			minimum = 0x800;
+		}
+		else if ((lead & 0xF8) == 0xF0)
+		{
+			count = 3;
+			value = lead & 0x07;
+			minimum = 0x10000;
+		}
+		else
+		{
+			return NO;
+		}
+
+		if (count >= length - i)
+			return NO;
+
+		for (NSUInteger j = 1; j <= count; j++)
+		{
+			uint8_t byte = bytes[i + j];
+			if ((byte & 0xC0) != 0x80)
+				return NO;
+
+			value = (value << 6) | (byte & 0x3F);
+		}
+
+		// Overlong forms, surrogates and values past the last code point
+		if ( (value < minimum) || (value > 0x10FFFF) || ((value >= 0xD800) && (value <= 0xDFFF)) )
+			return NO;
+
+		i += count + 1;
+	}
+
+	return YES;
+}
+
+
 #pragma mark -
 @implementation AppigoNote
 
 
 @synthesize name;
-@synthesize text;
 @synthesize notebook;
+@synthesize textData;
 
 
 #pragma mark -
@@ -61,28 +171,96 @@
 {
 	if (self = [super init])
 	{
-		if ( (noteName == nil) || ([[noteName stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] length] == 0) )
+		// The name is trimmed once here and never changes, so it is encoded as is
+		name = AppigoCopyStringByTrimmingWhitespace(noteName);
+		if ([name length] == 0)
+		{
+			[name release];
 			name = [[NSString alloc] initWithString:@"Unknown"];
-		else
-			name = [[NSString alloc] initWithString:[noteName stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]];
+		}
+	}
+	
+	return self;
+}
+
+
+- (id)initWithName:(NSString *)noteName textUTF8Data:(NSData *)data
+{
+	if (self = [self initWithName:noteName])
+	{
+		// Reading every byte once here only pages a mapped file in, and the
+		// system can drop those pages again
+		if (AppigoNoteIsValidUTF8([data bytes], [data length]) == NO)
+		{
+			NSLog(@"Note text is not valid UTF-8");
+			[self release];
+			return nil;
+		}
+		
+		textData = [data retain];
+		textRange = AppigoUTF8RangeByTrimmingWhitespace([data bytes], [data length]);
 	}
 	
 	return self;
 }
 
 
+- (id)initWithName:(NSString *)noteName textContentsOfFile:(NSString *)path
+{
+	NSData *data = (path != nil) ? [[NSData alloc] initWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL] : nil;
+	if (data == nil)
+	{
+		NSLog(@"Unable to map note text file: %@", path);
+		[self release];
+		return nil;
+	}
+	
+	self = [self initWithName:noteName textUTF8Data:data];
+	[data release];
+	
+	return self;
+}
+
+
 - (void)dealloc
 {
 	[name release];
 	[text release];
 	[notebook release];
+	[textData release];
 	
     [super dealloc];
 }
 
 
+- (NSString *)text
+{
+	if (textData == nil)
+		return text;
+	
+	return [AppigoNoteCopyStringWithData(textData, textRange) autorelease];
+}
+
+
+- (void)setText:(NSString *)newText
+{
+	if (text != newText)
+	{
+		[text release];
+		text = [newText retain];
+	}
+	
+	[textData release];
+	textData = nil;
+}
+
+
 - (NSString *)plainTextRepresentationWithName:(BOOL)includeName
 {
+	// Text read from data is not copied once more
+	if ( (includeName == NO) && (textData != nil) )
+		return self.text;
+	
 	NSMutableString *noteString = [[[NSMutableString alloc] init] autorelease];
 	
 	// Name
@@ -106,7 +284,24 @@
 {
 	AppigoTask *aTask = [[[AppigoTask alloc] initWithName:self.name] autorelease];
 	
-	aTask.note = [self.text stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	// Text read from data is already trimmed, so this only checks both ends.
+	// A task note also loses leading and trailing newlines, which are rare
+	// enough to fall back to the full character set for.
+	NSString *aNote = AppigoCopyStringByTrimmingWhitespace(self.text);
+	NSUInteger length = [aNote length];
+	if (length > 0)
+	{
+		NSCharacterSet *newlines = [NSCharacterSet newlineCharacterSet];
+		if ( ([newlines characterIsMember:[aNote characterAtIndex:0]] == YES) || ([newlines characterIsMember:[aNote characterAtIndex:length - 1]] == YES) )
+		{
+			NSString *trimmedNote = [[aNote stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]] retain];
+			[aNote release];
+			aNote = trimmedNote;
+		}
+	}
+	
+	aTask.note = aNote;
+	[aNote release];
 	aTask.list = self.notebook;
 	
 	return aTask;
@@ -121,21 +316,19 @@
 {
 	if (self = [super init])
 	{
-		NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
-		
 		NSString *aName = [aDecoder decodeObjectForKey:kAppigoNoteNameKey];
 		if (aName == nil)
 			name = [[NSString alloc] initWithString:@"Unknown"];
 		else
-			name = [[NSString alloc] initWithString:[aName stringByTrimmingCharactersInSet:whitespace]];
+			name = AppigoCopyStringByTrimmingWhitespace(aName);
 		
 		NSString *aText = [aDecoder decodeObjectForKey:kAppigoNoteTextKey];
 		if (aText != nil)
-			text = [[NSString alloc] initWithString:[aText stringByTrimmingCharactersInSet:whitespace]];
+			text = AppigoCopyStringByTrimmingWhitespace(aText);
 		
 		NSString *aNotebook = [aDecoder decodeObjectForKey:kAppigoNoteNotebookKey];
 		if (aNotebook != nil)
-			notebook = [[NSString alloc] initWithString:[aNotebook stringByTrimmingCharactersInSet:whitespace]];
+			notebook = AppigoCopyInternedTrimmedString(aNotebook, [AppigoStringPool currentPool]);
 	}
 	
 	return self;
@@ -144,10 +337,12 @@
 
 - (void)encodeWithCoder:(NSCoder *)aCoder
 {
-	[aCoder encodeObject:[name stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] forKey:kAppigoNoteNameKey];
+	[aCoder encodeObject:name forKey:kAppigoNoteNameKey];
 	
-	if (text != nil)
-		[aCoder encodeObject:text forKey:kAppigoNoteTextKey];
+	// A note backed by data encodes a string over that data, not a copy
+	NSString *aText = self.text;
+	if (aText != nil)
+		[aCoder encodeObject:aText forKey:kAppigoNoteTextKey];
 	
 	if (notebook != nil)
 		[aCoder encodeObject:notebook forKey:kAppigoNoteNotebookKey];
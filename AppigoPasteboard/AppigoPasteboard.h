@@ -270,8 +270,11 @@
 
 #import <UIKit/UIKit.h>
 
+#import "AppigoImportOperation.h"
+
 @class AppigoTask;
 @class AppigoNote;
+@class AppigoTaskTemplate;
 
 
 #pragma mark -
@@ -286,6 +289,22 @@
 
 #define kAppigoNotebookAppStoreURL @"http://phobos.apple.com/WebObjects/MZStore.woa/wa/viewSoftware?id=290089621&mt=8"
 
+// A compression threshold for setCompressionThreshold:forPasteboardNamed:.
+// Smaller payloads compress poorly and pay for the hash table setup, from
+// 4 KB on the ratio and speed level off (tests/AppigoCompressionBenchmark.c).
+#define kAppigoPasteboardCompressionThreshold	4096
+
+
+/**
+ An enumeration of the payload encodings that can be placed on a pasteboard.
+ */
+typedef enum
+{
+	AppigoPasteboardEncodingKeyedArchive = 0,		// NSKeyedArchiver data only (understood by every Appigo app)
+	AppigoPasteboardEncodingBinary,				// Compact binary data only (see AppigoBinaryCoding.h)
+	AppigoPasteboardEncodingKeyedArchiveAndBinary	// Both representations on every pasteboard item
+} AppigoPasteboardEncoding;
+
 
 
 #pragma mark -
@@ -302,6 +321,7 @@
  Check to see if Appigo Todo is installed.
  
  @return Returns YES if Appigo Todo is installed (calls UIApplication's canOpenURL:@"appigotodo://")
+ The answer is cached by AppigoCapabilityCache until an app is installed or removed.
  */
 + (BOOL)isTodoInstalled;
 
@@ -313,6 +333,7 @@
  send a hi-res (@2x) custom action icon to Todo.
  
  @return Returns YES if Appigo Todo is installed (calls UIApplication's canOpenURL:@"appigotodov2://")
+ The answer is cached by AppigoCapabilityCache until an app is installed or removed.
  */
 + (BOOL)isTodoInstalledWith2xSupport;
 
@@ -338,6 +359,41 @@
  */
 + (AppigoTask *)taskFromPasteboardNamed:(NSString *)pasteboardName;
 
+/**
+ Set the task on a specific pasteboard, as a delta against the task last set
+ on it with this method when possible.
+ 
+ Only the tasks that were added or changed since the last export are encoded
+ (see AppigoTaskDelta.h). A full payload is written instead when there is no
+ earlier export on the pasteboard, the root task was replaced, or the receiver
+ does not support deltas. Appigo Todo does not support deltas.
+ 
+ @param task The task to set.
+ @param pasteboardName The name of the pasteboard.
+ @param deltaSupported YES if the receiver keeps the task of the last export and reads it with taskFromPasteboardNamed:baseTask:.
+ */
++ (void)setTask:(AppigoTask *)task inPasteboardNamed:(NSString *)pasteboardName deltaSupported:(BOOL)deltaSupported;
+
+/**
+ Get the task from a specific pasteboard that may hold a delta.
+ 
+ @param pasteboardName The name of the specific pasteboard to look for a task.
+ @param baseTask The task read from the last export, may be nil.
+ @return Returns the task, or nil if no task is available or the pasteboard holds a delta that was not made against baseTask.
+ */
++ (AppigoTask *)taskFromPasteboardNamed:(NSString *)pasteboardName baseTask:(AppigoTask *)baseTask;
+
+/**
+ Get a lazily decoded preview of the task on a specific pasteboard. Only the
+ name, type, priority and dates are decoded up front; notes, images and
+ subtasks are decoded the first time they are accessed (see
+ AppigoTaskPreview.h).
+ 
+ @param pasteboardName The name of the specific pasteboard to look for a task.
+ @return Returns a preview of the task on the specified pasteboard or nil if no task is available on the specified pasteboard.
+ */
++ (AppigoTask *)taskPreviewFromPasteboardNamed:(NSString *)pasteboardName;
+
 /**
  Launch Appigo Todo and import the specified task.
  
@@ -346,10 +402,87 @@
  */
 + (BOOL)openTodoWithTask:(AppigoTask *)task;
 
+/**
+ Launch Appigo Todo and import the specified task without blocking the
+ calling thread. See openTodoWithTasks:completion:.
+ 
+ @param task The task to import into Appigo Todo.
+ @param completion Called on the main thread when the import finished, may be nil.
+ @return Returns an operation that can cancel the import.
+ */
++ (AppigoImportOperation *)openTodoWithTask:(AppigoTask *)task completion:(AppigoImportCompletion)completion;
+
+/**
+ Get all of the tasks available on a specific pasteboard.
+ 
+ @param pasteboardName The name of the specific pasteboard to look for tasks.
+ @return Returns an array of AppigoTask objects (one for each pasteboard item carrying a task) or nil if no tasks are available on the specified pasteboard.
+ */
++ (NSArray *)tasksFromPasteboardNamed:(NSString *)pasteboardName;
+
+/**
+ Launch Appigo Todo once and import all of the specified tasks.
+ 
+ Every task is written as a separate item of a single import pasteboard in one
+ pass, so importing a burst of tasks costs one pasteboard write and one app
+ switch instead of one of each per task.
+ 
+ Importing the same tasks again within the window of AppigoDuplicateFilter
+ does nothing and returns YES. The same goes for every other import method.
+ 
+ Like every import method, this runs on the queue of
+ openTodoWithTasks:completion:, so it waits for the imports started before
+ it instead of overwriting their pasteboard.
+ 
+ @param tasks An array of AppigoTask objects to import into Appigo Todo.
+ @return Returns NO if tasks is empty or if Todo was unable to be launched. See openTodoWithTask: for more information.
+ */
++ (BOOL)openTodoWithTasks:(NSArray *)tasks;
+
+/**
+ Launch Appigo Todo once and import all of the specified tasks without
+ blocking the calling thread.
+ 
+ The tasks are encoded and written to the pasteboard on a background serial
+ queue, and only opening the import URL (and the alert shown when that fails)
+ happens on the main thread. Do not change the tasks until the completion is
+ called. Imports started this way run one at a time, in order.
+ 
+ @param tasks An array of AppigoTask objects to import into Appigo Todo.
+ @param completion Called on the main thread when the import finished, with NO if tasks is empty, Todo could not be launched or the import was cancelled. May be nil.
+ @return Returns an operation that can cancel the import and reports its main thread time.
+ */
++ (AppigoImportOperation *)openTodoWithTasks:(NSArray *)tasks completion:(AppigoImportCompletion)completion;
+
+/**
+ Launch Appigo Todo and import a task filled in from a template without
+ blocking the calling thread. See openTodoWithTasks:completion:.
+ 
+ The template's archive goes onto the pasteboard as is, with only the name
+ and due date spliced in, so the task is not encoded again. With the binary
+ encoding, or while the import journal holds tasks to retry, the task is
+ decoded from the template and imported like any other.
+ 
+ @param taskTemplate The template of the task to import.
+ @param name The name of the task, or nil for the name of the template's task.
+ @param dueDate The due date of the task, or nil for the due date of the template's task.
+ @param completion Called on the main thread when the import finished, may be nil.
+ @return Returns an operation that can cancel the import.
+ */
++ (AppigoImportOperation *)openTodoWithTaskTemplate:(AppigoTaskTemplate *)taskTemplate name:(NSString *)name dueDate:(NSDate *)dueDate completion:(AppigoImportCompletion)completion;
+
 
 #pragma mark -
 #pragma mark Note Methods
 
+/**
+ Check to see if Appigo Notebook is installed.
+ 
+ @return Returns YES if Appigo Notebook is installed (calls UIApplication's canOpenURL:@"appigonotebook://")
+ The answer is cached by AppigoCapabilityCache until an app is installed or removed.
+ */
++ (BOOL)isNotebookInstalled;
+
 /**
  Set the Appigo Pasteboard note.
  
@@ -373,13 +506,27 @@
 + (AppigoNote *)noteFromPasteboardNamed:(NSString *)pasteboardName;
 
 /**
- Launch Appigo Notebook and import the specified note.
+ Launch Appigo Notebook and import the specified note. Importing the same
+ note again within the window of AppigoDuplicateFilter does nothing and
+ returns YES.
  
  @param note The note to import into Appigo Notebook.
  @return Returns NO if Notebook was unable to be launched. Check the console log for the specific reason. In most cases, the user likely does not have Appigo Notebook installed. We recommend using a UIAlertView to prompt the user about this (and offer a direct link to the App Store for them to download/purchase Notebook). Samples of how to do this are available in CustomTask (a sample third party app which demonstrates how to use Appigo's Third Party Integration).
  */
 + (BOOL)openNotebookWithNote:(AppigoNote *)note;
 
+/**
+ Launch Appigo Notebook and import the specified note without blocking the
+ calling thread. The note is encoded on the same queue as the tasks of
+ openTodoWithTasks:completion:, so do not change it until the completion is
+ called.
+ 
+ @param note The note to import into Appigo Notebook.
+ @param completion Called on the main thread when the import finished, may be nil.
+ @return Returns an operation that can cancel the import.
+ */
++ (AppigoImportOperation *)openNotebookWithNote:(AppigoNote *)note completion:(AppigoImportCompletion)completion;
+
 
 #pragma mark -
 #pragma mark Global Settings
@@ -394,5 +541,40 @@
  */
 + (void)setShowErrorAlertsAutomatically:(BOOL)showAlertsAutomatically;
 
+/**
+ Specify which payload encodings are written when tasks and notes are placed
+ on a pasteboard. Readers always prefer the binary representation when it is
+ present and fall back to the keyed archive.
+ 
+ @param encoding The encoding to write. By default, this is set to
+ AppigoPasteboardEncodingKeyedArchive, which is the only encoding understood by
+ Appigo Todo and Appigo Notebook. Use the binary encodings only when the
+ receiving app reads pasteboards with AppigoPasteboard.
+ */
++ (void)setPasteboardEncoding:(AppigoPasteboardEncoding)encoding;
+
+/**
+ Compress task and note payloads of at least a given size written to one
+ pasteboard (see AppigoCompression.h). A compressed payload replaces the
+ representation it was made from, under its own pasteboard type, and the
+ readers of AppigoPasteboard decompress it transparently. When both encodings
+ are written only the binary one is compressed. Payloads that do not get
+ smaller are written uncompressed.
+ 
+ Pasteboards are never compressed unless they opt in here, and the pasteboards
+ Appigo Todo and Appigo Notebook read (the Appigo pasteboard and the import
+ pasteboards) cannot opt in, because those apps do not read compressed
+ payloads.
+ 
+ @param threshold The smallest payload, in bytes, to compress, or 0 to stop
+ compressing. kAppigoPasteboardCompressionThreshold is a good start.
+ @param pasteboardName The name of a pasteboard read only by apps using
+ AppigoPasteboard.
+ */
++ (void)setCompressionThreshold:(NSUInteger)threshold forPasteboardNamed:(NSString *)pasteboardName;
+
+/** The smallest payload compressed on a pasteboard, or 0 if it is not compressed. */
++ (NSUInteger)compressionThresholdForPasteboardNamed:(NSString *)pasteboardName;
+
 
 @end
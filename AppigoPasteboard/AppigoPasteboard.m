@@ -27,6 +27,19 @@
 #import "AppigoPasteboard.h"
 #import "AppigoTask.h"
 #import "AppigoNote.h"
+#import "AppigoBinaryCoding.h"
+#import "AppigoTaskPreview.h"
+#import "AppigoPasteboardManager.h"
+#import "AppigoURLBuilder.h"
+#import "AppigoCapabilityCache.h"
+#import "AppigoTrace.h"
+#import "AppigoImportJournal.h"
+#import "AppigoStringPool.h"
+#import "AppigoTaskDelta.h"
+#import "AppigoCompression.h"
+#import "AppigoImportOperation.h"
+#import "AppigoTaskTemplate.h"
+#import "AppigoDuplicateFilter.h"
 
 // This is the name of the pasteboard used by Appigo Applications to share items
 // such as tasks, notes, etc. with each other and other applications.
@@ -36,24 +49,25 @@
 #define kAppigoPasteboardTypeTask			@"com.appigo.task"
 #define kAppigoPasteboardTypeNote			@"com.appigo.note"
 #define kAppigoPasteboardTypeFillUp			@"com.appigo.fillup"
+#define kAppigoPasteboardTypeTaskBinary		@"com.appigo.task.binary"
+#define kAppigoPasteboardTypeNoteBinary		@"com.appigo.note.binary"
+#define kAppigoPasteboardTypeTaskDelta		@"com.appigo.task.delta"
+#define kAppigoPasteboardTypeTaskCompressed	@"com.appigo.task.compressed"
+#define kAppigoPasteboardTypeNoteCompressed	@"com.appigo.note.compressed"
 
-// Appigo Todo URL Import Constants
-#define kAppigoTodoURLScheme				@"appigotodo://"
-#define kAppigoTodoURLSchemeV2				@"appigotodov2://"
-#define kAppigoTodoURLImportPath			@"/import"
-#define kAppigoTodoURLPasteboardSource		@"source=pasteboard"
-#define kAppigoTodoURLPasteboardName		@"pasteboard-name"
-
-// Appigo Notebook URL Import Constants
-#define kAppigoNotebookURLScheme			@"appigonotebook://"
-#define kAppigoNotebookURLImportPath		@"/import"
-#define kAppigoNotebookURLPasteboardSource	@"source=pasteboard"
-#define kAppigoNotebookURLPasteboardName	@"pasteboard-name"
+// The URL schemes are checked by AppigoCapabilityCache and the import URLs
+// themselves are built by AppigoURLBuilder
 
 
 static AppigoPasteboard *_mySharedInstance = nil;
 static BOOL _showErrorAlertsAutomatically = YES;
 static NSString *_appStoreURL = nil;
+static AppigoPasteboardEncoding _pasteboardEncoding = AppigoPasteboardEncodingKeyedArchive;
+static NSMutableDictionary *_compressionThresholds = nil;	// pasteboard name -> NSNumber, pasteboards without one are never compressed
+static NSMutableDictionary *_exportSnapshots = nil;	// pasteboard name -> AppigoTaskSnapshot of the last delta export
+static char _importQueueKey;							// marks _importQueue, see _isOnImportQueue
+static NSMutableArray *_mainThreadSteps = nil;			// blocks waiting to run on the main thread, see _performOnMainThread:
+static dispatch_semaphore_t _mainThreadStepSignal = NULL;	// signalled once per step added
 
 
 #pragma mark -
@@ -62,8 +76,47 @@ static NSString *_appStoreURL = nil;
 + (AppigoPasteboard *)_sharedInstance;
 - (id)_privateInit;
 
-+ (void)_setTask:(AppigoTask *)task inPasteboard:(UIPasteboard *)pasteboard;
-+ (void)_setNote:(AppigoNote *)note inPasteboard:(UIPasteboard *)pasteboard;
++ (BOOL)_openTodoWithTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal;
++ (void)_startTodoImport:(AppigoImportOperation *)operation withTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal;
++ (void)_runTodoImport:(AppigoImportOperation *)operation withTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal;
++ (NSURL *)_prepareTodoImportWithTasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal checkpoint:(AppigoImportJournalCheckpoint *)checkpoint;
++ (NSURL *)_prepareTodoImportWithTaskArchive:(NSData *)archive;
++ (NSURL *)_todoImportURLForPasteboardNamed:(NSString *)pasteboardName tasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal;
++ (BOOL)_launchTodoImportURL:(NSURL *)url showAlert:(BOOL)showAlert;
++ (void)_recordTodoImport:(BOOL)imported tasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal checkpoint:(AppigoImportJournalCheckpoint)checkpoint;
++ (NSURL *)_prepareNotebookImportWithNote:(AppigoNote *)note;
++ (void)_startNotebookImport:(AppigoImportOperation *)operation withNote:(AppigoNote *)note;
++ (void)_runNotebookImport:(AppigoImportOperation *)operation withNote:(AppigoNote *)note;
++ (BOOL)_launchNotebookImportURL:(NSURL *)url;
++ (BOOL)_waitForImport:(AppigoImportOperation *)operation finished:(dispatch_semaphore_t)finished;
++ (void)_finishImport:(AppigoImportOperation *)operation withURL:(NSURL *)url duplicateHash:(uint64_t)duplicateHash opener:(BOOL (^)(void))opener cleanup:(void (^)(BOOL opened, BOOL imported))cleanup;
++ (void)_finishSuppressedImport:(AppigoImportOperation *)operation;
++ (void)_performOnMainThread:(dispatch_block_t)step;
++ (dispatch_block_t)_nextMainThreadStep;
++ (NSString *)_importPasteboardName;
++ (dispatch_queue_t)_importQueue;
++ (BOOL)_isOnImportQueue;
++ (void)_setTasks:(NSArray *)tasks inPasteboardNamed:(NSString *)pasteboardName;
++ (void)_setExportSnapshot:(AppigoTaskSnapshot *)snapshot forPasteboardNamed:(NSString *)pasteboardName;
++ (NSData *)_dataForTask:(AppigoTask *)task;
++ (NSUInteger)_compressionThresholdForPasteboardNamed:(NSString *)pasteboardName;
++ (NSDictionary *)_pasteboardItemForTask:(AppigoTask *)task compressionThreshold:(NSUInteger)threshold;
++ (AppigoTask *)_taskFromBinaryData:(NSData *)binaryData keyedArchiveData:(NSData *)data;
++ (AppigoTask *)_taskFromCompressedData:(NSData *)compressedData;
++ (void)_journalTaskArchive:(NSData *)archive inJournal:(AppigoImportJournal *)journal;
++ (AppigoNote *)_noteFromBinaryData:(NSData *)binaryData keyedArchiveData:(NSData *)data;
++ (AppigoNote *)_noteFromCompressedData:(NSData *)compressedData;
++ (void)_setPayload:(NSData *)payload forType:(NSString *)type compressedType:(NSString *)compressedType inItem:(NSMutableDictionary *)item compressionThreshold:(NSUInteger)threshold;
++ (void)_setNote:(AppigoNote *)note inPasteboardNamed:(NSString *)pasteboardName;
+
+@end
+
+
+// Implemented in AppigoImportOperation.m
+@interface AppigoImportOperation (Private)
+
+- (id)_initWithCompletion:(AppigoImportCompletion)completion;
+- (void)_finishImported:(BOOL)imported mainThreadStart:(uint64_t)mainThreadStart;
 
 @end
 
@@ -80,21 +133,13 @@ static NSString *_appStoreURL = nil;
 
 + (BOOL)isTodoInstalled
 {
-	NSURL *testURL = [[NSURL alloc] initWithString:kAppigoTodoURLScheme];
-	BOOL v1Supported = [[UIApplication sharedApplication] canOpenURL:testURL];
-	[testURL release];
-	
-	return v1Supported;
+	return [[AppigoCapabilityCache sharedCache] isAvailable:AppigoCapabilityTodo];
 }
 
 
 + (BOOL)isTodoInstalledWith2xSupport
 {
-	NSURL *testURL = [[NSURL alloc] initWithString:kAppigoTodoURLSchemeV2];
-	BOOL v2Supported = [[UIApplication sharedApplication] canOpenURL:testURL];
-	[testURL release];
-	
-	return v2Supported;
+	return [[AppigoCapabilityCache sharedCache] isAvailable:AppigoCapabilityTodoV2];
 }
 
 
@@ -103,22 +148,9 @@ static NSString *_appStoreURL = nil;
 	if (task == nil)
 		return;
 	
-	// If the pasteboard exists, remove it first.  This fixes a problem we found
-	// in iOS 4.0 where apps that had already used this pasteboard, stayed
-	// running in the background, and use the pasteboard again were not able to
-	// change the items in the pasteboard without closing the app down first.
-	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:kAppigoPasteboardName create:NO];
-	if (pasteboard != nil)
-	{
-		[UIPasteboard removePasteboardWithName:kAppigoPasteboardName];
-	}
-	
-	// Create the Appigo Pasteboard and make sure it gets marked as persistent
-	UIPasteboard *appigoPasteboard = [UIPasteboard pasteboardWithName:kAppigoPasteboardName create:YES];
-	appigoPasteboard.persistent = YES;
-	
-	// Add the task to the Appigo Pasteboard
-	[AppigoPasteboard _setTask:task inPasteboard:appigoPasteboard];
+	// Add the task to the Appigo Pasteboard. The pasteboard manager takes care
+	// of creating the persistent pasteboard and of the iOS 4.0 workaround.
+	[AppigoPasteboard _setTasks:[NSArray arrayWithObject:task] inPasteboardNamed:kAppigoPasteboardName];
 }
 
 
@@ -137,15 +169,97 @@ static NSString *_appStoreURL = nil;
 	if (pasteboard == nil)
 		return nil;
 	
+	// Prefer the binary representation and only fetch the keyed archive from
+	// the pasteboard server if it is missing or unreadable
+	NSData *binaryData = [pasteboard valueForPasteboardType:kAppigoPasteboardTypeTaskBinary];
+	AppigoTask *task = [AppigoPasteboard _taskFromBinaryData:binaryData keyedArchiveData:nil];
+	if (task != nil)
+		return task;
+	
+	task = [AppigoPasteboard _taskFromCompressedData:[pasteboard valueForPasteboardType:kAppigoPasteboardTypeTaskCompressed]];
+	if (task != nil)
+		return task;
+	
 	NSData *data = [pasteboard valueForPasteboardType:kAppigoPasteboardTypeTask];
 	if (data == nil)
 		return nil;
 	
-	NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
-	AppigoTask *task = [[[AppigoTask alloc] initWithCoder:keyedUnarchiver] autorelease];
-	[keyedUnarchiver release];
+	return [AppigoPasteboard _taskFromBinaryData:nil keyedArchiveData:data];
+}
+
+
++ (void)setTask:(AppigoTask *)task inPasteboardNamed:(NSString *)pasteboardName deltaSupported:(BOOL)deltaSupported
+{
+	if ( (task == nil) || (pasteboardName == nil) )
+		return;
+	
+	AppigoTaskSnapshot *base = nil;
+	if (deltaSupported == YES)
+	{
+		@synchronized(self)
+		{
+			base = [[_exportSnapshots objectForKey:pasteboardName] retain];
+		}
+	}
+	
+	AppigoTaskSnapshot *snapshot = nil;
+	NSData *delta = [task binaryDeltaFromSnapshot:base snapshot:&snapshot];
+	[base release];
+	
+	if (delta != nil)
+	{
+		NSDictionary *item = [NSDictionary dictionaryWithObject:delta forKey:kAppigoPasteboardTypeTaskDelta];
+		[[AppigoPasteboardManager sharedManager] setItems:[NSArray arrayWithObject:item] forPasteboardNamed:pasteboardName];
+	}
+	else
+	{
+		[AppigoPasteboard _setTasks:[NSArray arrayWithObject:task] inPasteboardNamed:pasteboardName];
+	}
 	
-	return task;
+	// Written after _setTasks:, which forgets the previous snapshot
+	[AppigoPasteboard _setExportSnapshot:snapshot forPasteboardNamed:pasteboardName];
+}
+
+
++ (AppigoTask *)taskFromPasteboardNamed:(NSString *)pasteboardName baseTask:(AppigoTask *)baseTask
+{
+	if (pasteboardName == nil)
+		return nil;
+	
+	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
+	if (pasteboard == nil)
+		return nil;
+	
+	NSData *delta = [pasteboard valueForPasteboardType:kAppigoPasteboardTypeTaskDelta];
+	if (delta == nil)
+		return [AppigoPasteboard taskFromPasteboardNamed:pasteboardName];
+	
+	return [baseTask taskByApplyingBinaryDelta:delta];
+}
+
+
++ (AppigoTask *)taskPreviewFromPasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return nil;
+	
+	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
+	if (pasteboard == nil)
+		return nil;
+	
+	AppigoTask *task = [AppigoTask taskPreviewWithBinaryData:[pasteboard valueForPasteboardType:kAppigoPasteboardTypeTaskBinary]];
+	if (task != nil)
+		return task;
+	
+	// A compressed payload has to be read in full anyway, so the preview only
+	// saves decoding it
+	NSData *decompressedData = AppigoDecompressData([pasteboard valueForPasteboardType:kAppigoPasteboardTypeTaskCompressed]);
+	if (AppigoBinaryDataHasPreamble(decompressedData) == YES)
+		return [AppigoTask taskPreviewWithBinaryData:decompressedData];
+	if (decompressedData != nil)
+		return [AppigoTask taskPreviewWithKeyedArchiveData:decompressedData];
+	
+	return [AppigoTask taskPreviewWithKeyedArchiveData:[pasteboard valueForPasteboardType:kAppigoPasteboardTypeTask]];
 }
 
 
@@ -157,101 +271,179 @@ static NSString *_appStoreURL = nil;
 		return NO;
 	}
 	
-	// Copy the task onto the pasteboard
-	NSString *importSourceAppID = [[NSBundle mainBundle] bundleIdentifier];
-	NSString *pasteboardName = [NSString stringWithFormat:@"%@.%@", kAppigoPasteboardName, importSourceAppID];
-	
-	// If the pasteboard exists, remove it first.  This fixes a problem we found
-	// in iOS 4.0 where apps that had already used this pasteboard, stayed
-	// running in the background, and use the pasteboard again were not able to
-	// change the items in the pasteboard without closing the app down first.
-	UIPasteboard *pasteBoard = [UIPasteboard pasteboardWithName:pasteboardName create:NO];
-	if (pasteBoard != nil)
-	{
-		[UIPasteboard removePasteboardWithName:pasteboardName];
-	}
+	return [AppigoPasteboard openTodoWithTasks:[NSArray arrayWithObject:task]];
+}
+
+
++ (AppigoImportOperation *)openTodoWithTask:(AppigoTask *)task completion:(AppigoImportCompletion)completion
+{
+	return [AppigoPasteboard openTodoWithTasks:((task != nil) ? [NSArray arrayWithObject:task] : nil) completion:completion];
+}
+
+
++ (NSArray *)tasksFromPasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return nil;
 	
-	UIPasteboard *importPasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
-	importPasteboard.persistent = YES;
+	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
+	if (pasteboard == nil)
+		return nil;
 	
-	[AppigoPasteboard _setTask:task inPasteboard:importPasteboard];
+	NSArray *items = pasteboard.items;
+	if ([items count] == 0)
+		return nil;
 	
-	NSMutableString *urlString = [[NSMutableString alloc] init];
-	[urlString appendString:kAppigoTodoURLScheme];
+	// Share repeated lists, contexts and tags across the whole batch
+	AppigoStringPool *strings = [[AppigoStringPool alloc] init];
+	[strings activate];
 	
-	[urlString appendString:importSourceAppID];
+	APPIGO_TRACE_BEGIN(decode);
+	NSMutableArray *tasks = [NSMutableArray arrayWithCapacity:[items count]];
+	for (NSDictionary *item in items)
+	{
+		NSData *binaryData = [item objectForKey:kAppigoPasteboardTypeTaskBinary];
+		
+		// A compressed payload replaces the representation it was made from
+		AppigoTask *task = nil;
+		if (binaryData == nil)
+			task = [AppigoPasteboard _taskFromCompressedData:[item objectForKey:kAppigoPasteboardTypeTaskCompressed]];
+		if (task == nil)
+			task = [AppigoPasteboard _taskFromBinaryData:binaryData keyedArchiveData:[item objectForKey:kAppigoPasteboardTypeTask]];
+		if (task != nil)
+			[tasks addObject:task];
+	}
+	APPIGO_TRACE_END(decode, AppigoTraceEventTaskDecode, strings.savedByteCount);
 	
-	[urlString appendFormat:@"%@?", kAppigoTodoURLImportPath];
-	[urlString appendString:kAppigoTodoURLPasteboardSource];
-	[urlString appendFormat:@"&%@=%@", kAppigoTodoURLPasteboardName, pasteboardName];
+	[strings deactivate];
+	[strings release];
 	
-	NSURL *url = [[NSURL alloc] initWithString:urlString];
+	if ([tasks count] == 0)
+		return nil;
 	
-	if (url == nil)
+	return tasks;
+}
+
+
++ (BOOL)openTodoWithTasks:(NSArray *)tasks
+{
+	if ([tasks count] == 0)
 	{
-		NSLog(@"Error creating import URL: %@", urlString);
-		[urlString release];
-		[UIPasteboard removePasteboardWithName:pasteboardName];
+		NSLog(@"openTodoWithTasks: called without any tasks");
 		return NO;
 	}
-	[urlString release];
 	
-	BOOL result = [[UIApplication sharedApplication] openURL:url];
-	[url release];
+	return [AppigoPasteboard _openTodoWithTasks:tasks fromJournal:NO];
+}
+
+
++ (AppigoImportOperation *)openTodoWithTasks:(NSArray *)tasks completion:(AppigoImportCompletion)completion
+{
+	AppigoImportOperation *operation = [[[AppigoImportOperation alloc] _initWithCompletion:completion] autorelease];
 	
-	if (result == NO)
+	if ([tasks count] == 0)
 	{
-		NSLog(@"The user does not have Todo or Todo Lite installed.");
-		[UIPasteboard removePasteboardWithName:pasteboardName];
+		NSLog(@"openTodoWithTasks:completion: called without any tasks");
+		[AppigoPasteboard _finishImport:operation withURL:nil duplicateHash:0 opener:nil cleanup:nil];
+		return operation;
+	}
+	
+	[AppigoPasteboard _startTodoImport:operation withTasks:tasks fromJournal:NO];
+	
+	return operation;
+}
+
+
++ (AppigoImportOperation *)openTodoWithTaskTemplate:(AppigoTaskTemplate *)taskTemplate name:(NSString *)name dueDate:(NSDate *)dueDate completion:(AppigoImportCompletion)completion
+{
+	AppigoImportOperation *operation = [[[AppigoImportOperation alloc] _initWithCompletion:completion] autorelease];
+	
+	if (taskTemplate == nil)
+	{
+		NSLog(@"openTodoWithTaskTemplate:name:dueDate:completion: called without a task template");
+		[AppigoPasteboard _finishImport:operation withURL:nil duplicateHash:0 opener:nil cleanup:nil];
+		return operation;
+	}
+	
+	NSString *importName = [name copy];
+	dispatch_async([AppigoPasteboard _importQueue], ^{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
 		
-		if (_showErrorAlertsAutomatically == YES)
+		AppigoImportJournal *journal = [AppigoImportJournal sharedJournal];
+		NSData *archive = [taskTemplate keyedArchiveDataWithName:importName dueDate:dueDate];
+		AppigoDuplicateFilter *filter = [AppigoDuplicateFilter sharedFilter];
+		uint64_t hash = ([filter window] > 0.0) ? AppigoDuplicateFilterHashTaskData(archive) : 0;
+		NSURL *url = nil;
+		
+		if ([operation isCancelled] == YES)
 		{
-#ifdef IPAD
-			UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Todo for iPad?", @"Alert view title when a user attempts to import a task into Todo for iPad and they do not have Todo for iPad, Todo, or Todo Lite installed.")
-															message:NSLocalizedString(@"Import tasks directly into Appigo Todo for iPad available on the App Store.", @"Message body of the alert to prompt a user to purchase Todo for iPad if they do not have it installed and attempt to import a task.")
-#else
-								  UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Todo?", @"Alert view title when a user attempts to import a task into Todo and they do not have Todo or Todo Lite installed.")
-																				  message:NSLocalizedString(@"Import tasks directly into Appigo Todo. Try Todo Lite free on the App Store.", @"Message body of the alert to prompt a user to purchase Todo if they do not have it installed and attempt to import a task.")
-#endif
-														   delegate:[AppigoPasteboard _sharedInstance]
-												  cancelButtonTitle:NSLocalizedString(@"Cancel", @"Cancel button when prompting the user to purchase Todo")
-												  otherButtonTitles:NSLocalizedString(@"More Info", @"More information button used during our prompt to ask users if they'd like more information about Appigo Todo if they do not have it installed and try to import a task."), nil];
-			_appStoreURL = kAppigoTodoAppStoreURL;
-			[alert show];
-			[alert release];
+			[AppigoPasteboard _finishImport:operation withURL:nil duplicateHash:0 opener:nil cleanup:nil];
+		}
+		else if ( (hash != 0) && ([filter isDuplicateImportWithHash:hash] == YES) )
+		{
+			[AppigoPasteboard _finishSuppressedImport:operation];
+		}
+		else if ( (_pasteboardEncoding != AppigoPasteboardEncodingKeyedArchive) || ([journal pendingTaskCount] > 0) )
+		{
+			// The binary encoding and pending tasks both need the task itself
+			AppigoTask *importTask = [AppigoPasteboard _taskFromBinaryData:nil keyedArchiveData:archive];
+			if (importTask == nil)
+			{
+				NSLog(@"Unable to decode the archive of task template: %@", taskTemplate);
+				[AppigoPasteboard _finishImport:operation withURL:nil duplicateHash:hash opener:nil cleanup:nil];
+			}
+			else
+			{
+				NSArray *importTasks = [NSArray arrayWithObject:importTask];
+				AppigoImportJournalCheckpoint checkpoint = 0;
+				url = [AppigoPasteboard _prepareTodoImportWithTasks:importTasks journal:journal checkpoint:&checkpoint];
+				
+				[AppigoPasteboard _finishImport:operation withURL:url duplicateHash:hash opener:^BOOL {
+					return [AppigoPasteboard _launchTodoImportURL:url showAlert:YES];
+				} cleanup:^(BOOL opened, BOOL imported) {
+					[AppigoPasteboard _recordTodoImport:imported tasks:((opened == YES) ? importTasks : nil) journal:journal checkpoint:checkpoint];
+				}];
+			}
+		}
+		else
+		{
+			url = [AppigoPasteboard _prepareTodoImportWithTaskArchive:archive];
+			if (url == nil)
+				[AppigoPasteboard _journalTaskArchive:archive inJournal:journal];
+			
+			[AppigoPasteboard _finishImport:operation withURL:url duplicateHash:hash opener:^BOOL {
+				return [AppigoPasteboard _launchTodoImportURL:url showAlert:YES];
+			} cleanup:^(BOOL opened, BOOL imported) {
+				if ( (opened == YES) && (imported == NO) )
+					[AppigoPasteboard _journalTaskArchive:archive inJournal:journal];
+			}];
 		}
 		
-		return NO;
-	}
+		[pool release];
+	});
+	[importName release];
 	
-	return YES;
+	return operation;
 }
 
 
 #pragma mark -
 #pragma mark Note Methods
 
++ (BOOL)isNotebookInstalled
+{
+	return [[AppigoCapabilityCache sharedCache] isAvailable:AppigoCapabilityNotebook];
+}
+
+
 + (void)setNote:(AppigoNote *)note
 {
 	if (note == nil)
 		return;
 	
-	// If the pasteboard exists, remove it first.  This fixes a problem we found
-	// in iOS 4 where apps that had already used this pasteboard, stayed
-	// running in the background, and use the pasteboard again were not able to
-	// change the items in the pasteboard without closing the app down first.
-	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:kAppigoPasteboardName create:NO];
-	if (pasteboard != nil)
-	{
-		[UIPasteboard removePasteboardWithName:kAppigoPasteboardName];
-	}
-	
-	// Create the Appigo Pasteboard and make sure it gets marked as persistent
-	UIPasteboard *appigoPasteboard = [UIPasteboard pasteboardWithName:kAppigoPasteboardName create:YES];
-	appigoPasteboard.persistent = YES;
-	
-	// Add the note to the Appigo Pasteboard
-	[AppigoPasteboard _setNote:note inPasteboard:appigoPasteboard];
+	// Add the note to the Appigo Pasteboard. The pasteboard manager takes care
+	// of creating the persistent pasteboard and of the iOS 4.0 workaround.
+	[AppigoPasteboard _setNote:note inPasteboardNamed:kAppigoPasteboardName];
 }
 
 
@@ -270,15 +462,22 @@ static NSString *_appStoreURL = nil;
 	if (pasteboard == nil)
 		return nil;
 	
+	// Prefer the binary representation and only fetch the keyed archive from
+	// the pasteboard server if it is missing or unreadable
+	NSData *binaryData = [pasteboard valueForPasteboardType:kAppigoPasteboardTypeNoteBinary];
+	AppigoNote *note = [AppigoPasteboard _noteFromBinaryData:binaryData keyedArchiveData:nil];
+	if (note != nil)
+		return note;
+	
+	note = [AppigoPasteboard _noteFromCompressedData:[pasteboard valueForPasteboardType:kAppigoPasteboardTypeNoteCompressed]];
+	if (note != nil)
+		return note;
+	
 	NSData *data = [pasteboard valueForPasteboardType:kAppigoPasteboardTypeNote];
 	if (data == nil)
 		return nil;
 	
-	NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
-	AppigoNote *note = [[[AppigoNote alloc] initWithCoder:keyedUnarchiver] autorelease];
-	[keyedUnarchiver release];
-	
-	return note;
+	return [AppigoPasteboard _noteFromBinaryData:nil keyedArchiveData:data];
 }
 
 
@@ -290,79 +489,87 @@ static NSString *_appStoreURL = nil;
 		return NO;
 	}
 	
-	// Copy the task onto the pasteboard
-	NSString *importSourceAppID = [[NSBundle mainBundle] bundleIdentifier];
-	NSString *pasteboardName = [NSString stringWithFormat:@"%@.%@", kAppigoPasteboardName, importSourceAppID];
-	
-	// If the pasteboard exists, remove it first.  This fixes a problem we found
-	// in iOS 4.0 where apps that had already used this pasteboard, stayed
-	// running in the background, and use the pasteboard again were not able to
-	// change the items in the pasteboard without closing the app down first.
-	UIPasteboard *pasteBoard = [UIPasteboard pasteboardWithName:pasteboardName create:NO];
-	if (pasteBoard != nil)
-	{
-		[UIPasteboard removePasteboardWithName:pasteboardName];
-	}
+	// Runs on the import queue like openNotebookWithNote:completion:, so it
+	// does not write the pasteboard of an import that is still waiting there
+	dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+	AppigoImportOperation *operation = [[AppigoImportOperation alloc] _initWithCompletion:^(BOOL imported) {
+		dispatch_semaphore_signal(finished);
+	}];
 	
-	UIPasteboard *importPasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
-	importPasteboard.persistent = YES;
+	[AppigoPasteboard _startNotebookImport:operation withNote:note];
+	BOOL result = [AppigoPasteboard _waitForImport:operation finished:finished];
 	
-	[AppigoPasteboard _setNote:note inPasteboard:importPasteboard];
+	[operation release];
+	dispatch_release(finished);
 	
-	NSMutableString *urlString = [[NSMutableString alloc] init];
-	[urlString appendString:kAppigoNotebookURLScheme];
+	return result;
+}
+
+
++ (AppigoImportOperation *)openNotebookWithNote:(AppigoNote *)note completion:(AppigoImportCompletion)completion
+{
+	AppigoImportOperation *operation = [[[AppigoImportOperation alloc] _initWithCompletion:completion] autorelease];
 	
-	[urlString appendString:importSourceAppID];
+	if (note == nil)
+	{
+		NSLog(@"openNotebookWithNote:completion: called with a nil note");
+		[AppigoPasteboard _finishImport:operation withURL:nil duplicateHash:0 opener:nil cleanup:nil];
+		return operation;
+	}
 	
-	[urlString appendFormat:@"%@?", kAppigoNotebookURLImportPath];
-	[urlString appendString:kAppigoNotebookURLPasteboardSource];
-	[urlString appendFormat:@"&%@=%@", kAppigoNotebookURLPasteboardName, pasteboardName];
+	[AppigoPasteboard _startNotebookImport:operation withNote:note];
 	
-	NSURL *url = [[NSURL alloc] initWithString:urlString];
+	return operation;
+}
+
+
+#pragma mark -
+#pragma mark Global Settings
+
++ (void)setShowErrorAlertsAutomatically:(BOOL)showAlertsAutomatically
+{
+	_showErrorAlertsAutomatically = showAlertsAutomatically;
+}
+
+
++ (void)setPasteboardEncoding:(AppigoPasteboardEncoding)encoding
+{
+	_pasteboardEncoding = encoding;
+}
+
+
++ (void)setCompressionThreshold:(NSUInteger)threshold forPasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return;
 	
-	if (url == nil)
+	// Appigo Todo and Appigo Notebook read these and cannot decompress
+	NSString *appigoPrefix = [kAppigoPasteboardName stringByAppendingString:@"."];
+	if ( ([pasteboardName isEqualToString:kAppigoPasteboardName] == YES) || ([pasteboardName hasPrefix:appigoPrefix] == YES) )
 	{
-		NSLog(@"Error creating import URL: %@", urlString);
-		[urlString release];
-		[UIPasteboard removePasteboardWithName:pasteboardName];
-		return NO;
+		NSLog(@"The pasteboard %@ is read by Appigo apps and is never compressed", pasteboardName);
+		return;
 	}
-	[urlString release];
 	
-	BOOL result = [[UIApplication sharedApplication] openURL:url];
-	[url release];
-	
-	if (result == NO)
+	@synchronized(self)
 	{
-		NSLog(@"The user does not have Notebook installed.");
-		[UIPasteboard removePasteboardWithName:pasteboardName];
-		
-		
-		if (_showErrorAlertsAutomatically == YES)
+		if (threshold == 0)
 		{
-			UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Notebook?", @"Alert view title when a user attempts to import a task into Notebook and they do not have it installed.")
-															message:NSLocalizedString(@"Import notes directly into Appigo Notebook. See more information on the App Store.", @"Message body of the alert to prompt a user to purchase Notebook if they do not have it installed and attempt to import a note.")
-														   delegate:[AppigoPasteboard _sharedInstance]
-												  cancelButtonTitle:NSLocalizedString(@"Cancel", @"Cancel button when prompting the user to purchase Notebook")
-												  otherButtonTitles:NSLocalizedString(@"More Info", @"More information button used during our prompt to ask users if they'd like more information about Appigo Notebook if they do not have it installed and try to import a note."), nil];
-			_appStoreURL = kAppigoNotebookAppStoreURL;
-			[alert show];
-			[alert release];
+			[_compressionThresholds removeObjectForKey:pasteboardName];
+			return;
 		}
 		
-		return NO;
+		if (_compressionThresholds == nil)
+			_compressionThresholds = [[NSMutableDictionary alloc] init];
+		
+		[_compressionThresholds setObject:[NSNumber numberWithUnsignedInteger:threshold] forKey:pasteboardName];
 	}
-	
-	return YES;
 }
 
 
-#pragma mark -
-#pragma mark Global Settings
-
-+ (void)setShowErrorAlertsAutomatically:(BOOL)showAlertsAutomatically
++ (NSUInteger)compressionThresholdForPasteboardNamed:(NSString *)pasteboardName
 {
-	_showErrorAlertsAutomatically = showAlertsAutomatically;
+	return [AppigoPasteboard _compressionThresholdForPasteboardNamed:pasteboardName];
 }
 
 
@@ -424,50 +631,696 @@ static NSString *_appStoreURL = nil;
 }
 
 
-+ (void)_setTask:(AppigoTask *)task inPasteboard:(UIPasteboard *)pasteboard
+// The synchronous imports go through the import queue like the asynchronous
+// ones, so they never write the pasteboard of an import still waiting there
++ (BOOL)_openTodoWithTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal
 {
-	if (task == nil)
-		return;
+	dispatch_semaphore_t finished = dispatch_semaphore_create(0);
+	AppigoImportOperation *operation = [[AppigoImportOperation alloc] _initWithCompletion:^(BOOL imported) {
+		dispatch_semaphore_signal(finished);
+	}];
 	
-	NSMutableData *taskData = [[NSMutableData alloc] init];
-	NSKeyedArchiver *keyedArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:taskData];
-	[task encodeWithCoder:keyedArchiver];
-	[keyedArchiver finishEncoding];
+	[AppigoPasteboard _startTodoImport:operation withTasks:tasks fromJournal:fromJournal];
+	BOOL result = [AppigoPasteboard _waitForImport:operation finished:finished];
 	
-	// Add the encoded task onto the Appigo Pasteboard
-	NSDictionary *dictionaryItem = [[NSDictionary alloc] initWithObjectsAndKeys:
-									taskData, kAppigoPasteboardTypeTask,
-									nil];
+	[operation release];
+	dispatch_release(finished);
 	
-	// Replace all pre-existing pasteboard items
-	pasteboard.items = [NSArray arrayWithObject:dictionaryItem];
-	[dictionaryItem release];
-	[keyedArchiver release];
-	[taskData release];
+	return result;
 }
 
 
-+ (void)_setNote:(AppigoNote *)note inPasteboard:(UIPasteboard *)pasteboard
++ (void)_startTodoImport:(AppigoImportOperation *)operation withTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal
 {
-	// Validate the note to make sure it's not nil and at least has a name
-	if (note == nil)
+	if ([AppigoPasteboard _isOnImportQueue] == YES)
+	{
+		[AppigoPasteboard _runTodoImport:operation withTasks:tasks fromJournal:fromJournal];
 		return;
+	}
 	
-	NSMutableData *noteData = [[NSMutableData alloc] init];
-	NSKeyedArchiver *keyedArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:noteData];
-	[note encodeWithCoder:keyedArchiver];
-	[keyedArchiver finishEncoding];
+	NSArray *importTasks = [tasks copy];
+	dispatch_async([AppigoPasteboard _importQueue], ^{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[AppigoPasteboard _runTodoImport:operation withTasks:importTasks fromJournal:fromJournal];
+		[pool release];
+	});
+	[importTasks release];
+}
+
+
+// On the import queue. A replay of the journal brings its own pending tasks
+// and shows no alert, the user did not ask for it.
++ (void)_runTodoImport:(AppigoImportOperation *)operation withTasks:(NSArray *)tasks fromJournal:(BOOL)fromJournal
+{
+	AppigoDuplicateFilter *filter = [AppigoDuplicateFilter sharedFilter];
+	uint64_t hash = ( (fromJournal == NO) && ([filter window] > 0.0) ) ? AppigoDuplicateFilterHashTasks(tasks) : 0;
+	if ( (hash != 0) && ([filter isDuplicateImportWithHash:hash] == YES) )
+	{
+		[AppigoPasteboard _finishSuppressedImport:operation];
+		return;
+	}
 	
-	// Add the items onto the Appigo Pasteboard
-	NSDictionary *dictionaryItem = [[NSDictionary alloc] initWithObjectsAndKeys:
-									noteData, kAppigoPasteboardTypeNote,
-									nil];
+	// Tasks that could not be imported before go along with this batch
+	AppigoImportJournal *journal = (fromJournal == YES) ? nil : [AppigoImportJournal sharedJournal];
+	AppigoImportJournalCheckpoint checkpoint = 0;
+	NSURL *url = nil;
+	if ([operation isCancelled] == NO)
+		url = [AppigoPasteboard _prepareTodoImportWithTasks:tasks journal:journal checkpoint:&checkpoint];
 	
-	// Replace all pre-existing pasteboard items
-	pasteboard.items = [NSArray arrayWithObject:dictionaryItem];
+	[AppigoPasteboard _finishImport:operation withURL:url duplicateHash:hash opener:^BOOL {
+		return [AppigoPasteboard _launchTodoImportURL:url showAlert:(fromJournal == NO)];
+	} cleanup:^(BOOL opened, BOOL imported) {
+		[AppigoPasteboard _recordTodoImport:imported tasks:((opened == YES) ? tasks : nil) journal:journal checkpoint:checkpoint];
+	}];
+}
+
+
+// Everything up to launching Todo: adds the pending tasks of the journal,
+// writes the pasteboard and builds the URL. Safe off the main thread.
++ (NSURL *)_prepareTodoImportWithTasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal checkpoint:(AppigoImportJournalCheckpoint *)checkpoint
+{
+	NSArray *batch = tasks;
+	if ([journal pendingTaskCount] > 0)
+	{
+		NSArray *pendingTasks = [journal pendingTasksWithCheckpoint:checkpoint];
+		if ([pendingTasks count] > 0)
+			batch = [pendingTasks arrayByAddingObjectsFromArray:tasks];
+	}
+	
+	// Copy the tasks onto the pasteboard
+	NSString *pasteboardName = [AppigoPasteboard _importPasteboardName];
+	
+	[AppigoPasteboard _setTasks:batch inPasteboardNamed:pasteboardName];
+	
+	NSURL *url = [AppigoPasteboard _todoImportURLForPasteboardNamed:pasteboardName tasks:tasks journal:journal];
+	if ( (url == nil) && (checkpoint != NULL) )
+	{
+		[journal releaseCheckpoint:*checkpoint];
+		*checkpoint = 0;
+	}
+	
+	return url;
+}
+
+
+// Like _prepareTodoImportWithTasks:journal:checkpoint: for a single task,
+// but writes an archive filled in from a template instead of encoding it
++ (NSURL *)_prepareTodoImportWithTaskArchive:(NSData *)archive
+{
+	NSString *pasteboardName = [AppigoPasteboard _importPasteboardName];
+	
+	APPIGO_TRACE_BEGIN(encode);
+	NSMutableDictionary *dictionaryItem = [[NSMutableDictionary alloc] initWithCapacity:1];
+	[AppigoPasteboard _setPayload:archive
+						  forType:kAppigoPasteboardTypeTask
+				   compressedType:kAppigoPasteboardTypeTaskCompressed
+						   inItem:dictionaryItem
+			 compressionThreshold:0];
+	APPIGO_TRACE_END(encode, AppigoTraceEventTaskEncode, 1);
+	
+	[[AppigoPasteboardManager sharedManager] setItems:[NSArray arrayWithObject:dictionaryItem] forPasteboardNamed:pasteboardName];
+	[dictionaryItem release];
+	
+	// A delta against the replaced task would no longer apply
+	[AppigoPasteboard _setExportSnapshot:nil forPasteboardNamed:pasteboardName];
+	
+	// Nothing to journal yet, the task is only decoded if the import fails
+	return [AppigoPasteboard _todoImportURLForPasteboardNamed:pasteboardName tasks:nil journal:nil];
+}
+
+
++ (NSURL *)_todoImportURLForPasteboardNamed:(NSString *)pasteboardName tasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal
+{
+	NSString *importSourceAppID = [[NSBundle mainBundle] bundleIdentifier];
+	
+	APPIGO_TRACE_BEGIN(url);
+	NSURL *url = [AppigoURLBuilder todoImportURLWithSourceAppID:importSourceAppID pasteboardName:pasteboardName];
+	APPIGO_TRACE_END(url, AppigoTraceEventURLBuild, 0);
+	
+	if (url == nil)
+	{
+		NSLog(@"Error creating import URL for pasteboard: %@", pasteboardName);
+		[[AppigoPasteboardManager sharedManager] removePasteboardNamed:pasteboardName];
+		[journal appendTasks:tasks];
+		return nil;
+	}
+	
+	return url;
+}
+
+
+// Only opens the URL, and offers Todo on the App Store if it can not be
+// opened. Cleaning up after a failed import is left to the caller.
++ (BOOL)_launchTodoImportURL:(NSURL *)url showAlert:(BOOL)showAlert
+{
+	APPIGO_TRACE_BEGIN(open);
+	BOOL result = [[UIApplication sharedApplication] openURL:url];
+	APPIGO_TRACE_END(open, AppigoTraceEventOpenURL, result);
+	
+	if (result == NO)
+	{
+		NSLog(@"The user does not have Todo or Todo Lite installed.");
+		
+		if ( (_showErrorAlertsAutomatically == YES) && (showAlert == YES) )
+		{
+#ifdef IPAD
+			UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Todo for iPad?", @"Alert view title when a user attempts to import a task into Todo for iPad and they do not have Todo for iPad, Todo, or Todo Lite installed.")
+															message:NSLocalizedString(@"Import tasks directly into Appigo Todo for iPad available on the App Store.", @"Message body of the alert to prompt a user to purchase Todo for iPad if they do not have it installed and attempt to import a task.")
+#else
+								  UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Todo?", @"Alert view title when a user attempts to import a task into Todo and they do not have Todo or Todo Lite installed.")
+																				  message:NSLocalizedString(@"Import tasks directly into Appigo Todo. Try Todo Lite free on the App Store.", @"Message body of the alert to prompt a user to purchase Todo if they do not have it installed and attempt to import a task.")
+#endif
+														   delegate:[AppigoPasteboard _sharedInstance]
+												  cancelButtonTitle:NSLocalizedString(@"Cancel", @"Cancel button when prompting the user to purchase Todo")
+												  otherButtonTitles:NSLocalizedString(@"More Info", @"More information button used during our prompt to ask users if they'd like more information about Appigo Todo if they do not have it installed and try to import a task."), nil];
+			_appStoreURL = kAppigoTodoAppStoreURL;
+			[alert show];
+			[alert release];
+		}
+		
+		return NO;
+	}
+	
+	return YES;
+}
+
+
+// Updates the journal once Todo was or was not launched. The pending tasks
+// that went along stay pending unless they were imported.
++ (void)_recordTodoImport:(BOOL)imported tasks:(NSArray *)tasks journal:(AppigoImportJournal *)journal checkpoint:(AppigoImportJournalCheckpoint)checkpoint
+{
+	if (imported == YES)
+	{
+		[journal markImportedThroughCheckpoint:checkpoint];
+		return;
+	}
+	
+	// Keep the tasks so they are imported once Todo can be launched
+	[journal appendTasks:tasks];
+	[journal releaseCheckpoint:checkpoint];
+}
+
+
+// Writes the note to the pasteboard and builds the URL. Safe off the main
+// thread.
++ (NSURL *)_prepareNotebookImportWithNote:(AppigoNote *)note
+{
+	// Copy the note onto the pasteboard
+	NSString *importSourceAppID = [[NSBundle mainBundle] bundleIdentifier];
+	NSString *pasteboardName = [AppigoPasteboard _importPasteboardName];
+	
+	[AppigoPasteboard _setNote:note inPasteboardNamed:pasteboardName];
+	
+	APPIGO_TRACE_BEGIN(url);
+	NSURL *url = [AppigoURLBuilder notebookImportURLWithSourceAppID:importSourceAppID pasteboardName:pasteboardName];
+	APPIGO_TRACE_END(url, AppigoTraceEventURLBuild, 0);
+	
+	if (url == nil)
+	{
+		NSLog(@"Error creating import URL for pasteboard: %@", pasteboardName);
+		[[AppigoPasteboardManager sharedManager] removePasteboardNamed:pasteboardName];
+		return nil;
+	}
+	
+	return url;
+}
+
+
++ (void)_startNotebookImport:(AppigoImportOperation *)operation withNote:(AppigoNote *)note
+{
+	if ([AppigoPasteboard _isOnImportQueue] == YES)
+	{
+		[AppigoPasteboard _runNotebookImport:operation withNote:note];
+		return;
+	}
+	
+	[note retain];
+	dispatch_async([AppigoPasteboard _importQueue], ^{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[AppigoPasteboard _runNotebookImport:operation withNote:note];
+		[note release];
+		[pool release];
+	});
+}
+
+
+// On the import queue
++ (void)_runNotebookImport:(AppigoImportOperation *)operation withNote:(AppigoNote *)note
+{
+	AppigoDuplicateFilter *filter = [AppigoDuplicateFilter sharedFilter];
+	uint64_t hash = ([filter window] > 0.0) ? AppigoDuplicateFilterHashNote(note) : 0;
+	if ( (hash != 0) && ([filter isDuplicateImportWithHash:hash] == YES) )
+	{
+		[AppigoPasteboard _finishSuppressedImport:operation];
+		return;
+	}
+	
+	NSURL *url = nil;
+	if ([operation isCancelled] == NO)
+		url = [AppigoPasteboard _prepareNotebookImportWithNote:note];
+	
+	[AppigoPasteboard _finishImport:operation withURL:url duplicateHash:hash opener:^BOOL {
+		return [AppigoPasteboard _launchNotebookImportURL:url];
+	} cleanup:nil];
+}
+
+
+// Like _launchTodoImportURL:showAlert:, for Notebook
++ (BOOL)_launchNotebookImportURL:(NSURL *)url
+{
+	APPIGO_TRACE_BEGIN(open);
+	BOOL result = [[UIApplication sharedApplication] openURL:url];
+	APPIGO_TRACE_END(open, AppigoTraceEventOpenURL, result);
+	
+	if (result == NO)
+	{
+		NSLog(@"The user does not have Notebook installed.");
+		
+		if (_showErrorAlertsAutomatically == YES)
+		{
+			UIAlertView *alert = [[UIAlertView alloc] initWithTitle:NSLocalizedString(@"Purchase Notebook?", @"Alert view title when a user attempts to import a task into Notebook and they do not have it installed.")
+															message:NSLocalizedString(@"Import notes directly into Appigo Notebook. See more information on the App Store.", @"Message body of the alert to prompt a user to purchase Notebook if they do not have it installed and attempt to import a note.")
+														   delegate:[AppigoPasteboard _sharedInstance]
+												  cancelButtonTitle:NSLocalizedString(@"Cancel", @"Cancel button when prompting the user to purchase Notebook")
+												  otherButtonTitles:NSLocalizedString(@"More Info", @"More information button used during our prompt to ask users if they'd like more information about Appigo Notebook if they do not have it installed and try to import a note."), nil];
+			_appStoreURL = kAppigoNotebookAppStoreURL;
+			[alert show];
+			[alert release];
+		}
+		
+		return NO;
+	}
+	
+	return YES;
+}
+
+
+// Blocks until an import started with a completion signalling finished is
+// done. On the main thread, the main thread steps of this import and of the
+// imports queued before it run right here, since the main queue can not run
+// them while it waits.
++ (BOOL)_waitForImport:(AppigoImportOperation *)operation finished:(dispatch_semaphore_t)finished
+{
+	if ([NSThread isMainThread] == YES)
+	{
+		while ([operation isFinished] == NO)
+		{
+			dispatch_semaphore_wait(_mainThreadStepSignal, DISPATCH_TIME_FOREVER);
+			dispatch_block_t step = [AppigoPasteboard _nextMainThreadStep];
+			if (step != nil)
+				step();
+		}
+	}
+	else
+	{
+		dispatch_semaphore_wait(finished, DISPATCH_TIME_FOREVER);
+	}
+	
+	return [operation imported];
+}
+
+
+// Hops to the main thread to open the URL of a prepared import, unless it
+// was cancelled in the meantime, and finishes the operation there. An import
+// that did not happen is no longer a duplicate of anything.
+//
+// Every import writes the same pasteboard, so a prepared import holds the
+// import queue until its URL was opened. Only then is the pasteboard removed
+// after a cancelled or failed import, and cleanup run with whether the URL
+// was opened and the result, both on the import queue and before the next
+// import writes the pasteboard.
++ (void)_finishImport:(AppigoImportOperation *)operation withURL:(NSURL *)url duplicateHash:(uint64_t)duplicateHash opener:(BOOL (^)(void))opener cleanup:(void (^)(BOOL opened, BOOL imported))cleanup
+{
+	if (url == nil)
+	{
+		[AppigoPasteboard _performOnMainThread:^{
+			if (duplicateHash != 0)
+				[[AppigoDuplicateFilter sharedFilter] forgetImportWithHash:duplicateHash];
+			
+			[operation _finishImported:NO mainThreadStart:mach_absolute_time()];
+		}];
+		return;
+	}
+	
+	__block BOOL opened = NO;
+	__block BOOL imported = NO;
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	
+	[AppigoPasteboard _performOnMainThread:^{
+		uint64_t start = mach_absolute_time();
+		
+		if ([operation isCancelled] == NO)
+		{
+			opened = YES;
+			imported = opener();
+		}
+		
+		if ( (imported == NO) && (duplicateHash != 0) )
+			[[AppigoDuplicateFilter sharedFilter] forgetImportWithHash:duplicateHash];
+		
+		// Released before the completion runs, which may start another import
+		dispatch_semaphore_signal(done);
+		[operation _finishImported:imported mainThreadStart:start];
+	}];
+	
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	
+	if (imported == NO)
+		[[AppigoPasteboardManager sharedManager] removePasteboardNamed:[AppigoPasteboard _importPasteboardName]];
+	
+	if (cleanup != nil)
+		cleanup(opened, imported);
+}
+
+
+// A duplicate counts as imported, the import it repeats already launched the app
++ (void)_finishSuppressedImport:(AppigoImportOperation *)operation
+{
+	[AppigoPasteboard _performOnMainThread:^{
+		[operation _finishImported:YES mainThreadStart:mach_absolute_time()];
+	}];
+}
+
+
+// Every main thread step of an import goes through one FIFO, so that a
+// synchronous import waiting on the main thread can run them itself (see
+// _waitForImport:finished:). Otherwise the main queue runs them one by one.
++ (void)_performOnMainThread:(dispatch_block_t)step
+{
+	[AppigoPasteboard _importQueue];	// sets up the steps
+	
+	dispatch_block_t copiedStep = [step copy];
+	@synchronized(_mainThreadSteps)
+	{
+		[_mainThreadSteps addObject:copiedStep];
+	}
+	[copiedStep release];
+	
+	dispatch_semaphore_signal(_mainThreadStepSignal);
+	dispatch_async(dispatch_get_main_queue(), ^{
+		dispatch_block_t nextStep = [AppigoPasteboard _nextMainThreadStep];
+		if (nextStep == nil)
+			return;
+		
+		// Keeps the signal count in step with the FIFO, so a waiting import
+		// does not wake up for steps that already ran
+		dispatch_semaphore_wait(_mainThreadStepSignal, DISPATCH_TIME_NOW);
+		nextStep();
+	});
+}
+
+
+// Returns an autoreleased step, or nil if a waiting synchronous import
+// already ran every step
++ (dispatch_block_t)_nextMainThreadStep
+{
+	dispatch_block_t step = nil;
+	@synchronized(_mainThreadSteps)
+	{
+		if ([_mainThreadSteps count] > 0)
+		{
+			step = [[[_mainThreadSteps objectAtIndex:0] retain] autorelease];
+			[_mainThreadSteps removeObjectAtIndex:0];
+		}
+	}
+	
+	return step;
+}
+
+
++ (NSString *)_importPasteboardName
+{
+	return [NSString stringWithFormat:@"%@.%@", kAppigoPasteboardName, [[NSBundle mainBundle] bundleIdentifier]];
+}
+
+
+// Imports are encoded one at a time, in the order they were started
++ (dispatch_queue_t)_importQueue
+{
+	static dispatch_queue_t queue = NULL;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		queue = dispatch_queue_create("com.appigo.import", DISPATCH_QUEUE_SERIAL);
+		dispatch_queue_set_specific(queue, &_importQueueKey, &_importQueueKey, NULL);
+		
+		_mainThreadSteps = [[NSMutableArray alloc] init];
+		_mainThreadStepSignal = dispatch_semaphore_create(0);
+	});
+	
+	return queue;
+}
+
+
++ (BOOL)_isOnImportQueue
+{
+	return (dispatch_get_specific(&_importQueueKey) == &_importQueueKey);
+}
+
+
++ (void)_setTasks:(NSArray *)tasks inPasteboardNamed:(NSString *)pasteboardName
+{
+	if ([tasks count] == 0)
+		return;
+	
+	// Encode every task into its own pasteboard item so that the whole batch
+	// goes to the pasteboard server in a single write.
+	APPIGO_TRACE_BEGIN(encode);
+	NSUInteger threshold = [AppigoPasteboard _compressionThresholdForPasteboardNamed:pasteboardName];
+	NSMutableArray *items = [[NSMutableArray alloc] initWithCapacity:[tasks count]];
+	for (AppigoTask *task in tasks)
+		[items addObject:[AppigoPasteboard _pasteboardItemForTask:task compressionThreshold:threshold]];
+	APPIGO_TRACE_END(encode, AppigoTraceEventTaskEncode, [tasks count]);
+	
+	// Replace all pre-existing pasteboard items
+	[[AppigoPasteboardManager sharedManager] setItems:items forPasteboardNamed:pasteboardName];
+	[items release];
+	
+	// A delta against the replaced task would no longer apply
+	[AppigoPasteboard _setExportSnapshot:nil forPasteboardNamed:pasteboardName];
+}
+
+
++ (void)_setExportSnapshot:(AppigoTaskSnapshot *)snapshot forPasteboardNamed:(NSString *)pasteboardName
+{
+	@synchronized(self)
+	{
+		if (snapshot == nil)
+		{
+			[_exportSnapshots removeObjectForKey:pasteboardName];
+			return;
+		}
+		
+		if (_exportSnapshots == nil)
+			_exportSnapshots = [[NSMutableDictionary alloc] init];
+		
+		[_exportSnapshots setObject:snapshot forKey:pasteboardName];
+	}
+}
+
+
++ (NSData *)_dataForTask:(AppigoTask *)task
+{
+	NSMutableData *taskData = [[NSMutableData alloc] init];
+	NSKeyedArchiver *keyedArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:taskData];
+	[task encodeWithCoder:keyedArchiver];
+	[keyedArchiver finishEncoding];
+	[keyedArchiver release];
+	
+	return [taskData autorelease];
+}
+
+
++ (NSUInteger)_compressionThresholdForPasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return 0;
+	
+	@synchronized(self)
+	{
+		return [[_compressionThresholds objectForKey:pasteboardName] unsignedIntegerValue];
+	}
+}
+
+
++ (NSDictionary *)_pasteboardItemForTask:(AppigoTask *)task compressionThreshold:(NSUInteger)threshold
+{
+	NSMutableDictionary *dictionaryItem = [NSMutableDictionary dictionaryWithCapacity:2];
+	
+	// The binary representation goes first so that it is the one compressed
+	// when both are written
+	if (_pasteboardEncoding != AppigoPasteboardEncodingKeyedArchive)
+	{
+		[AppigoPasteboard _setPayload:[task binaryRepresentation]
+							  forType:kAppigoPasteboardTypeTaskBinary
+					   compressedType:kAppigoPasteboardTypeTaskCompressed
+							   inItem:dictionaryItem
+				 compressionThreshold:threshold];
+	}
+	
+	if (_pasteboardEncoding != AppigoPasteboardEncodingBinary)
+	{
+		[AppigoPasteboard _setPayload:[AppigoPasteboard _dataForTask:task]
+							  forType:kAppigoPasteboardTypeTask
+					   compressedType:kAppigoPasteboardTypeTaskCompressed
+							   inItem:dictionaryItem
+				 compressionThreshold:threshold];
+	}
+	
+	return dictionaryItem;
+}
+
+
++ (AppigoTask *)_taskFromBinaryData:(NSData *)binaryData keyedArchiveData:(NSData *)data
+{
+	// Share repeated lists, contexts and tags between the subtasks, unless the
+	// caller already set up a pool for a whole batch
+	AppigoStringPool *strings = nil;
+	if ([AppigoStringPool currentPool] == nil)
+	{
+		strings = [[AppigoStringPool alloc] init];
+		[strings activate];
+	}
+	
+	// Prefer the binary representation when it is present and readable
+	AppigoTask *task = nil;
+	if (binaryData != nil)
+		task = [[AppigoTask alloc] initWithBinaryData:binaryData];
+	
+	if ( (task == nil) && (data != nil) )
+	{
+		NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
+		task = [[AppigoTask alloc] initWithCoder:keyedUnarchiver];
+		[keyedUnarchiver release];
+	}
+	
+	[strings deactivate];
+	[strings release];
+	
+	return [task autorelease];
+}
+
+
++ (AppigoTask *)_taskFromCompressedData:(NSData *)compressedData
+{
+	NSData *data = AppigoDecompressData(compressedData);
+	if (data == nil)
+		return nil;
+	
+	// The frame holds whichever representation was compressed
+	if (AppigoBinaryDataHasPreamble(data) == YES)
+		return [AppigoPasteboard _taskFromBinaryData:data keyedArchiveData:nil];
+	
+	return [AppigoPasteboard _taskFromBinaryData:nil keyedArchiveData:data];
+}
+
+
+// Keeps the task of a template import that failed, so it is imported once Todo can be launched
++ (void)_journalTaskArchive:(NSData *)archive inJournal:(AppigoImportJournal *)journal
+{
+	AppigoTask *task = [AppigoPasteboard _taskFromBinaryData:nil keyedArchiveData:archive];
+	if (task == nil)
+	{
+		NSLog(@"Unable to decode the archive of a task template import, it is not journaled");
+		return;
+	}
+	
+	[journal appendTasks:[NSArray arrayWithObject:task]];
+}
+
+
++ (AppigoNote *)_noteFromBinaryData:(NSData *)binaryData keyedArchiveData:(NSData *)data
+{
+	// Prefer the binary representation when it is present and readable
+	if (binaryData != nil)
+	{
+		AppigoNote *note = [[AppigoNote alloc] initWithBinaryData:binaryData];
+		if (note != nil)
+			return [note autorelease];
+	}
+	
+	if (data == nil)
+		return nil;
+	
+	NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
+	AppigoNote *note = [[[AppigoNote alloc] initWithCoder:keyedUnarchiver] autorelease];
+	[keyedUnarchiver release];
+	
+	return note;
+}
+
+
++ (AppigoNote *)_noteFromCompressedData:(NSData *)compressedData
+{
+	NSData *data = AppigoDecompressData(compressedData);
+	if (data == nil)
+		return nil;
+	
+	if (AppigoBinaryDataHasPreamble(data) == YES)
+		return [AppigoPasteboard _noteFromBinaryData:data keyedArchiveData:nil];
+	
+	return [AppigoPasteboard _noteFromBinaryData:nil keyedArchiveData:data];
+}
+
+
+// Adds a payload to a pasteboard item, compressed when it is over the
+// threshold of its pasteboard and nothing else in the item was compressed yet
++ (void)_setPayload:(NSData *)payload forType:(NSString *)type compressedType:(NSString *)compressedType inItem:(NSMutableDictionary *)item compressionThreshold:(NSUInteger)threshold
+{
+	if (payload == nil)
+		return;
+	
+	if ( (threshold > 0) && ([payload length] >= threshold) && ([item objectForKey:compressedType] == nil) )
+	{
+		NSData *compressedData = AppigoCompressData(payload);
+		if (compressedData != nil)
+		{
+			[item setObject:compressedData forKey:compressedType];
+			return;
+		}
+	}
+	
+	[item setObject:payload forKey:type];
+}
+
+
++ (void)_setNote:(AppigoNote *)note inPasteboardNamed:(NSString *)pasteboardName
+{
+	// Validate the note to make sure it's not nil and at least has a name
+	if (note == nil)
+		return;
+	
+	NSUInteger threshold = [AppigoPasteboard _compressionThresholdForPasteboardNamed:pasteboardName];
+	NSMutableDictionary *dictionaryItem = [[NSMutableDictionary alloc] initWithCapacity:2];
+	
+	if (_pasteboardEncoding != AppigoPasteboardEncodingKeyedArchive)
+	{
+		[AppigoPasteboard _setPayload:[note binaryRepresentation]
+							  forType:kAppigoPasteboardTypeNoteBinary
+					   compressedType:kAppigoPasteboardTypeNoteCompressed
+							   inItem:dictionaryItem
+				 compressionThreshold:threshold];
+	}
+	
+	if (_pasteboardEncoding != AppigoPasteboardEncodingBinary)
+	{
+		NSMutableData *noteData = [[NSMutableData alloc] init];
+		NSKeyedArchiver *keyedArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:noteData];
+		[note encodeWithCoder:keyedArchiver];
+		[keyedArchiver finishEncoding];
+		
+		[AppigoPasteboard _setPayload:noteData
+							  forType:kAppigoPasteboardTypeNote
+					   compressedType:kAppigoPasteboardTypeNoteCompressed
+							   inItem:dictionaryItem
+				 compressionThreshold:threshold];
+		[keyedArchiver release];
+		[noteData release];
+	}
+	
+	// Replace all pre-existing pasteboard items
+	[[AppigoPasteboardManager sharedManager] setItems:[NSArray arrayWithObject:dictionaryItem] forPasteboardNamed:pasteboardName];
 	[dictionaryItem release];
-	[keyedArchiver release];
-	[noteData release];
 }
 
 
@@ -0,0 +1,93 @@
+/**
+
+ Appigo Third Party Integration - AppigoPasteboardManager.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoPasteboardManager.h
+ @brief Keeps named pasteboards alive so that they can be reused between imports.
+
+ @class AppigoPasteboardManager AppigoPasteboardManager.h
+ @brief Keeps named pasteboards alive so that they can be reused between imports.
+
+ Writing to a named pasteboard used to take four round trips to the pasteboard
+ server before the items were even set: look the pasteboard up, remove it,
+ create it again and mark it persistent. The manager keeps the pasteboards it
+ created and writes straight to them instead.
+
+ Removing and recreating the pasteboard works around a problem found in iOS
+ 4.0, where apps that had already used a pasteboard, stayed running in the
+ background and used the pasteboard again were not able to change its items.
+ The manager keeps that workaround correct by remembering the changeCount of
+ every pasteboard after its own last write. A reused pasteboard whose
+ changeCount did not advance after a write is assumed to be affected by the
+ problem and is removed and recreated exactly like before.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+
+#pragma mark -
+@interface AppigoPasteboardManager : NSObject
+{
+@private
+	NSMutableDictionary	*_pasteboards;
+	NSMutableDictionary	*_changeCounts;
+
+	NSUInteger			_writeCount;
+	NSUInteger			_reuseCount;
+	NSUInteger			_roundTripCount;
+	NSUInteger			_baselineRoundTripCount;
+}
+
+/** The number of times items were written through the manager. */
+@property (nonatomic, readonly) NSUInteger writeCount;
+
+/** The number of writes that reused a live pasteboard. */
+@property (nonatomic, readonly) NSUInteger reuseCount;
+
+/** The number of pasteboard server round trips made by the manager. */
+@property (nonatomic, readonly) NSUInteger roundTripCount;
+
+/**
+ The number of pasteboard server round trips avoided compared to removing and
+ recreating the pasteboard on every write.
+ */
+@property (nonatomic, readonly) NSUInteger roundTripsSaved;
+
+
+/**
+ Get the shared pasteboard manager.
+
+ @return Returns the shared pasteboard manager.
+ */
++ (AppigoPasteboardManager *)sharedManager;
+
+/**
+ Replace all of the items of a persistent named pasteboard.
+
+ @param items An array of pasteboard item dictionaries.
+ @param pasteboardName The name of the pasteboard.
+ @return Returns the pasteboard that the items were written to.
+ */
+- (UIPasteboard *)setItems:(NSArray *)items forPasteboardNamed:(NSString *)pasteboardName;
+
+/**
+ Remove a named pasteboard and forget about it.
+
+ @param pasteboardName The name of the pasteboard.
+ */
+- (void)removePasteboardNamed:(NSString *)pasteboardName;
+
+/**
+ Reset all of the counters to zero.
+ */
+- (void)resetStatistics;
+
+@end
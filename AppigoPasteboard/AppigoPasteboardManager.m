@@ -0,0 +1,218 @@
+/**
+
+ Appigo Third Party Integration - AppigoPasteboardManager.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoPasteboardManager.h"
+#import "AppigoTrace.h"
+
+
+// The number of round trips the remove-and-recreate write takes: look up,
+// remove, create, mark persistent and set the items.
+#define kAppigoPasteboardRecreateRoundTrips		5
+
+
+static AppigoPasteboardManager *_sharedManager = nil;
+
+
+#pragma mark -
+@interface AppigoPasteboardManager (Private)
+
+- (UIPasteboard *)_recreatePasteboardNamed:(NSString *)pasteboardName;
+
+@end
+
+
+#pragma mark -
+@implementation AppigoPasteboardManager
+
+
+@synthesize writeCount = _writeCount;
+@synthesize reuseCount = _reuseCount;
+@synthesize roundTripCount = _roundTripCount;
+
+
++ (AppigoPasteboardManager *)sharedManager
+{
+	@synchronized(self)
+	{
+		if (_sharedManager == nil)
+			_sharedManager = [[AppigoPasteboardManager alloc] init];
+	}
+
+	return _sharedManager;
+}
+
+
+- (id)init
+{
+	if (self = [super init])
+	{
+		_pasteboards = [[NSMutableDictionary alloc] init];
+		_changeCounts = [[NSMutableDictionary alloc] init];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	[_pasteboards release];
+	[_changeCounts release];
+
+	[super dealloc];
+}
+
+
+- (NSUInteger)roundTripsSaved
+{
+	@synchronized(self)
+	{
+		if (_baselineRoundTripCount <= _roundTripCount)
+			return 0;
+
+		return _baselineRoundTripCount - _roundTripCount;
+	}
+}
+
+
+- (UIPasteboard *)setItems:(NSArray *)items forPasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return nil;
+
+	APPIGO_TRACE_BEGIN(write);
+
+	@synchronized(self)
+	{
+		_writeCount++;
+		_baselineRoundTripCount += kAppigoPasteboardRecreateRoundTrips;
+
+		UIPasteboard *pasteboard = [_pasteboards objectForKey:pasteboardName];
+		NSNumber *lastChangeCount = [_changeCounts objectForKey:pasteboardName];
+
+		if ( (pasteboard != nil) && (lastChangeCount != nil) )
+		{
+			pasteboard.items = items;
+			_roundTripCount += 2;
+
+			// If the change count did not move, the write was swallowed (the
+			// iOS 4.0 problem) and the pasteboard has to be recreated.
+			NSInteger changeCount = pasteboard.changeCount;
+			if (changeCount != [lastChangeCount integerValue])
+			{
+				[_changeCounts setObject:[NSNumber numberWithInteger:changeCount] forKey:pasteboardName];
+				_reuseCount++;
+				APPIGO_TRACE_END(write, AppigoTraceEventPasteboardWrite, [items count]);
+				return [[pasteboard retain] autorelease];
+			}
+		}
+
+		pasteboard = [self _recreatePasteboardNamed:pasteboardName];
+		pasteboard.items = items;
+		_roundTripCount += 2;
+
+		if (pasteboard != nil)
+			[_changeCounts setObject:[NSNumber numberWithInteger:pasteboard.changeCount] forKey:pasteboardName];
+
+		APPIGO_TRACE_END(write, AppigoTraceEventPasteboardWrite, [items count]);
+		return pasteboard;
+	}
+}
+
+
+- (void)removePasteboardNamed:(NSString *)pasteboardName
+{
+	if (pasteboardName == nil)
+		return;
+
+	APPIGO_TRACE_BEGIN(remove);
+
+	@synchronized(self)
+	{
+		[_pasteboards removeObjectForKey:pasteboardName];
+		[_changeCounts removeObjectForKey:pasteboardName];
+
+		[UIPasteboard removePasteboardWithName:pasteboardName];
+		_roundTripCount++;
+		_baselineRoundTripCount++;
+	}
+
+	APPIGO_TRACE_END(remove, AppigoTraceEventPasteboardRemove, 0);
+}
+
+
+- (void)resetStatistics
+{
+	@synchronized(self)
+	{
+		_writeCount = 0;
+		_reuseCount = 0;
+		_roundTripCount = 0;
+		_baselineRoundTripCount = 0;
+	}
+}
+
+
+- (NSString *)description
+{
+	@synchronized(self)
+	{
+		return [NSString stringWithFormat:@"<%@: %lu writes, %lu reused, %lu round trips, %lu saved>",
+				NSStringFromClass([self class]),
+				(unsigned long)_writeCount,
+				(unsigned long)_reuseCount,
+				(unsigned long)_roundTripCount,
+				(unsigned long)[self roundTripsSaved]];
+	}
+}
+
+
+@end
+
+
+#pragma mark -
+
+
+@implementation AppigoPasteboardManager (Private)
+
+
+- (UIPasteboard *)_recreatePasteboardNamed:(NSString *)pasteboardName
+{
+	APPIGO_TRACE_BEGIN(create);
+
+	[_pasteboards removeObjectForKey:pasteboardName];
+	[_changeCounts removeObjectForKey:pasteboardName];
+
+	// If the pasteboard exists, remove it first.  This fixes a problem we found
+	// in iOS 4.0 where apps that had already used this pasteboard, stayed
+	// running in the background, and use the pasteboard again were not able to
+	// change the items in the pasteboard without closing the app down first.
+	UIPasteboard *existingPasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:NO];
+	_roundTripCount++;
+	if (existingPasteboard != nil)
+	{
+		[UIPasteboard removePasteboardWithName:pasteboardName];
+		_roundTripCount++;
+	}
+
+	// Create the pasteboard and make sure it gets marked as persistent
+	UIPasteboard *pasteboard = [UIPasteboard pasteboardWithName:pasteboardName create:YES];
+	pasteboard.persistent = YES;
+	_roundTripCount += 2;
+
+	if (pasteboard != nil)
+		[_pasteboards setObject:pasteboard forKey:pasteboardName];
+
+	APPIGO_TRACE_END(create, AppigoTraceEventPasteboardCreate, 0);
+
+	return pasteboard;
+}
+
+
+@end
@@ -0,0 +1,89 @@
+/**
+
+ Appigo Third Party Integration - AppigoRecurrence.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoRecurrence.h
+ @brief Compiles AppigoTask repeat values into rules and expands their occurrences.
+
+ The repeat property of AppigoTask is an integer code and advancedRepeat is a
+ string in one of the formats documented on AppigoTask. AppigoRecurrenceCompile
+ validates both and turns them into an AppigoRecurrenceRule, a small struct
+ that can be expanded into occurrences without going through NSCalendar.
+
+ Occurrences are expressed in epoch days, the number of days since
+ 1970-01-01 in the proleptic Gregorian calendar. Use AppigoRecurrenceDayFromDate
+ and AppigoRecurrenceDateFromDay to convert from and to dates in a calendar.
+
+ @code
+ AppigoRecurrenceRule rule;
+ if (AppigoRecurrenceCompile(task.repeat, task.advancedRepeat, &rule) == YES)
+ {
+	int32_t days[10];
+	NSUInteger count = AppigoRecurrenceExpand(&rule, AppigoRecurrenceDayFromDate(task.dueDate, nil), days, 10);
+ }
+ @endcode
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "AppigoTask.h"
+#import "AppigoRecurrenceRule.h"
+
+
+/**
+ Compile a repeat value and advanced repeat string, see
+ AppigoRecurrenceCompileRepeat.
+
+ @param repeat The repeat value of a task.
+ @param advancedRepeat The advanced repeat string, only used when repeat is 50 or 150.
+ @param rule Receives the compiled rule, may be NULL to only validate.
+ @return Returns NO if the repeat value or the advanced repeat string is not valid.
+ */
+BOOL AppigoRecurrenceCompile(NSInteger repeat, NSString *advancedRepeat, AppigoRecurrenceRule *rule);
+
+/**
+ Get the epoch day of the calendar day a date falls on.
+
+ @param date The date.
+ @param calendar The calendar, or nil for the current calendar.
+ */
+int32_t AppigoRecurrenceDayFromDate(NSDate *date, NSCalendar *calendar);
+
+/**
+ Get the start of the calendar day for an epoch day.
+
+ @param epochDay The epoch day.
+ @param calendar The calendar, or nil for the current calendar.
+ */
+NSDate *AppigoRecurrenceDateFromDay(int32_t epochDay, NSCalendar *calendar);
+
+
+#pragma mark -
+@interface AppigoTask (AppigoRecurrence)
+
+/**
+ Compile the repeat and advancedRepeat properties of the task.
+
+ @param rule Receives the compiled rule, may be NULL to only validate.
+ @return Returns NO if the task's repeat information is not valid.
+ */
+- (BOOL)compileRecurrenceRule:(AppigoRecurrenceRule *)rule;
+
+/**
+ Get the next due dates of a repeating task, starting after its due date.
+
+ @param count The maximum number of dates to return.
+ @return Returns an array of NSDate objects, empty if the task has no due date
+ or does not repeat from its due date, or nil if its repeat information is not valid.
+ */
+- (NSArray *)nextDueDates:(NSUInteger)count;
+
+@end
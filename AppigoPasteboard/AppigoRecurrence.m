@@ -0,0 +1,106 @@
+/**
+
+ Appigo Third Party Integration - AppigoRecurrence.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoRecurrence.h"
+
+
+#pragma mark -
+#pragma mark Dates
+
+
+int32_t AppigoRecurrenceDayFromDate(NSDate *date, NSCalendar *calendar)
+{
+	if (calendar == nil)
+		calendar = [NSCalendar currentCalendar];
+
+	NSDateComponents *components = [calendar components:(NSYearCalendarUnit | NSMonthCalendarUnit | NSDayCalendarUnit) fromDate:date];
+	return AppigoRecurrenceDayFromCivil((int32_t)[components year], (uint32_t)[components month], (uint32_t)[components day]);
+}
+
+
+NSDate *AppigoRecurrenceDateFromDay(int32_t epochDay, NSCalendar *calendar)
+{
+	if (calendar == nil)
+		calendar = [NSCalendar currentCalendar];
+
+	int32_t year;
+	uint32_t month, day;
+	AppigoRecurrenceCivilFromDay(epochDay, &year, &month, &day);
+
+	NSDateComponents *components = [[NSDateComponents alloc] init];
+	[components setYear:year];
+	[components setMonth:month];
+	[components setDay:day];
+
+	NSDate *date = [calendar dateFromComponents:components];
+	[components release];
+
+	return date;
+}
+
+
+BOOL AppigoRecurrenceCompile(NSInteger repeat, NSString *advancedRepeat, AppigoRecurrenceRule *rule)
+{
+	const char *text = [advancedRepeat UTF8String];
+	return (AppigoRecurrenceCompileRepeat((long)repeat, text, (text != NULL) ? strlen(text) : 0, rule) != 0) ? YES : NO;
+}
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoRecurrence)
+
+
+- (BOOL)compileRecurrenceRule:(AppigoRecurrenceRule *)rule
+{
+	return AppigoRecurrenceCompile(self.repeat, self.advancedRepeat, rule);
+}
+
+
+- (NSArray *)nextDueDates:(NSUInteger)count
+{
+	AppigoRecurrenceRule rule;
+	if ([self compileRecurrenceRule:&rule] == NO)
+		return nil;
+
+	NSDate *dueDate = self.dueDate;
+	if ( (dueDate == nil) || (rule.fromCompletion != 0) || (count == 0) )
+		return [NSArray array];
+
+	int32_t *days = malloc(sizeof(int32_t) * count);
+	if (days == NULL)
+		return [NSArray array];
+
+	NSCalendar *calendar = [NSCalendar currentCalendar];
+	NSUInteger dayCount = AppigoRecurrenceExpand(&rule, AppigoRecurrenceDayFromDate(dueDate, calendar), days, count);
+	NSMutableArray *dates = [NSMutableArray arrayWithCapacity:dayCount];
+
+	// Keep the time of day of the due date
+	NSDateComponents *components = [calendar components:(NSHourCalendarUnit | NSMinuteCalendarUnit | NSSecondCalendarUnit) fromDate:dueDate];
+
+	for (NSUInteger i = 0; i < dayCount; i++)
+	{
+		int32_t year;
+		uint32_t month, day;
+		AppigoRecurrenceCivilFromDay(days[i], &year, &month, &day);
+
+		[components setYear:year];
+		[components setMonth:month];
+		[components setDay:day];
+
+		NSDate *date = [calendar dateFromComponents:components];
+		if (date != nil)
+			[dates addObject:date];
+	}
+
+	free(days);
+
+	return dates;
+}
+
+@end
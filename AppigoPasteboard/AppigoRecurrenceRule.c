@@ -0,0 +1,528 @@
+/**
+
+ Appigo Third Party Integration - AppigoRecurrenceRule.c
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#include "AppigoRecurrenceRule.h"
+
+#include <string.h>
+
+
+// Advanced repeat strings are short, anything longer is not valid
+#define kAppigoRecurrenceMaxWords		16
+#define kAppigoRecurrenceMaxWordLength	16
+
+// The largest interval accepted in an advanced repeat string
+#define kAppigoRecurrenceMaxInterval	999
+
+
+typedef struct
+{
+	char	text[kAppigoRecurrenceMaxWordLength];
+	size_t	length;
+} AppigoRecurrenceWord;
+
+
+// Calendar arithmetic
+
+
+// Days from civil and civil from days use the era based algorithms from
+// Howard Hinnant's "chrono-Compatible Low-Level Date Algorithms"
+
+int32_t AppigoRecurrenceDayFromCivil(int32_t year, uint32_t month, uint32_t day)
+{
+	year -= month <= 2;
+	int32_t era = (year >= 0 ? year : year - 399) / 400;
+	uint32_t yearOfEra = (uint32_t)(year - era * 400);
+	uint32_t dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	uint32_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+
+	return era * 146097 + (int32_t)dayOfEra - 719468;
+}
+
+
+void AppigoRecurrenceCivilFromDay(int32_t epochDay, int32_t *year, uint32_t *month, uint32_t *day)
+{
+	epochDay += 719468;
+	int32_t era = (epochDay >= 0 ? epochDay : epochDay - 146096) / 146097;
+	uint32_t dayOfEra = (uint32_t)(epochDay - era * 146097);
+	uint32_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+	uint32_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+	uint32_t monthPrime = (5 * dayOfYear + 2) / 153;
+	uint32_t m = monthPrime < 10 ? monthPrime + 3 : monthPrime - 9;
+
+	*year = (int32_t)yearOfEra + era * 400 + (m <= 2);
+	*month = m;
+	*day = dayOfYear - (153 * monthPrime + 2) / 5 + 1;
+}
+
+
+uint32_t AppigoRecurrenceWeekdayFromDay(int32_t epochDay)
+{
+	// 1970-01-01 was a Thursday
+	int32_t weekday = (epochDay + 4) % 7;
+	return (uint32_t)(weekday < 0 ? weekday + 7 : weekday);
+}
+
+
+static inline int AppigoRecurrenceIsLeapYear(int32_t year)
+{
+	return (year % 4 == 0) && ((year % 100 != 0) || (year % 400 == 0));
+}
+
+
+static inline uint32_t AppigoRecurrenceDaysInMonth(int32_t year, uint32_t month)
+{
+	static const uint8_t daysInMonth[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+	if ( (month == 2) && AppigoRecurrenceIsLeapYear(year) )
+		return 29;
+
+	return daysInMonth[month - 1];
+}
+
+
+// The epoch day of an ordinal weekday in a month, or INT32_MIN if the month
+// does not have that many of them
+static int32_t AppigoRecurrenceDayOfOrdinalWeekday(int32_t year, uint32_t month, uint32_t weekday, int32_t ordinal)
+{
+	uint32_t daysInMonth = AppigoRecurrenceDaysInMonth(year, month);
+
+	if (ordinal < 0)
+	{
+		int32_t lastDay = AppigoRecurrenceDayFromCivil(year, month, daysInMonth);
+		return lastDay - (int32_t)((AppigoRecurrenceWeekdayFromDay(lastDay) + 7 - weekday) % 7);
+	}
+
+	int32_t firstDay = AppigoRecurrenceDayFromCivil(year, month, 1);
+	uint32_t dayOfMonth = 1 + (weekday + 7 - AppigoRecurrenceWeekdayFromDay(firstDay)) % 7 + (uint32_t)(ordinal - 1) * 7;
+	if (dayOfMonth > daysInMonth)
+		return INT32_MIN;
+
+	return firstDay + (int32_t)dayOfMonth - 1;
+}
+
+
+// Compiling
+
+
+static void AppigoRecurrenceRuleInit(AppigoRecurrenceRule *rule, AppigoRecurrenceKind kind, uint16_t interval)
+{
+	memset(rule, 0, sizeof(AppigoRecurrenceRule));
+	rule->kind = kind;
+	rule->interval = interval;
+}
+
+
+static inline int AppigoRecurrenceWordIs(const AppigoRecurrenceWord *word, const char *text)
+{
+	return strcmp(word->text, text) == 0;
+}
+
+
+// Split text into lowercase words at whitespace and commas
+static int AppigoRecurrenceSplitWords(const char *text, size_t length, AppigoRecurrenceWord *words, size_t *wordCount)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+	while (i < length)
+	{
+		char c = text[i];
+		if ( (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == ',') )
+		{
+			i++;
+			continue;
+		}
+
+		if (count == kAppigoRecurrenceMaxWords)
+			return 0;
+
+		AppigoRecurrenceWord *word = &words[count++];
+		word->length = 0;
+
+		while (i < length)
+		{
+			c = text[i];
+			if ( (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r') || (c == ',') )
+				break;
+
+			if (word->length == kAppigoRecurrenceMaxWordLength - 1)
+				return 0;
+
+			word->text[word->length++] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+			i++;
+		}
+
+		word->text[word->length] = '\0';
+	}
+
+	*wordCount = count;
+	return 1;
+}
+
+
+// A positive number of at most three digits
+static int AppigoRecurrenceParseInterval(const AppigoRecurrenceWord *word, uint16_t *interval)
+{
+	if ( (word->length == 0) || (word->length > 3) )
+		return 0;
+
+	uint16_t value = 0;
+	for (size_t i = 0; i < word->length; i++)
+	{
+		if ( (word->text[i] < '0') || (word->text[i] > '9') )
+			return 0;
+
+		value = value * 10 + (uint16_t)(word->text[i] - '0');
+	}
+
+	if ( (value == 0) || (value > kAppigoRecurrenceMaxInterval) )
+		return 0;
+
+	*interval = value;
+	return 1;
+}
+
+
+// Returns the weekday (0 is Sunday) or -1. Plurals ("Mondays") and three
+// letter abbreviations are accepted.
+static int AppigoRecurrenceParseWeekday(const AppigoRecurrenceWord *word)
+{
+	static const char *names[7] = { "sunday", "monday", "tuesday", "wednesday", "thursday", "friday", "saturday" };
+
+	size_t length = word->length;
+	if ( (length > 6) && (word->text[length - 1] == 's') )
+		length--;
+
+	for (int weekday = 0; weekday < 7; weekday++)
+	{
+		if ( ((length == 3) || (length == strlen(names[weekday]))) && (strncmp(word->text, names[weekday], length) == 0) )
+			return weekday;
+	}
+
+	return -1;
+}
+
+
+// 1st, 2nd, first, second... fifth and last. Returns 0 if word is not an ordinal.
+static int8_t AppigoRecurrenceParseOrdinal(const AppigoRecurrenceWord *word)
+{
+	static const char *names[5] = { "first", "second", "third", "fourth", "fifth" };
+	static const char *suffixes[5] = { "st", "nd", "rd", "th", "th" };
+
+	if (AppigoRecurrenceWordIs(word, "last"))
+		return -1;
+
+	for (int i = 0; i < 5; i++)
+	{
+		if (AppigoRecurrenceWordIs(word, names[i]))
+			return (int8_t)(i + 1);
+
+		if ( (word->length == 3) && (word->text[0] == '1' + i) && (strcmp(word->text + 1, suffixes[i]) == 0) )
+			return (int8_t)(i + 1);
+	}
+
+	return 0;
+}
+
+
+// Every X <days, weeks, months, years>
+// Every <Monday, Tuesday...Sunday, Weekday, Weekend>, and lists of weekdays
+static int AppigoRecurrenceCompileEvery(const AppigoRecurrenceWord *words, size_t count, AppigoRecurrenceRule *rule)
+{
+	if (count == 0)
+		return 0;
+
+	uint16_t interval = 1;
+	size_t index = 0;
+
+	if (AppigoRecurrenceWordIs(&words[0], "other"))
+	{
+		interval = 2;
+		index++;
+	}
+	else if (AppigoRecurrenceParseInterval(&words[0], &interval))
+		index++;
+
+	if (index == count)
+		return 0;
+
+	if (index + 1 == count)
+	{
+		const AppigoRecurrenceWord *unit = &words[index];
+
+		if ( (AppigoRecurrenceWordIs(unit, "day")) || (AppigoRecurrenceWordIs(unit, "days")) )
+		{
+			AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindDaily, interval);
+			return 1;
+		}
+		if ( (AppigoRecurrenceWordIs(unit, "week")) || (AppigoRecurrenceWordIs(unit, "weeks")) )
+		{
+			AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindWeekly, interval);
+			return 1;
+		}
+		if ( (AppigoRecurrenceWordIs(unit, "month")) || (AppigoRecurrenceWordIs(unit, "months")) )
+		{
+			AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindMonthly, interval);
+			return 1;
+		}
+		if ( (AppigoRecurrenceWordIs(unit, "year")) || (AppigoRecurrenceWordIs(unit, "years")) )
+		{
+			AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindYearly, interval);
+			return 1;
+		}
+	}
+
+	// The rest is a list of weekdays, optionally joined with "and"
+	uint8_t mask = 0;
+	for (; index < count; index++)
+	{
+		const AppigoRecurrenceWord *word = &words[index];
+
+		if (AppigoRecurrenceWordIs(word, "and"))
+			continue;
+
+		if ( (AppigoRecurrenceWordIs(word, "weekday")) || (AppigoRecurrenceWordIs(word, "weekdays")) )
+			mask |= kAppigoRecurrenceWeekdays;
+		else if ( (AppigoRecurrenceWordIs(word, "weekend")) || (AppigoRecurrenceWordIs(word, "weekends")) )
+			mask |= kAppigoRecurrenceWeekend;
+		else
+		{
+			int weekday = AppigoRecurrenceParseWeekday(word);
+			if (weekday < 0)
+				return 0;
+
+			mask |= (uint8_t)(1 << weekday);
+		}
+	}
+
+	if (mask == 0)
+		return 0;
+
+	AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindWeekly, interval);
+	rule->weekdayMask = mask;
+	return 1;
+}
+
+
+// On the X <Monday...Sunday> of the month
+static int AppigoRecurrenceCompileOnThe(const AppigoRecurrenceWord *words, size_t count, AppigoRecurrenceRule *rule)
+{
+	size_t index = 0;
+
+	if ( (index < count) && (AppigoRecurrenceWordIs(&words[index], "the")) )
+		index++;
+
+	if (count - index < 2)
+		return 0;
+
+	int8_t ordinal = AppigoRecurrenceParseOrdinal(&words[index++]);
+	int weekday = AppigoRecurrenceParseWeekday(&words[index++]);
+	if ( (ordinal == 0) || (weekday < 0) )
+		return 0;
+
+	// "of the month", "of each month", "of every month"
+	if (index < count)
+	{
+		if ( (count - index != 3) || (AppigoRecurrenceWordIs(&words[index], "of") == 0) || (AppigoRecurrenceWordIs(&words[index + 2], "month") == 0) )
+			return 0;
+
+		const AppigoRecurrenceWord *determiner = &words[index + 1];
+		if ( (AppigoRecurrenceWordIs(determiner, "the") == 0) && (AppigoRecurrenceWordIs(determiner, "each") == 0) && (AppigoRecurrenceWordIs(determiner, "every") == 0) )
+			return 0;
+	}
+
+	AppigoRecurrenceRuleInit(rule, AppigoRecurrenceKindMonthlyByWeekday, 1);
+	rule->weekday = (uint8_t)weekday;
+	rule->ordinal = ordinal;
+	return 1;
+}
+
+
+int AppigoRecurrenceCompileAdvanced(const char *text, size_t length, AppigoRecurrenceRule *rule)
+{
+	AppigoRecurrenceWord words[kAppigoRecurrenceMaxWords];
+	size_t count = 0;
+
+	if ( (text == NULL) || (AppigoRecurrenceSplitWords(text, length, words, &count) == 0) || (count == 0) )
+		return 0;
+
+	if (AppigoRecurrenceWordIs(&words[0], "every"))
+		return AppigoRecurrenceCompileEvery(words + 1, count - 1, rule);
+
+	if (AppigoRecurrenceWordIs(&words[0], "on"))
+		return AppigoRecurrenceCompileOnThe(words + 1, count - 1, rule);
+
+	return 0;
+}
+
+
+int AppigoRecurrenceCompileRepeat(long repeat, const char *advancedRepeat, size_t length, AppigoRecurrenceRule *rule)
+{
+	AppigoRecurrenceRule compiled;
+	int fromCompletion = 0;
+
+	if (repeat > kAppigoRecurrenceRepeatFromCompletion)
+	{
+		repeat -= kAppigoRecurrenceRepeatFromCompletion;
+		fromCompletion = 1;
+	}
+
+	switch (repeat)
+	{
+		case kAppigoRecurrenceRepeatNone:
+			if (fromCompletion != 0)
+				return 0;
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindNone, 0);
+			break;
+		case 1:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindWeekly, 1);
+			break;
+		case 2:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindMonthly, 1);
+			break;
+		case 3:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindYearly, 1);
+			break;
+		case 4:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindDaily, 1);
+			break;
+		case 5:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindWeekly, 2);
+			break;
+		case 6:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindMonthly, 2);
+			break;
+		case 7:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindMonthly, 6);
+			break;
+		case 8:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindMonthly, 3);
+			break;
+		case 9:
+			AppigoRecurrenceRuleInit(&compiled, AppigoRecurrenceKindWithParent, 0);
+			break;
+		case kAppigoRecurrenceRepeatAdvanced:
+			if (AppigoRecurrenceCompileAdvanced(advancedRepeat, length, &compiled) == 0)
+				return 0;
+			break;
+		default:
+			return 0;
+	}
+
+	compiled.fromCompletion = (uint8_t)fromCompletion;
+
+	if (rule != NULL)
+		*rule = compiled;
+
+	return 1;
+}
+
+
+// Expanding
+
+
+size_t AppigoRecurrenceExpand(const AppigoRecurrenceRule *rule, int32_t anchorDay, int32_t *days, size_t count)
+{
+	size_t written = 0;
+	int32_t interval = rule->interval;
+
+	if ( (count == 0) || (interval == 0) )
+		return 0;
+
+	switch (rule->kind)
+	{
+		case AppigoRecurrenceKindDaily:
+		{
+			int32_t day = anchorDay;
+			while (written < count)
+			{
+				day += interval;
+				days[written++] = day;
+			}
+			break;
+		}
+		case AppigoRecurrenceKindWeekly:
+		{
+			if (rule->weekdayMask == 0)
+			{
+				int32_t day = anchorDay;
+				while (written < count)
+				{
+					day += 7 * interval;
+					days[written++] = day;
+				}
+				break;
+			}
+
+			// Walk the weeks (starting on Sunday) that are interval weeks
+			// apart, beginning with the week of the anchor
+			int32_t weekStart = anchorDay - (int32_t)AppigoRecurrenceWeekdayFromDay(anchorDay);
+			while (written < count)
+			{
+				for (uint32_t weekday = 0; (weekday < 7) && (written < count); weekday++)
+				{
+					int32_t day = weekStart + (int32_t)weekday;
+					if ( ((rule->weekdayMask & (1 << weekday)) != 0) && (day > anchorDay) )
+						days[written++] = day;
+				}
+
+				weekStart += 7 * interval;
+			}
+			break;
+		}
+		case AppigoRecurrenceKindMonthly:
+		case AppigoRecurrenceKindYearly:
+		case AppigoRecurrenceKindMonthlyByWeekday:
+		{
+			int32_t year;
+			uint32_t month, dayOfMonth;
+			AppigoRecurrenceCivilFromDay(anchorDay, &year, &month, &dayOfMonth);
+
+			int32_t monthStep = (rule->kind == AppigoRecurrenceKindYearly) ? 12 * interval : interval;
+			int64_t monthIndex = (int64_t)year * 12 + (month - 1);
+
+			// Monthly by weekday rules may still fall later in the anchor's month
+			if (rule->kind != AppigoRecurrenceKindMonthlyByWeekday)
+				monthIndex += monthStep;
+
+			// A month without a fifth weekday is skipped, give up after a
+			// few years so that a bad rule can not loop forever
+			size_t misses = 0;
+			while ( (written < count) && (misses < 48) )
+			{
+				int32_t y = (int32_t)(monthIndex >= 0 ? monthIndex / 12 : (monthIndex - 11) / 12);
+				uint32_t m = (uint32_t)(monthIndex - (int64_t)y * 12) + 1;
+				int32_t day;
+
+				if (rule->kind == AppigoRecurrenceKindMonthlyByWeekday)
+					day = AppigoRecurrenceDayOfOrdinalWeekday(y, m, rule->weekday, rule->ordinal);
+				else
+				{
+					uint32_t daysInMonth = AppigoRecurrenceDaysInMonth(y, m);
+					day = AppigoRecurrenceDayFromCivil(y, m, (dayOfMonth < daysInMonth) ? dayOfMonth : daysInMonth);
+				}
+
+				if ( (day != INT32_MIN) && (day > anchorDay) )
+				{
+					days[written++] = day;
+					misses = 0;
+				}
+				else
+					misses++;
+
+				monthIndex += monthStep;
+			}
+			break;
+		}
+		default:
+			break;
+	}
+
+	return written;
+}
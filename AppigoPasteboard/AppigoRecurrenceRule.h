@@ -0,0 +1,135 @@
+/**
+
+ Appigo Third Party Integration - AppigoRecurrenceRule.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoRecurrenceRule.h
+ @brief Compiles repeat values into rules and expands their occurrences.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host. AppigoRecurrence.h wraps it for AppigoTask, NSString and NSDate.
+ */
+
+
+#ifndef APPIGO_RECURRENCE_RULE_H
+#define APPIGO_RECURRENCE_RULE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** The repeat value of a task that does not repeat. */
+#define kAppigoRecurrenceRepeatNone				0
+
+/** The repeat value that refers to advancedRepeat. */
+#define kAppigoRecurrenceRepeatAdvanced			50
+
+/** Added to a repeat value to repeat from the completion date instead of the due date. */
+#define kAppigoRecurrenceRepeatFromCompletion	100
+
+
+/**
+ The kinds of recurrence rules.
+ */
+typedef enum
+{
+	AppigoRecurrenceKindNone = 0,			///< does not repeat
+	AppigoRecurrenceKindDaily,				///< every interval days
+	AppigoRecurrenceKindWeekly,				///< every interval weeks, on weekdayMask (or the anchor's weekday if it is 0)
+	AppigoRecurrenceKindMonthly,			///< every interval months on the anchor's day of the month
+	AppigoRecurrenceKindMonthlyByWeekday,	///< every interval months on the ordinal weekday of the month
+	AppigoRecurrenceKindYearly,				///< every interval years on the anchor's month and day
+	AppigoRecurrenceKindWithParent			///< repeats with the parent task, has no occurrences of its own
+} AppigoRecurrenceKind;
+
+
+/** Weekday bits used by weekdayMask (bit 0 is Sunday). */
+#define kAppigoRecurrenceSunday		(1 << 0)
+#define kAppigoRecurrenceMonday		(1 << 1)
+#define kAppigoRecurrenceTuesday	(1 << 2)
+#define kAppigoRecurrenceWednesday	(1 << 3)
+#define kAppigoRecurrenceThursday	(1 << 4)
+#define kAppigoRecurrenceFriday		(1 << 5)
+#define kAppigoRecurrenceSaturday	(1 << 6)
+#define kAppigoRecurrenceWeekdays	(kAppigoRecurrenceMonday | kAppigoRecurrenceTuesday | kAppigoRecurrenceWednesday | kAppigoRecurrenceThursday | kAppigoRecurrenceFriday)
+#define kAppigoRecurrenceWeekend	(kAppigoRecurrenceSaturday | kAppigoRecurrenceSunday)
+
+
+/**
+ A compiled recurrence rule.
+
+ Days of the month past the end of a shorter month (the 31st, February 29th)
+ fall on the last day of that month. Monthly rules on the fifth weekday of
+ the month skip months that do not have one.
+ */
+typedef struct
+{
+	uint8_t		kind;				///< an AppigoRecurrenceKind
+	uint8_t		fromCompletion;		///< 1 if the task repeats from its completion date
+	uint16_t	interval;			///< number of days, weeks, months or years between occurrences
+	uint8_t		weekdayMask;		///< weekly rules only, 0 means the anchor's weekday
+	uint8_t		weekday;			///< monthly by weekday rules only, 0 (Sunday) to 6 (Saturday)
+	int8_t		ordinal;			///< monthly by weekday rules only, 1 to 5 or -1 for the last one
+} AppigoRecurrenceRule;
+
+
+/**
+ Compile a repeat value and advanced repeat string.
+
+ @param repeat The repeat value of a task.
+ @param advancedRepeat The UTF-8 advanced repeat string, only used when
+ repeat is 50 or 150. May be NULL.
+ @param length The number of bytes in advancedRepeat.
+ @param rule Receives the compiled rule, may be NULL to only validate.
+ @return Returns 0 if the repeat value or the advanced repeat string is not valid.
+ */
+int AppigoRecurrenceCompileRepeat(long repeat, const char *advancedRepeat, size_t length, AppigoRecurrenceRule *rule);
+
+/**
+ Compile an advanced repeat string given as UTF-8. The match is case
+ insensitive and ignores extra whitespace and commas.
+
+ @param text The UTF-8 text.
+ @param length The number of bytes in text.
+ @param rule Receives the compiled rule.
+ @return Returns 0 if the text does not match any of the advanced repeat formats.
+ */
+int AppigoRecurrenceCompileAdvanced(const char *text, size_t length, AppigoRecurrenceRule *rule);
+
+/**
+ Expand the occurrences of a rule that come after an anchor day.
+
+ @param rule The compiled rule.
+ @param anchorDay The epoch day the task is due (or completed, for rules that repeat from completion).
+ @param days Receives the occurrences in ascending order.
+ @param count The maximum number of occurrences to write to days.
+ @return Returns the number of occurrences written, 0 for rules without occurrences.
+ */
+size_t AppigoRecurrenceExpand(const AppigoRecurrenceRule *rule, int32_t anchorDay, int32_t *days, size_t count);
+
+
+/** Convert a Gregorian calendar date to an epoch day. */
+int32_t AppigoRecurrenceDayFromCivil(int32_t year, uint32_t month, uint32_t day);
+
+/** Convert an epoch day to a Gregorian calendar date. */
+void AppigoRecurrenceCivilFromDay(int32_t epochDay, int32_t *year, uint32_t *month, uint32_t *day);
+
+/** The weekday of an epoch day, 0 (Sunday) to 6 (Saturday). */
+uint32_t AppigoRecurrenceWeekdayFromDay(int32_t epochDay);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
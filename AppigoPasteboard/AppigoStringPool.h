@@ -0,0 +1,134 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringPool.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoStringPool.h
+ @brief Shares one string instance between tasks with the same field values.
+
+ @class AppigoStringPool AppigoStringPool.h
+ @brief Shares one string instance between tasks with the same field values.
+
+ A large import repeats a handful of lists, contexts and tags across
+ thousands of tasks, and decoding used to create a separate string for every
+ one of them. A pool maps UTF-8 bytes to a single immutable string, so the
+ binary decoder can look a value up without creating a string at all.
+
+ The decoders use the pool that is active on the calling thread when the
+ decode starts, and the parallel binary decoder hands it to its workers.
+ Without an active pool they create strings like before. AppigoPasteboard
+ activates a pool for each batch it reads.
+
+ @code
+ AppigoStringPool *pool = [[AppigoStringPool alloc] init];
+ [pool activate];
+ NSArray *tasks = [AppigoPasteboard tasksFromPasteboardNamed:name];
+ [pool deactivate];
+ NSLog(@"%@", pool);
+ [pool release];
+ @endcode
+
+ Values longer than kAppigoStringPoolMaximumLength bytes are not interned,
+ and once kAppigoStringPoolMaximumCount values are in the pool new ones are
+ created without being added, so a pool stays small when values are unique.
+ Interning is thread safe.
+ */
+
+
+#import <Foundation/Foundation.h>
+#import "AppigoStringTable.h"
+
+
+/**
+ The longest value, in UTF-8 bytes, that is interned. Longer values are
+ mostly notes, which rarely repeat, and the pool keeps a copy of the bytes of
+ every value it holds.
+ */
+#define kAppigoStringPoolMaximumLength	256
+
+/**
+ The most values a pool keeps. Lookups in larger pools miss the cache often
+ enough to cost more than they save (tests/AppigoStringTableBenchmark.c).
+ */
+#define kAppigoStringPoolMaximumCount	4096
+
+
+#pragma mark -
+@interface AppigoStringPool : NSObject
+{
+@private
+	AppigoStringTable		_table;			// UTF-8 bytes -> retained NSString
+
+	NSUInteger				_lookupCount;
+	NSUInteger				_hitCount;
+	NSUInteger				_savedByteCount;
+
+	AppigoStringPool		*_previousPool;	// active before activate was called
+}
+
+/** The number of distinct values in the pool. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/** The number of values looked up. */
+@property (nonatomic, readonly) NSUInteger lookupCount;
+
+/** The number of lookups that returned a string already in the pool. */
+@property (nonatomic, readonly) NSUInteger hitCount;
+
+/** The UTF-8 bytes of every lookup that returned a shared string, roughly the string storage saved. */
+@property (nonatomic, readonly) NSUInteger savedByteCount;
+
+/**
+ The pool that is active on the calling thread.
+
+ @return Returns the pool that was activated last on this thread, or nil.
+ */
++ (AppigoStringPool *)currentPool;
+
+/**
+ Make the pool the current pool of the calling thread until deactivate is
+ called on the same thread. Pools can be nested, and the pool must stay
+ alive while it is active.
+ */
+- (void)activate;
+
+/**
+ Make the pool that was current before activate was called current again.
+ */
+- (void)deactivate;
+
+/**
+ Get the pooled string for UTF-8 bytes, without creating a string when the
+ value is already in the pool.
+
+ @return Returns a retained immutable string, or nil if the bytes are not valid UTF-8.
+ */
+- (NSString *)copyStringWithUTF8Bytes:(const uint8_t *)bytes length:(NSUInteger)length;
+
+/**
+ Get the pooled string equal to a string.
+
+ @param string The string, may be nil.
+ @return Returns a retained immutable string equal to string, or nil if
+ string is nil.
+ */
+- (NSString *)copyInternedString:(NSString *)string;
+
+@end
+
+
+/**
+ Trim whitespace from a string (see AppigoStringTrimming.h) and get the
+ pooled string for the result.
+
+ @param string The string, may be nil.
+ @param strings The pool, or nil to only trim.
+ @return Returns a retained immutable string, or nil if string is nil.
+ */
+NSString *AppigoCopyInternedTrimmedString(NSString *string, AppigoStringPool *strings);
@@ -0,0 +1,238 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringPool.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoStringPool.h"
+#import "AppigoStringTrimming.h"
+
+#include <pthread.h>
+
+
+static pthread_key_t _currentPoolKey;
+
+
+NSString *AppigoCopyInternedTrimmedString(NSString *string, AppigoStringPool *strings)
+{
+	NSString *trimmed = AppigoCopyStringByTrimmingWhitespace(string);
+	if ( (trimmed == nil) || (strings == nil) )
+		return trimmed;
+
+	NSString *interned = [strings copyInternedString:trimmed];
+	[trimmed release];
+
+	return interned;
+}
+
+
+@interface AppigoStringPool (Private)
+
++ (void)_createCurrentPoolKey;
+- (NSString *)_copyExistingStringForBytes:(const uint8_t *)bytes length:(NSUInteger)length hash:(uint32_t)hash;
+- (NSString *)_copyAddingString:(NSString *)string bytes:(const uint8_t *)bytes length:(NSUInteger)length hash:(uint32_t)hash;
+
+@end
+
+
+#pragma mark -
+@implementation AppigoStringPool
+
+
++ (AppigoStringPool *)currentPool
+{
+	[AppigoStringPool _createCurrentPoolKey];
+	return (AppigoStringPool *)pthread_getspecific(_currentPoolKey);
+}
+
+
+- (void)dealloc
+{
+	for (size_t i = 0; i < _table.capacity; i++)
+		[(NSString *)_table.entries[i].value release];
+
+	AppigoStringTableFree(&_table);
+
+	[super dealloc];
+}
+
+
+- (NSString *)description
+{
+	@synchronized(self)
+	{
+		return [NSString stringWithFormat:@"<%@: %lu strings, %lu lookups, %lu hits, %lu bytes saved>",
+				NSStringFromClass([self class]),
+				(unsigned long)_table.count,
+				(unsigned long)_lookupCount,
+				(unsigned long)_hitCount,
+				(unsigned long)_savedByteCount];
+	}
+}
+
+
+- (NSUInteger)count
+{
+	@synchronized(self)
+	{
+		return _table.count;
+	}
+}
+
+
+- (NSUInteger)lookupCount
+{
+	@synchronized(self)
+	{
+		return _lookupCount;
+	}
+}
+
+
+- (NSUInteger)hitCount
+{
+	@synchronized(self)
+	{
+		return _hitCount;
+	}
+}
+
+
+- (NSUInteger)savedByteCount
+{
+	@synchronized(self)
+	{
+		return _savedByteCount;
+	}
+}
+
+
+- (void)activate
+{
+	[AppigoStringPool _createCurrentPoolKey];
+
+	_previousPool = (AppigoStringPool *)pthread_getspecific(_currentPoolKey);
+	pthread_setspecific(_currentPoolKey, self);
+}
+
+
+- (void)deactivate
+{
+	if ([AppigoStringPool currentPool] != self)
+	{
+		NSLog(@"deactivate called on a string pool that is not the current pool");
+		return;
+	}
+
+	pthread_setspecific(_currentPoolKey, _previousPool);
+	_previousPool = nil;
+}
+
+
+- (NSString *)copyStringWithUTF8Bytes:(const uint8_t *)bytes length:(NSUInteger)length
+{
+	if (length > kAppigoStringPoolMaximumLength)
+		return [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+
+	uint32_t hash = AppigoStringTableHash(bytes, length);
+
+	NSString *string = [self _copyExistingStringForBytes:bytes length:length hash:hash];
+	if (string != nil)
+		return string;
+
+	string = [[NSString alloc] initWithBytes:bytes length:length encoding:NSUTF8StringEncoding];
+	if (string == nil)
+		return nil;
+
+	return [self _copyAddingString:string bytes:bytes length:length hash:hash];
+}
+
+
+- (NSString *)copyInternedString:(NSString *)string
+{
+	if (string == nil)
+		return nil;
+
+	// Every UTF-16 unit takes at least one UTF-8 byte
+	CFIndex length = CFStringGetLength((CFStringRef)string);
+	if (length > kAppigoStringPoolMaximumLength)
+		return [string copy];
+
+	uint8_t buffer[kAppigoStringPoolMaximumLength];
+	CFIndex usedLength = 0;
+	CFIndex converted = CFStringGetBytes((CFStringRef)string, CFRangeMake(0, length), kCFStringEncodingUTF8, 0, false, buffer, sizeof(buffer), &usedLength);
+	if (converted != length)
+		return [string copy];
+
+	uint32_t hash = AppigoStringTableHash(buffer, (NSUInteger)usedLength);
+
+	NSString *interned = [self _copyExistingStringForBytes:buffer length:(NSUInteger)usedLength hash:hash];
+	if (interned != nil)
+		return interned;
+
+	return [self _copyAddingString:[string copy] bytes:buffer length:(NSUInteger)usedLength hash:hash];
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoStringPool (Private)
+
+
++ (void)_createCurrentPoolKey
+{
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		pthread_key_create(&_currentPoolKey, NULL);
+	});
+}
+
+
+- (NSString *)_copyExistingStringForBytes:(const uint8_t *)bytes length:(NSUInteger)length hash:(uint32_t)hash
+{
+	@synchronized(self)
+	{
+		_lookupCount++;
+
+		NSString *string = (NSString *)AppigoStringTableLookup(&_table, bytes, length, hash);
+		if (string == nil)
+			return nil;
+
+		_hitCount++;
+		_savedByteCount += length;
+
+		return [string retain];
+	}
+}
+
+
+// Takes ownership of string and returns it, or the equal string another
+// thread added in the meantime.
+- (NSString *)_copyAddingString:(NSString *)string bytes:(const uint8_t *)bytes length:(NSUInteger)length hash:(uint32_t)hash
+{
+	@synchronized(self)
+	{
+		NSString *pooled = (NSString *)AppigoStringTableAdd(&_table, bytes, length, hash, string, kAppigoStringPoolMaximumCount);
+
+		// Full or out of memory, the string is not shared
+		if (pooled == nil)
+			return string;
+
+		if (pooled != string)
+		{
+			[string release];
+			return [pooled retain];
+		}
+
+		// The table holds a reference of its own
+		return [string retain];
+	}
+}
+
+
+@end
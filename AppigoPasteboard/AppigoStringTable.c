@@ -0,0 +1,168 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringTable.c
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#include "AppigoStringTable.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+#define kAppigoStringTableInitialCapacity	64
+#define kAppigoStringTableInitialBytes		1024
+
+
+static inline uint64_t AppigoStringTableMix(uint64_t hash, uint64_t word)
+{
+	hash ^= word * 0x9E3779B97F4A7C15ULL;
+	hash = (hash << 31) | (hash >> 33);
+
+	return hash * 0xC2B2AE3D27D4EB4FULL;
+}
+
+
+// Eight bytes per step, values are hashed on every decode and only ever
+// compared within the process
+uint32_t AppigoStringTableHash(const uint8_t *bytes, size_t length)
+{
+	uint64_t hash = 0x27D4EB2F165667C5ULL ^ length;
+	uint64_t word;
+
+	for (; length >= 8; bytes += 8, length -= 8)
+	{
+		memcpy(&word, bytes, sizeof(word));
+		hash = AppigoStringTableMix(hash, word);
+	}
+
+	// Most lists, contexts and tags end here, a memcpy of a variable length
+	// would be a library call
+	if (length > 0)
+	{
+		word = 0;
+		for (size_t i = 0; i < length; i++)
+			word |= (uint64_t)bytes[i] << (i * 8);
+
+		hash = AppigoStringTableMix(hash, word);
+	}
+
+	hash ^= hash >> 29;
+	hash *= 0x94D049BB133111EBULL;
+	hash ^= hash >> 32;
+
+	return (uint32_t)hash;
+}
+
+
+// Returns the entry holding the bytes, or the empty slot they belong in. The
+// table must have room.
+static AppigoStringTableEntry *AppigoStringTableSlot(const AppigoStringTable *table, const uint8_t *bytes, size_t length, uint32_t hash)
+{
+	size_t mask = table->capacity - 1;
+	size_t index = hash & mask;
+
+	for (;;)
+	{
+		AppigoStringTableEntry *entry = &table->entries[index];
+		if (entry->value == NULL)
+			return entry;
+
+		if ( (entry->hash == hash) && (entry->length == length) && (memcmp(table->bytes + entry->offset, bytes, length) == 0) )
+			return entry;
+
+		index = (index + 1) & mask;
+	}
+}
+
+
+static int AppigoStringTableGrow(AppigoStringTable *table)
+{
+	size_t newCapacity = (table->capacity == 0) ? kAppigoStringTableInitialCapacity : table->capacity * 2;
+
+	AppigoStringTableEntry *newEntries = calloc(newCapacity, sizeof(AppigoStringTableEntry));
+	if (newEntries == NULL)
+		return 0;
+
+	for (size_t i = 0; i < table->capacity; i++)
+	{
+		if (table->entries[i].value == NULL)
+			continue;
+
+		size_t index = table->entries[i].hash & (newCapacity - 1);
+		while (newEntries[index].value != NULL)
+			index = (index + 1) & (newCapacity - 1);
+
+		newEntries[index] = table->entries[i];
+	}
+
+	free(table->entries);
+	table->entries = newEntries;
+	table->capacity = newCapacity;
+
+	return 1;
+}
+
+
+const void *AppigoStringTableLookup(const AppigoStringTable *table, const uint8_t *bytes, size_t length, uint32_t hash)
+{
+	if (table->count == 0)
+		return NULL;
+
+	return AppigoStringTableSlot(table, bytes, length, hash)->value;
+}
+
+
+const void *AppigoStringTableAdd(AppigoStringTable *table, const uint8_t *bytes, size_t length, uint32_t hash, const void *value, size_t maximumCount)
+{
+	if ( (length > UINT32_MAX) || (table->count >= maximumCount) )
+		return NULL;
+
+	// Keep the table at most half full
+	if ( ((table->count + 1) * 2 > table->capacity) && (AppigoStringTableGrow(table) == 0) )
+		return NULL;
+
+	AppigoStringTableEntry *entry = AppigoStringTableSlot(table, bytes, length, hash);
+	if (entry->value != NULL)
+		return entry->value;
+
+	if ( (table->bytes == NULL) || (table->bytesLength + length > table->bytesCapacity) )
+	{
+		size_t newCapacity = table->bytesCapacity * 2;
+		if (newCapacity < table->bytesLength + length)
+			newCapacity = table->bytesLength + length;
+		if (newCapacity < kAppigoStringTableInitialBytes)
+			newCapacity = kAppigoStringTableInitialBytes;
+
+		uint8_t *newBytes = realloc(table->bytes, newCapacity);
+		if (newBytes == NULL)
+			return NULL;
+
+		table->bytes = newBytes;
+		table->bytesCapacity = newCapacity;
+	}
+
+	memcpy(table->bytes + table->bytesLength, bytes, length);
+
+	entry->value = value;
+	entry->hash = hash;
+	entry->length = (uint32_t)length;
+	entry->offset = table->bytesLength;
+
+	table->bytesLength += length;
+	table->count++;
+
+	return value;
+}
+
+
+void AppigoStringTableFree(AppigoStringTable *table)
+{
+	free(table->entries);
+	free(table->bytes);
+
+	memset(table, 0, sizeof(*table));
+}
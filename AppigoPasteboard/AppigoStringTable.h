@@ -0,0 +1,85 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringTable.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoStringTable.h
+ @brief The hash table behind AppigoStringPool.h.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host. The table maps UTF-8 bytes to an opaque value, the pooled string, and
+ keeps a copy of the bytes of every entry so a lookup never has to ask the
+ value for its bytes. It uses open addressing with linear probing and stays
+ at most half full. The table does not lock and does not own its values.
+ */
+
+
+#ifndef APPIGO_STRING_TABLE_H
+#define APPIGO_STRING_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct AppigoStringTableEntry
+{
+	const void	*value;		// NULL for an empty slot
+	uint32_t	hash;
+	uint32_t	length;
+	size_t		offset;		// of the bytes in the table's byte storage
+} AppigoStringTableEntry;
+
+/** A table, all zero when empty. */
+typedef struct AppigoStringTable
+{
+	AppigoStringTableEntry	*entries;
+	size_t					capacity;		// a power of two, or 0
+	size_t					count;
+
+	uint8_t					*bytes;			// the bytes of every entry
+	size_t					bytesLength;
+	size_t					bytesCapacity;
+} AppigoStringTable;
+
+
+/** The hash of the bytes to look up or add. Not stable across processes or architectures. */
+uint32_t AppigoStringTableHash(const uint8_t *bytes, size_t length);
+
+/**
+ Look up bytes.
+
+ @param hash AppigoStringTableHash of the bytes.
+ @return Returns the value of the entry, or NULL if the bytes are not in the table.
+ */
+const void *AppigoStringTableLookup(const AppigoStringTable *table, const uint8_t *bytes, size_t length, uint32_t hash);
+
+/**
+ Add bytes unless they are already in the table.
+
+ @param hash AppigoStringTableHash of the bytes.
+ @param value The value to add, not NULL.
+ @param maximumCount The most entries the table may hold.
+ @return Returns value if it was added, the value already in the table for
+ the bytes, or NULL if the table is full or out of memory.
+ */
+const void *AppigoStringTableAdd(AppigoStringTable *table, const uint8_t *bytes, size_t length, uint32_t hash, const void *value, size_t maximumCount);
+
+/** Free the storage of the table and empty it. The values are the caller's. */
+void AppigoStringTableFree(AppigoStringTable *table);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
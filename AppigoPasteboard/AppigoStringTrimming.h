@@ -0,0 +1,58 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringTrimming.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoStringTrimming.h
+ @brief Trims whitespace without copying strings that are already trimmed.
+
+ Every task and note field is trimmed of the characters in
+ [NSCharacterSet whitespaceCharacterSet] when it is set or decoded, so fields
+ hold trimmed strings and are encoded as they are. stringByTrimmingCharactersInSet:
+ always scans and usually allocates, even for a string with nothing to trim.
+ These functions only look at the ends of a string. An already trimmed string
+ costs two character reads and is returned as is. The whitespace test and
+ the UTF-8 kernel are plain C in AppigoWhitespace.h, with host tests.
+
+ The UTF-8 variant trims encoded bytes before a string object is created, so
+ decoding a field creates a single string.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+
+/**
+ Check whether a character is in [NSCharacterSet whitespaceCharacterSet],
+ see AppigoUnicharIsWhitespace.
+ */
+BOOL AppigoCharacterIsWhitespace(unichar character);
+
+/**
+ Trim whitespace from a string.
+
+ @param string The string, may be nil.
+ @return Returns a retained immutable string, which is string itself (or an
+ immutable copy of it) when there is nothing to trim, or nil if string is nil.
+ */
+NSString *AppigoCopyStringByTrimmingWhitespace(NSString *string);
+
+/**
+ Check whether a string is nil, empty or only holds whitespace.
+ */
+BOOL AppigoStringIsBlank(NSString *string);
+
+/**
+ Find the part of UTF-8 encoded text without leading and trailing whitespace.
+
+ @param bytes The UTF-8 bytes.
+ @param length The number of bytes.
+ @return Returns the range of bytes to keep, relative to bytes.
+ */
+NSRange AppigoUTF8RangeByTrimmingWhitespace(const uint8_t *bytes, NSUInteger length);
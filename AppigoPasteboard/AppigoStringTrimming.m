@@ -0,0 +1,72 @@
+/**
+
+ Appigo Third Party Integration - AppigoStringTrimming.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoStringTrimming.h"
+#import "AppigoWhitespace.h"
+
+
+BOOL AppigoCharacterIsWhitespace(unichar character)
+{
+	return (AppigoUnicharIsWhitespace(character) != 0) ? YES : NO;
+}
+
+
+NSString *AppigoCopyStringByTrimmingWhitespace(NSString *string)
+{
+	if (string == nil)
+		return nil;
+
+	CFIndex length = CFStringGetLength((CFStringRef)string);
+
+	CFStringInlineBuffer buffer;
+	CFStringInitInlineBuffer((CFStringRef)string, &buffer, CFRangeMake(0, length));
+
+	CFIndex start = 0;
+	while ( (start < length) && (AppigoCharacterIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, start)) == YES) )
+		start++;
+
+	CFIndex end = length;
+	while ( (end > start) && (AppigoCharacterIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, end - 1)) == YES) )
+		end--;
+
+	// Copying an immutable string only retains it
+	if ( (start == 0) && (end == length) )
+		return [string copy];
+
+	return (NSString *)CFStringCreateWithSubstring(kCFAllocatorDefault, (CFStringRef)string, CFRangeMake(start, end - start));
+}
+
+
+BOOL AppigoStringIsBlank(NSString *string)
+{
+	if (string == nil)
+		return YES;
+
+	CFIndex length = CFStringGetLength((CFStringRef)string);
+
+	CFStringInlineBuffer buffer;
+	CFStringInitInlineBuffer((CFStringRef)string, &buffer, CFRangeMake(0, length));
+
+	for (CFIndex i = 0; i < length; i++)
+	{
+		if (AppigoCharacterIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, i)) == NO)
+			return NO;
+	}
+
+	return YES;
+}
+
+
+NSRange AppigoUTF8RangeByTrimmingWhitespace(const uint8_t *bytes, NSUInteger length)
+{
+	size_t start, end;
+	AppigoUTF8TrimWhitespace(bytes, length, &start, &end);
+
+	return NSMakeRange(start, end - start);
+}
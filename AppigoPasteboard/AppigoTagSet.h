@@ -0,0 +1,192 @@
+/**
+
+ Appigo Third Party Integration - AppigoTagSet.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTagSet.h
+ @brief Parsed task tags and queries over them.
+
+ A task's tags are a comma-separated string, and that string is still what
+ is encoded and sent to Todo. Grouping or filtering tasks by tag used to mean
+ splitting that string again for every task and every question. An
+ AppigoTagSet is the string parsed once into the identifiers of its tags,
+ and an AppigoTagQuery answers "with these tags and none of those" for a
+ whole batch in a single pass, with bitset lookups instead of string
+ comparisons.
+
+ @code
+ AppigoTagQuery *query = [[AppigoTagQuery alloc] initWithRequiredTags:[NSArray arrayWithObject:@"work"]
+													 excludedTags:[NSArray arrayWithObject:@"someday"]];
+ NSArray *matches = [query filteredTasks:tasks];
+ [query release];
+ @endcode
+
+ Tags are compared without regard to case, and surrounding whitespace and
+ empty entries are ignored, so "Work, ,home" has the tags "Work" and "home".
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "AppigoTask.h"
+
+
+/** The identifier of a tag, shared by every tag set in the process. */
+typedef uint32_t AppigoTagIdentifier;
+
+/** Returned for tags that have never been registered. */
+#define kAppigoTagNotFound				UINT32_MAX
+
+/** The number of identifiers a tag set holds without allocating. */
+#define kAppigoTagSetInlineCapacity		4
+
+
+#pragma mark -
+/**
+ @class AppigoTagRegistry AppigoTagSet.h
+ @brief Assigns every tag name a small identifier.
+
+ Identifiers are handed out in order from 0 and never reused, so they can
+ index bitsets. The spelling a tag is first registered with is the one
+ returned by tagForIdentifier:. The registry is thread safe.
+ */
+@interface AppigoTagRegistry : NSObject
+{
+@private
+	NSMutableDictionary		*_identifiers;	// lowercase tag -> NSNumber
+	NSMutableArray			*_tags;			// indexed by identifier
+}
+
+/** The number of registered tags, one more than the largest identifier. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/** The registry used by every tag set. */
++ (AppigoTagRegistry *)sharedRegistry;
+
+/**
+ Get the identifier of a tag, registering it if needed.
+
+ @param tag The tag, surrounding whitespace is ignored.
+ @return Returns the identifier, or kAppigoTagNotFound if tag is nil or empty.
+ */
+- (AppigoTagIdentifier)identifierForTag:(NSString *)tag;
+
+/**
+ Get the identifier of a tag without registering it.
+
+ @return Returns the identifier, or kAppigoTagNotFound if the tag is not registered.
+ */
+- (AppigoTagIdentifier)existingIdentifierForTag:(NSString *)tag;
+
+/** Returns the tag with an identifier, or nil. */
+- (NSString *)tagForIdentifier:(AppigoTagIdentifier)identifier;
+
+@end
+
+
+#pragma mark -
+/**
+ @class AppigoTagSet AppigoTagSet.h
+ @brief The parsed tags of a task.
+
+ The identifiers are kept sorted and without duplicates, inline for up to
+ kAppigoTagSetInlineCapacity tags. A tag set is immutable.
+ */
+@interface AppigoTagSet : NSObject <NSCopying>
+{
+@private
+	NSUInteger				_count;
+	AppigoTagIdentifier		*_identifiers;	// _inlineIdentifiers, or malloc'ed
+	AppigoTagIdentifier		_inlineIdentifiers[kAppigoTagSetInlineCapacity];
+}
+
+/** The number of tags. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Parse a tags string.
+
+ @param tags A comma-separated list of tags, may be nil.
+ @return Returns an autoreleased tag set.
+ */
++ (AppigoTagSet *)tagSetWithString:(NSString *)tags;
+
+/**
+ Create a tag set from tag names.
+
+ @param tagNames An array of NSString tags.
+ @return Returns an autoreleased tag set.
+ */
++ (AppigoTagSet *)tagSetWithTags:(NSArray *)tagNames;
+
+/** Returns the identifier at an index, identifiers are in ascending order. */
+- (AppigoTagIdentifier)identifierAtIndex:(NSUInteger)index;
+
+- (BOOL)containsIdentifier:(AppigoTagIdentifier)identifier;
+
+/** Check for a tag, without regard to case. */
+- (BOOL)containsTag:(NSString *)tag;
+
+/** Returns the tags as NSStrings, in identifier order. */
+- (NSArray *)tags;
+
+/** Returns the tags joined by ", ", the format of AppigoTask's tags, or nil for an empty set. */
+- (NSString *)stringValue;
+
+@end
+
+
+#pragma mark -
+/**
+ @class AppigoTagQuery AppigoTagSet.h
+ @brief Matches tasks that have all of some tags and none of others.
+
+ The tags are turned into two bitsets indexed by identifier when the query
+ is created, so matching a task is one bit test per tag it has.
+ */
+@interface AppigoTagQuery : NSObject
+{
+@private
+	uint64_t				*_required;		// bitset of required identifiers
+	uint64_t				*_excluded;		// bitset of excluded identifiers
+	NSUInteger				_wordCount;
+	NSUInteger				_requiredCount;
+	BOOL					_matchesNothing;	// a required tag was never registered
+}
+
+/**
+ Initialize a query.
+
+ @param requiredTags The NSString tags a task must have, may be nil.
+ @param excludedTags The NSString tags a task must not have, may be nil.
+ */
+- (id)initWithRequiredTags:(NSArray *)requiredTags excludedTags:(NSArray *)excludedTags;
+
+- (BOOL)matchesTagSet:(AppigoTagSet *)tagSet;
+- (BOOL)matchesTask:(AppigoTask *)task;
+
+/** Returns the indexes of the matching tasks in an array of AppigoTask objects. */
+- (NSIndexSet *)indexesOfMatchingTasks:(NSArray *)tasks;
+
+/** Returns the matching tasks of an array of AppigoTask objects, in order. */
+- (NSArray *)filteredTasks:(NSArray *)tasks;
+
+@end
+
+
+#pragma mark -
+@interface AppigoTask (AppigoTagSet)
+
+/**
+ The parsed tags of the task. It is created from tags when first used and
+ kept until tags changes.
+ */
+@property (nonatomic, copy) AppigoTagSet *tagSet;
+
+@end
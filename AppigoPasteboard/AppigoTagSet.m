@@ -0,0 +1,584 @@
+/**
+
+ Appigo Third Party Integration - AppigoTagSet.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTagSet.h"
+#import "AppigoStringTrimming.h"
+
+
+#define kAppigoTagSetSeparator		','
+
+
+static AppigoTagRegistry *_sharedRegistry = nil;
+
+
+static int AppigoTagIdentifierCompare(const void *a, const void *b)
+{
+	AppigoTagIdentifier first = *(const AppigoTagIdentifier *)a;
+	AppigoTagIdentifier second = *(const AppigoTagIdentifier *)b;
+
+	return (first < second) ? -1 : ((first > second) ? 1 : 0);
+}
+
+
+@interface AppigoTagSet (Private)
+
+- (id)_initWithIdentifiers:(AppigoTagIdentifier *)identifiers count:(NSUInteger)count;
+- (const AppigoTagIdentifier *)_identifiers;
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTagRegistry
+
+
++ (AppigoTagRegistry *)sharedRegistry
+{
+	@synchronized(self)
+	{
+		if (_sharedRegistry == nil)
+			_sharedRegistry = [[AppigoTagRegistry alloc] init];
+	}
+
+	return _sharedRegistry;
+}
+
+
+- (id)init
+{
+	if (self = [super init])
+	{
+		_identifiers = [[NSMutableDictionary alloc] init];
+		_tags = [[NSMutableArray alloc] init];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	[_identifiers release];
+	[_tags release];
+
+	[super dealloc];
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %lu tags>", NSStringFromClass([self class]), (unsigned long)[self count]];
+}
+
+
+- (NSUInteger)count
+{
+	@synchronized(self)
+	{
+		return [_tags count];
+	}
+}
+
+
+- (AppigoTagIdentifier)identifierForTag:(NSString *)tag
+{
+	NSString *trimmedTag = AppigoCopyStringByTrimmingWhitespace(tag);
+	if ([trimmedTag length] == 0)
+	{
+		[trimmedTag release];
+		return kAppigoTagNotFound;
+	}
+
+	NSString *key = [trimmedTag lowercaseString];
+	AppigoTagIdentifier identifier;
+
+	@synchronized(self)
+	{
+		NSNumber *existing = [_identifiers objectForKey:key];
+		if (existing != nil)
+		{
+			identifier = [existing unsignedIntValue];
+		}
+		else
+		{
+			identifier = (AppigoTagIdentifier)[_tags count];
+			[_tags addObject:trimmedTag];
+			[_identifiers setObject:[NSNumber numberWithUnsignedInt:identifier] forKey:key];
+		}
+	}
+
+	[trimmedTag release];
+
+	return identifier;
+}
+
+
+- (AppigoTagIdentifier)existingIdentifierForTag:(NSString *)tag
+{
+	NSString *trimmedTag = AppigoCopyStringByTrimmingWhitespace(tag);
+	NSString *key = [trimmedTag lowercaseString];
+	[trimmedTag release];
+
+	if ([key length] == 0)
+		return kAppigoTagNotFound;
+
+	@synchronized(self)
+	{
+		NSNumber *existing = [_identifiers objectForKey:key];
+		if (existing == nil)
+			return kAppigoTagNotFound;
+
+		return [existing unsignedIntValue];
+	}
+}
+
+
+- (NSString *)tagForIdentifier:(AppigoTagIdentifier)identifier
+{
+	@synchronized(self)
+	{
+		if (identifier >= [_tags count])
+			return nil;
+
+		return [[[_tags objectAtIndex:identifier] retain] autorelease];
+	}
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTagSet
+
+
+@synthesize count = _count;
+
+
++ (AppigoTagSet *)tagSetWithString:(NSString *)tags
+{
+	AppigoTagRegistry *registry = [AppigoTagRegistry sharedRegistry];
+
+	AppigoTagIdentifier inlineIdentifiers[kAppigoTagSetInlineCapacity];
+	AppigoTagIdentifier *identifiers = inlineIdentifiers;
+	NSUInteger capacity = kAppigoTagSetInlineCapacity;
+	NSUInteger count = 0;
+
+	CFIndex length = (tags != nil) ? CFStringGetLength((CFStringRef)tags) : 0;
+
+	CFStringInlineBuffer buffer;
+	if (length > 0)
+		CFStringInitInlineBuffer((CFStringRef)tags, &buffer, CFRangeMake(0, length));
+
+	// Split on commas without creating an array of components
+	CFIndex start = 0;
+	for (CFIndex i = 0; i <= length; i++)
+	{
+		if ( (i < length) && (CFStringGetCharacterFromInlineBuffer(&buffer, i) != kAppigoTagSetSeparator) )
+			continue;
+
+		CFIndex tagStart = start;
+		CFIndex tagEnd = i;
+		start = i + 1;
+
+		while ( (tagStart < tagEnd) && (AppigoCharacterIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, tagStart)) == YES) )
+			tagStart++;
+
+		while ( (tagEnd > tagStart) && (AppigoCharacterIsWhitespace(CFStringGetCharacterFromInlineBuffer(&buffer, tagEnd - 1)) == YES) )
+			tagEnd--;
+
+		if (tagStart == tagEnd)
+			continue;
+
+		NSString *tag = (NSString *)CFStringCreateWithSubstring(kCFAllocatorDefault, (CFStringRef)tags, CFRangeMake(tagStart, tagEnd - tagStart));
+		AppigoTagIdentifier identifier = [registry identifierForTag:tag];
+		[tag release];
+
+		if (count == capacity)
+		{
+			AppigoTagIdentifier *newIdentifiers = malloc(sizeof(AppigoTagIdentifier) * capacity * 2);
+			if (newIdentifiers == NULL)
+				break;
+
+			memcpy(newIdentifiers, identifiers, sizeof(AppigoTagIdentifier) * count);
+			if (identifiers != inlineIdentifiers)
+				free(identifiers);
+
+			identifiers = newIdentifiers;
+			capacity *= 2;
+		}
+
+		identifiers[count++] = identifier;
+	}
+
+	AppigoTagSet *tagSet = [[AppigoTagSet alloc] _initWithIdentifiers:identifiers count:count];
+
+	if (identifiers != inlineIdentifiers)
+		free(identifiers);
+
+	return [tagSet autorelease];
+}
+
+
++ (AppigoTagSet *)tagSetWithTags:(NSArray *)tagNames
+{
+	AppigoTagRegistry *registry = [AppigoTagRegistry sharedRegistry];
+
+	NSUInteger count = [tagNames count];
+	AppigoTagIdentifier *identifiers = malloc(sizeof(AppigoTagIdentifier) * MAX(count, (NSUInteger)1));
+	if (identifiers == NULL)
+		return nil;
+
+	NSUInteger found = 0;
+	for (NSString *tag in tagNames)
+	{
+		AppigoTagIdentifier identifier = [registry identifierForTag:tag];
+		if (identifier != kAppigoTagNotFound)
+			identifiers[found++] = identifier;
+	}
+
+	AppigoTagSet *tagSet = [[AppigoTagSet alloc] _initWithIdentifiers:identifiers count:found];
+	free(identifiers);
+
+	return [tagSet autorelease];
+}
+
+
+- (id)init
+{
+	return [self _initWithIdentifiers:NULL count:0];
+}
+
+
+- (void)dealloc
+{
+	if (_identifiers != _inlineIdentifiers)
+		free(_identifiers);
+
+	[super dealloc];
+}
+
+
+- (id)copyWithZone:(NSZone *)zone
+{
+	// Immutable
+	return [self retain];
+}
+
+
+- (BOOL)isEqual:(id)object
+{
+	if (object == self)
+		return YES;
+
+	if ([object isKindOfClass:[AppigoTagSet class]] == NO)
+		return NO;
+
+	AppigoTagSet *other = (AppigoTagSet *)object;
+	if (other.count != _count)
+		return NO;
+
+	return (memcmp([other _identifiers], _identifiers, sizeof(AppigoTagIdentifier) * _count) == 0);
+}
+
+
+- (NSUInteger)hash
+{
+	NSUInteger hash = _count;
+	for (NSUInteger i = 0; i < _count; i++)
+		hash = hash * 31 + _identifiers[i];
+
+	return hash;
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %@>", NSStringFromClass([self class]), [self stringValue]];
+}
+
+
+- (AppigoTagIdentifier)identifierAtIndex:(NSUInteger)index
+{
+	if (index >= _count)
+		return kAppigoTagNotFound;
+
+	return _identifiers[index];
+}
+
+
+- (BOOL)containsIdentifier:(AppigoTagIdentifier)identifier
+{
+	return (bsearch(&identifier, _identifiers, _count, sizeof(AppigoTagIdentifier), AppigoTagIdentifierCompare) != NULL);
+}
+
+
+- (BOOL)containsTag:(NSString *)tag
+{
+	AppigoTagIdentifier identifier = [[AppigoTagRegistry sharedRegistry] existingIdentifierForTag:tag];
+	if (identifier == kAppigoTagNotFound)
+		return NO;
+
+	return [self containsIdentifier:identifier];
+}
+
+
+- (NSArray *)tags
+{
+	AppigoTagRegistry *registry = [AppigoTagRegistry sharedRegistry];
+
+	NSMutableArray *tags = [NSMutableArray arrayWithCapacity:_count];
+	for (NSUInteger i = 0; i < _count; i++)
+	{
+		NSString *tag = [registry tagForIdentifier:_identifiers[i]];
+		if (tag != nil)
+			[tags addObject:tag];
+	}
+
+	return tags;
+}
+
+
+- (NSString *)stringValue
+{
+	if (_count == 0)
+		return nil;
+
+	return [[self tags] componentsJoinedByString:@", "];
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTagSet (Private)
+
+
+// Sorts the identifiers in place and keeps each of them once
+- (id)_initWithIdentifiers:(AppigoTagIdentifier *)identifiers count:(NSUInteger)count
+{
+	if (self = [super init])
+	{
+		if (count > 1)
+			qsort(identifiers, count, sizeof(AppigoTagIdentifier), AppigoTagIdentifierCompare);
+
+		NSUInteger unique = 0;
+		for (NSUInteger i = 0; i < count; i++)
+		{
+			if ( (unique == 0) || (identifiers[i] != identifiers[unique - 1]) )
+				identifiers[unique++] = identifiers[i];
+		}
+
+		_identifiers = _inlineIdentifiers;
+		if (unique > kAppigoTagSetInlineCapacity)
+		{
+			_identifiers = malloc(sizeof(AppigoTagIdentifier) * unique);
+			if (_identifiers == NULL)
+			{
+				_identifiers = _inlineIdentifiers;
+				[self release];
+				return nil;
+			}
+		}
+
+		if (unique > 0)
+			memcpy(_identifiers, identifiers, sizeof(AppigoTagIdentifier) * unique);
+
+		_count = unique;
+	}
+
+	return self;
+}
+
+
+- (const AppigoTagIdentifier *)_identifiers
+{
+	return _identifiers;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTagQuery
+
+
+- (id)initWithRequiredTags:(NSArray *)requiredTags excludedTags:(NSArray *)excludedTags
+{
+	if (self = [super init])
+	{
+		AppigoTagRegistry *registry = [AppigoTagRegistry sharedRegistry];
+
+		// Only look tags up, a query must not register them. A required tag
+		// that is not registered cannot be on any task.
+		AppigoTagSet *required = nil;
+		for (NSString *tag in requiredTags)
+		{
+			if ([registry existingIdentifierForTag:tag] == kAppigoTagNotFound)
+				_matchesNothing = YES;
+		}
+
+		if (_matchesNothing == NO)
+			required = [AppigoTagSet tagSetWithTags:requiredTags];
+
+		NSMutableArray *registeredExcludedTags = [NSMutableArray arrayWithCapacity:[excludedTags count]];
+		for (NSString *tag in excludedTags)
+		{
+			if ([registry existingIdentifierForTag:tag] != kAppigoTagNotFound)
+				[registeredExcludedTags addObject:tag];
+		}
+
+		AppigoTagSet *excluded = [AppigoTagSet tagSetWithTags:registeredExcludedTags];
+
+		// Identifiers are sorted, so the last ones are the largest
+		AppigoTagIdentifier largest = 0;
+		if (required.count > 0)
+			largest = MAX(largest, [required identifierAtIndex:required.count - 1]);
+		if (excluded.count > 0)
+			largest = MAX(largest, [excluded identifierAtIndex:excluded.count - 1]);
+
+		_wordCount = (NSUInteger)largest / 64 + 1;
+		_required = calloc(_wordCount, sizeof(uint64_t));
+		_excluded = calloc(_wordCount, sizeof(uint64_t));
+		if ( (_required == NULL) || (_excluded == NULL) )
+		{
+			[self release];
+			return nil;
+		}
+
+		for (NSUInteger i = 0; i < required.count; i++)
+		{
+			AppigoTagIdentifier identifier = [required identifierAtIndex:i];
+			_required[identifier / 64] |= (1ULL << (identifier % 64));
+		}
+
+		for (NSUInteger i = 0; i < excluded.count; i++)
+		{
+			AppigoTagIdentifier identifier = [excluded identifierAtIndex:i];
+			_excluded[identifier / 64] |= (1ULL << (identifier % 64));
+		}
+
+		_requiredCount = required.count;
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	free(_required);
+	free(_excluded);
+
+	[super dealloc];
+}
+
+
+- (BOOL)matchesTagSet:(AppigoTagSet *)tagSet
+{
+	if (_matchesNothing == YES)
+		return NO;
+
+	NSUInteger count = tagSet.count;
+	if (count < _requiredCount)
+		return NO;
+
+	const AppigoTagIdentifier *identifiers = [tagSet _identifiers];
+	NSUInteger limit = _wordCount * 64;
+	NSUInteger requiredFound = 0;
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		AppigoTagIdentifier identifier = identifiers[i];
+
+		// Identifiers are sorted, the rest are in neither bitset
+		if (identifier >= limit)
+			break;
+
+		uint64_t bit = 1ULL << (identifier % 64);
+		if ((_excluded[identifier / 64] & bit) != 0)
+			return NO;
+
+		if ((_required[identifier / 64] & bit) != 0)
+			requiredFound++;
+	}
+
+	return (requiredFound == _requiredCount);
+}
+
+
+- (BOOL)matchesTask:(AppigoTask *)task
+{
+	return [self matchesTagSet:task.tagSet];
+}
+
+
+- (NSIndexSet *)indexesOfMatchingTasks:(NSArray *)tasks
+{
+	NSMutableIndexSet *indexes = [NSMutableIndexSet indexSet];
+
+	NSUInteger index = 0;
+	for (AppigoTask *task in tasks)
+	{
+		if ([self matchesTagSet:task.tagSet] == YES)
+			[indexes addIndex:index];
+
+		index++;
+	}
+
+	return indexes;
+}
+
+
+- (NSArray *)filteredTasks:(NSArray *)tasks
+{
+	NSMutableArray *matches = [NSMutableArray array];
+
+	for (AppigoTask *task in tasks)
+	{
+		if ([self matchesTagSet:task.tagSet] == YES)
+			[matches addObject:task];
+	}
+
+	return matches;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTagSet)
+
+
+- (AppigoTagSet *)tagSet
+{
+	// Goes through the accessor so that previews decode their tags first
+	NSString *someTags = self.tags;
+
+	if (_tagSet == nil)
+		_tagSet = [[AppigoTagSet tagSetWithString:someTags] retain];
+
+	return _tagSet;
+}
+
+
+- (void)setTagSet:(AppigoTagSet *)aTagSet
+{
+	// The string stays the field that is encoded, setting it clears _tagSet
+	self.tags = [aTagSet stringValue];
+
+	[_tagSet release];
+	_tagSet = [aTagSet copy];
+}
+
+
+@end
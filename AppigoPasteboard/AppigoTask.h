@@ -41,6 +41,7 @@
 
 
 @class AppigoNote;
+@class AppigoTagSet;
 
 
 #define kAppigoTaskTypeAppIdKey					@"app-id"
@@ -104,6 +105,7 @@ typedef enum
 	UIImage				*actionImage;
 	
 	NSMutableArray		*_subtasks;
+	AppigoTagSet		*_tagSet;		// parsed from tags on demand, see AppigoTagSet.h
 }
 
 
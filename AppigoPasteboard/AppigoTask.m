@@ -27,6 +27,9 @@
 #import "AppigoPasteboard.h"
 #import "AppigoTask.h"
 #import "AppigoNote.h"
+#import "AppigoImageCoding.h"
+#import "AppigoStringPool.h"
+#import "AppigoStringTrimming.h"
 
 
 #pragma mark Task Properties
@@ -51,6 +54,182 @@
 #define kAppigoTaskSubtasksKey			@"com.appigo.task.subtasks"				// NSArray * (of NSDictionary * tasks)
 
 
+#pragma mark -
+@interface AppigoTask (Private)
+
+- (id)_initWithCoder:(NSCoder *)aDecoder headerOnly:(BOOL)headerOnly;
+- (void)_decodeBodyWithCoder:(NSCoder *)aDecoder;
+- (void)_appendPlainTextToString:(NSMutableString *)text withName:(BOOL)includeName;
+
+@end
+
+
+#pragma mark -
+#pragma mark Plain Text Rendering
+
+
+// Localized strings used by the plain text representation
+typedef struct
+{
+	NSString *priority;
+	NSString *priorityHigh;
+	NSString *priorityMedium;
+	NSString *priorityLow;
+	NSString *priorityNone;
+	NSString *dueDate;
+	NSString *noDueDate;
+	NSString *startDate;
+	NSString *completed;
+	NSString *notCompleted;
+	NSString *note;
+} AppigoTaskPlainTextStrings;
+
+
+// A subtask list being rendered and the index of its next subtask
+typedef struct
+{
+	NSArray		*subtasks;
+	NSUInteger	index;
+} AppigoTaskPlainTextFrame;
+
+
+#define kAppigoTaskDateFormattersThreadKey	@"com.appigo.task.date-formatters"
+#define kAppigoTaskSubtaskSeparator			@"\n--------\n\n"
+
+
+// The strings only depend on the main bundle, so they are resolved once
+static const AppigoTaskPlainTextStrings *AppigoTaskGetPlainTextStrings(void)
+{
+	static AppigoTaskPlainTextStrings strings;
+	static dispatch_once_t onceToken;
+	
+	dispatch_once(&onceToken, ^{
+		strings.priority = [NSLocalizedString(@"Priority", @"") retain];
+		strings.priorityHigh = [NSLocalizedString(@"High", @"High task priority") retain];
+		strings.priorityMedium = [NSLocalizedString(@"Medium", @"Medium task priority") retain];
+		strings.priorityLow = [NSLocalizedString(@"Low", @"Low task priority") retain];
+		strings.priorityNone = [NSLocalizedString(@"None", @"No priority") retain];
+		strings.dueDate = [NSLocalizedString(@"Due Date", @"") retain];
+		strings.noDueDate = [NSLocalizedString(@"No due date", @"") retain];
+		strings.startDate = [NSLocalizedString(@"Start Date", @"") retain];
+		strings.completed = [NSLocalizedString(@"Completed", @"") retain];
+		strings.notCompleted = [NSLocalizedString(@"No", @"") retain];
+		strings.note = [NSLocalizedString(@"Note", @"") retain];
+	});
+	
+	return &strings;
+}
+
+
+// NSDateFormatter is expensive to create and not safe to share between
+// threads, so each thread keeps one per locale
+static NSDateFormatter *AppigoTaskGetPlainTextDateFormatter(void)
+{
+	NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+	NSMutableDictionary *formatters = [threadDictionary objectForKey:kAppigoTaskDateFormattersThreadKey];
+	if (formatters == nil)
+	{
+		formatters = [NSMutableDictionary dictionary];
+		[threadDictionary setObject:formatters forKey:kAppigoTaskDateFormattersThreadKey];
+	}
+	
+	NSLocale *locale = [NSLocale currentLocale];
+	NSString *localeIdentifier = [locale localeIdentifier];
+	
+	NSDateFormatter *dateFormatter = [formatters objectForKey:localeIdentifier];
+	if (dateFormatter == nil)
+	{
+		dateFormatter = [[NSDateFormatter alloc] init];
+		[dateFormatter setLocale:locale];
+		[dateFormatter setDateStyle:NSDateFormatterLongStyle];
+		[dateFormatter setTimeStyle:NSDateFormatterNoStyle];
+		
+		[formatters setObject:dateFormatter forKey:localeIdentifier];
+		[dateFormatter release];
+	}
+	
+	return dateFormatter;
+}
+
+
+// Append the fields of a single task, without its subtasks. Fields are read
+// through their accessors so that lazily decoded tasks are filled in.
+static void AppigoTaskAppendPlainTextFields(NSMutableString *text, AppigoTask *task, BOOL includeName, const AppigoTaskPlainTextStrings *strings, NSDateFormatter *dateFormatter)
+{
+	if (includeName == YES)
+	{
+		[text appendString:task.name];
+		[text appendString:@"\n\n"];
+	}
+	
+	// Priority
+	NSString *taskPriorityString;
+	switch (task.priority)
+	{
+		case AppigoTaskPriorityHigh:
+			taskPriorityString = strings->priorityHigh;
+			break;
+		case AppigoTaskPriorityMedium:
+			taskPriorityString = strings->priorityMedium;
+			break;
+		case AppigoTaskPriorityLow:
+			taskPriorityString = strings->priorityLow;
+			break;
+		default:
+			taskPriorityString = strings->priorityNone;
+			break;
+	}
+	
+	[text appendString:strings->priority];
+	[text appendString:@": "];
+	[text appendString:taskPriorityString];
+	[text appendString:@"\n"];
+	
+	// Due Date
+	NSDate *dueDate = task.dueDate;
+	if (dueDate != nil)
+	{
+		[text appendString:strings->dueDate];
+		[text appendString:@": "];
+		if ([dueDate compare:[NSDate distantFuture]] == NSOrderedSame)
+			[text appendString:strings->noDueDate];
+		else
+			[text appendString:[dateFormatter stringFromDate:dueDate]];
+		[text appendString:@"\n"];
+	}
+	
+	// Start Date
+	NSDate *startDate = task.startDate;
+	if ( (startDate != nil) && ([startDate compare:[NSDate distantPast]] != NSOrderedSame) )
+	{
+		[text appendString:strings->startDate];
+		[text appendString:@": "];
+		[text appendString:[dateFormatter stringFromDate:startDate]];
+		[text appendString:@"\n"];
+	}
+	
+	// Completed
+	NSDate *completionDate = task.completionDate;
+	[text appendString:strings->completed];
+	[text appendString:@": "];
+	if ( (completionDate == nil) || ([completionDate compare:[NSDate distantPast]] == NSOrderedSame) )
+		[text appendString:strings->notCompleted];
+	else
+		[text appendString:[dateFormatter stringFromDate:completionDate]];
+	[text appendString:@"\n"];
+	
+	// Note
+	NSString *taskNote = task.note;
+	if (taskNote != nil)
+	{
+		[text appendString:strings->note];
+		[text appendString:@":\n"];
+		[text appendString:taskNote];
+		[text appendString:@"\n"];
+	}
+}
+
+
 #pragma mark -
 @implementation AppigoTask
 
@@ -88,10 +267,13 @@
 {
 	if (self = [super init])
 	{
-		if ( (taskName == nil) || ([[taskName stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] length] == 0) )
+		// The name is trimmed once here and never changes, so it is encoded as is
+		name = AppigoCopyStringByTrimmingWhitespace(taskName);
+		if ([name length] == 0)
+		{
+			[name release];
 			name = [[NSString alloc] initWithString:@"Unknown"];
-		else
-			name = [[NSString alloc] initWithString:[taskName stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]]];
+		}
 		
 		_subtasks = [[NSMutableArray alloc] init];
 		
@@ -121,6 +303,7 @@
 	[actionImage release];
 	
 	[_subtasks release];
+	[_tagSet release];
 	
 	[super dealloc];
 }
@@ -198,7 +381,7 @@
 						   withActionImage:(UIImage *)anActionImage
 {
 	// Must have a non-empty display name
-	if ( (aDisplayName == nil) || ([[aDisplayName stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] length] == 0) )
+	if (AppigoStringIsBlank(aDisplayName) == YES)
 	{
 		NSLog(@"displayName must not be nil or empty.");
 		return;
@@ -288,8 +471,9 @@
 			}
 			else
 			{
-				// Make sure that we can get a PNG representation of the UIImage
-				NSData *imageData = UIImagePNGRepresentation(anActionImage);
+				// Make sure that we can get a PNG representation of the UIImage.
+				// The PNG data is kept for when the task is archived.
+				NSData *imageData = AppigoImagePNGRepresentation(anActionImage);
 				if (imageData != nil)
 					self.actionImage = anActionImage;
 				else
@@ -304,73 +488,7 @@
 {
 	NSMutableString *text = [[[NSMutableString alloc] init] autorelease];
 	
-	if (includeName == YES)
-		[text appendFormat:@"%@\n\n", self.name];
-	
-	// Priority
-	NSString *taskPriorityString;
-	switch (self.priority)
-	{
-		case AppigoTaskPriorityHigh:
-			taskPriorityString = NSLocalizedString(@"High", @"High task priority");
-			break;
-		case AppigoTaskPriorityMedium:
-			taskPriorityString = NSLocalizedString(@"Medium", @"Medium task priority");
-			break;
-		case AppigoTaskPriorityLow:
-			taskPriorityString = NSLocalizedString(@"Low", @"Low task priority");
-			break;
-		default:
-			taskPriorityString = NSLocalizedString(@"None", @"No priority");
-			break;
-	}
-	
-	[text appendFormat:@"%@: %@\n", NSLocalizedString(@"Priority", @""), taskPriorityString];
-	
-	// Due Date
-	NSDateFormatter *dateFormatter = [[NSDateFormatter alloc] init];
-	[dateFormatter setDateStyle:NSDateFormatterLongStyle];
-	[dateFormatter setTimeStyle:NSDateFormatterNoStyle];
-	
-	if (self.dueDate != nil)
-	{
-		[text appendFormat:@"%@: ", NSLocalizedString(@"Due Date", @"")];
-		if ([self.dueDate compare:[NSDate distantFuture]] == NSOrderedSame)
-			[text appendFormat:@"%@\n", NSLocalizedString(@"No due date", @"")];
-		else
-			[text appendFormat:@"%@\n", [dateFormatter stringFromDate:dueDate]];
-	}
-	
-	// Start Date
-	if ( (self.startDate != nil) && ([self.startDate compare:[NSDate distantPast]] != NSOrderedSame) )
-	{
-		[text appendFormat:@"%@: %@\n",
-		 NSLocalizedString(@"Start Date", @""),
-		 [dateFormatter stringFromDate:self.startDate]];
-	}
-	
-	// Completed
-	if ( (self.completionDate == nil) || ([self.completionDate compare:[NSDate distantPast]] == NSOrderedSame) )
-		[text appendFormat:@"%@: %@\n", NSLocalizedString(@"Completed", @""), NSLocalizedString(@"No", @"")];
-	else
-		[text appendFormat:@"%@: %@\n", NSLocalizedString(@"Completed", @""), [dateFormatter stringFromDate:self.completionDate]];
-	
-	// Note
-	if (self.note != nil)
-	{
-		[text appendFormat:@"%@:\n%@\n", NSLocalizedString(@"Note", @""), self.note];
-	}
-	
-	// Subtasks
-	for (int i = 0; i < [_subtasks count]; i++)
-	{
-		AppigoTask *subtask = [_subtasks objectAtIndex:i];
-		
-		[text appendString:@"\n--------\n\n"];
-		[text appendString:[subtask plainTextRepresentationWithName:YES]];
-	}
-								
-	[dateFormatter release];
+	[self _appendPlainTextToString:text withName:includeName];
 	
 	return text;
 }
@@ -382,7 +500,7 @@
 	
 	NSMutableString *noteText = [[NSMutableString alloc] init];
 	
-	[noteText appendString:[self plainTextRepresentationWithName:NO]];
+	[self _appendPlainTextToString:noteText withName:NO];
 	
 	newNote.text = noteText;
 	[noteText release];
@@ -397,97 +515,13 @@
 
 - (id)initWithCoder:(NSCoder *)aDecoder
 {
-	if (self = [super init])
-	{
-		NSCharacterSet *whitespace = [NSCharacterSet whitespaceCharacterSet];
-		
-		NSString *aName = [aDecoder decodeObjectForKey:kAppigoTaskNameKey];
-		if (aName == nil)
-			name = [[NSString alloc] initWithString:@"Unknown"];
-		else
-			name = [[NSString alloc] initWithString:[aName stringByTrimmingCharactersInSet:whitespace]];
-		
-		type = (AppigoTaskType)[aDecoder decodeIntegerForKey:kAppigoTaskTypeKey];
-		
-		NSArray *keys = [aDecoder decodeObjectForKey:kAppigoTaskTypeKeysKey];
-		if (keys != nil)
-			typeKeys = [[NSArray alloc] initWithArray:keys];
-		
-		NSArray *values = [aDecoder decodeObjectForKey:kAppigoTaskTypeValuesKey];
-		if (values != nil)
-			typeValues = [[NSArray alloc] initWithArray:values];
-		
-		int pri = [aDecoder decodeIntegerForKey:kAppigoTaskPriorityKey];
-		switch (pri) {
-			case 1:
-				priority = AppigoTaskPriorityHigh;
-				break;
-			case 2:
-				priority = AppigoTaskPriorityMedium;
-				break;
-			case 3:
-				priority = AppigoTaskPriorityLow;
-				break;
-			case 4:
-				priority = AppigoTaskPriorityNone;
-				break;
-		}
-
-		NSDate *aDueDate = [aDecoder decodeObjectForKey:kAppigoTaskDueDateKey];
-		if (aDueDate != nil)
-			dueDate = [aDueDate retain];
-		
-		dueDateHasTime = [aDecoder decodeBoolForKey:kAppigoTaskDueDateHasTimeKey];
-		
-		NSDate *aStartDate = [aDecoder decodeObjectForKey:kAppigoTaskStartDateKey];
-		if (aStartDate != nil)
-			startDate = [aStartDate retain];
-		
-		NSDate *aCompletionDate = [aDecoder decodeObjectForKey:kAppigoTaskCompletionDateKey];
-		if (aCompletionDate != nil)
-			completionDate = [aCompletionDate retain];
-		
-		repeat = [aDecoder decodeIntegerForKey:kAppigoTaskRepeatKey];
-		
-		NSString *anAdvancedRepeat = [aDecoder decodeObjectForKey:kAppigoTaskAdvancedRepeatKey];
-		if (anAdvancedRepeat != nil)
-			advancedRepeat = [[NSString alloc] initWithString:[anAdvancedRepeat stringByTrimmingCharactersInSet:whitespace]];
-		
-		NSString *aNote = [aDecoder decodeObjectForKey:kAppigoTaskNoteKey];
-		if (aNote != nil)
-			note = [[NSString alloc] initWithString:[aNote stringByTrimmingCharactersInSet:whitespace]];
-		
-		NSString *aList = [aDecoder decodeObjectForKey:kAppigoTaskListKey];
-		if (aList != nil)
-			list = [[NSString alloc] initWithString:[aList stringByTrimmingCharactersInSet:whitespace]];
-		
-		NSString *aContext = [aDecoder decodeObjectForKey:kAppigoTaskContextKey];
-		if (aContext != nil)
-			context = [[NSString alloc] initWithString:[aContext stringByTrimmingCharactersInSet:whitespace]];
-		
-		NSString *someTags = [aDecoder decodeObjectForKey:kAppigoTaskTagsKey];
-		if (someTags != nil)
-			tags = [[NSString alloc] initWithString:[someTags stringByTrimmingCharactersInSet:whitespace]];
-		
-		NSData *imageData = [aDecoder decodeObjectForKey:kAppigoTaskActionImageDataKey];
-		if (imageData != nil)
-			actionImage = [[UIImage alloc] initWithData:imageData];
-		
-		// Now check for subtasks
-		NSArray *someSubtasks = [aDecoder decodeObjectForKey:kAppigoTaskSubtasksKey];
-		if (someSubtasks != nil)
-			_subtasks = [[NSMutableArray alloc] initWithArray:someSubtasks];
-		else
-			_subtasks = [[NSMutableArray alloc] init];
-	}
-	
-	return self;
+	return [self _initWithCoder:aDecoder headerOnly:NO];
 }
 
 
 - (void)encodeWithCoder:(NSCoder *)aCoder
 {
-	[aCoder encodeObject:[name stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]] forKey:kAppigoTaskNameKey];
+	[aCoder encodeObject:name forKey:kAppigoTaskNameKey];
 	
 	[aCoder encodeInteger:type forKey:kAppigoTaskTypeKey];
 	
@@ -519,18 +553,18 @@
 		[aCoder encodeObject:note forKey:kAppigoTaskNoteKey];
 	
 	if (list != nil)
-		[aCoder encodeObject:list forKey:kAppigoTaskContextKey];
+		[aCoder encodeObject:list forKey:kAppigoTaskListKey];
 	
 	if (context != nil)
-		[aCoder encodeObject:context forKey:kAppigoTaskTagsKey];
+		[aCoder encodeObject:context forKey:kAppigoTaskContextKey];
 	
 	if (tags != nil)
-		[aCoder encodeObject:tags forKey:kAppigoTaskSubtasksKey];
+		[aCoder encodeObject:tags forKey:kAppigoTaskTagsKey];
 	
 	if (actionImage != nil)
 	{
 		// Make sure that the image can be converted to PNG data
-		NSData *imageData = UIImagePNGRepresentation(actionImage);
+		NSData *imageData = AppigoImagePNGRepresentation(actionImage);
 		if (imageData != nil)
 			[aCoder encodeObject:imageData forKey:kAppigoTaskActionImageDataKey];
 	}
@@ -564,4 +598,186 @@
 }
 
 
+- (void)setTags:(NSString *)someTags
+{
+	if (tags != someTags)
+	{
+		[tags release];
+		tags = [someTags retain];
+	}
+	
+	// Parsed again from the new string when it is next used
+	[_tagSet release];
+	_tagSet = nil;
+}
+
+
+@end
+
+
+#pragma mark -
+
+
+@implementation AppigoTask (Private)
+
+
+- (id)_initWithCoder:(NSCoder *)aDecoder headerOnly:(BOOL)headerOnly
+{
+	if (self = [super init])
+	{
+		NSString *aName = [aDecoder decodeObjectForKey:kAppigoTaskNameKey];
+		if (aName == nil)
+			name = [[NSString alloc] initWithString:@"Unknown"];
+		else
+			name = AppigoCopyStringByTrimmingWhitespace(aName);
+		
+		type = (AppigoTaskType)[aDecoder decodeIntegerForKey:kAppigoTaskTypeKey];
+		
+		int pri = [aDecoder decodeIntegerForKey:kAppigoTaskPriorityKey];
+		switch (pri) {
+			case 1:
+				priority = AppigoTaskPriorityHigh;
+				break;
+			case 2:
+				priority = AppigoTaskPriorityMedium;
+				break;
+			case 3:
+				priority = AppigoTaskPriorityLow;
+				break;
+			case 4:
+				priority = AppigoTaskPriorityNone;
+				break;
+		}
+
+		NSDate *aDueDate = [aDecoder decodeObjectForKey:kAppigoTaskDueDateKey];
+		if (aDueDate != nil)
+			dueDate = [aDueDate retain];
+		
+		dueDateHasTime = [aDecoder decodeBoolForKey:kAppigoTaskDueDateHasTimeKey];
+		
+		NSDate *aStartDate = [aDecoder decodeObjectForKey:kAppigoTaskStartDateKey];
+		if (aStartDate != nil)
+			startDate = [aStartDate retain];
+		
+		NSDate *aCompletionDate = [aDecoder decodeObjectForKey:kAppigoTaskCompletionDateKey];
+		if (aCompletionDate != nil)
+			completionDate = [aCompletionDate retain];
+		
+		repeat = [aDecoder decodeIntegerForKey:kAppigoTaskRepeatKey];
+		
+		// Everything else is only needed once the task is used beyond a list
+		// preview (see AppigoTaskPreview.h)
+		if (headerOnly == NO)
+			[self _decodeBodyWithCoder:aDecoder];
+	}
+	
+	return self;
+}
+
+
+- (void)_decodeBodyWithCoder:(NSCoder *)aDecoder
+{
+	NSArray *keys = [aDecoder decodeObjectForKey:kAppigoTaskTypeKeysKey];
+	if (keys != nil)
+		typeKeys = [[NSArray alloc] initWithArray:keys];
+	
+	NSArray *values = [aDecoder decodeObjectForKey:kAppigoTaskTypeValuesKey];
+	if (values != nil)
+		typeValues = [[NSArray alloc] initWithArray:values];
+	
+	NSString *anAdvancedRepeat = [aDecoder decodeObjectForKey:kAppigoTaskAdvancedRepeatKey];
+	if (anAdvancedRepeat != nil)
+		advancedRepeat = AppigoCopyStringByTrimmingWhitespace(anAdvancedRepeat);
+	
+	NSString *aNote = [aDecoder decodeObjectForKey:kAppigoTaskNoteKey];
+	if (aNote != nil)
+		note = AppigoCopyStringByTrimmingWhitespace(aNote);
+	
+	// Lists, contexts and tags repeat across a batch of tasks
+	AppigoStringPool *strings = [AppigoStringPool currentPool];
+	
+	NSString *aList = [aDecoder decodeObjectForKey:kAppigoTaskListKey];
+	if (aList != nil)
+		list = AppigoCopyInternedTrimmedString(aList, strings);
+	
+	NSString *aContext = [aDecoder decodeObjectForKey:kAppigoTaskContextKey];
+	if (aContext != nil)
+		context = AppigoCopyInternedTrimmedString(aContext, strings);
+	
+	NSString *someTags = [aDecoder decodeObjectForKey:kAppigoTaskTagsKey];
+	if (someTags != nil)
+		tags = AppigoCopyInternedTrimmedString(someTags, strings);
+	
+	NSData *imageData = [aDecoder decodeObjectForKey:kAppigoTaskActionImageDataKey];
+	if (imageData != nil)
+		actionImage = [AppigoImageWithPNGDataFromCoder(imageData, aDecoder) retain];
+	
+	// Now check for subtasks
+	NSArray *someSubtasks = [aDecoder decodeObjectForKey:kAppigoTaskSubtasksKey];
+	if (someSubtasks != nil)
+		_subtasks = [[NSMutableArray alloc] initWithArray:someSubtasks];
+	else
+		_subtasks = [[NSMutableArray alloc] init];
+}
+
+
+- (void)_appendPlainTextToString:(NSMutableString *)text withName:(BOOL)includeName
+{
+	const AppigoTaskPlainTextStrings *strings = AppigoTaskGetPlainTextStrings();
+	NSDateFormatter *dateFormatter = AppigoTaskGetPlainTextDateFormatter();
+	
+	AppigoTaskAppendPlainTextFields(text, self, includeName, strings, dateFormatter);
+	
+	NSArray *subtasks = self.subtasks;
+	if ([subtasks count] == 0)
+		return;
+	
+	// Walk the subtasks depth first with an explicit stack, so that every
+	// task is appended straight to text no matter how deep the tree is
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoTaskPlainTextFrame *stack = malloc(sizeof(AppigoTaskPlainTextFrame) * capacity);
+	if (stack == NULL)
+		return;
+	
+	stack[0].subtasks = subtasks;
+	stack[0].index = 0;
+	
+	while (depth > 0)
+	{
+		AppigoTaskPlainTextFrame *frame = &stack[depth - 1];
+		if (frame->index >= [frame->subtasks count])
+		{
+			depth--;
+			continue;
+		}
+		
+		AppigoTask *subtask = [frame->subtasks objectAtIndex:frame->index++];
+		
+		[text appendString:kAppigoTaskSubtaskSeparator];
+		AppigoTaskAppendPlainTextFields(text, subtask, YES, strings, dateFormatter);
+		
+		NSArray *children = subtask.subtasks;
+		if ([children count] == 0)
+			continue;
+		
+		if (depth == capacity)
+		{
+			AppigoTaskPlainTextFrame *grownStack = realloc(stack, sizeof(AppigoTaskPlainTextFrame) * capacity * 2);
+			if (grownStack == NULL)
+				break;
+			
+			stack = grownStack;
+			capacity *= 2;
+		}
+		
+		stack[depth].subtasks = children;
+		stack[depth].index = 0;
+		depth++;
+	}
+	
+	free(stack);
+}
+
+
 @end
@@ -0,0 +1,117 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskDelta.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTaskDelta.h
+ @brief Encodes only what changed in a task tree since it was last exported.
+
+ Exporting a large project again after a small edit used to encode the whole
+ tree. A snapshot remembers a content fingerprint of every task in a tree: a
+ hash of the task's own fields, combined with the fingerprints of its
+ subtasks. Comparing a tree against the snapshot of an earlier export skips
+ every unchanged subtree after a single comparison. A delta then only holds
+ the tasks that were added or changed. Subtasks that were removed are left
+ out, and unchanged subtrees are referred to by their position in the
+ earlier tree.
+
+ A delta is a binary payload of kind kAppigoBinaryCodingKindTaskDelta:
+
+ @code
+ delta   := preamble, varint imageCount, data * imageCount,
+			int64 baseFingerprint, int64 fingerprint, node
+ node    := uint8 0, varint baseIndex                        (keep)
+		  | uint8 1, varint baseIndex, uint8 hasFields,
+			[record], varint subtaskCount, node * subtaskCount  (patch)
+		  | uint8 2, record                                   (add)
+ @endcode
+
+ Base indexes count the tasks of the earlier tree breadth first, starting with
+ the root at 0. A keep node reuses that task and all of its subtasks, and a
+ patch node reuses its fields unless a record with new fields (and no
+ subtasks) follows. An add node is a complete record with all of its
+ subtasks, in the format of AppigoBinaryCoding.h.
+
+ Only receivers that still hold the tree of the earlier export can apply a
+ delta, and Todo is not one of them. AppigoPasteboard only writes deltas when
+ asked to (see setTask:inPasteboardNamed:deltaSupported:).
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "AppigoTask.h"
+
+
+typedef struct AppigoTaskSnapshotNode AppigoTaskSnapshotNode;
+
+
+#pragma mark -
+/**
+ @class AppigoTaskSnapshot AppigoTaskDelta.h
+ @brief The fingerprints of a task tree at one point in time.
+
+ A snapshot does not keep the tasks, so changing them later does not change
+ the snapshot.
+ */
+@interface AppigoTaskSnapshot : NSObject
+{
+@private
+	AppigoTaskSnapshotNode	*_nodes;	// breadth first, subtasks are contiguous
+	NSUInteger				_count;
+}
+
+/** The number of tasks in the tree. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/** The fingerprint of the whole tree. */
+@property (nonatomic, readonly) uint64_t fingerprint;
+
+/**
+ Take a snapshot of a task and all of its subtasks.
+
+ @param task The root of the tree.
+ @return Returns nil if task is nil or memory ran out.
+ */
+- (id)initWithTask:(AppigoTask *)task;
+
+@end
+
+
+#pragma mark -
+@interface AppigoTask (AppigoTaskDelta)
+
+/**
+ Encode the differences between an earlier snapshot and this task.
+
+ @param base The snapshot of the earlier tree, may be nil.
+ @param snapshot Receives an autoreleased snapshot of this task to use as
+ the base of the next delta, may be NULL.
+ @return Returns the delta, or nil if there is no base or the root task
+ itself was replaced, in which case a full payload should be written.
+ */
+- (NSData *)binaryDeltaFromSnapshot:(AppigoTaskSnapshot *)base snapshot:(AppigoTaskSnapshot **)snapshot;
+
+/**
+ Apply a delta that was created against the snapshot of this task.
+
+ Unchanged subtrees of this task are shared with the new tree rather than
+ copied.
+
+ @param delta The delta.
+ @return Returns an autoreleased task, or nil if the delta was not made
+ against this task or is damaged.
+ */
+- (AppigoTask *)taskByApplyingBinaryDelta:(NSData *)delta;
+
+@end
+
+
+/** Returns YES if data is a task delta payload. */
+BOOL AppigoBinaryDataIsTaskDelta(NSData *data);
@@ -0,0 +1,882 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskDelta.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTaskDelta.h"
+#import "AppigoBinaryCoding.h"
+#import "AppigoChecksum.h"
+#import "AppigoImageCoding.h"
+
+
+#define kAppigoTaskDeltaKeep				0
+#define kAppigoTaskDeltaPatch				1
+#define kAppigoTaskDeltaAdd					2
+
+#define kAppigoTaskDeltaHashSeed			14695981039346656037ULL
+#define kAppigoTaskDeltaAutoreleaseBatch	256
+
+
+struct AppigoTaskSnapshotNode
+{
+	uint64_t	fingerprint;	// the fields and the fingerprints of every subtask
+	uint64_t	fieldsHash;		// the fields of the task itself
+	uint64_t	nameHash;
+	uint32_t	firstSubtask;
+	uint32_t	subtaskCount;
+};
+
+
+// Which base subtask a subtask is written against
+typedef struct
+{
+	uint8_t		operation;
+	BOOL		hasFields;
+	uint32_t	baseIndex;
+} AppigoTaskDeltaMatch;
+
+
+// A base subtask ordered by one of its hashes
+typedef struct
+{
+	uint64_t	key;
+	uint32_t	position;
+} AppigoTaskDeltaKey;
+
+
+// A patched task whose subtasks are still being written
+typedef struct
+{
+	uint32_t				index;
+	uint32_t				next;
+	AppigoTaskDeltaMatch	*matches;
+} AppigoTaskDeltaWriteFrame;
+
+
+// A patched task whose subtasks are still being read
+typedef struct
+{
+	AppigoTask	*task;
+	uint64_t	remaining;
+} AppigoTaskDeltaReadFrame;
+
+
+// Implemented in AppigoBinaryCoding.m
+@interface AppigoTask (AppigoBinaryCodingPrivate)
+
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader;
+- (void)_appendBinaryRecordToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable;
+
+@end
+
+
+@interface AppigoTask (AppigoTaskDeltaPrivate)
+
+- (AppigoTask *)_copyWithoutSubtasks;
+
+@end
+
+
+@interface AppigoTaskSnapshot (Private)
+
+- (id)_initWithTask:(AppigoTask *)task tasks:(AppigoTask ***)tasks;
+- (const AppigoTaskSnapshotNode *)_nodes;
+
+@end
+
+
+#pragma mark -
+#pragma mark Hashing
+
+// FNV-1a over the eight bytes of a value
+static inline uint64_t AppigoTaskDeltaMix(uint64_t hash, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+static void AppigoTaskDeltaWriteStrings(NSMutableData *data, NSArray *strings)
+{
+	AppigoBinaryWriteVarint(data, (strings == nil) ? 0 : [strings count] + 1);
+	for (NSString *string in strings)
+		AppigoBinaryWriteString(data, string);
+}
+
+
+// Images are hashed by their PNG data, once per image instance
+static uint64_t AppigoTaskDeltaImageHash(UIImage *image, NSMutableDictionary *imageHashes)
+{
+	if (image == nil)
+		return 0;
+
+	NSValue *key = [NSValue valueWithNonretainedObject:image];
+	NSNumber *hash = [imageHashes objectForKey:key];
+	if (hash == nil)
+	{
+		NSData *png = AppigoImagePNGRepresentation(image);
+		hash = [NSNumber numberWithUnsignedLongLong:AppigoFNV1a64([png bytes], [png length])];
+		[imageHashes setObject:hash forKey:key];
+	}
+
+	return [hash unsignedLongLongValue];
+}
+
+
+// Hashes everything a record holds except the subtasks. The name comes
+// first so that its hash is a prefix of the same bytes.
+static void AppigoTaskDeltaHashFields(AppigoTask *task, NSMutableData *scratch, NSMutableDictionary *imageHashes, uint64_t *nameHash, uint64_t *fieldsHash)
+{
+	[scratch setLength:0];
+
+	AppigoBinaryWriteString(scratch, task.name);
+	*nameHash = AppigoFNV1a64([scratch bytes], [scratch length]);
+
+	NSDate *dueDate = task.dueDate;
+	NSDate *startDate = task.startDate;
+	NSDate *completionDate = task.completionDate;
+
+	AppigoBinaryWriteVarint(scratch, (uint64_t)task.type);
+	AppigoBinaryWriteVarint(scratch, (uint64_t)task.priority);
+	AppigoBinaryWriteUInt8(scratch, (uint8_t)(((dueDate != nil) ? 0x01 : 0)
+											  | ((startDate != nil) ? 0x02 : 0)
+											  | ((completionDate != nil) ? 0x04 : 0)
+											  | ((task.dueDateHasTime == YES) ? 0x08 : 0)));
+	if (dueDate != nil)
+		AppigoBinaryWriteDate(scratch, dueDate);
+	if (startDate != nil)
+		AppigoBinaryWriteDate(scratch, startDate);
+	if (completionDate != nil)
+		AppigoBinaryWriteDate(scratch, completionDate);
+
+	AppigoBinaryWriteSignedVarint(scratch, task.repeat);
+	AppigoTaskDeltaWriteStrings(scratch, task.typeKeys);
+	AppigoTaskDeltaWriteStrings(scratch, task.typeValues);
+	AppigoBinaryWriteString(scratch, task.advancedRepeat);
+	AppigoBinaryWriteString(scratch, task.note);
+	AppigoBinaryWriteString(scratch, task.list);
+	AppigoBinaryWriteString(scratch, task.context);
+	AppigoBinaryWriteString(scratch, task.tags);
+	AppigoBinaryWriteInt64(scratch, (int64_t)AppigoTaskDeltaImageHash(task.actionImage, imageHashes));
+
+	*fieldsHash = AppigoFNV1a64([scratch bytes], [scratch length]);
+}
+
+
+#pragma mark -
+#pragma mark Matching
+
+static int AppigoTaskDeltaCompareKeys(const void *a, const void *b)
+{
+	const AppigoTaskDeltaKey *first = (const AppigoTaskDeltaKey *)a;
+	const AppigoTaskDeltaKey *second = (const AppigoTaskDeltaKey *)b;
+
+	if (first->key != second->key)
+		return (first->key < second->key) ? -1 : 1;
+	if (first->position != second->position)
+		return (first->position < second->position) ? -1 : 1;
+
+	return 0;
+}
+
+
+static inline uint64_t AppigoTaskDeltaNodeKey(const AppigoTaskSnapshotNode *node, int pass)
+{
+	if (pass == 0)
+		return node->fingerprint;
+	if (pass == 1)
+		return node->fieldsHash;
+
+	return node->nameHash;
+}
+
+
+// Returns the first unused position with a key, or UINT32_MAX
+static uint32_t AppigoTaskDeltaFindKey(const AppigoTaskDeltaKey *keys, uint32_t count, uint64_t key, const BOOL *used)
+{
+	uint32_t low = 0;
+	uint32_t high = count;
+	while (low < high)
+	{
+		uint32_t middle = low + (high - low) / 2;
+		if (keys[middle].key < key)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (uint32_t i = low; (i < count) && (keys[i].key == key); i++)
+	{
+		if (used[keys[i].position] == NO)
+			return keys[i].position;
+	}
+
+	return UINT32_MAX;
+}
+
+
+// Pairs the subtasks of a task with the subtasks of its base task: whole
+// subtrees first, then tasks whose fields are unchanged, then tasks with the
+// same name. Equal keys pair up in order. Returns a malloc'ed array with one
+// match per subtask, or NULL if memory ran out.
+static AppigoTaskDeltaMatch *AppigoTaskDeltaCreateMatches(const AppigoTaskSnapshotNode *baseNodes, uint32_t baseIndex, const AppigoTaskSnapshotNode *nodes, uint32_t index)
+{
+	const AppigoTaskSnapshotNode *baseNode = &baseNodes[baseIndex];
+	const AppigoTaskSnapshotNode *node = &nodes[index];
+
+	uint32_t count = node->subtaskCount;
+	uint32_t baseCount = baseNode->subtaskCount;
+
+	AppigoTaskDeltaMatch *matches = malloc(sizeof(AppigoTaskDeltaMatch) * MAX(count, 1U));
+	if (matches == NULL)
+		return NULL;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		matches[i].operation = kAppigoTaskDeltaAdd;
+		matches[i].hasFields = NO;
+		matches[i].baseIndex = 0;
+	}
+
+	if (baseCount == 0)
+		return matches;
+
+	BOOL *used = calloc(baseCount, sizeof(BOOL));
+	AppigoTaskDeltaKey *keys = malloc(sizeof(AppigoTaskDeltaKey) * baseCount);
+	if ( (used == NULL) || (keys == NULL) )
+	{
+		free(used);
+		free(keys);
+		free(matches);
+		return NULL;
+	}
+
+	uint32_t unmatched = count;
+	for (int pass = 0; (pass < 3) && (unmatched > 0); pass++)
+	{
+		for (uint32_t i = 0; i < baseCount; i++)
+		{
+			keys[i].key = AppigoTaskDeltaNodeKey(&baseNodes[baseNode->firstSubtask + i], pass);
+			keys[i].position = i;
+		}
+		qsort(keys, baseCount, sizeof(AppigoTaskDeltaKey), AppigoTaskDeltaCompareKeys);
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			if (matches[i].operation != kAppigoTaskDeltaAdd)
+				continue;
+
+			uint64_t key = AppigoTaskDeltaNodeKey(&nodes[node->firstSubtask + i], pass);
+			uint32_t position = AppigoTaskDeltaFindKey(keys, baseCount, key, used);
+			if (position == UINT32_MAX)
+				continue;
+
+			used[position] = YES;
+			unmatched--;
+
+			matches[i].operation = (pass == 0) ? kAppigoTaskDeltaKeep : kAppigoTaskDeltaPatch;
+			matches[i].hasFields = (pass == 2) ? YES : NO;
+			matches[i].baseIndex = baseNode->firstSubtask + position;
+		}
+	}
+
+	free(keys);
+	free(used);
+
+	return matches;
+}
+
+
+#pragma mark -
+#pragma mark Writing
+
+static void AppigoTaskDeltaAppendPatchStart(NSMutableData *body, AppigoBinaryImageTable *imageTable, AppigoTask *task, AppigoTaskDeltaMatch match, uint32_t subtaskCount)
+{
+	AppigoBinaryWriteUInt8(body, kAppigoTaskDeltaPatch);
+	AppigoBinaryWriteVarint(body, match.baseIndex);
+	AppigoBinaryWriteUInt8(body, (match.hasFields == YES) ? 1 : 0);
+
+	if (match.hasFields == YES)
+	{
+		// The new fields go out as a record without subtasks
+		AppigoTask *fields = [task _copyWithoutSubtasks];
+		[fields _appendBinaryRecordToData:body imageTable:imageTable];
+		[fields release];
+	}
+
+	AppigoBinaryWriteVarint(body, subtaskCount);
+}
+
+
+// Writes the root as a patch node and walks the patched tasks with an
+// explicit stack, so deep trees do not recurse
+static BOOL AppigoTaskDeltaAppendTree(NSMutableData *body, AppigoBinaryImageTable *imageTable, const AppigoTaskSnapshotNode *baseNodes, const AppigoTaskSnapshotNode *nodes, AppigoTask **tasks)
+{
+	AppigoTaskDeltaMatch rootMatch;
+	rootMatch.operation = kAppigoTaskDeltaPatch;
+	rootMatch.hasFields = (nodes[0].fieldsHash != baseNodes[0].fieldsHash) ? YES : NO;
+	rootMatch.baseIndex = 0;
+
+	AppigoTaskDeltaAppendPatchStart(body, imageTable, tasks[0], rootMatch, nodes[0].subtaskCount);
+	if (nodes[0].subtaskCount == 0)
+		return YES;
+
+	NSUInteger capacity = 16;
+	NSUInteger depth = 0;
+	AppigoTaskDeltaWriteFrame *stack = malloc(sizeof(AppigoTaskDeltaWriteFrame) * capacity);
+	AppigoTaskDeltaMatch *rootMatches = AppigoTaskDeltaCreateMatches(baseNodes, 0, nodes, 0);
+	if ( (stack == NULL) || (rootMatches == NULL) )
+	{
+		free(stack);
+		free(rootMatches);
+		return NO;
+	}
+
+	stack[depth].index = 0;
+	stack[depth].next = 0;
+	stack[depth].matches = rootMatches;
+	depth++;
+
+	BOOL written = YES;
+	NSUInteger writtenCount = 0;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	while ( (depth > 0) && (written == YES) )
+	{
+		AppigoTaskDeltaWriteFrame *frame = &stack[depth - 1];
+		const AppigoTaskSnapshotNode *node = &nodes[frame->index];
+		if (frame->next == node->subtaskCount)
+		{
+			free(frame->matches);
+			depth--;
+			continue;
+		}
+
+		uint32_t index = node->firstSubtask + frame->next;
+		AppigoTaskDeltaMatch match = frame->matches[frame->next];
+		frame->next++;
+
+		if ((++writtenCount % kAppigoTaskDeltaAutoreleaseBatch) == 0)
+		{
+			[pool release];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+
+		if (match.operation == kAppigoTaskDeltaKeep)
+		{
+			AppigoBinaryWriteUInt8(body, kAppigoTaskDeltaKeep);
+			AppigoBinaryWriteVarint(body, match.baseIndex);
+		}
+		else if (match.operation == kAppigoTaskDeltaAdd)
+		{
+			AppigoBinaryWriteUInt8(body, kAppigoTaskDeltaAdd);
+			[tasks[index] _appendBinaryRecordToData:body imageTable:imageTable];
+		}
+		else
+		{
+			AppigoTaskDeltaAppendPatchStart(body, imageTable, tasks[index], match, nodes[index].subtaskCount);
+			if (nodes[index].subtaskCount == 0)
+				continue;
+
+			if (depth == capacity)
+			{
+				AppigoTaskDeltaWriteFrame *newStack = realloc(stack, sizeof(AppigoTaskDeltaWriteFrame) * capacity * 2);
+				if (newStack == NULL)
+				{
+					written = NO;
+					break;
+				}
+
+				stack = newStack;
+				capacity *= 2;
+			}
+
+			AppigoTaskDeltaMatch *matches = AppigoTaskDeltaCreateMatches(baseNodes, match.baseIndex, nodes, index);
+			if (matches == NULL)
+			{
+				written = NO;
+				break;
+			}
+
+			stack[depth].index = index;
+			stack[depth].next = 0;
+			stack[depth].matches = matches;
+			depth++;
+		}
+	}
+
+	[pool release];
+
+	for (NSUInteger i = 0; i < depth; i++)
+		free(stack[i].matches);
+	free(stack);
+
+	return written;
+}
+
+
+#pragma mark -
+#pragma mark Reading
+
+// Reads one node and returns it retained, with the number of subtasks that
+// still follow it in subtaskCount
+static AppigoTask *AppigoTaskDeltaCopyNode(AppigoBinaryReader *reader, AppigoTask **baseTasks, NSUInteger baseCount, uint64_t *subtaskCount)
+{
+	*subtaskCount = 0;
+
+	uint8_t operation = AppigoBinaryReadUInt8(reader);
+	if (reader->failed == YES)
+		return nil;
+
+	if (operation == kAppigoTaskDeltaAdd)
+		return [[AppigoTask alloc] _initWithBinaryReader:reader];
+
+	if ( (operation != kAppigoTaskDeltaKeep) && (operation != kAppigoTaskDeltaPatch) )
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	uint64_t baseIndex = AppigoBinaryReadVarint(reader);
+	if ( (reader->failed == YES) || (baseIndex >= baseCount) )
+	{
+		reader->failed = YES;
+		return nil;
+	}
+
+	if (operation == kAppigoTaskDeltaKeep)
+		return [baseTasks[baseIndex] retain];
+
+	uint8_t hasFields = AppigoBinaryReadUInt8(reader);
+	if (reader->failed == YES)
+		return nil;
+
+	AppigoTask *task = nil;
+	if (hasFields != 0)
+		task = [[AppigoTask alloc] _initWithBinaryReader:reader];
+	else
+		task = [baseTasks[baseIndex] _copyWithoutSubtasks];
+
+	uint64_t count = AppigoBinaryReadVarint(reader);
+
+	// Every node takes at least two bytes
+	if ( (task == nil) || (reader->failed == YES) || (count > (reader->length - reader->offset) / 2) )
+	{
+		reader->failed = YES;
+		[task release];
+		return nil;
+	}
+
+	*subtaskCount = count;
+
+	return task;
+}
+
+
+static AppigoTask *AppigoTaskDeltaCopyTree(AppigoBinaryReader *reader, AppigoTask **baseTasks, NSUInteger baseCount)
+{
+	uint64_t subtaskCount = 0;
+	AppigoTask *root = AppigoTaskDeltaCopyNode(reader, baseTasks, baseCount, &subtaskCount);
+	if ( (root == nil) || (subtaskCount == 0) )
+		return root;
+
+	NSUInteger capacity = 16;
+	NSUInteger depth = 0;
+	AppigoTaskDeltaReadFrame *stack = malloc(sizeof(AppigoTaskDeltaReadFrame) * capacity);
+	if (stack == NULL)
+	{
+		[root release];
+		return nil;
+	}
+
+	stack[depth].task = root;
+	stack[depth].remaining = subtaskCount;
+	depth++;
+
+	BOOL failed = NO;
+	NSUInteger readCount = 0;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	while (depth > 0)
+	{
+		AppigoTaskDeltaReadFrame *frame = &stack[depth - 1];
+		if (frame->remaining == 0)
+		{
+			depth--;
+			continue;
+		}
+
+		frame->remaining--;
+		AppigoTask *parent = frame->task;
+
+		if ((++readCount % kAppigoTaskDeltaAutoreleaseBatch) == 0)
+		{
+			[pool release];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+
+		AppigoTask *subtask = AppigoTaskDeltaCopyNode(reader, baseTasks, baseCount, &subtaskCount);
+		if (subtask == nil)
+		{
+			failed = YES;
+			break;
+		}
+
+		[parent addSubtask:subtask];
+		[subtask release];
+
+		if (subtaskCount == 0)
+			continue;
+
+		if (depth == capacity)
+		{
+			AppigoTaskDeltaReadFrame *newStack = realloc(stack, sizeof(AppigoTaskDeltaReadFrame) * capacity * 2);
+			if (newStack == NULL)
+			{
+				failed = YES;
+				break;
+			}
+
+			stack = newStack;
+			capacity *= 2;
+		}
+
+		stack[depth].task = subtask;
+		stack[depth].remaining = subtaskCount;
+		depth++;
+	}
+
+	[pool release];
+	free(stack);
+
+	if (failed == YES)
+	{
+		[root release];
+		return nil;
+	}
+
+	return root;
+}
+
+
+BOOL AppigoBinaryDataIsTaskDelta(NSData *data)
+{
+	if (AppigoBinaryDataHasPreamble(data) == NO)
+		return NO;
+
+	// The kind follows the magic and the version
+	return (((const uint8_t *)[data bytes])[5] == kAppigoBinaryCodingKindTaskDelta);
+}
+
+
+#pragma mark -
+@implementation AppigoTaskSnapshot
+
+
+- (id)initWithTask:(AppigoTask *)task
+{
+	return [self _initWithTask:task tasks:NULL];
+}
+
+
+- (void)dealloc
+{
+	free(_nodes);
+
+	[super dealloc];
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %lu tasks, fingerprint %016llx>",
+			NSStringFromClass([self class]),
+			(unsigned long)_count,
+			(unsigned long long)self.fingerprint];
+}
+
+
+- (NSUInteger)count
+{
+	return _count;
+}
+
+
+- (uint64_t)fingerprint
+{
+	return _nodes[0].fingerprint;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTaskDelta)
+
+
+- (NSData *)binaryDeltaFromSnapshot:(AppigoTaskSnapshot *)base snapshot:(AppigoTaskSnapshot **)snapshot
+{
+	if (snapshot != NULL)
+		*snapshot = nil;
+
+	AppigoTask **tasks = NULL;
+	AppigoTaskSnapshot *current = [[AppigoTaskSnapshot alloc] _initWithTask:self tasks:&tasks];
+	if (current == nil)
+		return nil;
+
+	NSMutableData *data = nil;
+	const AppigoTaskSnapshotNode *baseNodes = [base _nodes];
+	const AppigoTaskSnapshotNode *nodes = [current _nodes];
+
+	// A root with a new name and new fields is a different task
+	if ( (base != nil)
+		&& ( (nodes[0].nameHash == baseNodes[0].nameHash) || (nodes[0].fieldsHash == baseNodes[0].fieldsHash) ) )
+	{
+		AppigoBinaryImageTable *imageTable = [[AppigoBinaryImageTable alloc] init];
+		NSMutableData *body = [[NSMutableData alloc] initWithCapacity:256];
+
+		AppigoBinaryWriteInt64(body, (int64_t)base.fingerprint);
+		AppigoBinaryWriteInt64(body, (int64_t)current.fingerprint);
+
+		BOOL written = YES;
+		if (base.fingerprint == current.fingerprint)
+		{
+			AppigoBinaryWriteUInt8(body, kAppigoTaskDeltaKeep);
+			AppigoBinaryWriteVarint(body, 0);
+		}
+		else
+		{
+			written = AppigoTaskDeltaAppendTree(body, imageTable, baseNodes, nodes, tasks);
+		}
+
+		if (written == YES)
+		{
+			data = [NSMutableData dataWithCapacity:[body length] + 16];
+			AppigoBinaryWritePreamble(data, kAppigoBinaryCodingKindTaskDelta);
+			[imageTable writeToData:data];
+			[data appendData:body];
+		}
+
+		[body release];
+		[imageTable release];
+	}
+
+	free(tasks);
+
+	if (snapshot != NULL)
+		*snapshot = [current autorelease];
+	else
+		[current release];
+
+	return data;
+}
+
+
+- (AppigoTask *)taskByApplyingBinaryDelta:(NSData *)delta
+{
+	AppigoBinaryReader reader;
+	AppigoBinaryReaderInit(&reader, delta);
+
+	if (AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindTaskDelta) == NO)
+		return nil;
+
+	uint64_t baseFingerprint = (uint64_t)AppigoBinaryReadInt64(&reader);
+	uint64_t fingerprint = (uint64_t)AppigoBinaryReadInt64(&reader);
+	if (reader.failed == YES)
+		return nil;
+
+	AppigoTask **tasks = NULL;
+	AppigoTaskSnapshot *base = [[AppigoTaskSnapshot alloc] _initWithTask:self tasks:&tasks];
+	if (base == nil)
+		return nil;
+
+	AppigoTask *task = nil;
+	if (base.fingerprint == baseFingerprint)
+		task = AppigoTaskDeltaCopyTree(&reader, tasks, base.count);
+
+	free(tasks);
+	[base release];
+
+	// The new tree has to be the one the delta was made from
+	if (task != nil)
+	{
+		AppigoTaskSnapshot *check = [[AppigoTaskSnapshot alloc] initWithTask:task];
+		if ( (check == nil) || (check.fingerprint != fingerprint) )
+		{
+			NSLog(@"Task delta does not produce the task it was made from");
+			[task release];
+			task = nil;
+		}
+		[check release];
+	}
+
+	return [task autorelease];
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTaskDeltaPrivate)
+
+
+// Copies the fields through the accessors, so previews are read in full
+- (AppigoTask *)_copyWithoutSubtasks
+{
+	AppigoTask *copy = [[AppigoTask alloc] initWithName:self.name];
+
+	copy->type = self.type;
+	copy->typeKeys = [self.typeKeys copy];
+	copy->typeValues = [self.typeValues copy];
+
+	copy.priority = self.priority;
+	copy.dueDate = self.dueDate;
+	copy.dueDateHasTime = self.dueDateHasTime;
+	copy.startDate = self.startDate;
+	copy.completionDate = self.completionDate;
+	copy.repeat = self.repeat;
+	copy.advancedRepeat = self.advancedRepeat;
+	copy.note = self.note;
+	copy.list = self.list;
+	copy.context = self.context;
+	copy.tags = self.tags;
+	copy.actionImage = self.actionImage;
+
+	return copy;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTaskSnapshot (Private)
+
+
+// Optionally returns the tasks in node order, not retained, in a malloc'ed
+// array the caller frees
+- (id)_initWithTask:(AppigoTask *)task tasks:(AppigoTask ***)tasksOut
+{
+	if (self = [super init])
+	{
+		NSUInteger capacity = 64;
+		AppigoTask **tasks = malloc(sizeof(AppigoTask *) * capacity);
+		_nodes = malloc(sizeof(AppigoTaskSnapshotNode) * capacity);
+
+		if ( (task == nil) || (tasks == NULL) || (_nodes == NULL) )
+		{
+			free(tasks);
+			[self release];
+			return nil;
+		}
+
+		tasks[0] = task;
+		_count = 1;
+
+		NSMutableData *scratch = [[NSMutableData alloc] initWithCapacity:256];
+		NSMutableDictionary *imageHashes = [[NSMutableDictionary alloc] init];
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		BOOL complete = YES;
+
+		// Breadth first, so the subtasks of a task are next to each other
+		// and come after it
+		for (NSUInteger i = 0; i < _count; i++)
+		{
+			if (((i + 1) % kAppigoTaskDeltaAutoreleaseBatch) == 0)
+			{
+				[pool release];
+				pool = [[NSAutoreleasePool alloc] init];
+			}
+
+			AppigoTask *current = tasks[i];
+			NSArray *subtasks = current.subtasks;
+			NSUInteger subtaskCount = [subtasks count];
+
+			if (_count + subtaskCount > UINT32_MAX)
+			{
+				complete = NO;
+				break;
+			}
+
+			if (_count + subtaskCount > capacity)
+			{
+				NSUInteger newCapacity = MAX(capacity * 2, _count + subtaskCount);
+				AppigoTask **newTasks = realloc(tasks, sizeof(AppigoTask *) * newCapacity);
+				if (newTasks != NULL)
+					tasks = newTasks;
+
+				AppigoTaskSnapshotNode *newNodes = realloc(_nodes, sizeof(AppigoTaskSnapshotNode) * newCapacity);
+				if (newNodes != NULL)
+					_nodes = newNodes;
+
+				if ( (newTasks == NULL) || (newNodes == NULL) )
+				{
+					complete = NO;
+					break;
+				}
+
+				capacity = newCapacity;
+			}
+
+			AppigoTaskSnapshotNode *node = &_nodes[i];
+			AppigoTaskDeltaHashFields(current, scratch, imageHashes, &node->nameHash, &node->fieldsHash);
+			node->firstSubtask = (uint32_t)_count;
+			node->subtaskCount = (uint32_t)subtaskCount;
+
+			for (AppigoTask *subtask in subtasks)
+				tasks[_count++] = subtask;
+		}
+
+		[pool release];
+		[imageHashes release];
+		[scratch release];
+
+		if (complete == NO)
+		{
+			free(tasks);
+			[self release];
+			return nil;
+		}
+
+		// Subtasks come after their task, so walking backwards finishes
+		// every subtask before its task
+		for (NSUInteger i = _count; i > 0; i--)
+		{
+			AppigoTaskSnapshotNode *node = &_nodes[i - 1];
+
+			uint64_t hash = AppigoTaskDeltaMix(kAppigoTaskDeltaHashSeed, node->fieldsHash);
+			hash = AppigoTaskDeltaMix(hash, node->subtaskCount);
+			for (uint32_t j = 0; j < node->subtaskCount; j++)
+				hash = AppigoTaskDeltaMix(hash, _nodes[node->firstSubtask + j].fingerprint);
+
+			node->fingerprint = hash;
+		}
+
+		if (tasksOut != NULL)
+			*tasksOut = tasks;
+		else
+			free(tasks);
+	}
+
+	return self;
+}
+
+
+- (const AppigoTaskSnapshotNode *)_nodes
+{
+	return _nodes;
+}
+
+
+@end
@@ -0,0 +1,295 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskForest.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTaskForest.h
+ @brief A flat container for large trees of tasks.
+
+ @class AppigoTaskForest AppigoTaskForest.h
+ @brief A flat container for large trees of tasks.
+
+ Every AppigoTask is an object with about fifteen retained fields and its
+ subtasks in an array of more objects, so a generated project with tens of
+ thousands of subtasks is tens of thousands of heap blocks to create, walk
+ and release. A forest keeps the same information in one contiguous array
+ per field, indexed by task, and links the tasks through parent, first
+ subtask and next sibling indices. The strings of every task live in a single
+ arena, and action images are shared by reference.
+
+ A forest can be built field by field, filled from AppigoTask objects or from
+ a binary task payload, and written back as a binary task payload (see
+ AppigoBinaryCoding.h) without creating any AppigoTask. Tasks are only
+ materialized when taskAtIndex: is called.
+
+ @code
+ AppigoTaskForest *forest = [[AppigoTaskForest alloc] initWithCapacity:10001];
+ AppigoTaskForestIndex project = [forest addTaskWithName:@"Inventory" parent:kAppigoTaskForestNoTask];
+ [forest setType:AppigoTaskTypeProject ofTask:project];
+
+ for (int i = 0; i < 10000; i++)
+ {
+	char name[32];
+	int length = snprintf(name, sizeof(name), "Item %d", i);
+	[forest addTaskWithUTF8Name:name length:length parent:project];
+ }
+
+ NSData *payload = [forest binaryRepresentationOfTask:project];
+ @endcode
+
+ Strings are trimmed of leading and trailing whitespace, the same way the
+ decoders trim them (see AppigoStringTrimming.h). The arena only grows, so replacing a string leaves
+ the old bytes behind until the forest is released. A forest is not thread
+ safe.
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "AppigoTask.h"
+
+
+/** The index of a task in a forest. */
+typedef uint32_t AppigoTaskForestIndex;
+
+/** Used for a missing parent, subtask or sibling, and to add root tasks. */
+#define kAppigoTaskForestNoTask		UINT32_MAX
+
+
+/**
+ The string fields of a task.
+ */
+typedef enum
+{
+	AppigoTaskForestFieldName = 0,
+	AppigoTaskForestFieldAdvancedRepeat,
+	AppigoTaskForestFieldNote,
+	AppigoTaskForestFieldList,
+	AppigoTaskForestFieldContext,
+	AppigoTaskForestFieldTags,
+	AppigoTaskForestStringFieldCount
+} AppigoTaskForestStringField;
+
+
+/**
+ The date fields of a task.
+ */
+typedef enum
+{
+	AppigoTaskForestFieldDueDate = 0,
+	AppigoTaskForestFieldStartDate,
+	AppigoTaskForestFieldCompletionDate,
+	AppigoTaskForestDateFieldCount
+} AppigoTaskForestDateField;
+
+
+#pragma mark -
+@interface AppigoTaskForest : NSObject
+{
+@private
+	NSUInteger				_count;
+	NSUInteger				_capacity;
+
+	// Structure
+	AppigoTaskForestIndex	*_parents;
+	AppigoTaskForestIndex	*_firstSubtasks;
+	AppigoTaskForestIndex	*_lastSubtasks;
+	AppigoTaskForestIndex	*_nextSiblings;
+	uint32_t				*_subtaskCounts;
+	AppigoTaskForestIndex	_firstRoot;
+	AppigoTaskForestIndex	_lastRoot;
+	NSUInteger				_rootCount;
+
+	// Fields
+	uint8_t					*_types;
+	uint8_t					*_priorities;
+	uint8_t					*_flags;				// kAppigoBinaryTaskFlag... values
+	int32_t					*_repeats;
+	int64_t					*_dates[AppigoTaskForestDateFieldCount];	// milliseconds since the reference date
+	uint32_t				*_strings[AppigoTaskForestStringFieldCount];	// arena offset + 1, 0 means nil
+	uint32_t				*_typeKeys;				// string list offset + 1, 0 means nil
+	uint32_t				*_typeValues;
+	uint32_t				*_imageReferences;		// image index + 1, 0 means no image
+
+	// String storage
+	uint8_t					*_arena;				// uint32 length, UTF-8 bytes
+	NSUInteger				_arenaLength;
+	NSUInteger				_arenaCapacity;
+	uint32_t				*_stringLists;			// count, arena references
+	NSUInteger				_stringListsLength;
+	NSUInteger				_stringListsCapacity;
+
+	NSMutableArray			*_images;
+	CFMutableDictionaryRef	_imageIndexes;			// UIImage * (retained by _images) -> index + 1
+}
+
+/** The number of tasks in the forest. */
+@property (nonatomic, readonly) NSUInteger count;
+
+/** The number of tasks without a parent. */
+@property (nonatomic, readonly) NSUInteger rootCount;
+
+/** The first task without a parent, follow nextSiblingOfTask: for the others. */
+@property (nonatomic, readonly) AppigoTaskForestIndex firstRoot;
+
+/** The number of bytes allocated for tasks and strings, not counting images. */
+@property (nonatomic, readonly) NSUInteger byteSize;
+
+
+#pragma mark -
+#pragma mark Building
+
+/**
+ Initialize an empty forest.
+
+ @param capacity The number of tasks to allocate room for up front.
+ */
+- (id)initWithCapacity:(NSUInteger)capacity;
+
+/**
+ Initialize a forest with copies of tasks and all of their subtasks.
+
+ @param tasks An array of AppigoTask objects, each becomes a root.
+ */
+- (id)initWithTasks:(NSArray *)tasks;
+
+/**
+ Add a task.
+
+ @param name The task name, nil or empty names become "Unknown".
+ @param parent The parent task, or kAppigoTaskForestNoTask to add a root.
+ @return Returns the index of the new task, or kAppigoTaskForestNoTask if
+ parent is not valid or memory could not be allocated.
+ */
+- (AppigoTaskForestIndex)addTaskWithName:(NSString *)name parent:(AppigoTaskForestIndex)parent;
+
+/**
+ Add a task named with UTF-8 bytes, without creating a string object.
+
+ @see addTaskWithName:parent:
+ */
+- (AppigoTaskForestIndex)addTaskWithUTF8Name:(const char *)name length:(NSUInteger)length parent:(AppigoTaskForestIndex)parent;
+
+/**
+ Add a copy of a task and all of its subtasks.
+
+ @param task The task to copy.
+ @param parent The parent of the copy, or kAppigoTaskForestNoTask to add a root.
+ @return Returns the index of the copy, or kAppigoTaskForestNoTask on failure.
+ */
+- (AppigoTaskForestIndex)addTask:(AppigoTask *)task parent:(AppigoTaskForestIndex)parent;
+
+/**
+ Add the task of a binary task payload and all of its subtasks, decoding them
+ straight into the forest. Nothing is added if the payload is not valid.
+
+ @param data A payload created by binaryRepresentation or binaryRepresentationOfTask:.
+ @param parent The parent of the decoded task, or kAppigoTaskForestNoTask to add a root.
+ @return Returns the index of the decoded task, or kAppigoTaskForestNoTask on failure.
+ */
+- (AppigoTaskForestIndex)addTaskFromBinaryData:(NSData *)data parent:(AppigoTaskForestIndex)parent;
+
+
+#pragma mark -
+#pragma mark Structure
+
+/** Returns the parent of a task, or kAppigoTaskForestNoTask for a root. */
+- (AppigoTaskForestIndex)parentOfTask:(AppigoTaskForestIndex)task;
+
+/** Returns the first subtask of a task, or kAppigoTaskForestNoTask. */
+- (AppigoTaskForestIndex)firstSubtaskOfTask:(AppigoTaskForestIndex)task;
+
+/** Returns the next subtask of the same parent (or the next root), or kAppigoTaskForestNoTask. */
+- (AppigoTaskForestIndex)nextSiblingOfTask:(AppigoTaskForestIndex)task;
+
+/** Returns the number of direct subtasks of a task. */
+- (NSUInteger)subtaskCountOfTask:(AppigoTaskForestIndex)task;
+
+
+#pragma mark -
+#pragma mark Fields
+
+- (AppigoTaskType)typeOfTask:(AppigoTaskForestIndex)task;
+- (void)setType:(AppigoTaskType)type ofTask:(AppigoTaskForestIndex)task;
+
+/**
+ Set the type and the type data of a task without the checks done by
+ AppigoTask's setType:withPropertyKeys:withPropertyValues:.
+ */
+- (void)setType:(AppigoTaskType)type keys:(NSArray *)keys values:(NSArray *)values ofTask:(AppigoTaskForestIndex)task;
+
+- (NSArray *)typeKeysOfTask:(AppigoTaskForestIndex)task;
+- (NSArray *)typeValuesOfTask:(AppigoTaskForestIndex)task;
+
+- (AppigoTaskPriority)priorityOfTask:(AppigoTaskForestIndex)task;
+- (void)setPriority:(AppigoTaskPriority)priority ofTask:(AppigoTaskForestIndex)task;
+
+- (NSInteger)repeatOfTask:(AppigoTaskForestIndex)task;
+- (void)setRepeat:(NSInteger)repeat ofTask:(AppigoTaskForestIndex)task;
+
+- (BOOL)dueDateHasTimeOfTask:(AppigoTaskForestIndex)task;
+- (void)setDueDateHasTime:(BOOL)hasTime ofTask:(AppigoTaskForestIndex)task;
+
+/** Returns the date, or nil if it is not set. */
+- (NSDate *)dateForField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task;
+
+/** Set a date, nil clears it. */
+- (void)setDate:(NSDate *)date forField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task;
+
+/** Set a date without creating an NSDate. */
+- (void)setTimeIntervalSinceReferenceDate:(NSTimeInterval)interval forField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task;
+
+/** Returns a new string object for a field, or nil if it is not set. */
+- (NSString *)stringForField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task;
+
+/**
+ Get the UTF-8 bytes of a string field without creating a string object.
+
+ @param length Receives the number of bytes.
+ @return Returns a pointer into the arena that stays valid until the forest
+ is changed, or NULL if the field is not set.
+ */
+- (const char *)UTF8StringForField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task length:(NSUInteger *)length;
+
+/** Set a string field, nil clears it. */
+- (void)setString:(NSString *)string forField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task;
+
+/** Set a string field from UTF-8 bytes, NULL clears it. */
+- (void)setUTF8String:(const char *)string length:(NSUInteger)length forField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task;
+
+- (UIImage *)actionImageOfTask:(AppigoTaskForestIndex)task;
+- (void)setActionImage:(UIImage *)image ofTask:(AppigoTaskForestIndex)task;
+
+
+#pragma mark -
+#pragma mark Converting
+
+/**
+ Create an AppigoTask with all of its subtasks from a task in the forest.
+
+ @return Returns an autoreleased task, or nil if the index is not valid.
+ */
+- (AppigoTask *)taskAtIndex:(AppigoTaskForestIndex)task;
+
+/**
+ Create AppigoTask objects for every root in the forest.
+
+ @return Returns an array of AppigoTask objects.
+ */
+- (NSArray *)rootTasks;
+
+/**
+ Encode a task and all of its subtasks as a binary task payload, the same
+ payload AppigoTask's binaryRepresentation creates.
+
+ @return Returns the encoded payload, or nil if the index is not valid.
+ */
+- (NSData *)binaryRepresentationOfTask:(AppigoTaskForestIndex)task;
+
+@end
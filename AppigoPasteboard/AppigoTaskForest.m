@@ -0,0 +1,1473 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskForest.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTaskForest.h"
+#import "AppigoBinaryCoding.h"
+#import "AppigoImageCoding.h"
+#import "AppigoStringTrimming.h"
+
+#include <math.h>
+
+
+#define kAppigoTaskForestMinimumCapacity	16
+#define kAppigoTaskForestAutoreleaseBatch	256
+
+// The bytes taken by one task across all columns
+#define kAppigoTaskForestBytesPerTask		(5 * sizeof(AppigoTaskForestIndex) + 3 * sizeof(uint8_t) + sizeof(int32_t) \
+											 + AppigoTaskForestDateFieldCount * sizeof(int64_t) \
+											 + (AppigoTaskForestStringFieldCount + 3) * sizeof(uint32_t))
+
+static const uint8_t kAppigoTaskForestDateFlags[AppigoTaskForestDateFieldCount] = {
+	kAppigoBinaryTaskFlagHasDueDate,
+	kAppigoBinaryTaskFlagHasStartDate,
+	kAppigoBinaryTaskFlagHasCompletionDate
+};
+
+
+// Everything needed to undo a failed addTask:parent: or addTaskFromBinaryData:parent:
+typedef struct
+{
+	NSUInteger				count;
+	NSUInteger				arenaLength;
+	NSUInteger				stringListsLength;
+	AppigoTaskForestIndex	parent;
+	AppigoTaskForestIndex	previousSibling;
+} AppigoTaskForestState;
+
+
+// The action images written to one payload, by forest image index
+typedef struct
+{
+	uint32_t		*references;	// table reference, 0 if not added yet, UINT32_MAX if it has no PNG data
+	NSMutableArray	*images;		// PNG data in table order
+} AppigoTaskForestImageTable;
+
+
+typedef struct
+{
+	NSArray					*subtasks;
+	NSUInteger				index;
+	AppigoTaskForestIndex	parent;
+} AppigoTaskForestCopyFrame;
+
+
+typedef struct
+{
+	AppigoTask				*task;
+	AppigoTaskForestIndex	next;
+} AppigoTaskForestMaterializeFrame;
+
+
+typedef struct
+{
+	AppigoTaskForestIndex	next;
+	NSUInteger				bodyOffset;
+} AppigoTaskForestWriteFrame;
+
+
+typedef struct
+{
+	AppigoTaskForestIndex	task;
+	uint64_t				remaining;
+	NSUInteger				bodyEnd;
+} AppigoTaskForestReadFrame;
+
+
+#pragma mark -
+@interface AppigoTaskForest (Private)
+
+- (BOOL)_reserveTasks:(NSUInteger)count;
+- (BOOL)_reserveArena:(NSUInteger)length;
+- (BOOL)_reserveStringLists:(NSUInteger)length;
+- (AppigoTaskForestIndex)_addTaskWithParent:(AppigoTaskForestIndex)parent;
+- (AppigoTaskForestState)_state;
+- (void)_restoreState:(AppigoTaskForestState)state;
+
+- (uint32_t)_storeUTF8String:(const char *)string length:(NSUInteger)length trim:(BOOL)trim;
+- (uint32_t)_storeString:(NSString *)string trim:(BOOL)trim;
+- (uint32_t)_storeStringList:(NSArray *)strings;
+- (NSString *)_stringAtReference:(uint32_t)reference;
+- (NSArray *)_stringListAtReference:(uint32_t)reference;
+- (uint32_t)_referenceForImage:(UIImage *)image;
+
+- (void)_copyFieldsOfTask:(AppigoTask *)task toTask:(AppigoTaskForestIndex)index;
+- (AppigoTask *)_newTaskAtIndex:(AppigoTaskForestIndex)index;
+- (NSUInteger)_appendRecordStartOfTask:(AppigoTaskForestIndex)task toData:(NSMutableData *)data imageTable:(AppigoTaskForestImageTable *)imageTable;
+- (AppigoTaskForestIndex)_addTaskFromBinaryReader:(AppigoBinaryReader *)reader parent:(AppigoTaskForestIndex)parent subtaskCount:(uint64_t *)subtaskCount bodyEnd:(NSUInteger *)bodyEnd;
+- (uint32_t)_storeStringListFromBinaryReader:(AppigoBinaryReader *)reader;
+
+@end
+
+
+#pragma mark -
+@interface AppigoTask (AppigoTaskForestPrivate)
+
+- (void)_setType:(AppigoTaskType)aType typeKeys:(NSArray *)keys typeValues:(NSArray *)values;
+
+@end
+
+
+#pragma mark -
+#pragma mark Helpers
+
+
+static BOOL AppigoTaskForestGrow(void **buffer, size_t elementSize, NSUInteger capacity)
+{
+	void *grown = realloc(*buffer, elementSize * capacity);
+	if (grown == NULL)
+		return NO;
+
+	*buffer = grown;
+	return YES;
+}
+
+
+static inline uint32_t AppigoTaskForestStringLength(const uint8_t *arena, uint32_t reference)
+{
+	uint32_t length;
+	memcpy(&length, arena + reference - 1, sizeof(length));
+	return length;
+}
+
+
+static inline const uint8_t *AppigoTaskForestStringBytes(const uint8_t *arena, uint32_t reference)
+{
+	return arena + reference - 1 + sizeof(uint32_t);
+}
+
+
+static void AppigoTaskForestWriteString(NSMutableData *data, const uint8_t *arena, uint32_t reference)
+{
+	if (reference == 0)
+	{
+		AppigoBinaryWriteVarint(data, 0);
+		return;
+	}
+
+	uint32_t length = AppigoTaskForestStringLength(arena, reference);
+	AppigoBinaryWriteVarint(data, (uint64_t)length + 1);
+	[data appendBytes:AppigoTaskForestStringBytes(arena, reference) length:length];
+}
+
+
+static void AppigoTaskForestWriteStringList(NSMutableData *data, const uint8_t *arena, const uint32_t *stringLists, uint32_t reference)
+{
+	if (reference == 0)
+	{
+		AppigoBinaryWriteVarint(data, 0);
+		return;
+	}
+
+	const uint32_t *list = stringLists + reference - 1;
+	AppigoBinaryWriteVarint(data, (uint64_t)list[0] + 1);
+	for (uint32_t i = 1; i <= list[0]; i++)
+		AppigoTaskForestWriteString(data, arena, list[i]);
+}
+
+
+// Points bytes at the next string of the payload without copying it
+static BOOL AppigoTaskForestReadUTF8(AppigoBinaryReader *reader, const uint8_t **bytes, NSUInteger *length)
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return NO;
+
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return NO;
+	}
+
+	*bytes = reader->bytes + reader->offset;
+	*length = (NSUInteger)(prefix - 1);
+	reader->offset += *length;
+
+	return YES;
+}
+
+
+#pragma mark -
+@implementation AppigoTaskForest
+
+
+@synthesize count = _count;
+@synthesize rootCount = _rootCount;
+@synthesize firstRoot = _firstRoot;
+
+
+- (id)init
+{
+	return [self initWithCapacity:0];
+}
+
+
+- (id)initWithCapacity:(NSUInteger)capacity
+{
+	if (self = [super init])
+	{
+		_firstRoot = kAppigoTaskForestNoTask;
+		_lastRoot = kAppigoTaskForestNoTask;
+
+		_images = [[NSMutableArray alloc] init];
+		_imageIndexes = CFDictionaryCreateMutable(kCFAllocatorDefault, 0, NULL, NULL);
+
+		if ( (capacity > 0) && ([self _reserveTasks:capacity] == NO) )
+		{
+			[self release];
+			return nil;
+		}
+	}
+
+	return self;
+}
+
+
+- (id)initWithTasks:(NSArray *)tasks
+{
+	if (self = [self initWithCapacity:[tasks count]])
+	{
+		for (AppigoTask *task in tasks)
+			[self addTask:task parent:kAppigoTaskForestNoTask];
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	free(_parents);
+	free(_firstSubtasks);
+	free(_lastSubtasks);
+	free(_nextSiblings);
+	free(_subtaskCounts);
+
+	free(_types);
+	free(_priorities);
+	free(_flags);
+	free(_repeats);
+	for (NSUInteger i = 0; i < AppigoTaskForestDateFieldCount; i++)
+		free(_dates[i]);
+	for (NSUInteger i = 0; i < AppigoTaskForestStringFieldCount; i++)
+		free(_strings[i]);
+	free(_typeKeys);
+	free(_typeValues);
+	free(_imageReferences);
+
+	free(_arena);
+	free(_stringLists);
+
+	[_images release];
+	CFRelease(_imageIndexes);
+
+	[super dealloc];
+}
+
+
+- (NSUInteger)byteSize
+{
+	return _capacity * kAppigoTaskForestBytesPerTask + _arenaCapacity + _stringListsCapacity * sizeof(uint32_t);
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %lu tasks, %lu roots, %lu bytes, %lu images>",
+			NSStringFromClass([self class]),
+			(unsigned long)_count,
+			(unsigned long)_rootCount,
+			(unsigned long)[self byteSize],
+			(unsigned long)[_images count]];
+}
+
+
+#pragma mark -
+#pragma mark Building
+
+
+- (AppigoTaskForestIndex)addTaskWithName:(NSString *)name parent:(AppigoTaskForestIndex)parent
+{
+	AppigoTaskForestIndex task = [self _addTaskWithParent:parent];
+	if (task != kAppigoTaskForestNoTask)
+		[self setString:name forField:AppigoTaskForestFieldName ofTask:task];
+
+	return task;
+}
+
+
+- (AppigoTaskForestIndex)addTaskWithUTF8Name:(const char *)name length:(NSUInteger)length parent:(AppigoTaskForestIndex)parent
+{
+	AppigoTaskForestIndex task = [self _addTaskWithParent:parent];
+	if (task != kAppigoTaskForestNoTask)
+		[self setUTF8String:name length:length forField:AppigoTaskForestFieldName ofTask:task];
+
+	return task;
+}
+
+
+- (AppigoTaskForestIndex)addTask:(AppigoTask *)task parent:(AppigoTaskForestIndex)parent
+{
+	if (task == nil)
+		return kAppigoTaskForestNoTask;
+
+	AppigoTaskForestState state = [self _state];
+	state.parent = parent;
+	state.previousSibling = (parent == kAppigoTaskForestNoTask) ? _lastRoot : ((parent < _count) ? _lastSubtasks[parent] : kAppigoTaskForestNoTask);
+
+	AppigoTaskForestIndex root = [self addTaskWithName:task.name parent:parent];
+	if (root == kAppigoTaskForestNoTask)
+		return kAppigoTaskForestNoTask;
+
+	[self _copyFieldsOfTask:task toTask:root];
+
+	NSArray *subtasks = task.subtasks;
+	if ([subtasks count] == 0)
+		return root;
+
+	// Copy the subtasks depth first with an explicit stack. Subtasks are read
+	// through their accessors so that lazily decoded tasks are filled in.
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoTaskForestCopyFrame *stack = malloc(sizeof(AppigoTaskForestCopyFrame) * capacity);
+	if (stack == NULL)
+	{
+		[self _restoreState:state];
+		return kAppigoTaskForestNoTask;
+	}
+
+	stack[0].subtasks = subtasks;
+	stack[0].index = 0;
+	stack[0].parent = root;
+
+	BOOL failed = NO;
+	NSUInteger copied = 0;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	while ( (depth > 0) && (failed == NO) )
+	{
+		AppigoTaskForestCopyFrame *frame = &stack[depth - 1];
+		if (frame->index >= [frame->subtasks count])
+		{
+			depth--;
+			continue;
+		}
+
+		AppigoTask *subtask = [frame->subtasks objectAtIndex:frame->index++];
+
+		AppigoTaskForestIndex index = [self addTaskWithName:subtask.name parent:frame->parent];
+		if (index == kAppigoTaskForestNoTask)
+		{
+			failed = YES;
+			break;
+		}
+
+		[self _copyFieldsOfTask:subtask toTask:index];
+
+		// The subtask arrays on the stack are retained by their tasks, which
+		// are kept alive by the root for the whole walk
+		if ((++copied % kAppigoTaskForestAutoreleaseBatch) == 0)
+		{
+			[pool drain];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+
+		NSArray *children = subtask.subtasks;
+		if ([children count] == 0)
+			continue;
+
+		if ( (depth == capacity) && (AppigoTaskForestGrow((void **)&stack, sizeof(AppigoTaskForestCopyFrame), capacity * 2) == YES) )
+			capacity *= 2;
+
+		if (depth == capacity)
+		{
+			failed = YES;
+			break;
+		}
+
+		stack[depth].subtasks = children;
+		stack[depth].index = 0;
+		stack[depth].parent = index;
+		depth++;
+	}
+
+	[pool drain];
+	free(stack);
+
+	if (failed == YES)
+	{
+		[self _restoreState:state];
+		return kAppigoTaskForestNoTask;
+	}
+
+	return root;
+}
+
+
+- (AppigoTaskForestIndex)addTaskFromBinaryData:(NSData *)data parent:(AppigoTaskForestIndex)parent
+{
+	if ( (parent != kAppigoTaskForestNoTask) && (parent >= _count) )
+		return kAppigoTaskForestNoTask;
+
+	AppigoBinaryReader reader;
+	AppigoBinaryReaderInit(&reader, data);
+
+	if (AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindTask) == NO)
+		return kAppigoTaskForestNoTask;
+
+	AppigoTaskForestState state = [self _state];
+	state.parent = parent;
+	state.previousSibling = (parent == kAppigoTaskForestNoTask) ? _lastRoot : _lastSubtasks[parent];
+
+	uint64_t subtaskCount = 0;
+	NSUInteger bodyEnd = 0;
+	AppigoTaskForestIndex root = [self _addTaskFromBinaryReader:&reader parent:parent subtaskCount:&subtaskCount bodyEnd:&bodyEnd];
+
+	// Read the records depth first with an explicit stack, every frame
+	// counts down the subtasks of a task that are still to be read
+	NSUInteger capacity = 16;
+	NSUInteger depth = 0;
+	AppigoTaskForestReadFrame *stack = NULL;
+
+	if ( (reader.failed == NO) && (subtaskCount > 0) )
+	{
+		stack = malloc(sizeof(AppigoTaskForestReadFrame) * capacity);
+		if (stack == NULL)
+			reader.failed = YES;
+		else
+		{
+			stack[0].task = root;
+			stack[0].remaining = subtaskCount;
+			stack[0].bodyEnd = bodyEnd;
+			depth = 1;
+		}
+	}
+	else
+		AppigoBinaryReaderSeek(&reader, bodyEnd);
+
+	while ( (depth > 0) && (reader.failed == NO) )
+	{
+		AppigoTaskForestReadFrame *frame = &stack[depth - 1];
+		if (frame->remaining == 0)
+		{
+			AppigoBinaryReaderSeek(&reader, frame->bodyEnd);
+			depth--;
+			continue;
+		}
+
+		frame->remaining--;
+
+		AppigoTaskForestIndex task = [self _addTaskFromBinaryReader:&reader parent:frame->task subtaskCount:&subtaskCount bodyEnd:&bodyEnd];
+		if (reader.failed == YES)
+			break;
+
+		if (subtaskCount == 0)
+		{
+			AppigoBinaryReaderSeek(&reader, bodyEnd);
+			continue;
+		}
+
+		if ( (depth == capacity) && (AppigoTaskForestGrow((void **)&stack, sizeof(AppigoTaskForestReadFrame), capacity * 2) == YES) )
+			capacity *= 2;
+
+		if (depth == capacity)
+		{
+			reader.failed = YES;
+			break;
+		}
+
+		stack[depth].task = task;
+		stack[depth].remaining = subtaskCount;
+		stack[depth].bodyEnd = bodyEnd;
+		depth++;
+	}
+
+	free(stack);
+
+	if (reader.failed == YES)
+	{
+		[self _restoreState:state];
+		return kAppigoTaskForestNoTask;
+	}
+
+	return root;
+}
+
+
+#pragma mark -
+#pragma mark Structure
+
+
+- (AppigoTaskForestIndex)parentOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? _parents[task] : kAppigoTaskForestNoTask;
+}
+
+
+- (AppigoTaskForestIndex)firstSubtaskOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? _firstSubtasks[task] : kAppigoTaskForestNoTask;
+}
+
+
+- (AppigoTaskForestIndex)nextSiblingOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? _nextSiblings[task] : kAppigoTaskForestNoTask;
+}
+
+
+- (NSUInteger)subtaskCountOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? _subtaskCounts[task] : 0;
+}
+
+
+#pragma mark -
+#pragma mark Fields
+
+
+- (AppigoTaskType)typeOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? (AppigoTaskType)_types[task] : AppigoTaskTypeNormal;
+}
+
+
+- (void)setType:(AppigoTaskType)type ofTask:(AppigoTaskForestIndex)task
+{
+	if (task < _count)
+		_types[task] = (uint8_t)type;
+}
+
+
+- (void)setType:(AppigoTaskType)type keys:(NSArray *)keys values:(NSArray *)values ofTask:(AppigoTaskForestIndex)task
+{
+	if (task >= _count)
+		return;
+
+	_types[task] = (uint8_t)type;
+	_typeKeys[task] = [self _storeStringList:keys];
+	_typeValues[task] = [self _storeStringList:values];
+}
+
+
+- (NSArray *)typeKeysOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? [self _stringListAtReference:_typeKeys[task]] : nil;
+}
+
+
+- (NSArray *)typeValuesOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? [self _stringListAtReference:_typeValues[task]] : nil;
+}
+
+
+- (AppigoTaskPriority)priorityOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? (AppigoTaskPriority)_priorities[task] : AppigoTaskPriorityNone;
+}
+
+
+- (void)setPriority:(AppigoTaskPriority)priority ofTask:(AppigoTaskForestIndex)task
+{
+	if (task < _count)
+		_priorities[task] = (uint8_t)priority;
+}
+
+
+- (NSInteger)repeatOfTask:(AppigoTaskForestIndex)task
+{
+	return (task < _count) ? _repeats[task] : 0;
+}
+
+
+- (void)setRepeat:(NSInteger)repeat ofTask:(AppigoTaskForestIndex)task
+{
+	if (task < _count)
+		_repeats[task] = (int32_t)repeat;
+}
+
+
+- (BOOL)dueDateHasTimeOfTask:(AppigoTaskForestIndex)task
+{
+	return ( (task < _count) && ((_flags[task] & kAppigoBinaryTaskFlagDueDateHasTime) != 0) );
+}
+
+
+- (void)setDueDateHasTime:(BOOL)hasTime ofTask:(AppigoTaskForestIndex)task
+{
+	if (task >= _count)
+		return;
+
+	if (hasTime == YES)
+		_flags[task] |= kAppigoBinaryTaskFlagDueDateHasTime;
+	else
+		_flags[task] &= ~kAppigoBinaryTaskFlagDueDateHasTime;
+}
+
+
+- (NSDate *)dateForField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestDateFieldCount) || ((_flags[task] & kAppigoTaskForestDateFlags[field]) == 0) )
+		return nil;
+
+	return [NSDate dateWithTimeIntervalSinceReferenceDate:(NSTimeInterval)_dates[field][task] / 1000.0];
+}
+
+
+- (void)setDate:(NSDate *)date forField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestDateFieldCount) )
+		return;
+
+	if (date == nil)
+	{
+		_flags[task] &= ~kAppigoTaskForestDateFlags[field];
+		_dates[field][task] = 0;
+		return;
+	}
+
+	[self setTimeIntervalSinceReferenceDate:[date timeIntervalSinceReferenceDate] forField:field ofTask:task];
+}
+
+
+- (void)setTimeIntervalSinceReferenceDate:(NSTimeInterval)interval forField:(AppigoTaskForestDateField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestDateFieldCount) )
+		return;
+
+	// Dates are kept at the precision of the binary encoding
+	_dates[field][task] = (int64_t)llround(interval * 1000.0);
+	_flags[task] |= kAppigoTaskForestDateFlags[field];
+}
+
+
+- (NSString *)stringForField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestStringFieldCount) )
+		return nil;
+
+	return [self _stringAtReference:_strings[field][task]];
+}
+
+
+- (const char *)UTF8StringForField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task length:(NSUInteger *)length
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestStringFieldCount) || (_strings[field][task] == 0) )
+	{
+		if (length != NULL)
+			*length = 0;
+		return NULL;
+	}
+
+	uint32_t reference = _strings[field][task];
+	if (length != NULL)
+		*length = AppigoTaskForestStringLength(_arena, reference);
+
+	return (const char *)AppigoTaskForestStringBytes(_arena, reference);
+}
+
+
+- (void)setString:(NSString *)string forField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestStringFieldCount) )
+		return;
+
+	uint32_t reference = [self _storeString:string trim:YES];
+
+	// Names follow the rules of AppigoTask's initWithName:
+	if ( (field == AppigoTaskForestFieldName) && ( (reference == 0) || (AppigoTaskForestStringLength(_arena, reference) == 0) ) )
+		reference = [self _storeUTF8String:"Unknown" length:7 trim:NO];
+
+	_strings[field][task] = reference;
+}
+
+
+- (void)setUTF8String:(const char *)string length:(NSUInteger)length forField:(AppigoTaskForestStringField)field ofTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (field >= AppigoTaskForestStringFieldCount) )
+		return;
+
+	uint32_t reference = (string != NULL) ? [self _storeUTF8String:string length:length trim:YES] : 0;
+
+	if ( (field == AppigoTaskForestFieldName) && ( (reference == 0) || (AppigoTaskForestStringLength(_arena, reference) == 0) ) )
+		reference = [self _storeUTF8String:"Unknown" length:7 trim:NO];
+
+	_strings[field][task] = reference;
+}
+
+
+- (UIImage *)actionImageOfTask:(AppigoTaskForestIndex)task
+{
+	if ( (task >= _count) || (_imageReferences[task] == 0) )
+		return nil;
+
+	return [_images objectAtIndex:_imageReferences[task] - 1];
+}
+
+
+- (void)setActionImage:(UIImage *)image ofTask:(AppigoTaskForestIndex)task
+{
+	if (task < _count)
+		_imageReferences[task] = [self _referenceForImage:image];
+}
+
+
+#pragma mark -
+#pragma mark Converting
+
+
+- (AppigoTask *)taskAtIndex:(AppigoTaskForestIndex)root
+{
+	if (root >= _count)
+		return nil;
+
+	AppigoTask *rootTask = [self _newTaskAtIndex:root];
+	if (_subtaskCounts[root] == 0)
+		return [rootTask autorelease];
+
+	NSUInteger capacity = 16;
+	NSUInteger depth = 1;
+	AppigoTaskForestMaterializeFrame *stack = malloc(sizeof(AppigoTaskForestMaterializeFrame) * capacity);
+	if (stack == NULL)
+	{
+		[rootTask release];
+		return nil;
+	}
+
+	stack[0].task = rootTask;
+	stack[0].next = _firstSubtasks[root];
+
+	BOOL failed = NO;
+	NSUInteger created = 0;
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	while (depth > 0)
+	{
+		AppigoTaskForestMaterializeFrame *frame = &stack[depth - 1];
+		if (frame->next == kAppigoTaskForestNoTask)
+		{
+			depth--;
+			continue;
+		}
+
+		AppigoTaskForestIndex index = frame->next;
+		frame->next = _nextSiblings[index];
+
+		// The parent's subtask array keeps the new task alive
+		AppigoTask *subtask = [self _newTaskAtIndex:index];
+		[frame->task addSubtask:subtask];
+		[subtask release];
+
+		if ((++created % kAppigoTaskForestAutoreleaseBatch) == 0)
+		{
+			[pool drain];
+			pool = [[NSAutoreleasePool alloc] init];
+		}
+
+		if (_subtaskCounts[index] == 0)
+			continue;
+
+		if ( (depth == capacity) && (AppigoTaskForestGrow((void **)&stack, sizeof(AppigoTaskForestMaterializeFrame), capacity * 2) == YES) )
+			capacity *= 2;
+
+		if (depth == capacity)
+		{
+			failed = YES;
+			break;
+		}
+
+		stack[depth].task = subtask;
+		stack[depth].next = _firstSubtasks[index];
+		depth++;
+	}
+
+	[pool drain];
+	free(stack);
+
+	if (failed == YES)
+	{
+		[rootTask release];
+		return nil;
+	}
+
+	return [rootTask autorelease];
+}
+
+
+- (NSArray *)rootTasks
+{
+	NSMutableArray *tasks = [NSMutableArray arrayWithCapacity:_rootCount];
+
+	for (AppigoTaskForestIndex root = _firstRoot; root != kAppigoTaskForestNoTask; root = _nextSiblings[root])
+	{
+		AppigoTask *task = [self taskAtIndex:root];
+		if (task != nil)
+			[tasks addObject:task];
+	}
+
+	return tasks;
+}
+
+
+- (NSData *)binaryRepresentationOfTask:(AppigoTaskForestIndex)root
+{
+	if (root >= _count)
+		return nil;
+
+	AppigoTaskForestImageTable imageTable;
+	imageTable.references = calloc([_images count] + 1, sizeof(uint32_t));
+	imageTable.images = [[NSMutableArray alloc] init];
+
+	NSUInteger capacity = 16;
+	NSUInteger depth = 0;
+	AppigoTaskForestWriteFrame *stack = malloc(sizeof(AppigoTaskForestWriteFrame) * capacity);
+
+	if ( (imageTable.references == NULL) || (stack == NULL) )
+	{
+		free(imageTable.references);
+		free(stack);
+		[imageTable.images release];
+		return nil;
+	}
+
+	// As with AppigoTask, the image table comes first but is only complete
+	// once every task was written, so the record is written on its own.
+	// Every frame is a task whose body stays open until its last subtask
+	// was written.
+	NSMutableData *record = [[NSMutableData alloc] initWithCapacity:256];
+
+	stack[0].bodyOffset = [self _appendRecordStartOfTask:root toData:record imageTable:&imageTable];
+	stack[0].next = _firstSubtasks[root];
+	depth = 1;
+
+	BOOL failed = NO;
+
+	while (depth > 0)
+	{
+		AppigoTaskForestWriteFrame *frame = &stack[depth - 1];
+		if (frame->next == kAppigoTaskForestNoTask)
+		{
+			AppigoBinaryPatchUInt32(record, frame->bodyOffset, (uint32_t)([record length] - frame->bodyOffset - 4));
+			depth--;
+			continue;
+		}
+
+		AppigoTaskForestIndex task = frame->next;
+		frame->next = _nextSiblings[task];
+
+		NSUInteger bodyOffset = [self _appendRecordStartOfTask:task toData:record imageTable:&imageTable];
+
+		if (_subtaskCounts[task] == 0)
+		{
+			AppigoBinaryPatchUInt32(record, bodyOffset, (uint32_t)([record length] - bodyOffset - 4));
+			continue;
+		}
+
+		if ( (depth == capacity) && (AppigoTaskForestGrow((void **)&stack, sizeof(AppigoTaskForestWriteFrame), capacity * 2) == YES) )
+			capacity *= 2;
+
+		if (depth == capacity)
+		{
+			failed = YES;
+			break;
+		}
+
+		stack[depth].next = _firstSubtasks[task];
+		stack[depth].bodyOffset = bodyOffset;
+		depth++;
+	}
+
+	free(stack);
+	free(imageTable.references);
+
+	NSMutableData *data = nil;
+	if (failed == NO)
+	{
+		data = [NSMutableData dataWithCapacity:[record length] + 16];
+		AppigoBinaryWritePreamble(data, kAppigoBinaryCodingKindTask);
+
+		AppigoBinaryWriteVarint(data, [imageTable.images count]);
+		for (NSData *pngData in imageTable.images)
+			AppigoBinaryWriteData(data, pngData);
+
+		[data appendData:record];
+	}
+
+	[record release];
+	[imageTable.images release];
+
+	return data;
+}
+
+
+@end
+
+
+#pragma mark -
+
+
+@implementation AppigoTaskForest (Private)
+
+
+- (BOOL)_reserveTasks:(NSUInteger)count
+{
+	if (count <= _capacity)
+		return YES;
+
+	NSUInteger capacity = MAX(MAX(_capacity * 2, count), (NSUInteger)kAppigoTaskForestMinimumCapacity);
+
+	// Columns that were grown before a failure are simply larger than needed
+	if ( (AppigoTaskForestGrow((void **)&_parents, sizeof(AppigoTaskForestIndex), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_firstSubtasks, sizeof(AppigoTaskForestIndex), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_lastSubtasks, sizeof(AppigoTaskForestIndex), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_nextSiblings, sizeof(AppigoTaskForestIndex), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_subtaskCounts, sizeof(uint32_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_types, sizeof(uint8_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_priorities, sizeof(uint8_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_flags, sizeof(uint8_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_repeats, sizeof(int32_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_typeKeys, sizeof(uint32_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_typeValues, sizeof(uint32_t), capacity) == NO)
+		|| (AppigoTaskForestGrow((void **)&_imageReferences, sizeof(uint32_t), capacity) == NO) )
+	{
+		return NO;
+	}
+
+	for (NSUInteger i = 0; i < AppigoTaskForestDateFieldCount; i++)
+	{
+		if (AppigoTaskForestGrow((void **)&_dates[i], sizeof(int64_t), capacity) == NO)
+			return NO;
+	}
+
+	for (NSUInteger i = 0; i < AppigoTaskForestStringFieldCount; i++)
+	{
+		if (AppigoTaskForestGrow((void **)&_strings[i], sizeof(uint32_t), capacity) == NO)
+			return NO;
+	}
+
+	_capacity = capacity;
+	return YES;
+}
+
+
+- (AppigoTaskForestIndex)_addTaskWithParent:(AppigoTaskForestIndex)parent
+{
+	if ( (parent != kAppigoTaskForestNoTask) && (parent >= _count) )
+		return kAppigoTaskForestNoTask;
+
+	if ( (_count >= kAppigoTaskForestNoTask - 1) || ([self _reserveTasks:_count + 1] == NO) )
+		return kAppigoTaskForestNoTask;
+
+	AppigoTaskForestIndex task = (AppigoTaskForestIndex)_count++;
+
+	_parents[task] = parent;
+	_firstSubtasks[task] = kAppigoTaskForestNoTask;
+	_lastSubtasks[task] = kAppigoTaskForestNoTask;
+	_nextSiblings[task] = kAppigoTaskForestNoTask;
+	_subtaskCounts[task] = 0;
+
+	_types[task] = AppigoTaskTypeNormal;
+	_priorities[task] = AppigoTaskPriorityNone;
+	_flags[task] = 0;
+	_repeats[task] = 0;
+	for (NSUInteger i = 0; i < AppigoTaskForestDateFieldCount; i++)
+		_dates[i][task] = 0;
+	for (NSUInteger i = 0; i < AppigoTaskForestStringFieldCount; i++)
+		_strings[i][task] = 0;
+	_typeKeys[task] = 0;
+	_typeValues[task] = 0;
+	_imageReferences[task] = 0;
+
+	if (parent == kAppigoTaskForestNoTask)
+	{
+		if (_lastRoot == kAppigoTaskForestNoTask)
+			_firstRoot = task;
+		else
+			_nextSiblings[_lastRoot] = task;
+
+		_lastRoot = task;
+		_rootCount++;
+	}
+	else
+	{
+		if (_lastSubtasks[parent] == kAppigoTaskForestNoTask)
+			_firstSubtasks[parent] = task;
+		else
+			_nextSiblings[_lastSubtasks[parent]] = task;
+
+		_lastSubtasks[parent] = task;
+		_subtaskCounts[parent]++;
+	}
+
+	return task;
+}
+
+
+- (BOOL)_reserveArena:(NSUInteger)length
+{
+	// References are 32-bit offsets into the arena
+	if (length >= UINT32_MAX)
+		return NO;
+
+	if (length <= _arenaCapacity)
+		return YES;
+
+	NSUInteger capacity = MAX(MAX(_arenaCapacity * 2, length), (NSUInteger)1024);
+	if (capacity >= UINT32_MAX)
+		capacity = length;
+
+	if (AppigoTaskForestGrow((void **)&_arena, 1, capacity) == NO)
+		return NO;
+
+	_arenaCapacity = capacity;
+	return YES;
+}
+
+
+- (BOOL)_reserveStringLists:(NSUInteger)length
+{
+	if (length >= UINT32_MAX)
+		return NO;
+
+	if (length <= _stringListsCapacity)
+		return YES;
+
+	NSUInteger capacity = MAX(MAX(_stringListsCapacity * 2, length), (NSUInteger)64);
+	if (AppigoTaskForestGrow((void **)&_stringLists, sizeof(uint32_t), capacity) == NO)
+		return NO;
+
+	_stringListsCapacity = capacity;
+	return YES;
+}
+
+
+- (AppigoTaskForestState)_state
+{
+	AppigoTaskForestState state;
+	state.count = _count;
+	state.arenaLength = _arenaLength;
+	state.stringListsLength = _stringListsLength;
+	state.parent = kAppigoTaskForestNoTask;
+	state.previousSibling = kAppigoTaskForestNoTask;
+
+	return state;
+}
+
+
+- (void)_restoreState:(AppigoTaskForestState)state
+{
+	// Only the first task added since the state was taken is linked to a
+	// task that stays, everything after it is dropped with the count
+	if (_count > state.count)
+	{
+		if (state.parent == kAppigoTaskForestNoTask)
+		{
+			if (state.previousSibling == kAppigoTaskForestNoTask)
+				_firstRoot = kAppigoTaskForestNoTask;
+			else
+				_nextSiblings[state.previousSibling] = kAppigoTaskForestNoTask;
+
+			_lastRoot = state.previousSibling;
+			_rootCount--;
+		}
+		else
+		{
+			if (state.previousSibling == kAppigoTaskForestNoTask)
+				_firstSubtasks[state.parent] = kAppigoTaskForestNoTask;
+			else
+				_nextSiblings[state.previousSibling] = kAppigoTaskForestNoTask;
+
+			_lastSubtasks[state.parent] = state.previousSibling;
+			_subtaskCounts[state.parent]--;
+		}
+	}
+
+	_count = state.count;
+	_arenaLength = state.arenaLength;
+	_stringListsLength = state.stringListsLength;
+}
+
+
+- (uint32_t)_storeUTF8String:(const char *)string length:(NSUInteger)length trim:(BOOL)trim
+{
+	if (string == NULL)
+		return 0;
+
+	if (trim == YES)
+	{
+		NSRange range = AppigoUTF8RangeByTrimmingWhitespace((const uint8_t *)string, length);
+		string += range.location;
+		length = range.length;
+	}
+
+	if ([self _reserveArena:_arenaLength + sizeof(uint32_t) + length] == NO)
+		return 0;
+
+	uint32_t stringLength = (uint32_t)length;
+	memcpy(_arena + _arenaLength, &stringLength, sizeof(stringLength));
+	memcpy(_arena + _arenaLength + sizeof(uint32_t), string, length);
+
+	uint32_t reference = (uint32_t)_arenaLength + 1;
+	_arenaLength += sizeof(uint32_t) + length;
+
+	return reference;
+}
+
+
+- (uint32_t)_storeString:(NSString *)string trim:(BOOL)trim
+{
+	if (string == nil)
+		return 0;
+
+	// Convert straight into the arena without an intermediate C string
+	NSUInteger byteLength = [string lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	if ([self _reserveArena:_arenaLength + sizeof(uint32_t) + byteLength] == NO)
+		return 0;
+
+	uint8_t *bytes = _arena + _arenaLength + sizeof(uint32_t);
+	[string getBytes:bytes
+		   maxLength:byteLength
+		  usedLength:NULL
+			encoding:NSUTF8StringEncoding
+			 options:0
+			   range:NSMakeRange(0, [string length])
+	  remainingRange:NULL];
+
+	NSRange range = NSMakeRange(0, byteLength);
+	if (trim == YES)
+	{
+		range = AppigoUTF8RangeByTrimmingWhitespace(bytes, byteLength);
+		if (range.location > 0)
+			memmove(bytes, bytes + range.location, range.length);
+	}
+
+	uint32_t stringLength = (uint32_t)range.length;
+	memcpy(_arena + _arenaLength, &stringLength, sizeof(stringLength));
+
+	uint32_t reference = (uint32_t)_arenaLength + 1;
+	_arenaLength += sizeof(uint32_t) + stringLength;
+
+	return reference;
+}
+
+
+- (uint32_t)_storeStringList:(NSArray *)strings
+{
+	if (strings == nil)
+		return 0;
+
+	NSUInteger count = [strings count];
+	if ([self _reserveStringLists:_stringListsLength + count + 1] == NO)
+		return 0;
+
+	NSUInteger offset = _stringListsLength;
+	_stringListsLength += count + 1;
+
+	_stringLists[offset] = (uint32_t)count;
+	for (NSUInteger i = 0; i < count; i++)
+		_stringLists[offset + 1 + i] = [self _storeString:[strings objectAtIndex:i] trim:NO];
+
+	return (uint32_t)offset + 1;
+}
+
+
+- (NSString *)_stringAtReference:(uint32_t)reference
+{
+	if (reference == 0)
+		return nil;
+
+	return [[[NSString alloc] initWithBytes:AppigoTaskForestStringBytes(_arena, reference)
+									 length:AppigoTaskForestStringLength(_arena, reference)
+								   encoding:NSUTF8StringEncoding] autorelease];
+}
+
+
+- (NSArray *)_stringListAtReference:(uint32_t)reference
+{
+	if (reference == 0)
+		return nil;
+
+	const uint32_t *list = _stringLists + reference - 1;
+
+	NSMutableArray *strings = [NSMutableArray arrayWithCapacity:list[0]];
+	for (uint32_t i = 1; i <= list[0]; i++)
+	{
+		NSString *string = [self _stringAtReference:list[i]];
+		[strings addObject:(string != nil) ? string : @""];
+	}
+
+	return strings;
+}
+
+
+- (uint32_t)_referenceForImage:(UIImage *)image
+{
+	if (image == nil)
+		return 0;
+
+	const void *reference = CFDictionaryGetValue(_imageIndexes, image);
+	if (reference != NULL)
+		return (uint32_t)(uintptr_t)reference;
+
+	[_images addObject:image];
+
+	uint32_t imageReference = (uint32_t)[_images count];
+	CFDictionarySetValue(_imageIndexes, image, (const void *)(uintptr_t)imageReference);
+
+	return imageReference;
+}
+
+
+- (void)_copyFieldsOfTask:(AppigoTask *)task toTask:(AppigoTaskForestIndex)index
+{
+	_types[index] = (uint8_t)task.type;
+	_typeKeys[index] = [self _storeStringList:task.typeKeys];
+	_typeValues[index] = [self _storeStringList:task.typeValues];
+	_priorities[index] = (uint8_t)task.priority;
+	_repeats[index] = (int32_t)task.repeat;
+
+	[self setDueDateHasTime:task.dueDateHasTime ofTask:index];
+	[self setDate:task.dueDate forField:AppigoTaskForestFieldDueDate ofTask:index];
+	[self setDate:task.startDate forField:AppigoTaskForestFieldStartDate ofTask:index];
+	[self setDate:task.completionDate forField:AppigoTaskForestFieldCompletionDate ofTask:index];
+
+	_strings[AppigoTaskForestFieldAdvancedRepeat][index] = [self _storeString:task.advancedRepeat trim:YES];
+	_strings[AppigoTaskForestFieldNote][index] = [self _storeString:task.note trim:YES];
+	_strings[AppigoTaskForestFieldList][index] = [self _storeString:task.list trim:YES];
+	_strings[AppigoTaskForestFieldContext][index] = [self _storeString:task.context trim:YES];
+	_strings[AppigoTaskForestFieldTags][index] = [self _storeString:task.tags trim:YES];
+
+	_imageReferences[index] = [self _referenceForImage:task.actionImage];
+}
+
+
+- (AppigoTask *)_newTaskAtIndex:(AppigoTaskForestIndex)index
+{
+	AppigoTask *task = [[AppigoTask alloc] initWithName:[self _stringAtReference:_strings[AppigoTaskForestFieldName][index]]];
+
+	[task _setType:(AppigoTaskType)_types[index]
+		  typeKeys:[self _stringListAtReference:_typeKeys[index]]
+		typeValues:[self _stringListAtReference:_typeValues[index]]];
+
+	task.priority = (AppigoTaskPriority)_priorities[index];
+	task.repeat = _repeats[index];
+	task.dueDateHasTime = [self dueDateHasTimeOfTask:index];
+	task.dueDate = [self dateForField:AppigoTaskForestFieldDueDate ofTask:index];
+	task.startDate = [self dateForField:AppigoTaskForestFieldStartDate ofTask:index];
+	task.completionDate = [self dateForField:AppigoTaskForestFieldCompletionDate ofTask:index];
+
+	task.advancedRepeat = [self _stringAtReference:_strings[AppigoTaskForestFieldAdvancedRepeat][index]];
+	task.note = [self _stringAtReference:_strings[AppigoTaskForestFieldNote][index]];
+	task.list = [self _stringAtReference:_strings[AppigoTaskForestFieldList][index]];
+	task.context = [self _stringAtReference:_strings[AppigoTaskForestFieldContext][index]];
+	task.tags = [self _stringAtReference:_strings[AppigoTaskForestFieldTags][index]];
+
+	task.actionImage = [self actionImageOfTask:index];
+
+	return task;
+}
+
+
+- (NSUInteger)_appendRecordStartOfTask:(AppigoTaskForestIndex)task toData:(NSMutableData *)data imageTable:(AppigoTaskForestImageTable *)imageTable
+{
+	// Header
+	NSUInteger headerOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldName][task]);
+	AppigoBinaryWriteUInt8(data, _types[task]);
+	AppigoBinaryWriteUInt8(data, _priorities[task]);
+
+	uint8_t flags = _flags[task];
+	AppigoBinaryWriteUInt8(data, flags);
+
+	for (NSUInteger i = 0; i < AppigoTaskForestDateFieldCount; i++)
+	{
+		if ((flags & kAppigoTaskForestDateFlags[i]) != 0)
+			AppigoBinaryWriteInt64(data, _dates[i][task]);
+	}
+
+	AppigoBinaryWriteSignedVarint(data, _repeats[task]);
+
+	AppigoBinaryPatchUInt32(data, headerOffset, (uint32_t)([data length] - headerOffset - 4));
+
+	// Body, closed by the caller once the subtasks were written
+	NSUInteger bodyOffset = [data length];
+	AppigoBinaryWriteUInt32(data, 0);
+
+	AppigoTaskForestWriteStringList(data, _arena, _stringLists, _typeKeys[task]);
+	AppigoTaskForestWriteStringList(data, _arena, _stringLists, _typeValues[task]);
+
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldAdvancedRepeat][task]);
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldNote][task]);
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldList][task]);
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldContext][task]);
+	AppigoTaskForestWriteString(data, _arena, _strings[AppigoTaskForestFieldTags][task]);
+
+	uint32_t imageReference = 0;
+	if (_imageReferences[task] != 0)
+	{
+		NSUInteger imageIndex = _imageReferences[task] - 1;
+		if (imageTable->references[imageIndex] == 0)
+		{
+			NSData *pngData = AppigoImagePNGRepresentation([_images objectAtIndex:imageIndex]);
+			if (pngData == nil)
+				imageTable->references[imageIndex] = UINT32_MAX;
+			else
+			{
+				[imageTable->images addObject:pngData];
+				imageTable->references[imageIndex] = (uint32_t)[imageTable->images count];
+			}
+		}
+
+		if (imageTable->references[imageIndex] != UINT32_MAX)
+			imageReference = imageTable->references[imageIndex];
+	}
+	AppigoBinaryWriteVarint(data, imageReference);
+
+	AppigoBinaryWriteVarint(data, _subtaskCounts[task]);
+
+	return bodyOffset;
+}
+
+
+- (AppigoTaskForestIndex)_addTaskFromBinaryReader:(AppigoBinaryReader *)reader parent:(AppigoTaskForestIndex)parent subtaskCount:(uint64_t *)subtaskCount bodyEnd:(NSUInteger *)bodyEnd
+{
+	*subtaskCount = 0;
+	*bodyEnd = reader->length;
+
+	// Header
+	NSUInteger headerEnd = AppigoBinaryReadSectionEnd(reader);
+
+	const uint8_t *bytes = NULL;
+	NSUInteger length = 0;
+	AppigoTaskForestReadUTF8(reader, &bytes, &length);
+
+	if (reader->failed == YES)
+		return kAppigoTaskForestNoTask;
+
+	AppigoTaskForestIndex task = [self addTaskWithUTF8Name:(const char *)bytes length:length parent:parent];
+	if (task == kAppigoTaskForestNoTask)
+	{
+		// Out of memory, stop reading
+		reader->failed = YES;
+		return kAppigoTaskForestNoTask;
+	}
+
+	_types[task] = AppigoBinaryReadUInt8(reader);
+
+	uint8_t pri = AppigoBinaryReadUInt8(reader);
+	if ( (pri >= AppigoTaskPriorityHigh) && (pri <= AppigoTaskPriorityNone) )
+		_priorities[task] = pri;
+
+	uint8_t flags = AppigoBinaryReadUInt8(reader) & (kAppigoBinaryTaskFlagDueDateHasTime | kAppigoBinaryTaskFlagHasDueDate
+													 | kAppigoBinaryTaskFlagHasStartDate | kAppigoBinaryTaskFlagHasCompletionDate);
+	_flags[task] = flags;
+
+	for (NSUInteger i = 0; i < AppigoTaskForestDateFieldCount; i++)
+	{
+		if ((flags & kAppigoTaskForestDateFlags[i]) != 0)
+			_dates[i][task] = AppigoBinaryReadInt64(reader);
+	}
+
+	_repeats[task] = (int32_t)AppigoBinaryReadSignedVarint(reader);
+
+	AppigoBinaryReaderSeek(reader, headerEnd);
+
+	// Body
+	*bodyEnd = AppigoBinaryReadSectionEnd(reader);
+
+	_typeKeys[task] = [self _storeStringListFromBinaryReader:reader];
+	_typeValues[task] = [self _storeStringListFromBinaryReader:reader];
+
+	static const AppigoTaskForestStringField bodyFields[] = {
+		AppigoTaskForestFieldAdvancedRepeat,
+		AppigoTaskForestFieldNote,
+		AppigoTaskForestFieldList,
+		AppigoTaskForestFieldContext,
+		AppigoTaskForestFieldTags
+	};
+
+	for (NSUInteger i = 0; i < sizeof(bodyFields) / sizeof(bodyFields[0]); i++)
+	{
+		if (AppigoTaskForestReadUTF8(reader, &bytes, &length) == YES)
+			_strings[bodyFields[i]][task] = [self _storeUTF8String:(const char *)bytes length:length trim:YES];
+	}
+
+	_imageReferences[task] = [self _referenceForImage:AppigoBinaryReadImage(reader)];
+
+	uint64_t count = AppigoBinaryReadVarint(reader);
+	if (count > (reader->length - reader->offset) / kAppigoBinaryMinimumRecordLength)
+		reader->failed = YES;
+
+	*subtaskCount = (reader->failed == YES) ? 0 : count;
+
+	return task;
+}
+
+
+- (uint32_t)_storeStringListFromBinaryReader:(AppigoBinaryReader *)reader
+{
+	uint64_t prefix = AppigoBinaryReadVarint(reader);
+	if (prefix == 0)
+		return 0;
+
+	// Every string takes at least one byte
+	if (prefix - 1 > (uint64_t)(reader->length - reader->offset))
+	{
+		reader->failed = YES;
+		return 0;
+	}
+
+	NSUInteger count = (NSUInteger)(prefix - 1);
+	if ([self _reserveStringLists:_stringListsLength + count + 1] == NO)
+	{
+		reader->failed = YES;
+		return 0;
+	}
+
+	NSUInteger offset = _stringListsLength;
+	_stringListsLength += count + 1;
+
+	_stringLists[offset] = (uint32_t)count;
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		const uint8_t *bytes = NULL;
+		NSUInteger length = 0;
+
+		if (AppigoTaskForestReadUTF8(reader, &bytes, &length) == YES)
+			_stringLists[offset + 1 + i] = [self _storeUTF8String:(const char *)bytes length:length trim:NO];
+		else
+			_stringLists[offset + 1 + i] = 0;
+	}
+
+	return (uint32_t)offset + 1;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTaskForestPrivate)
+
+
+- (void)_setType:(AppigoTaskType)aType typeKeys:(NSArray *)keys typeValues:(NSArray *)values
+{
+	type = aType;
+
+	[typeKeys release];
+	typeKeys = [keys copy];
+
+	[typeValues release];
+	typeValues = [values copy];
+}
+
+
+@end
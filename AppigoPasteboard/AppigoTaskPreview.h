@@ -0,0 +1,68 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskPreview.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTaskPreview.h
+ @brief Lazily decoded tasks for fast previews of imported data.
+
+ A task preview only decodes the header fields of a task (name, type,
+ priority, dates and repeat) when it is created. The remaining fields (type
+ data, note, list, context, tags, action image and the whole subtask tree) are
+ decoded the first time any of them is accessed or the task is encoded,
+ rendered or modified. Until then the preview only holds on to the encoded
+ payload, so showing the name of a large imported project costs the same as
+ showing the name of a single task.
+
+ Previews are regular AppigoTask objects and can be used anywhere a task is
+ expected.
+
+ @code
+ AppigoTask *preview = [AppigoPasteboard taskPreviewFromPasteboardNamed:pasteboardName];
+ titleLabel.text = preview.name;				// only the header was decoded
+ NSUInteger count = [preview.subtasks count];	// the rest is decoded here
+ @endcode
+ */
+
+
+#import <UIKit/UIKit.h>
+
+#import "AppigoTask.h"
+
+
+#pragma mark -
+@interface AppigoTask (AppigoTaskPreview)
+
+/**
+ Create a lazily decoded task from a binary payload (see AppigoBinaryCoding.h).
+ Only the header section of the payload is read up front.
+
+ @param data The encoded payload.
+ @return Returns nil if the payload is not a supported binary task payload.
+ */
++ (AppigoTask *)taskPreviewWithBinaryData:(NSData *)data;
+
+/**
+ Create a lazily decoded task from an NSKeyedArchiver payload. Only the header
+ fields are decoded up front. The archive is not kept parsed, so it is parsed
+ a second time when the remaining fields are needed.
+
+ @param data The keyed archive data.
+ @return Returns nil if data is nil.
+ */
++ (AppigoTask *)taskPreviewWithKeyedArchiveData:(NSData *)data;
+
+/**
+ Check whether the task still has fields that have not been decoded.
+
+ @return Returns YES for previews whose remaining fields are still pending.
+ */
+- (BOOL)hasPendingFields;
+
+@end
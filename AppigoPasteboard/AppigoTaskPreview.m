@@ -0,0 +1,357 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskPreview.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTaskPreview.h"
+
+#import "AppigoBinaryCoding.h"
+
+#include <libkern/OSAtomic.h>
+
+
+// Implemented in AppigoTask.m
+@interface AppigoTask (Private)
+
+- (id)_initWithCoder:(NSCoder *)aDecoder headerOnly:(BOOL)headerOnly;
+- (void)_decodeBodyWithCoder:(NSCoder *)aDecoder;
+
+@end
+
+
+// Implemented in AppigoBinaryCoding.m
+@interface AppigoTask (AppigoBinaryCodingPrivate)
+
+- (id)_initWithBinaryReader:(AppigoBinaryReader *)reader headerOnly:(BOOL)headerOnly;
+- (void)_decodeBinaryBodyWithReader:(AppigoBinaryReader *)reader;
+- (NSUInteger)_appendBinaryRecordStartToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable;
+
+@end
+
+
+#pragma mark -
+@interface AppigoTaskPreview : AppigoTask
+{
+@private
+	NSData		*_pendingData;
+	NSUInteger	_pendingBodyOffset;
+	BOOL		_pendingIsKeyedArchive;
+}
+
+- (void)_setPendingData:(NSData *)data bodyOffset:(NSUInteger)bodyOffset keyedArchive:(BOOL)keyedArchive;
+- (void)_materializePendingFields;
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTaskPreview)
+
+
++ (AppigoTask *)taskPreviewWithBinaryData:(NSData *)data
+{
+	if (data == nil)
+		return nil;
+
+	AppigoBinaryReader reader;
+	AppigoBinaryReaderInit(&reader, data);
+
+	if (AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindTask) == NO)
+		return nil;
+
+	AppigoTaskPreview *preview = [[AppigoTaskPreview alloc] _initWithBinaryReader:&reader headerOnly:YES];
+	if (preview == nil)
+		return nil;
+
+	[preview _setPendingData:data bodyOffset:reader.offset keyedArchive:NO];
+
+	return [preview autorelease];
+}
+
+
++ (AppigoTask *)taskPreviewWithKeyedArchiveData:(NSData *)data
+{
+	if (data == nil)
+		return nil;
+
+	NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:data];
+	AppigoTaskPreview *preview = [[AppigoTaskPreview alloc] _initWithCoder:keyedUnarchiver headerOnly:YES];
+	[keyedUnarchiver release];
+
+	if (preview == nil)
+		return nil;
+
+	[preview _setPendingData:data bodyOffset:0 keyedArchive:YES];
+
+	return [preview autorelease];
+}
+
+
+- (BOOL)hasPendingFields
+{
+	return NO;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTaskPreview
+
+
+- (void)dealloc
+{
+	[_pendingData release];
+
+	[super dealloc];
+}
+
+
+- (void)_setPendingData:(NSData *)data bodyOffset:(NSUInteger)bodyOffset keyedArchive:(BOOL)keyedArchive
+{
+	[_pendingData release];
+	_pendingData = [data retain];
+	_pendingBodyOffset = bodyOffset;
+	_pendingIsKeyedArchive = keyedArchive;
+}
+
+
+- (void)_materializePendingFields
+{
+	if (_pendingData == nil)
+		return;
+
+	@synchronized(self)
+	{
+		if (_pendingData == nil)
+			return;
+
+		if (_pendingIsKeyedArchive == YES)
+		{
+			NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:_pendingData];
+			[self _decodeBodyWithCoder:keyedUnarchiver];
+			[keyedUnarchiver release];
+		}
+		else
+		{
+			AppigoBinaryReader reader;
+			AppigoBinaryReaderInit(&reader, _pendingData);
+
+			// Read the preamble again for the payload version and image table
+			AppigoBinaryReadPreamble(&reader, kAppigoBinaryCodingKindTask);
+			AppigoBinaryReaderSeek(&reader, _pendingBodyOffset);
+			[self _decodeBinaryBodyWithReader:&reader];
+
+			if (reader.failed == YES)
+				NSLog(@"Unable to decode the remaining fields of task: %@", self.name);
+		}
+
+		// Decoding a corrupt body may stop before the subtasks are created
+		if (_subtasks == nil)
+			_subtasks = [[NSMutableArray alloc] init];
+
+		// Only publish that the fields are ready once they have all been
+		// stored, since the check above is made without the lock.
+		OSMemoryBarrier();
+		[_pendingData release];
+		_pendingData = nil;
+	}
+}
+
+
+- (BOOL)hasPendingFields
+{
+	return (_pendingData != nil);
+}
+
+
+// Archived previews are decoded as plain tasks by apps that do not have this
+// private class, Todo included
+- (Class)classForCoder
+{
+	return [AppigoTask class];
+}
+
+
+- (Class)classForKeyedArchiver
+{
+	return [AppigoTask class];
+}
+
+
+#pragma mark -
+#pragma mark Lazily Decoded Properties
+
+
+- (NSArray *)typeKeys
+{
+	[self _materializePendingFields];
+	return [super typeKeys];
+}
+
+
+- (NSArray *)typeValues
+{
+	[self _materializePendingFields];
+	return [super typeValues];
+}
+
+
+- (NSString *)advancedRepeat
+{
+	[self _materializePendingFields];
+	return [super advancedRepeat];
+}
+
+
+- (void)setAdvancedRepeat:(NSString *)anAdvancedRepeat
+{
+	[self _materializePendingFields];
+	[super setAdvancedRepeat:anAdvancedRepeat];
+}
+
+
+- (NSString *)note
+{
+	[self _materializePendingFields];
+	return [super note];
+}
+
+
+- (void)setNote:(NSString *)aNote
+{
+	[self _materializePendingFields];
+	[super setNote:aNote];
+}
+
+
+- (NSString *)list
+{
+	[self _materializePendingFields];
+	return [super list];
+}
+
+
+- (void)setList:(NSString *)aList
+{
+	[self _materializePendingFields];
+	[super setList:aList];
+}
+
+
+- (NSString *)context
+{
+	[self _materializePendingFields];
+	return [super context];
+}
+
+
+- (void)setContext:(NSString *)aContext
+{
+	[self _materializePendingFields];
+	[super setContext:aContext];
+}
+
+
+- (NSString *)tags
+{
+	[self _materializePendingFields];
+	return [super tags];
+}
+
+
+- (void)setTags:(NSString *)someTags
+{
+	[self _materializePendingFields];
+	[super setTags:someTags];
+}
+
+
+- (UIImage *)actionImage
+{
+	[self _materializePendingFields];
+	return [super actionImage];
+}
+
+
+- (void)setActionImage:(UIImage *)anActionImage
+{
+	[self _materializePendingFields];
+	[super setActionImage:anActionImage];
+}
+
+
+- (NSArray *)subtasks
+{
+	[self _materializePendingFields];
+	return [super subtasks];
+}
+
+
+- (void)setSubtasks:(NSArray *)newSubtasks
+{
+	[self _materializePendingFields];
+	[super setSubtasks:newSubtasks];
+}
+
+
+#pragma mark -
+#pragma mark Methods Using Every Field
+
+
+- (void)setType:(AppigoTaskType)aTaskType withPropertyKeys:(NSArray *)keys withPropertyValues:(NSArray *)values
+{
+	[self _materializePendingFields];
+	[super setType:aTaskType withPropertyKeys:keys withPropertyValues:values];
+}
+
+
+- (void)addSubtask:(AppigoTask *)subtask
+{
+	[self _materializePendingFields];
+	[super addSubtask:subtask];
+}
+
+
+- (void)setActionForTaskWithAppDisplayName:(NSString *)aDisplayName
+				   withCompletionNotifyURL:(NSURL *)aCompletionNotifyURL
+				   withCompletionLaunchURL:(NSURL *)aCompletionLaunchURL
+					   withActionLaunchURL:(NSURL *)anActionLaunchURL
+						   withActionImage:(UIImage *)anActionImage
+{
+	[self _materializePendingFields];
+	[super setActionForTaskWithAppDisplayName:aDisplayName
+					  withCompletionNotifyURL:aCompletionNotifyURL
+					  withCompletionLaunchURL:aCompletionLaunchURL
+						  withActionLaunchURL:anActionLaunchURL
+							  withActionImage:anActionImage];
+}
+
+
+- (NSString *)plainTextRepresentationWithName:(BOOL)includeName
+{
+	[self _materializePendingFields];
+	return [super plainTextRepresentationWithName:includeName];
+}
+
+
+- (void)encodeWithCoder:(NSCoder *)aCoder
+{
+	[self _materializePendingFields];
+	[super encodeWithCoder:aCoder];
+}
+
+
+- (NSUInteger)_appendBinaryRecordStartToData:(NSMutableData *)data imageTable:(AppigoBinaryImageTable *)imageTable
+{
+	[self _materializePendingFields];
+	return [super _appendBinaryRecordStartToData:data imageTable:imageTable];
+}
+
+
+@end
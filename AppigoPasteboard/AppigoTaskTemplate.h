@@ -0,0 +1,81 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskTemplate.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTaskTemplate.h
+ @brief A task encoded once, with only its name and due date filled in per use.
+
+ @class AppigoTaskTemplate AppigoTaskTemplate.h
+ @brief A task encoded once, with only its name and due date filled in per use.
+
+ Tasks that are created over and over from the same template ("Errand: list
+ Home, high priority, due today") used to be archived from scratch every
+ time. A template archives its task once, with placeholders for the name and
+ the due date. The keyed archive is written as an XML property list, which
+ NSKeyedUnarchiver reads like any other archive. Filling in a template then
+ only splices the escaped name and the time of the due date into a copy of
+ that archive.
+
+ @code
+ AppigoTaskTemplate *errand = [[AppigoTaskTemplate alloc] initWithTask:task];
+ [AppigoPasteboard openTodoWithTaskTemplate:errand name:@"Buy milk" dueDate:[NSDate date] completion:nil];
+ @endcode
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#import "AppigoTask.h"
+
+
+#pragma mark -
+@interface AppigoTaskTemplate : NSObject
+{
+@private
+	AppigoTask		*_task;
+	NSData			*_archive;			// XML keyed archive with placeholders
+	NSRange			_nameRange;			// of the name placeholder in _archive
+	NSRange			_dueDateRange;		// of the due date placeholder, location NSNotFound without a due date
+
+	NSString		*_placeholderName;	// only set while archiving
+	NSDate			*_placeholderDate;
+}
+
+/** The task the template was created from. */
+@property (nonatomic, readonly) AppigoTask *task;
+
+/**
+ Encode a template.
+
+ @param task The task, including its subtasks. Its name and due date are the
+ defaults when filling in the template. They are replaced with equal objects
+ no other field can share. Do not change the task afterwards.
+ @return Returns nil if task is nil or can not be archived.
+ */
+- (id)initWithTask:(AppigoTask *)task;
+
+/**
+ Get the keyed archive of the template filled in.
+
+ @param name The task name, or nil or empty for the name of the template's task.
+ @param dueDate The due date, or nil for the due date of the template's task.
+ Ignored if the template's task has no due date.
+ @return Returns the archive, in the format of AppigoTask's encodeWithCoder:.
+ */
+- (NSData *)keyedArchiveDataWithName:(NSString *)name dueDate:(NSDate *)dueDate;
+
+/**
+ Get a task from the template filled in, see keyedArchiveDataWithName:dueDate:.
+
+ @return Returns an autoreleased task.
+ */
+- (AppigoTask *)taskWithName:(NSString *)name dueDate:(NSDate *)dueDate;
+
+@end
@@ -0,0 +1,374 @@
+/**
+
+ Appigo Third Party Integration - AppigoTaskTemplate.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTaskTemplate.h"
+#import "AppigoStringTrimming.h"
+
+
+// A time no real due date has, with a short exact representation
+#define kAppigoTaskTemplatePlaceholderTime	(-3.0e9)
+
+
+static NSRange AppigoTaskTemplateFindBytes(NSData *data, const void *bytes, NSUInteger length, NSUInteger from)
+{
+	if ([data length] < from + length)
+		return NSMakeRange(NSNotFound, 0);
+
+	return [data rangeOfData:[NSData dataWithBytesNoCopy:(void *)bytes length:length freeWhenDone:NO]
+					 options:0
+					   range:NSMakeRange(from, [data length] - from)];
+}
+
+
+// Returns the range of the text of the <real> element holding value
+static NSRange AppigoTaskTemplateFindReal(NSData *data, double value)
+{
+	static const char openTag[] = "<real>";
+	static const char closeTag[] = "</real>";
+
+	NSUInteger offset = 0;
+	for (;;)
+	{
+		NSRange open = AppigoTaskTemplateFindBytes(data, openTag, sizeof(openTag) - 1, offset);
+		if (open.location == NSNotFound)
+			return open;
+
+		NSUInteger start = NSMaxRange(open);
+		NSRange close = AppigoTaskTemplateFindBytes(data, closeTag, sizeof(closeTag) - 1, start);
+		if ( (close.location == NSNotFound) || (close.location - start > 63) )
+			return NSMakeRange(NSNotFound, 0);
+
+		char text[64];
+		memcpy(text, (const char *)[data bytes] + start, close.location - start);
+		text[close.location - start] = '\0';
+
+		if (strtod(text, NULL) == value)
+			return NSMakeRange(start, close.location - start);
+
+		offset = NSMaxRange(close);
+	}
+}
+
+
+// Escapes the characters XML does not allow in text, and drops the control
+// characters it does not allow at all
+static void AppigoTaskTemplateAppendEscapedString(NSMutableData *data, NSString *string)
+{
+	const char *utf8 = [string UTF8String];
+	const char *run = utf8;
+
+	for (const char *c = utf8; *c != '\0'; c++)
+	{
+		const char *replacement = NULL;
+		if (*c == '&')
+			replacement = "&amp;";
+		else if (*c == '<')
+			replacement = "&lt;";
+		else if (*c == '>')
+			replacement = "&gt;";
+		else if ( ((uint8_t)*c < 0x20) && (*c != '\t') && (*c != '\n') && (*c != '\r') )
+			replacement = "";
+		else
+			continue;
+
+		[data appendBytes:run length:c - run];
+		[data appendBytes:replacement length:strlen(replacement)];
+		run = c + 1;
+	}
+
+	[data appendBytes:run length:strlen(run)];
+}
+
+
+// The archiver replaces every reference to an object the way it replaced the
+// first one, so the placeholders only stand for the root's name and due date
+// if no other field of the tree holds the same instance. Tagged and interned
+// strings and dates make that common, see _setUniqueNameAndDueDate.
+static BOOL AppigoTaskTemplateSharesInstances(AppigoTask *task, AppigoTask *root)
+{
+	NSMutableArray *fields = [NSMutableArray arrayWithCapacity:12];
+	if (task != root)
+	{
+		[fields addObject:task.name];
+		if (task.dueDate != nil)
+			[fields addObject:task.dueDate];
+	}
+
+	if (task.startDate != nil)
+		[fields addObject:task.startDate];
+	if (task.completionDate != nil)
+		[fields addObject:task.completionDate];
+	if (task.advancedRepeat != nil)
+		[fields addObject:task.advancedRepeat];
+	if (task.note != nil)
+		[fields addObject:task.note];
+	if (task.list != nil)
+		[fields addObject:task.list];
+	if (task.context != nil)
+		[fields addObject:task.context];
+	if (task.tags != nil)
+		[fields addObject:task.tags];
+	if (task.typeKeys != nil)
+		[fields addObjectsFromArray:task.typeKeys];
+	if (task.typeValues != nil)
+		[fields addObjectsFromArray:task.typeValues];
+
+	for (id field in fields)
+	{
+		if ( (field == root.name) || ((root.dueDate != nil) && (field == root.dueDate)) )
+			return YES;
+	}
+
+	for (AppigoTask *subtask in task.subtasks)
+	{
+		if (AppigoTaskTemplateSharesInstances(subtask, root) == YES)
+			return YES;
+	}
+
+	return NO;
+}
+
+
+// A date that is never a tagged pointer or a shared instance, so no other
+// field can hold it. It archives as a plain NSDate.
+@interface AppigoTaskTemplateDate : NSDate
+{
+@private
+	NSTimeInterval	_time;
+}
+
+@end
+
+
+@interface AppigoTask (AppigoTaskTemplatePrivate)
+
+- (void)_setUniqueNameAndDueDate;
+
+@end
+
+
+@interface AppigoTaskTemplate (Private) <NSKeyedArchiverDelegate>
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTaskTemplate
+
+
+@synthesize task = _task;
+
+
+- (id)initWithTask:(AppigoTask *)task
+{
+	if (self = [super init])
+	{
+		if (task == nil)
+		{
+			[self release];
+			return nil;
+		}
+
+		// Equal values, but instances nothing else in the tree can hold
+		[task _setUniqueNameAndDueDate];
+		if (AppigoTaskTemplateSharesInstances(task, task) == YES)
+		{
+			NSLog(@"Unable to create a template from a task that shares its name or due date object with another field: %@", task.name);
+			[self release];
+			return nil;
+		}
+
+		_task = [task retain];
+
+		// The placeholder name has to be unique, or the archiver would share
+		// it with an equal string elsewhere in the task
+		_placeholderName = [[[NSProcessInfo processInfo] globallyUniqueString] retain];
+		_placeholderDate = [[NSDate alloc] initWithTimeIntervalSinceReferenceDate:kAppigoTaskTemplatePlaceholderTime];
+
+		NSMutableData *archive = [[NSMutableData alloc] init];
+		NSKeyedArchiver *keyedArchiver = [[NSKeyedArchiver alloc] initForWritingWithMutableData:archive];
+		[keyedArchiver setOutputFormat:NSPropertyListXMLFormat_v1_0];
+		[keyedArchiver setDelegate:self];
+		[task encodeWithCoder:keyedArchiver];
+		[keyedArchiver finishEncoding];
+		[keyedArchiver release];
+
+		const char *placeholder = [_placeholderName UTF8String];
+		_nameRange = AppigoTaskTemplateFindBytes(archive, placeholder, strlen(placeholder), 0);
+		_dueDateRange = (task.dueDate != nil) ? AppigoTaskTemplateFindReal(archive, kAppigoTaskTemplatePlaceholderTime) : NSMakeRange(NSNotFound, 0);
+
+		[_placeholderName release];
+		_placeholderName = nil;
+		[_placeholderDate release];
+		_placeholderDate = nil;
+
+		if ( (_nameRange.location == NSNotFound) || ((task.dueDate != nil) && (_dueDateRange.location == NSNotFound)) )
+		{
+			NSLog(@"Unable to find the placeholders in the archive of task template: %@", task.name);
+			[archive release];
+			[self release];
+			return nil;
+		}
+
+		_archive = archive;
+	}
+
+	return self;
+}
+
+
+- (void)dealloc
+{
+	[_task release];
+	[_archive release];
+	[_placeholderName release];
+	[_placeholderDate release];
+
+	[super dealloc];
+}
+
+
+- (NSString *)description
+{
+	return [NSString stringWithFormat:@"<%@: %@, %lu byte archive>",
+			NSStringFromClass([self class]),
+			_task.name,
+			(unsigned long)[_archive length]];
+}
+
+
+- (NSData *)keyedArchiveDataWithName:(NSString *)name dueDate:(NSDate *)dueDate
+{
+	NSString *trimmedName = [AppigoCopyStringByTrimmingWhitespace(name) autorelease];
+	if ([trimmedName length] == 0)
+		trimmedName = _task.name;
+
+	NSMutableData *nameData = [NSMutableData dataWithCapacity:[trimmedName length] + 16];
+	AppigoTaskTemplateAppendEscapedString(nameData, trimmedName);
+
+	NSData *dueDateData = nil;
+	if (_dueDateRange.location != NSNotFound)
+	{
+		NSTimeInterval time = [((dueDate != nil) ? dueDate : _task.dueDate) timeIntervalSinceReferenceDate];
+		char text[64];
+		int length = snprintf(text, sizeof(text), "%.17g", time);
+		dueDateData = [NSData dataWithBytes:text length:(NSUInteger)length];
+	}
+
+	// Splice the values in, in the order their placeholders appear
+	NSRange ranges[2] = { _nameRange, _dueDateRange };
+	NSData *values[2] = { nameData, dueDateData };
+	NSUInteger count = (dueDateData != nil) ? 2 : 1;
+	if ( (count == 2) && (ranges[1].location < ranges[0].location) )
+	{
+		ranges[0] = _dueDateRange;
+		ranges[1] = _nameRange;
+		values[0] = dueDateData;
+		values[1] = nameData;
+	}
+
+	const uint8_t *bytes = [_archive bytes];
+	NSMutableData *data = [NSMutableData dataWithCapacity:[_archive length] + [nameData length] + 32];
+	NSUInteger offset = 0;
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		[data appendBytes:bytes + offset length:ranges[i].location - offset];
+		[data appendData:values[i]];
+		offset = NSMaxRange(ranges[i]);
+	}
+
+	[data appendBytes:bytes + offset length:[_archive length] - offset];
+
+	return data;
+}
+
+
+- (AppigoTask *)taskWithName:(NSString *)name dueDate:(NSDate *)dueDate
+{
+	NSKeyedUnarchiver *keyedUnarchiver = [[NSKeyedUnarchiver alloc] initForReadingWithData:[self keyedArchiveDataWithName:name dueDate:dueDate]];
+	AppigoTask *task = [[AppigoTask alloc] initWithCoder:keyedUnarchiver];
+	[keyedUnarchiver release];
+
+	return [task autorelease];
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTaskTemplate (Private)
+
+
+// Swaps the name and due date of the template's task for the placeholders
+- (id)archiver:(NSKeyedArchiver *)archiver willEncodeObject:(id)object
+{
+	if (object == _task.name)
+		return _placeholderName;
+
+	if ( (object != nil) && (object == _task.dueDate) )
+		return _placeholderDate;
+
+	return object;
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTaskTemplateDate
+
+
+- (id)initWithTimeIntervalSinceReferenceDate:(NSTimeInterval)time
+{
+	if (self = [super init])
+		_time = time;
+
+	return self;
+}
+
+
+- (NSTimeInterval)timeIntervalSinceReferenceDate
+{
+	return _time;
+}
+
+
+- (Class)classForCoder
+{
+	return [NSDate class];
+}
+
+
+@end
+
+
+#pragma mark -
+@implementation AppigoTask (AppigoTaskTemplatePrivate)
+
+
+// A mutable string is never tagged or uniqued, unlike a copy of an immutable one
+- (void)_setUniqueNameAndDueDate
+{
+	NSString *uniqueName = [[NSMutableString alloc] initWithString:name];
+	[name release];
+	name = uniqueName;
+
+	if (dueDate != nil)
+	{
+		NSDate *uniqueDate = [[AppigoTaskTemplateDate alloc] initWithTimeIntervalSinceReferenceDate:[dueDate timeIntervalSinceReferenceDate]];
+		[dueDate release];
+		dueDate = uniqueDate;
+	}
+}
+
+
+@end
@@ -0,0 +1,102 @@
+/**
+
+ Appigo Third Party Integration - AppigoTrace.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoTrace.h
+ @brief Low overhead tracing of the import path.
+
+ Spans (an event, a start and end time, the thread and one integer argument)
+ are recorded into a fixed size ring buffer that is shared by all threads
+ without locks. Recording a span is an atomic increment, a handful of stores
+ and two calls to mach_absolute_time(). Once the buffer is full the oldest
+ spans are overwritten.
+
+ Tracing is compiled in only when APPIGO_TRACE is defined (build with
+ "make TRACE=1"). Otherwise all of the macros below expand to nothing.
+
+ The buffer can be dumped on demand by posting the com.appigo.trace.dump
+ darwin notification, for example with "notifyutil -p com.appigo.trace.dump".
+ The spans are then written to syslog and to AppigoTrace.log in the
+ temporary directory.
+
+ @code
+ APPIGO_TRACE_BEGIN(write);
+ pasteboard.items = items;
+ APPIGO_TRACE_END(write, AppigoTraceEventPasteboardWrite, [items count]);
+ @endcode
+ */
+
+
+#import <Foundation/Foundation.h>
+
+#include <mach/mach_time.h>
+
+
+/** The number of spans kept in the ring buffer, a power of two. */
+#define kAppigoTraceCapacity			1024
+
+/** The darwin notification that dumps the ring buffer. */
+#define kAppigoTraceDumpNotification	"com.appigo.trace.dump"
+
+
+/**
+ The traced events.
+ */
+typedef enum
+{
+	AppigoTraceEventActivatorEvent = 0,	///< Activator event received until the alert was shown
+	AppigoTraceEventAlertPresent,		///< Activator event received until the alert was drawn
+	AppigoTraceEventAlertDismiss,		///< alert dismissed, including the import it started
+	AppigoTraceEventTaskEncode,			///< tasks encoded into pasteboard items, arg is the task count
+	AppigoTraceEventPasteboardCreate,	///< pasteboard removed and created again
+	AppigoTraceEventPasteboardRemove,	///< pasteboard removed
+	AppigoTraceEventPasteboardWrite,	///< pasteboard items written, arg is the item count
+	AppigoTraceEventURLBuild,			///< import URL built
+	AppigoTraceEventOpenURL,			///< openURL:, arg is 1 if it succeeded
+	AppigoTraceEventTaskDecode,			///< tasks decoded from pasteboard items, arg is the bytes saved by string interning
+	AppigoTraceEventImportMainThread,	///< main thread part of an asynchronous import, arg is 1 if it imported
+	AppigoTraceEventTweakLoad,			///< +load of the tweak, arg is the resident memory it added in KB
+	AppigoTraceEventFirstEventSetup,	///< setup deferred to the first Activator event, arg is the resident memory it added in KB
+	AppigoTraceEventCount
+} AppigoTraceEvent;
+
+
+#ifdef APPIGO_TRACE
+
+/** Record a span. Safe to call from any thread. */
+void AppigoTraceRecord(AppigoTraceEvent event, uint64_t start, uint64_t end, uint32_t arg);
+
+/** Start listening for the dump notification. */
+void AppigoTraceInstall(void);
+
+/**
+ Write the spans in the buffer, oldest first, to a file.
+
+ @param path The file to write.
+ @return Returns NO if the file could not be written.
+ */
+BOOL AppigoTraceDumpToFile(NSString *path);
+
+/** Write the spans in the buffer, oldest first, to syslog. */
+void AppigoTraceDumpToSyslog(void);
+
+#define APPIGO_TRACE_INSTALL()					AppigoTraceInstall()
+#define APPIGO_TRACE_BEGIN(name)				uint64_t _appigoTraceStart_##name = mach_absolute_time()
+#define APPIGO_TRACE_END(name, event, arg)		AppigoTraceRecord((event), _appigoTraceStart_##name, mach_absolute_time(), (uint32_t)(arg))
+#define APPIGO_TRACE_SPAN(event, start, arg)	AppigoTraceRecord((event), (start), mach_absolute_time(), (uint32_t)(arg))
+
+#else
+
+#define APPIGO_TRACE_INSTALL()					do {} while (0)
+#define APPIGO_TRACE_BEGIN(name)
+#define APPIGO_TRACE_END(name, event, arg)		do {} while (0)
+#define APPIGO_TRACE_SPAN(event, start, arg)	do {} while (0)
+
+#endif
@@ -0,0 +1,189 @@
+/**
+
+ Appigo Third Party Integration - AppigoTrace.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoTrace.h"
+
+#ifdef APPIGO_TRACE
+
+#include <libkern/OSAtomic.h>
+#include <pthread.h>
+#include <syslog.h>
+
+
+#define kAppigoTraceMask			(kAppigoTraceCapacity - 1)
+#define kAppigoTraceLogFileName		@"AppigoTrace.log"
+
+
+// A slot is complete when its sequence is the index it was written for plus
+// one. Writers clear the sequence first so that readers can skip slots that
+// are being overwritten.
+typedef struct
+{
+	volatile uint32_t	sequence;
+	uint32_t			event;
+	uint32_t			thread;
+	uint32_t			arg;
+	uint64_t			start;
+	uint64_t			end;
+} AppigoTraceSlot;
+
+
+static AppigoTraceSlot _slots[kAppigoTraceCapacity];
+static volatile int32_t _nextIndex = 0;
+
+static const char *_eventNames[AppigoTraceEventCount] = {
+	"activator-event",
+	"alert-present",
+	"alert-dismiss",
+	"task-encode",
+	"pasteboard-create",
+	"pasteboard-remove",
+	"pasteboard-write",
+	"url-build",
+	"open-url",
+	"task-decode",
+	"import-main-thread",
+	"tweak-load",
+	"first-event-setup"
+};
+
+
+void AppigoTraceRecord(AppigoTraceEvent event, uint64_t start, uint64_t end, uint32_t arg)
+{
+	uint32_t index = (uint32_t)OSAtomicIncrement32(&_nextIndex) - 1;
+	AppigoTraceSlot *slot = &_slots[index & kAppigoTraceMask];
+
+	slot->sequence = 0;
+	OSMemoryBarrier();
+
+	slot->event = event;
+	slot->thread = pthread_mach_thread_np(pthread_self());
+	slot->arg = arg;
+	slot->start = start;
+	slot->end = end;
+
+	OSMemoryBarrier();
+	slot->sequence = index + 1;
+}
+
+
+#pragma mark -
+#pragma mark Dumping
+
+
+// Copy the complete spans, oldest first. Returns the number copied.
+static NSUInteger AppigoTraceSnapshot(AppigoTraceSlot *spans)
+{
+	uint32_t end = (uint32_t)_nextIndex;
+	uint32_t begin = (end > kAppigoTraceCapacity) ? end - kAppigoTraceCapacity : 0;
+	NSUInteger count = 0;
+
+	for (uint32_t index = begin; index != end; index++)
+	{
+		const AppigoTraceSlot *slot = &_slots[index & kAppigoTraceMask];
+
+		if (slot->sequence != index + 1)
+			continue;
+		OSMemoryBarrier();
+
+		AppigoTraceSlot copy = *slot;
+
+		// Skip the slot if a writer started on it while it was copied
+		OSMemoryBarrier();
+		if (slot->sequence != index + 1)
+			continue;
+
+		spans[count++] = copy;
+	}
+
+	return count;
+}
+
+
+static double AppigoTraceMicroseconds(uint64_t machTime)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+
+	return (double)machTime * timebase.numer / timebase.denom / 1000.0;
+}
+
+
+// One line per span: start (relative to the earliest start), duration, event,
+// thread and argument
+static NSArray *AppigoTraceLines(void)
+{
+	AppigoTraceSlot *spans = malloc(sizeof(AppigoTraceSlot) * kAppigoTraceCapacity);
+	if (spans == NULL)
+		return [NSArray array];
+
+	NSUInteger count = AppigoTraceSnapshot(spans);
+	NSMutableArray *lines = [NSMutableArray arrayWithCapacity:count];
+
+	// Spans are recorded when they end, so the first one is not necessarily
+	// the one that started first
+	uint64_t origin = (count > 0) ? spans[0].start : 0;
+	for (NSUInteger i = 1; i < count; i++)
+		origin = MIN(origin, spans[i].start);
+
+	for (NSUInteger i = 0; i < count; i++)
+	{
+		const AppigoTraceSlot *span = &spans[i];
+		const char *name = (span->event < AppigoTraceEventCount) ? _eventNames[span->event] : "unknown";
+
+		[lines addObject:[NSString stringWithFormat:@"%12.1fus %10.1fus %-18s thread %-6u arg %u",
+						  AppigoTraceMicroseconds(span->start - origin),
+						  AppigoTraceMicroseconds(span->end - span->start),
+						  name,
+						  span->thread,
+						  span->arg]];
+	}
+
+	free(spans);
+
+	return lines;
+}
+
+
+BOOL AppigoTraceDumpToFile(NSString *path)
+{
+	NSString *text = [[AppigoTraceLines() componentsJoinedByString:@"\n"] stringByAppendingString:@"\n"];
+	return [text writeToFile:path atomically:YES encoding:NSUTF8StringEncoding error:NULL];
+}
+
+
+void AppigoTraceDumpToSyslog(void)
+{
+	for (NSString *line in AppigoTraceLines())
+		syslog(LOG_NOTICE, "AppigoTrace: %s", [line UTF8String]);
+}
+
+
+static void AppigoTraceDumpRequested(CFNotificationCenterRef center, void *observer, CFStringRef name, const void *object, CFDictionaryRef userInfo)
+{
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	AppigoTraceDumpToSyslog();
+	AppigoTraceDumpToFile([NSTemporaryDirectory() stringByAppendingPathComponent:kAppigoTraceLogFileName]);
+
+	[pool release];
+}
+
+
+void AppigoTraceInstall(void)
+{
+	static dispatch_once_t onceToken;
+
+	dispatch_once(&onceToken, ^{
+		CFNotificationCenterAddObserver(CFNotificationCenterGetDarwinNotifyCenter(), NULL, AppigoTraceDumpRequested, CFSTR(kAppigoTraceDumpNotification), NULL, CFNotificationSuspensionBehaviorDeliverImmediately);
+	});
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+
+ Appigo Third Party Integration - AppigoURLBuilder.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoURLBuilder.h
+ @brief Builds the URLs used to launch Appigo apps for an import.
+
+ @class AppigoURLBuilder AppigoURLBuilder.h
+ @brief Builds the URLs used to launch Appigo apps for an import.
+
+ Import URLs are assembled from precomputed scheme and path prefixes in a
+ single buffer that is sized up front, so building a URL takes one allocation
+ (none beyond the URL itself for short URLs). Values placed in the query are
+ percent-encoded as query components with a lookup table: everything except
+ the RFC 3986 unreserved characters (A-Z, a-z, 0-9, "-", ".", "_" and "~") is
+ escaped, so characters like "&", "#", "+" and "=" in a task name can never
+ change the meaning of the query.
+ */
+
+
+#import <Foundation/Foundation.h>
+
+
+#pragma mark -
+@interface AppigoURLBuilder : NSObject
+{
+}
+
+/**
+ Percent-encode a string for use as a single URL query component (a key or a
+ value). The string is encoded as UTF-8.
+
+ @param component The string to encode.
+ @return Returns the encoded string or nil if component is nil.
+ */
++ (NSString *)stringByEncodingQueryComponent:(NSString *)component;
+
+/**
+ Build the URL that launches Appigo Todo to import the tasks on a pasteboard.
+
+ @param sourceAppID The bundle identifier of the app importing the tasks.
+ @param pasteboardName The name of the pasteboard holding the tasks.
+ @return Returns the import URL or nil if it could not be created.
+ */
++ (NSURL *)todoImportURLWithSourceAppID:(NSString *)sourceAppID pasteboardName:(NSString *)pasteboardName;
+
+/**
+ Build the URL that launches Appigo Todo to import a task with only a name
+ (no pasteboard needed).
+
+ @param sourceAppID The bundle identifier of the app importing the task.
+ @param taskName The name of the new task.
+ @return Returns the import URL or nil if it could not be created.
+ */
++ (NSURL *)todoImportURLWithSourceAppID:(NSString *)sourceAppID taskName:(NSString *)taskName;
+
+/**
+ Build the URL that launches Appigo Notebook to import the note on a pasteboard.
+
+ @param sourceAppID The bundle identifier of the app importing the note.
+ @param pasteboardName The name of the pasteboard holding the note.
+ @return Returns the import URL or nil if it could not be created.
+ */
++ (NSURL *)notebookImportURLWithSourceAppID:(NSString *)sourceAppID pasteboardName:(NSString *)pasteboardName;
+
+@end
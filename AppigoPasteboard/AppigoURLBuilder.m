@@ -0,0 +1,143 @@
+/**
+
+ Appigo Third Party Integration - AppigoURLBuilder.m
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#import "AppigoURLBuilder.h"
+#import "AppigoURLEncoding.h"
+
+
+// Import URL prefixes, stored as C strings so they can be copied without any
+// conversion while building a URL.
+#define kAppigoURLTodoScheme				"appigotodo://"
+#define kAppigoURLNotebookScheme			"appigonotebook://"
+#define kAppigoURLPasteboardImportQuery		"/import?source=pasteboard&pasteboard-name="
+#define kAppigoURLNameImportQuery			"/import?name="
+
+// URLs shorter than this are built on the stack
+#define kAppigoURLStackBufferLength			512
+
+
+// Copy the UTF-8 bytes of string to buffer and return how many were written
+static NSUInteger AppigoURLGetUTF8Bytes(NSString *string, void *buffer, NSUInteger maxLength)
+{
+	NSUInteger usedLength = 0;
+
+	[string getBytes:buffer
+		   maxLength:maxLength
+		  usedLength:&usedLength
+			encoding:NSUTF8StringEncoding
+			 options:0
+			   range:NSMakeRange(0, [string length])
+	  remainingRange:NULL];
+
+	return usedLength;
+}
+
+
+// Build scheme + host + query + encoded value in one buffer
+static NSURL *AppigoURLCreateImportURL(const char *scheme, size_t schemeLength, NSString *host, const char *query, size_t queryLength, NSString *value)
+{
+	if ( (host == nil) || (value == nil) )
+		return nil;
+
+	NSUInteger hostLength = [host lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger valueLength = [value lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+
+	// Room for the prefixes, the worst case encoded value and the raw value
+	// which is encoded in place from the end of the buffer.
+	size_t capacity = schemeLength + hostLength + queryLength + (4 * valueLength);
+
+	char stackBuffer[kAppigoURLStackBufferLength];
+	char *buffer = (capacity <= sizeof(stackBuffer)) ? stackBuffer : (char *)malloc(capacity);
+	if (buffer == NULL)
+		return nil;
+
+	char *cursor = buffer;
+
+	memcpy(cursor, scheme, schemeLength);
+	cursor += schemeLength;
+
+	cursor += AppigoURLGetUTF8Bytes(host, cursor, hostLength);
+
+	memcpy(cursor, query, queryLength);
+	cursor += queryLength;
+
+	uint8_t *rawValue = (uint8_t *)cursor + (3 * valueLength);
+	NSUInteger rawLength = AppigoURLGetUTF8Bytes(value, rawValue, valueLength);
+	cursor = AppigoURLEncodeBytes(cursor, rawValue, rawLength);
+
+	CFURLRef url = CFURLCreateWithBytes(kCFAllocatorDefault, (const UInt8 *)buffer, (CFIndex)(cursor - buffer), kCFStringEncodingUTF8, NULL);
+
+	if (buffer != stackBuffer)
+		free(buffer);
+
+	if (url == NULL)
+		return nil;
+
+	return [(NSURL *)url autorelease];
+}
+
+
+#pragma mark -
+@implementation AppigoURLBuilder
+
+
++ (NSString *)stringByEncodingQueryComponent:(NSString *)component
+{
+	if (component == nil)
+		return nil;
+
+	NSUInteger length = [component lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	size_t capacity = 4 * length;
+
+	char stackBuffer[kAppigoURLStackBufferLength];
+	char *buffer = (capacity <= sizeof(stackBuffer)) ? stackBuffer : (char *)malloc(capacity);
+	if (buffer == NULL)
+		return nil;
+
+	uint8_t *rawComponent = (uint8_t *)buffer + (3 * length);
+	NSUInteger rawLength = AppigoURLGetUTF8Bytes(component, rawComponent, length);
+	char *end = AppigoURLEncodeBytes(buffer, rawComponent, rawLength);
+
+	NSString *encoded = [[NSString alloc] initWithBytes:buffer length:(NSUInteger)(end - buffer) encoding:NSASCIIStringEncoding];
+
+	if (buffer != stackBuffer)
+		free(buffer);
+
+	return [encoded autorelease];
+}
+
+
++ (NSURL *)todoImportURLWithSourceAppID:(NSString *)sourceAppID pasteboardName:(NSString *)pasteboardName
+{
+	return AppigoURLCreateImportURL(kAppigoURLTodoScheme, sizeof(kAppigoURLTodoScheme) - 1,
+									sourceAppID,
+									kAppigoURLPasteboardImportQuery, sizeof(kAppigoURLPasteboardImportQuery) - 1,
+									pasteboardName);
+}
+
+
++ (NSURL *)todoImportURLWithSourceAppID:(NSString *)sourceAppID taskName:(NSString *)taskName
+{
+	return AppigoURLCreateImportURL(kAppigoURLTodoScheme, sizeof(kAppigoURLTodoScheme) - 1,
+									sourceAppID,
+									kAppigoURLNameImportQuery, sizeof(kAppigoURLNameImportQuery) - 1,
+									taskName);
+}
+
+
++ (NSURL *)notebookImportURLWithSourceAppID:(NSString *)sourceAppID pasteboardName:(NSString *)pasteboardName
+{
+	return AppigoURLCreateImportURL(kAppigoURLNotebookScheme, sizeof(kAppigoURLNotebookScheme) - 1,
+									sourceAppID,
+									kAppigoURLPasteboardImportQuery, sizeof(kAppigoURLPasteboardImportQuery) - 1,
+									pasteboardName);
+}
+
+
+@end
@@ -0,0 +1,54 @@
+/**
+
+ Appigo Third Party Integration - AppigoURLEncoding.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoURLEncoding.h
+ @brief Table-driven percent-encoding of URL query components.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host. Everything except the RFC 3986 unreserved characters (A-Z, a-z, 0-9,
+ "-", ".", "_" and "~") is escaped, using upper case hex digits.
+ */
+
+
+#ifndef APPIGO_URL_ENCODING_H
+#define APPIGO_URL_ENCODING_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/** The most bytes a single input byte is encoded into. */
+#define kAppigoURLEncodedBytesPerByte	3
+
+
+/**
+ Percent-encode bytes as a URL query component.
+
+ @param out The output, with room for kAppigoURLEncodedBytesPerByte * length
+ bytes. The input may live in the same buffer as long as it starts at least
+ kAppigoURLEncodedBytesPerByte * length bytes after out, since the output
+ can never catch up with the unread input.
+ @param bytes The bytes to encode, usually UTF-8.
+ @param length The number of bytes.
+ @return Returns the end of the encoded bytes, which are not NUL terminated.
+ */
+char *AppigoURLEncodeBytes(char *out, const uint8_t *bytes, size_t length);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
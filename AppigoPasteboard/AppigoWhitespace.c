@@ -0,0 +1,140 @@
+/**
+
+ Appigo Third Party Integration - AppigoWhitespace.c
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+#include "AppigoWhitespace.h"
+
+#include <string.h>
+
+
+// Eight spaces, to skip long runs of padding a word at a time
+#define kAppigoWhitespaceSpaceWord	0x2020202020202020ULL
+
+
+int AppigoUnicharIsWhitespace(uint16_t character)
+{
+	if (character < 0x80)
+		return ( (character == ' ') || (character == '\t') );
+
+	// The space separators outside ASCII
+	switch (character)
+	{
+		case 0x00A0:	// no-break space
+		case 0x1680:	// ogham space mark
+		case 0x202F:	// narrow no-break space
+		case 0x205F:	// medium mathematical space
+		case 0x3000:	// ideographic space
+			return 1;
+		default:
+			return ( (character >= 0x2000) && (character <= 0x200A) );	// en quad to hair space
+	}
+}
+
+
+// Decode the UTF-8 sequence at bytes into a UTF-16 character. Returns the
+// length of the sequence, or 0 if it is not valid or outside the BMP (no
+// whitespace characters are).
+static size_t AppigoUTF8DecodeCharacter(const uint8_t *bytes, size_t length, uint16_t *character)
+{
+	uint8_t lead = bytes[0];
+
+	if ( (lead >= 0xC2) && (lead <= 0xDF) && (length >= 2) && ((bytes[1] & 0xC0) == 0x80) )
+	{
+		*character = (uint16_t)(((lead & 0x1F) << 6) | (bytes[1] & 0x3F));
+		return 2;
+	}
+
+	if ( ((lead & 0xF0) == 0xE0) && (length >= 3) && ((bytes[1] & 0xC0) == 0x80) && ((bytes[2] & 0xC0) == 0x80) )
+	{
+		uint16_t value = (uint16_t)(((lead & 0x0F) << 12) | ((bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F));
+		if (value < 0x800)
+			return 0;
+
+		*character = value;
+		return 3;
+	}
+
+	return 0;
+}
+
+
+void AppigoUTF8TrimWhitespace(const uint8_t *bytes, size_t length, size_t *startOut, size_t *endOut)
+{
+	size_t start = 0;
+	size_t end = length;
+	uint16_t character;
+
+	while (start < end)
+	{
+		uint8_t byte = bytes[start];
+		if (byte < 0x80)
+		{
+			if ( (byte != ' ') && (byte != '\t') )
+				break;
+
+			// Only a space can start a run worth skipping a word at a time
+			if ( (byte == ' ') && (end - start >= 8) )
+			{
+				uint64_t word;
+				memcpy(&word, bytes + start, sizeof(word));
+				if (word == kAppigoWhitespaceSpaceWord)
+				{
+					start += 8;
+					continue;
+				}
+			}
+
+			start++;
+			continue;
+		}
+
+		size_t sequenceLength = AppigoUTF8DecodeCharacter(bytes + start, end - start, &character);
+		if ( (sequenceLength == 0) || (AppigoUnicharIsWhitespace(character) == 0) )
+			break;
+
+		start += sequenceLength;
+	}
+
+	while (end > start)
+	{
+		uint8_t byte = bytes[end - 1];
+		if (byte < 0x80)
+		{
+			if ( (byte != ' ') && (byte != '\t') )
+				break;
+
+			if ( (byte == ' ') && (end - start >= 8) )
+			{
+				uint64_t word;
+				memcpy(&word, bytes + end - 8, sizeof(word));
+				if (word == kAppigoWhitespaceSpaceWord)
+				{
+					end -= 8;
+					continue;
+				}
+			}
+
+			end--;
+			continue;
+		}
+
+		// Step back over continuation bytes to the start of the last character
+		size_t lead = end - 1;
+		while ( (lead > start) && ((bytes[lead] & 0xC0) == 0x80) && (end - lead < 3) )
+			lead--;
+
+		size_t sequenceLength = AppigoUTF8DecodeCharacter(bytes + lead, end - lead, &character);
+		if ( (sequenceLength != end - lead) || (AppigoUnicharIsWhitespace(character) == 0) )
+			break;
+
+		end = lead;
+	}
+
+	*startOut = start;
+	*endOut = end;
+}
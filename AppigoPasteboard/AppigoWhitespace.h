@@ -0,0 +1,58 @@
+/**
+
+ Appigo Third Party Integration - AppigoWhitespace.h
+
+ Copyright (c) 2014, Julian Weiss. All rights reserved.
+ Distributed under the Simplified BSD License (see README.md).
+
+ */
+
+
+/**
+ @file AppigoWhitespace.h
+ @brief The whitespace test and UTF-8 trimming kernel behind AppigoStringTrimming.h.
+
+ Plain C with no Foundation dependency, so it can be built and tested on any
+ host. Whitespace is what [NSCharacterSet whitespaceCharacterSet] holds: the
+ Unicode space separators (general category Zs) and the tab. Line breaks are
+ not whitespace.
+ */
+
+
+#ifndef APPIGO_WHITESPACE_H
+#define APPIGO_WHITESPACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ Check whether a UTF-16 code unit is whitespace. There is no whitespace
+ outside the BMP.
+
+ @return Returns 1 for whitespace, 0 otherwise.
+ */
+int AppigoUnicharIsWhitespace(uint16_t character);
+
+/**
+ Find the part of UTF-8 encoded text without leading and trailing whitespace.
+ Invalid or truncated sequences are never whitespace.
+
+ @param bytes The UTF-8 bytes.
+ @param length The number of bytes.
+ @param start Receives the offset of the first byte to keep.
+ @param end Receives the offset after the last byte to keep, equal to start
+ if everything is whitespace.
+ */
+void AppigoUTF8TrimWhitespace(const uint8_t *bytes, size_t length, size_t *start, size_t *end);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
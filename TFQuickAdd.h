@@ -0,0 +1,21 @@
+#import <Foundation/Foundation.h>
+#import "AppigoPasteboard/AppigoTask.h"
+#import "TFQuickAddParser.h"
+
+// Builds AppigoTasks from the quick-add syntax described in TFQuickAddParser.h
+@interface TFQuickAdd : NSObject
+
+// Returns an autoreleased task for text. recognizedSyntax (optional) is set to
+// YES when anything beyond a plain name was found, in which case the task
+// needs to go through the pasteboard to keep its other properties.
++(AppigoTask *)taskFromText:(NSString *)text recognizedSyntax:(BOOL *)recognizedSyntax;
+
+// As above, and result (optional) is set to what the parser found, so that a
+// caller reusing the text later can recompute its relative due date. Its
+// nameLength is 0 when the text held nothing but syntax.
++(AppigoTask *)taskFromText:(NSString *)text result:(TFQuickAddResult *)result recognizedSyntax:(BOOL *)recognizedSyntax;
+
+// The due date of a parse result as of now, or nil without one
++(NSDate *)dueDateForResult:(const TFQuickAddResult *)result;
+
+@end
@@ -0,0 +1,194 @@
+#import "TFQuickAdd.h"
+
+#define kTFQuickAddStackBufferSize 256
+
+static NSString *TFStringFromSpan(const char *text, TFQuickAddSpan span){
+	if (span.length == 0)
+		return nil;
+
+	return [[[NSString alloc] initWithBytes:text + span.offset length:span.length encoding:NSUTF8StringEncoding] autorelease];
+}
+
+static NSString *TFWeekdayName(int weekday){
+	static NSString *const names[] = { @"Sunday", @"Monday", @"Tuesday", @"Wednesday", @"Thursday", @"Friday", @"Saturday" };
+	return (weekday >= 1 && weekday <= 7) ? names[weekday - 1] : nil;
+}
+
+@implementation TFQuickAdd
+
++(NSDate *)dueDateForResult:(const TFQuickAddResult *)result{
+	if (result->dueKind == TFQuickAddDueNone)
+		return nil;
+
+	NSCalendar *calendar = [NSCalendar currentCalendar];
+	NSDateComponents *today = [calendar components:NSYearCalendarUnit | NSMonthCalendarUnit | NSDayCalendarUnit | NSWeekdayCalendarUnit fromDate:[NSDate date]];
+	NSDateComponents *due = [[[NSDateComponents alloc] init] autorelease];
+	[due setYear:[today year]];
+	[due setMonth:[today month]];
+	[due setDay:[today day]];
+
+	switch (result->dueKind){
+		case TFQuickAddDueRelativeDays:
+			[due setDay:[today day] + result->dueDays];
+			break;
+
+		case TFQuickAddDueWeekday:
+			[due setDay:[today day] + (result->dueWeekday - [today weekday] + 7) % 7];
+			break;
+
+		case TFQuickAddDueDate:
+			[due setMonth:result->dueMonth];
+			[due setDay:result->dueDay];
+			if (result->dueYear > 0)
+				[due setYear:result->dueYear];
+
+			// A month and day that already passed this year means next year
+			else if (result->dueMonth < [today month] || (result->dueMonth == [today month] && result->dueDay < [today day]))
+				[due setYear:[today year] + 1];
+			break;
+
+		default:
+			break;
+	}
+
+	if (result->dueHasTime){
+		[due setHour:result->dueHour];
+		[due setMinute:result->dueMinute];
+	}
+
+	// NSCalendar normalizes day overflow ("today + 40")
+	return [calendar dateFromComponents:due];
+}
+
++(void)applyRepeatFromResult:(const TFQuickAddResult *)result toTask:(AppigoTask *)task{
+	int interval = result->repeatInterval;
+	NSInteger repeat = 0;
+	NSString *advancedRepeat = nil;
+
+	switch (result->repeatUnit){
+		case TFQuickAddRepeatDays:
+			if (interval == 1)
+				repeat = 4;
+			else
+				advancedRepeat = [NSString stringWithFormat:@"Every %d days", interval];
+			break;
+
+		case TFQuickAddRepeatWeeks:
+			if (interval == 1)
+				repeat = 1;
+			else if (interval == 2)
+				repeat = 5;
+			else
+				advancedRepeat = [NSString stringWithFormat:@"Every %d weeks", interval];
+			break;
+
+		case TFQuickAddRepeatMonths:
+			if (interval == 1)
+				repeat = 2;
+			else if (interval == 2)
+				repeat = 6;
+			else if (interval == 3)
+				repeat = 8;
+			else if (interval == 6)
+				repeat = 7;
+			else
+				advancedRepeat = [NSString stringWithFormat:@"Every %d months", interval];
+			break;
+
+		case TFQuickAddRepeatYears:
+			if (interval == 1)
+				repeat = 3;
+			else
+				advancedRepeat = [NSString stringWithFormat:@"Every %d years", interval];
+			break;
+
+		case TFQuickAddRepeatWeekdays:
+			advancedRepeat = @"Every Weekday";
+			break;
+
+		case TFQuickAddRepeatWeekends:
+			advancedRepeat = @"Every Weekend";
+			break;
+
+		case TFQuickAddRepeatDayOfWeek:
+			advancedRepeat = [NSString stringWithFormat:@"Every %@", TFWeekdayName(result->repeatWeekday)];
+			break;
+
+		default:
+			return;
+	}
+
+	if (advancedRepeat){
+		repeat = 50;
+		task.advancedRepeat = advancedRepeat;
+	}
+
+	task.repeat = repeat;
+}
+
++(AppigoTask *)taskFromText:(NSString *)text recognizedSyntax:(BOOL *)recognizedSyntax{
+	return [self taskFromText:text result:NULL recognizedSyntax:recognizedSyntax];
+}
+
++(AppigoTask *)taskFromText:(NSString *)text result:(TFQuickAddResult *)resultOut recognizedSyntax:(BOOL *)recognizedSyntax{
+	if (recognizedSyntax)
+		*recognizedSyntax = NO;
+
+	if (resultOut)
+		memset(resultOut, 0, sizeof(*resultOut));
+
+	const char *utf8 = [text UTF8String];
+	if (!utf8)
+		return [[[AppigoTask alloc] initWithName:nil] autorelease];
+
+	size_t length = strlen(utf8);
+	char stackBuffer[kTFQuickAddStackBufferSize];
+	char *nameBuffer = length < kTFQuickAddStackBufferSize ? stackBuffer : malloc(length + 1);
+	if (!nameBuffer)
+		return [[[AppigoTask alloc] initWithName:text] autorelease];
+
+	TFQuickAddResult result;
+	unsigned recognized = TFQuickAddParse(utf8, length, nameBuffer, &result);
+
+	NSString *name = recognized > 0 ? [[[NSString alloc] initWithBytes:nameBuffer length:result.nameLength encoding:NSUTF8StringEncoding] autorelease] : text;
+	if (nameBuffer != stackBuffer)
+		free(nameBuffer);
+
+	if (resultOut)
+		*resultOut = result;
+
+	AppigoTask *task = [[[AppigoTask alloc] initWithName:name] autorelease];
+	if (recognized == 0)
+		return task;
+
+	if (recognizedSyntax)
+		*recognizedSyntax = YES;
+
+	if (result.priority != TFQuickAddPriorityUnset)
+		task.priority = (AppigoTaskPriority)result.priority;
+
+	task.list = TFStringFromSpan(utf8, result.list);
+	task.context = TFStringFromSpan(utf8, result.context);
+
+	if (result.tagCount > 0){
+		NSMutableArray *tags = [NSMutableArray arrayWithCapacity:result.tagCount];
+		for (unsigned i = 0; i < result.tagCount; i++){
+			NSString *tag = TFStringFromSpan(utf8, result.tags[i]);
+			if (tag)
+				[tags addObject:tag];
+		}
+
+		task.tags = [tags componentsJoinedByString:@", "];
+	}
+
+	NSDate *dueDate = [self dueDateForResult:&result];
+	if (dueDate){
+		task.dueDate = dueDate;
+		task.dueDateHasTime = result.dueHasTime ? YES : NO;
+	}
+
+	[self applyRepeatFromResult:&result toTask:task];
+	return task;
+}
+
+@end
@@ -0,0 +1,455 @@
+/*
+ * TFQuickAddParser.c
+ *
+ * See TFQuickAddParser.h for the accepted syntax.
+ */
+
+#include "TFQuickAddParser.h"
+
+#include <string.h>
+
+typedef struct {
+	const char *text;
+	size_t length;
+	size_t position;
+} TFQuickAddScanner;
+
+typedef struct {
+	const char *start;
+	size_t length;
+} TFQuickAddToken;
+
+static int TFIsSpace(char c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static int TFIsDigit(char c){
+	return c >= '0' && c <= '9';
+}
+
+static char TFLower(char c){
+	return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+// Read the next whitespace separated token without consuming it
+static int TFPeekToken(const TFQuickAddScanner *scanner, TFQuickAddToken *token, size_t *end){
+	size_t i = scanner->position;
+	while (i < scanner->length && TFIsSpace(scanner->text[i]))
+		i++;
+
+	if (i >= scanner->length)
+		return 0;
+
+	size_t start = i;
+	while (i < scanner->length && !TFIsSpace(scanner->text[i]))
+		i++;
+
+	token->start = scanner->text + start;
+	token->length = i - start;
+	*end = i;
+	return 1;
+}
+
+static int TFNextToken(TFQuickAddScanner *scanner, TFQuickAddToken *token){
+	size_t end;
+	if (!TFPeekToken(scanner, token, &end))
+		return 0;
+
+	scanner->position = end;
+	return 1;
+}
+
+// Case-insensitive comparison against a lowercase ASCII word
+static int TFEquals(const char *s, size_t length, const char *word){
+	size_t i = 0;
+	for (; i < length; i++){
+		if (word[i] == '\0' || TFLower(s[i]) != word[i])
+			return 0;
+	}
+	return word[i] == '\0';
+}
+
+// Match against a NULL terminated list of words, returning its index or -1
+static int TFMatchWord(const char *s, size_t length, const char *const *words){
+	for (int i = 0; words[i]; i++){
+		if (TFEquals(s, length, words[i]))
+			return i;
+	}
+	return -1;
+}
+
+static int TFParseNumber(const char *s, size_t length, int *value){
+	if (length == 0 || length > 6)
+		return 0;
+
+	int number = 0;
+	for (size_t i = 0; i < length; i++){
+		if (!TFIsDigit(s[i]))
+			return 0;
+		number = number * 10 + (s[i] - '0');
+	}
+
+	*value = number;
+	return 1;
+}
+
+// Returns 1 (Sunday) ... 7 (Saturday) or 0
+static int TFParseWeekday(const char *s, size_t length){
+	static const char *const names[] = {
+		"sun", "sunday",
+		"mon", "monday",
+		"tue", "tues", "tuesday",
+		"wed", "wednesday",
+		"thu", "thur", "thurs", "thursday",
+		"fri", "friday",
+		"sat", "saturday",
+		NULL
+	};
+	static const int days[] = { 1, 1, 2, 2, 3, 3, 3, 4, 4, 5, 5, 5, 5, 6, 6, 7, 7 };
+
+	int index = TFMatchWord(s, length, names);
+	return index < 0 ? 0 : days[index];
+}
+
+// 5pm, 5:30pm, 17:00, noon, midnight
+static int TFParseTime(const char *s, size_t length, int *hour, int *minute){
+	if (TFEquals(s, length, "noon")){
+		*hour = 12;
+		*minute = 0;
+		return 1;
+	}
+	if (TFEquals(s, length, "midnight")){
+		*hour = 0;
+		*minute = 0;
+		return 1;
+	}
+
+	size_t i = 0;
+	int h = 0, m = 0, digits = 0;
+
+	while (i < length && TFIsDigit(s[i]) && digits < 2){
+		h = h * 10 + (s[i++] - '0');
+		digits++;
+	}
+	if (digits == 0)
+		return 0;
+
+	int hasMinutes = 0;
+	if (i < length && s[i] == ':'){
+		i++;
+		if (i + 2 > length || !TFIsDigit(s[i]) || !TFIsDigit(s[i + 1]))
+			return 0;
+		m = (s[i] - '0') * 10 + (s[i + 1] - '0');
+		i += 2;
+		hasMinutes = 1;
+	}
+
+	int meridiem = 0;	// 1 = am, 2 = pm
+	if (i < length){
+		if (TFEquals(s + i, length - i, "am") || TFEquals(s + i, length - i, "a"))
+			meridiem = 1;
+		else if (TFEquals(s + i, length - i, "pm") || TFEquals(s + i, length - i, "p"))
+			meridiem = 2;
+		else
+			return 0;
+	}
+
+	// A bare number is not a time ("due:today 5" is more likely part of the name)
+	if (!hasMinutes && !meridiem)
+		return 0;
+
+	if (m > 59)
+		return 0;
+
+	if (meridiem){
+		if (h < 1 || h > 12)
+			return 0;
+		if (h == 12)
+			h = 0;
+		if (meridiem == 2)
+			h += 12;
+	}
+	else if (h > 23)
+		return 0;
+
+	*hour = h;
+	*minute = m;
+	return 1;
+}
+
+// YYYY-MM-DD or M/D or M/D/YYYY
+static int TFParseCalendarDate(const char *s, size_t length, int *year, int *month, int *day){
+	int parts[3] = { 0, 0, 0 };
+	int count = 0, digits = 0;
+	char separator = 0;
+
+	for (size_t i = 0; i <= length; i++){
+		if (i < length && TFIsDigit(s[i])){
+			// A fourth part ("1-2-3-4") is never a date
+			if (count == 3 || ++digits > 4)
+				return 0;
+			parts[count] = parts[count] * 10 + (s[i] - '0');
+			continue;
+		}
+
+		if (digits == 0)
+			return 0;
+
+		if (i < length){
+			if (s[i] != '-' && s[i] != '/')
+				return 0;
+			if (separator && s[i] != separator)
+				return 0;
+			separator = s[i];
+		}
+
+		if (++count > 3)
+			return 0;
+		digits = 0;
+	}
+
+	if (separator == '-' && count == 3){
+		*year = parts[0];
+		*month = parts[1];
+		*day = parts[2];
+	}
+	else if (separator == '/' && (count == 2 || count == 3)){
+		*month = parts[0];
+		*day = parts[1];
+		*year = count == 3 ? parts[2] : 0;
+		if (*year > 0 && *year < 100)
+			*year += 2000;
+	}
+	else
+		return 0;
+
+	return *month >= 1 && *month <= 12 && *day >= 1 && *day <= 31;
+}
+
+static int TFParseDueDay(const char *s, size_t length, TFQuickAddResult *result){
+	int value;
+
+	if (TFEquals(s, length, "today") || TFEquals(s, length, "tod")){
+		result->dueKind = TFQuickAddDueRelativeDays;
+		result->dueDays = 0;
+		return 1;
+	}
+	if (TFEquals(s, length, "tomorrow") || TFEquals(s, length, "tom") || TFEquals(s, length, "tmr")){
+		result->dueKind = TFQuickAddDueRelativeDays;
+		result->dueDays = 1;
+		return 1;
+	}
+
+	int weekday = TFParseWeekday(s, length);
+	if (weekday){
+		result->dueKind = TFQuickAddDueWeekday;
+		result->dueWeekday = weekday;
+		return 1;
+	}
+
+	// +N, Nd, Nw
+	if (length >= 2 && s[0] == '+' && TFParseNumber(s + 1, length - 1, &value)){
+		result->dueKind = TFQuickAddDueRelativeDays;
+		result->dueDays = value;
+		return 1;
+	}
+	if (length >= 2 && (TFLower(s[length - 1]) == 'd' || TFLower(s[length - 1]) == 'w') && TFParseNumber(s, length - 1, &value)){
+		result->dueKind = TFQuickAddDueRelativeDays;
+		result->dueDays = TFLower(s[length - 1]) == 'w' ? value * 7 : value;
+		return 1;
+	}
+
+	if (TFParseCalendarDate(s, length, &result->dueYear, &result->dueMonth, &result->dueDay)){
+		result->dueKind = TFQuickAddDueDate;
+		return 1;
+	}
+
+	return 0;
+}
+
+// Consumes an optional "[at] <time>" following a due date
+static void TFParseDueTime(TFQuickAddScanner *scanner, TFQuickAddResult *result){
+	TFQuickAddScanner lookahead = *scanner;
+	TFQuickAddToken token;
+
+	if (!TFNextToken(&lookahead, &token))
+		return;
+
+	if (TFEquals(token.start, token.length, "at") && !TFNextToken(&lookahead, &token))
+		return;
+
+	if (TFParseTime(token.start, token.length, &result->dueHour, &result->dueMinute)){
+		result->dueHasTime = 1;
+		*scanner = lookahead;
+	}
+}
+
+// due:<day> [at] [<time>], the day may also be the next token ("due: friday")
+static int TFParseDue(TFQuickAddScanner *scanner, const TFQuickAddToken *token, TFQuickAddResult *result){
+	TFQuickAddScanner lookahead = *scanner;
+	TFQuickAddToken value = { token->start + 4, token->length - 4 };
+
+	if (value.length == 0 && !TFNextToken(&lookahead, &value))
+		return 0;
+
+	if (TFParseDueDay(value.start, value.length, result)){
+		*scanner = lookahead;
+		TFParseDueTime(scanner, result);
+		return 1;
+	}
+
+	// A time on its own means today
+	if (TFParseTime(value.start, value.length, &result->dueHour, &result->dueMinute)){
+		*scanner = lookahead;
+		result->dueKind = TFQuickAddDueRelativeDays;
+		result->dueDays = 0;
+		result->dueHasTime = 1;
+		return 1;
+	}
+
+	return 0;
+}
+
+// every [other|N] <unit>
+static int TFParseEvery(TFQuickAddScanner *scanner, TFQuickAddResult *result){
+	static const char *const units[] = {
+		"day", "days", "week", "weeks", "month", "months", "year", "years",
+		"weekday", "weekdays", "weekend", "weekends",
+		NULL
+	};
+	static const TFQuickAddRepeatUnit unitValues[] = {
+		TFQuickAddRepeatDays, TFQuickAddRepeatDays,
+		TFQuickAddRepeatWeeks, TFQuickAddRepeatWeeks,
+		TFQuickAddRepeatMonths, TFQuickAddRepeatMonths,
+		TFQuickAddRepeatYears, TFQuickAddRepeatYears,
+		TFQuickAddRepeatWeekdays, TFQuickAddRepeatWeekdays,
+		TFQuickAddRepeatWeekends, TFQuickAddRepeatWeekends
+	};
+
+	TFQuickAddScanner lookahead = *scanner;
+	TFQuickAddToken token;
+	int interval = 1;
+
+	if (!TFNextToken(&lookahead, &token))
+		return 0;
+
+	if (TFEquals(token.start, token.length, "other")){
+		interval = 2;
+		if (!TFNextToken(&lookahead, &token))
+			return 0;
+	}
+	else if (TFParseNumber(token.start, token.length, &interval)){
+		if (interval < 1 || !TFNextToken(&lookahead, &token))
+			return 0;
+	}
+
+	int unit = TFMatchWord(token.start, token.length, units);
+	if (unit >= 0){
+		result->repeatUnit = unitValues[unit];
+		result->repeatInterval = interval;
+		*scanner = lookahead;
+		return 1;
+	}
+
+	int weekday = TFParseWeekday(token.start, token.length);
+	if (weekday && interval == 1){
+		result->repeatUnit = TFQuickAddRepeatDayOfWeek;
+		result->repeatInterval = 1;
+		result->repeatWeekday = weekday;
+		*scanner = lookahead;
+		return 1;
+	}
+
+	return 0;
+}
+
+static int TFParsePriority(const TFQuickAddToken *token, TFQuickAddResult *result){
+	static const char *const names[] = {
+		"!!!", "!high", "!hi", "!h", "!1",
+		"!!", "!medium", "!med", "!m", "!2",
+		"!low", "!lo", "!l", "!3",
+		"!none", "!0",
+		NULL
+	};
+	static const TFQuickAddPriority values[] = {
+		TFQuickAddPriorityHigh, TFQuickAddPriorityHigh, TFQuickAddPriorityHigh, TFQuickAddPriorityHigh, TFQuickAddPriorityHigh,
+		TFQuickAddPriorityMedium, TFQuickAddPriorityMedium, TFQuickAddPriorityMedium, TFQuickAddPriorityMedium, TFQuickAddPriorityMedium,
+		TFQuickAddPriorityLow, TFQuickAddPriorityLow, TFQuickAddPriorityLow, TFQuickAddPriorityLow,
+		TFQuickAddPriorityNone, TFQuickAddPriorityNone
+	};
+
+	int index = TFMatchWord(token->start, token->length, names);
+	if (index < 0)
+		return 0;
+
+	result->priority = values[index];
+	return 1;
+}
+
+static TFQuickAddSpan TFSpanAfterSigil(const char *text, const TFQuickAddToken *token){
+	TFQuickAddSpan span = { (size_t)(token->start - text) + 1, token->length - 1 };
+	return span;
+}
+
+unsigned TFQuickAddParse(const char *text, size_t length, char *nameBuffer, TFQuickAddResult *result){
+	memset(result, 0, sizeof(*result));
+
+	TFQuickAddScanner scanner = { text, length, 0 };
+	TFQuickAddToken token;
+	size_t nameLength = 0;
+
+	while (TFNextToken(&scanner, &token)){
+		int recognized = 0;
+		char sigil = token.start[0];
+
+		if (token.length > 1){
+			switch (sigil){
+				case '!':
+					recognized = TFParsePriority(&token, result);
+					break;
+
+				case '#':
+					if (result->tagCount < TF_QUICKADD_MAX_TAGS){
+						result->tags[result->tagCount++] = TFSpanAfterSigil(text, &token);
+						recognized = 1;
+					}
+					break;
+
+				case '@':
+					result->context = TFSpanAfterSigil(text, &token);
+					recognized = 1;
+					break;
+
+				case '^':
+					result->list = TFSpanAfterSigil(text, &token);
+					recognized = 1;
+					break;
+
+				default:
+					break;
+			}
+		}
+
+		if (!recognized && token.length >= 4 && TFEquals(token.start, 4, "due:"))
+			recognized = TFParseDue(&scanner, &token, result);
+
+		if (!recognized && TFEquals(token.start, token.length, "every"))
+			recognized = TFParseEvery(&scanner, result);
+
+		if (recognized){
+			result->recognizedTokens++;
+			continue;
+		}
+
+		// Everything else is part of the name
+		if (nameLength > 0)
+			nameBuffer[nameLength++] = ' ';
+		memcpy(nameBuffer + nameLength, token.start, token.length);
+		nameLength += token.length;
+	}
+
+	nameBuffer[nameLength] = '\0';
+	result->nameLength = nameLength;
+
+	return result->recognizedTokens;
+}
@@ -0,0 +1,104 @@
+/*
+ * TFQuickAddParser.h
+ *
+ * Single pass parser for the inline syntax accepted by the TodoFast text
+ * field. Plain C with no Foundation dependency, so it can be built and
+ * exercised on any host.
+ *
+ *   Buy milk !high #errands @store ^Home due:tomorrow 5pm every 2 weeks
+ *
+ *   !high !med !low !none !1 !2 !3 !!! !!   priority
+ *   #tag                                    tag (repeatable)
+ *   @context                                context
+ *   ^list                                   list
+ *   due:<day> [at] [<time>]                 due date and optional time
+ *       day:  today, tomorrow, mon..sun, +N, Nd, Nw, YYYY-MM-DD, M/D[/YYYY]
+ *       time: 5pm, 5:30pm, 17:00, noon, midnight
+ *   every [other|N] <unit>                  repeat
+ *       unit: day(s), week(s), month(s), year(s), weekday, weekend
+ *   every <mon..sun>                        repeat weekly on that day
+ *
+ * Every word that is not part of a recognized token is kept, in order, as
+ * the task name.
+ */
+
+#ifndef TF_QUICKADD_PARSER_H
+#define TF_QUICKADD_PARSER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TF_QUICKADD_MAX_TAGS 16
+
+typedef enum {
+	TFQuickAddPriorityUnset = 0,
+	TFQuickAddPriorityHigh,
+	TFQuickAddPriorityMedium,
+	TFQuickAddPriorityLow,
+	TFQuickAddPriorityNone
+} TFQuickAddPriority;
+
+typedef enum {
+	TFQuickAddDueNone = 0,
+	TFQuickAddDueRelativeDays,	// dueDays from today
+	TFQuickAddDueWeekday,		// next dueWeekday (today included)
+	TFQuickAddDueDate			// dueYear/dueMonth/dueDay (dueYear 0 means this year)
+} TFQuickAddDueKind;
+
+typedef enum {
+	TFQuickAddRepeatNone = 0,
+	TFQuickAddRepeatDays,
+	TFQuickAddRepeatWeeks,
+	TFQuickAddRepeatMonths,
+	TFQuickAddRepeatYears,
+	TFQuickAddRepeatWeekdays,	// Monday through Friday
+	TFQuickAddRepeatWeekends,	// Saturday and Sunday
+	TFQuickAddRepeatDayOfWeek	// every repeatWeekday
+} TFQuickAddRepeatUnit;
+
+// A range of the parsed input
+typedef struct {
+	size_t offset;
+	size_t length;
+} TFQuickAddSpan;
+
+typedef struct {
+	size_t nameLength;				// name is written to the caller's buffer
+
+	TFQuickAddPriority priority;
+	TFQuickAddSpan list;
+	TFQuickAddSpan context;
+	TFQuickAddSpan tags[TF_QUICKADD_MAX_TAGS];
+	unsigned tagCount;
+
+	TFQuickAddDueKind dueKind;
+	int dueDays;
+	int dueWeekday;					// 1 = Sunday ... 7 = Saturday
+	int dueYear, dueMonth, dueDay;
+	int dueHasTime;
+	int dueHour, dueMinute;
+
+	TFQuickAddRepeatUnit repeatUnit;
+	int repeatInterval;
+	int repeatWeekday;				// 1 = Sunday ... 7 = Saturday
+
+	unsigned recognizedTokens;		// number of syntax tokens consumed
+} TFQuickAddResult;
+
+/*
+ * Parse length bytes of UTF-8 text. The task name (the remaining words
+ * joined by single spaces, NUL terminated) is written to nameBuffer, which
+ * must hold at least length + 1 bytes. Spans in the result point into text.
+ *
+ * Returns the number of recognized syntax tokens.
+ */
+unsigned TFQuickAddParse(const char *text, size_t length, char *nameBuffer, TFQuickAddResult *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,27 @@
+#import <libactivator/libactivator.h>
+#import <UIKit/UIKit.h>
+
+// Task templates, each registered as its own Activator listener. They are
+// read once from TFTemplatesPath, for example:
+//
+//   Templates = (
+//       { title = "Errand"; text = "^Home !high due:today"; },
+//       { title = "Call Mom"; text = "Call Mom @phone due:tomorrow 6pm"; }
+//   );
+//
+// text uses the quick-add syntax (see TFQuickAddParser.h). A template whose
+// text has no name asks for one when triggered, one with a name imports
+// right away. Relative due dates are recomputed for every import.
+@interface TFTemplates : NSObject <LAListener, UIAlertViewDelegate>{
+@private
+	NSDictionary *entries;			// listener name -> template dictionary from the file
+	NSMutableDictionary *templates;	// listener name -> TFTemplate, or NSNull if it failed, parsed and encoded on first use
+	UIAlertView *nameView;			// created on first use and reused for every nameless template
+	id pendingTemplate;				// the template nameView asks a name for
+}
+
+// Reads the template titles and registers a listener for each one. The
+// templates themselves are only parsed and encoded when first triggered.
++(void)registerTemplates;
+
+@end
@@ -0,0 +1,169 @@
+#import "TFTemplates.h"
+#import "TFQuickAdd.h"
+#import "AppigoPasteboard/AppigoPasteboard.h"
+#import "AppigoPasteboard/AppigoTaskTemplate.h"
+
+#define TFTemplatesPath @"/var/mobile/Library/Preferences/com.insanj.todofast.templates.plist"
+#define TFTemplatesListenerPrefix @"libactivator.todofast.template."
+
+// One template, parsed and encoded the first time it is triggered
+@interface TFTemplate : NSObject{
+@public
+	NSString *title;
+	AppigoTaskTemplate *taskTemplate;
+	TFQuickAddResult result;	// only the due date fields are used, the spans point into text that is gone
+	BOOL hasName;
+}
+@end
+
+@implementation TFTemplate
+
+-(void)dealloc{
+	[title release];
+	[taskTemplate release];
+	[super dealloc];
+}
+
+@end
+
+@implementation TFTemplates
+
+-(id)initWithContentsOfFile:(NSString *)path{
+	if ((self = [super init])){
+		NSArray *list = [[NSDictionary dictionaryWithContentsOfFile:path] objectForKey:@"Templates"];
+		NSMutableDictionary *loaded = [NSMutableDictionary dictionaryWithCapacity:[list count]];
+
+		for (NSDictionary *entry in list){
+			if (![entry isKindOfClass:[NSDictionary class]])
+				continue;
+
+			NSString *entryTitle = [entry objectForKey:@"title"];
+			if (![entryTitle isKindOfClass:[NSString class]] || [entryTitle length] == 0 || ![[entry objectForKey:@"text"] isKindOfClass:[NSString class]])
+				continue;
+
+			[loaded setObject:entry forKey:[TFTemplatesListenerPrefix stringByAppendingString:entryTitle]];
+		}//end for
+
+		entries = [loaded copy];
+	}
+
+	return self;
+}
+
+-(TFTemplate *)templateForListenerName:(NSString *)listenerName{
+	TFTemplate *template = [templates objectForKey:listenerName];
+	if (template)
+		return template != (id)[NSNull null] ? template : nil;
+
+	NSDictionary *entry = [entries objectForKey:listenerName];
+	if (!entry)
+		return nil;
+
+	template = [[[TFTemplate alloc] init] autorelease];
+	AppigoTask *task = [TFQuickAdd taskFromText:[entry objectForKey:@"text"] result:&template->result recognizedSyntax:NULL];
+	template->title = [[entry objectForKey:@"title"] copy];
+	template->hasName = template->result.nameLength > 0;	// task.name is never empty, it falls back to a placeholder
+	template->taskTemplate = [[AppigoTaskTemplate alloc] initWithTask:task];
+
+	if (!templates)
+		templates = [[NSMutableDictionary alloc] initWithCapacity:[entries count]];
+
+	// Remembered either way, the file is only read once so a failure is final
+	if (!template->taskTemplate){
+		NSLog(@"TodoFast: unable to encode template %@", template->title);
+		[templates setObject:[NSNull null] forKey:listenerName];
+		return nil;
+	}
+
+	[templates setObject:template forKey:listenerName];
+	return template;
+}
+
+-(void)importTemplate:(TFTemplate *)template name:(NSString *)name{
+	// Only the name and due date are spliced into the encoded template
+	[AppigoPasteboard openTodoWithTaskTemplate:template->taskTemplate name:name dueDate:[TFQuickAdd dueDateForResult:&template->result] completion:nil];
+}
+
+-(BOOL)dismiss{
+	if (pendingTemplate){
+		[nameView dismissWithClickedButtonIndex:[nameView cancelButtonIndex] animated:YES];
+		return YES;
+	}
+
+	return NO;
+}
+
+-(void)alertView:(UIAlertView *)alertView willDismissWithButtonIndex:(NSInteger)buttonIndex{
+	TFTemplate *template = [pendingTemplate autorelease];
+	pendingTemplate = nil;
+
+	if (template && buttonIndex != [alertView cancelButtonIndex])
+		[self importTemplate:template name:[alertView textFieldAtIndex:0].text];
+}//end method
+
+-(void)activator:(LAActivator *)activator receiveEvent:(LAEvent *)event forListenerName:(NSString *)listenerName{
+	if ([self dismiss])
+		return;
+
+	TFTemplate *template = [self templateForListenerName:listenerName];
+	if (!template)
+		return;
+
+	if (template->hasName)
+		[self importTemplate:template name:nil];
+
+	else{
+		if (!nameView){
+			nameView = [[UIAlertView alloc] initWithTitle:nil message:nil delegate:self cancelButtonTitle:@"Cancel" otherButtonTitles:@"Create", nil];
+			[nameView setAlertViewStyle:UIAlertViewStylePlainTextInput];
+			[[nameView textFieldAtIndex:0] setPlaceholder:@"Task Name"];
+		}
+
+		[nameView setTitle:template->title];
+		[[nameView textFieldAtIndex:0] setText:nil];
+		pendingTemplate = [template retain];
+		[nameView show];
+	}//end else
+
+	[event setHandled:YES];
+}
+
+-(void)activator:(LAActivator *)activator abortEvent:(LAEvent *)event forListenerName:(NSString *)listenerName{
+	[self dismiss];
+}
+
+-(void)activator:(LAActivator *)activator otherListenerDidHandleEvent:(LAEvent *)event forListenerName:(NSString *)listenerName{
+	[self dismiss];
+}
+
+-(NSString *)activator:(LAActivator *)activator requiresLocalizedTitleForListenerName:(NSString *)listenerName{
+	return [[entries objectForKey:listenerName] objectForKey:@"title"];
+}
+
+-(NSString *)activator:(LAActivator *)activator requiresLocalizedDescriptionForListenerName:(NSString *)listenerName{
+	return @"Create an Appigo Todo task from a template";
+}
+
+-(NSString *)activator:(LAActivator *)activator requiresLocalizedGroupForListenerName:(NSString *)listenerName{
+	return @"TodoFast";
+}
+
+-(void)dealloc{
+	[entries release];
+	[templates release];
+	[nameView release];
+	[pendingTemplate release];
+	[super dealloc];
+}
+
++(void)registerTemplates{
+	TFTemplates *listener = [[self alloc] initWithContentsOfFile:TFTemplatesPath];
+	for (NSString *listenerName in listener->entries)
+		[[LAActivator sharedInstance] registerListener:listener forName:listenerName];
+
+	// Activator does not retain its listeners
+	if ([listener->entries count] == 0)
+		[listener release];
+}
+
+@end
@@ -0,0 +1,93 @@
+/*
+ * AppigoCompressionBenchmark.c
+ *
+ * Times the compression path of a pasteboard payload, AppigoLZEncode plus the
+ * CRC of the frame, and the way back, on keyed archive flavoured payloads
+ * from a single task up to a big project. "break even" is the copy rate below
+ * which compressing pays for itself: the bytes saved over the time both
+ * directions take. Run with "make -C tests bench".
+ */
+
+#include "AppigoLZ.h"
+#include "AppigoChecksum.h"
+#include "TFBenchmark.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kAppigoBenchmarkBytes (256 * 1024 * 1024)
+
+static void TFFillPayload(uint8_t *bytes, size_t length){
+	static const char *const words[] = {
+		"$class", "NSMutableString", "name", "note", "dueDate", "list", "Inbox", "context",
+		"@errands", "#weekly", "Buy milk", "Call mom", "AppigoTask", "subtasks", "\n", " "
+	};
+	size_t offset = 0;
+
+	srand(1);
+	while (offset < length){
+		const char *word = words[rand() % (sizeof(words) / sizeof(words[0]))];
+		size_t wordLength = strlen(word);
+		if (wordLength > length - offset)
+			wordLength = length - offset;
+		memcpy(bytes + offset, word, wordLength);
+		offset += wordLength;
+
+		if ( (offset < length) && (rand() % 4 == 0) )
+			bytes[offset++] = (uint8_t)('a' + rand() % 26);
+	}
+}
+
+int main(void){
+	static const size_t lengths[] = { 256, 1024, 4096, 16384, 65536, 262144, 1048576, 4194304 };
+
+	size_t largest = lengths[sizeof(lengths) / sizeof(lengths[0]) - 1];
+	uint8_t *input = malloc(largest);
+	uint8_t *block = malloc(largest + largest / 255 + 16);
+	uint8_t *output = malloc(largest);
+	uint32_t sink = 0;
+
+	TFFillPayload(input, largest);
+
+	printf("%8s %7s %12s %12s %12s %12s\n", "bytes", "ratio", "compress", "decompress", "memcpy", "break even");
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++){
+		size_t length = lengths[i];
+		long iterations = kAppigoBenchmarkBytes / 4 / (long)length;
+		size_t blockLength = 0;
+
+		double start = TFBenchmarkNow();
+		for (long iteration = 0; iteration < iterations; iteration++){
+			blockLength = AppigoLZEncode(input, length, block, largest + largest / 255 + 16);
+			sink += AppigoCRC32(0, input, length);
+		}
+		double compress = (TFBenchmarkNow() - start) / iterations;
+
+		start = TFBenchmarkNow();
+		for (long iteration = 0; iteration < iterations; iteration++){
+			sink += (uint32_t)AppigoLZDecode(block, blockLength, output, length);
+			sink += AppigoCRC32(0, output, length);
+		}
+		double decompress = (TFBenchmarkNow() - start) / iterations;
+
+		start = TFBenchmarkNow();
+		for (long iteration = 0; iteration < iterations; iteration++){
+			memcpy(output, input, length);
+			__asm__ __volatile__("" : : "r"(output) : "memory");
+		}
+		double copy = (TFBenchmarkNow() - start) / iterations;
+
+		if (memcmp(output, input, length) != 0)
+			return 1;
+
+		printf("%8zu %6.1f%% %7.1f MB/s %7.1f MB/s %7.0f MB/s %7.1f MB/s\n",
+			   length, 100.0 * blockLength / length,
+			   length / compress / 1e6, length / decompress / 1e6, length / copy / 1e6,
+			   (double)(length - blockLength) / (compress + decompress) / 1e6);
+	}
+
+	free(output);
+	free(block);
+	free(input);
+
+	return sink == 0;
+}
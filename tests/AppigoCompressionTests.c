@@ -0,0 +1,205 @@
+/*
+ * AppigoCompressionTests.c
+ *
+ * Round trips of the LZ block codec on text, repetitive and random bytes,
+ * encoding into too small buffers, and decoding damaged blocks, which must
+ * fail without touching memory outside the buffers. Also the checksums the
+ * compression frame and the binary coding rely on.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "TFTest.h"
+#include "AppigoLZ.h"
+#include "AppigoChecksum.h"
+
+// Enough room for a block of bytes that do not compress at all
+static size_t TFWorstCase(size_t length){
+	return length + length / 255 + 16;
+}
+
+// Keyed archive flavoured text, like the payloads that get compressed
+static void TFFillText(uint8_t *bytes, size_t length, unsigned seed){
+	static const char *const words[] = {
+		"$class", "NSMutableString", "name", "note", "dueDate", "list", "Inbox", "context",
+		"@errands", "#weekly", "Buy milk", "Call mom", "AppigoTask", "subtasks", "\n", " "
+	};
+	size_t offset = 0;
+
+	srand(seed);
+	while (offset < length){
+		const char *word = words[rand() % (sizeof(words) / sizeof(words[0]))];
+		size_t wordLength = strlen(word);
+		if (wordLength > length - offset)
+			wordLength = length - offset;
+		memcpy(bytes + offset, word, wordLength);
+		offset += wordLength;
+
+		if ( (offset < length) && (rand() % 4 == 0) )
+			bytes[offset++] = (uint8_t)('a' + rand() % 26);
+	}
+}
+
+static void TFFillRandom(uint8_t *bytes, size_t length, unsigned seed){
+	srand(seed);
+	for (size_t i = 0; i < length; i++)
+		bytes[i] = (uint8_t)rand();
+}
+
+// Encodes into a buffer of exactly the worst case size and decodes into one of
+// exactly length bytes, so ASan catches any access past either
+static int TFRoundTrips(const uint8_t *input, size_t length, size_t *blockLength){
+	size_t capacity = TFWorstCase(length);
+	uint8_t *block = malloc(capacity);
+	uint8_t *output = malloc(length ? length : 1);
+
+	*blockLength = AppigoLZEncode(input, length, block, capacity);
+	int ok = (*blockLength > 0) && (AppigoLZDecode(block, *blockLength, output, length) == 1) && (memcmp(output, input, length) == 0);
+
+	free(output);
+	free(block);
+
+	return ok;
+}
+
+static void TFTestChecksums(void){
+	TF_EXPECT(AppigoCRC32(0, "", 0) == 0);
+	TF_EXPECT(AppigoCRC32(0, "123456789", 9) == 0xCBF43926u);
+	TF_EXPECT(AppigoCRC32(0, "The quick brown fox jumps over the lazy dog", 43) == 0x414FA339u);
+
+	// In pieces, as the binary coding checksums its sections
+	uint32_t crc = AppigoCRC32(0, "1234", 4);
+	TF_EXPECT(AppigoCRC32(crc, "56789", 5) == 0xCBF43926u);
+
+	TF_EXPECT(AppigoFNV1a64("", 0) == 0xCBF29CE484222325ull);
+	TF_EXPECT(AppigoFNV1a64("a", 1) == 0xAF63DC4C8601EC8Cull);
+	TF_EXPECT(AppigoFNV1a64("foobar", 6) == 0x85944171F73967E8ull);
+}
+
+static void TFTestRoundTrips(void){
+	static const size_t lengths[] = { 1, 4, 5, 9, 13, 15, 16, 17, 64, 255, 256, 270, 1000, 4096, 65535, 65536, 70000, 300000 };
+	size_t blockLength;
+
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++){
+		size_t length = lengths[i];
+		uint8_t *input = malloc(length);
+
+		TFFillText(input, length, (unsigned)i);
+		TF_EXPECT(TFRoundTrips(input, length, &blockLength));
+		if (length >= 4096)
+			TF_EXPECT(blockLength < length / 2);
+
+		TFFillRandom(input, length, (unsigned)i);
+		TF_EXPECT(TFRoundTrips(input, length, &blockLength));
+
+		// Long runs need extra length bytes for both literals and matches
+		memset(input, 'x', length);
+		TF_EXPECT(TFRoundTrips(input, length, &blockLength));
+		if (length >= 4096)
+			TF_EXPECT(blockLength < length / 100);
+
+		free(input);
+	}
+
+	// The empty input is a single empty sequence
+	uint8_t block[16];
+	TF_EXPECT(AppigoLZEncode((const uint8_t *)"", 0, block, sizeof(block)) == 1);
+	TF_EXPECT(AppigoLZDecode(block, 1, block + 8, 0) == 1);
+
+	// Matches further back than 64 KB are not used
+	size_t length = 200000;
+	uint8_t *input = malloc(length);
+	TFFillRandom(input, 70000, 99);
+	memcpy(input + 70000, input, 70000);
+	TFFillRandom(input + 140000, length - 140000, 100);
+	TF_EXPECT(TFRoundTrips(input, length, &blockLength));
+	free(input);
+}
+
+static void TFTestSmallCapacity(void){
+	size_t length = 4096;
+	uint8_t *input = malloc(length);
+	TFFillRandom(input, length, 5);
+
+	// Random bytes never fit in less room than they take up
+	for (size_t capacity = 0; capacity < length; capacity += 97){
+		uint8_t *block = malloc(capacity ? capacity : 1);
+		TF_EXPECT(AppigoLZEncode(input, length, block, capacity) == 0);
+		free(block);
+	}
+
+	// Text either fits whole or not at all, whatever the room
+	TFFillText(input, length, 6);
+	uint8_t *block = malloc(TFWorstCase(length));
+	size_t blockLength = AppigoLZEncode(input, length, block, TFWorstCase(length));
+	free(block);
+
+	int bad = 0;
+	for (size_t capacity = 0; capacity <= TFWorstCase(length); capacity++){
+		block = malloc(capacity ? capacity : 1);
+		size_t result = AppigoLZEncode(input, length, block, capacity);
+		if ( (result != 0) && ((result != blockLength) || (capacity < blockLength)) )
+			bad++;
+		free(block);
+	}
+	TF_EXPECT(bad == 0);
+
+	free(input);
+}
+
+static void TFTestDamaged(void){
+	size_t length = 2048;
+	uint8_t *input = malloc(length);
+	uint8_t *output = malloc(length);
+	uint8_t *block = malloc(TFWorstCase(length));
+
+	TFFillText(input, length, 11);
+	size_t blockLength = AppigoLZEncode(input, length, block, TFWorstCase(length));
+
+	// Every truncation, and the wrong original length either way
+	int bad = 0;
+	for (size_t cut = 0; cut < blockLength; cut++){
+		uint8_t *truncated = malloc(cut ? cut : 1);
+		memcpy(truncated, block, cut);
+		if (AppigoLZDecode(truncated, cut, output, length) != 0)
+			bad++;
+		free(truncated);
+	}
+	TF_EXPECT(bad == 0);
+	TF_EXPECT(AppigoLZDecode(block, blockLength, output, length - 1) == 0);
+	TF_EXPECT(AppigoLZDecode(block, blockLength, output, length) == 1);
+
+	uint8_t *longer = malloc(length + 1);
+	TF_EXPECT(AppigoLZDecode(block, blockLength, longer, length + 1) == 0);
+	free(longer);
+
+	// Flipped bytes and plain noise may decode to garbage, but only inside the buffers
+	srand(12);
+	uint8_t *damaged = malloc(blockLength);
+	for (int round = 0; round < 20000; round++){
+		memcpy(damaged, block, blockLength);
+		for (int flips = 1 + rand() % 4; flips > 0; flips--)
+			damaged[rand() % blockLength] = (uint8_t)rand();
+		AppigoLZDecode(damaged, blockLength, output, length);
+	}
+	for (int round = 0; round < 20000; round++){
+		size_t noiseLength = 1 + (size_t)(rand() % 64);
+		TFFillRandom(damaged, noiseLength < blockLength ? noiseLength : blockLength, (unsigned)round);
+		AppigoLZDecode(damaged, noiseLength < blockLength ? noiseLength : blockLength, output, (size_t)(rand() % (int)length));
+	}
+
+	free(damaged);
+	free(block);
+	free(output);
+	free(input);
+}
+
+int main(void){
+	TFTestChecksums();
+	TFTestRoundTrips();
+	TFTestSmallCapacity();
+	TFTestDamaged();
+
+	return TFTestFinish("AppigoCompressionTests");
+}
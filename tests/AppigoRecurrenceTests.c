@@ -0,0 +1,293 @@
+/*
+ * AppigoRecurrenceTests.c
+ *
+ * Compiling repeat values and advanced repeat strings, and expanding the
+ * rules into occurrences, including month ends, leap years and invalid input.
+ */
+
+#include <stdint.h>
+
+#include "TFTest.h"
+#include "AppigoRecurrenceRule.h"
+
+#define TF_DAY(year, month, day) AppigoRecurrenceDayFromCivil((year), (month), (day))
+
+static int TFCompile(long repeat, const char *advanced, AppigoRecurrenceRule *rule){
+	return AppigoRecurrenceCompileRepeat(repeat, advanced, advanced ? strlen(advanced) : 0, rule);
+}
+
+static int TFCompileAdvanced(const char *text, AppigoRecurrenceRule *rule){
+	return AppigoRecurrenceCompileAdvanced(text, strlen(text), rule);
+}
+
+// Expands rule from anchor and compares with the expected epoch days
+static int TFExpandsTo(const AppigoRecurrenceRule *rule, int32_t anchor, const int32_t *expected, size_t count){
+	int32_t days[16];
+	if (AppigoRecurrenceExpand(rule, anchor, days, count) != count)
+		return 0;
+
+	for (size_t i = 0; i < count; i++){
+		if (days[i] != expected[i])
+			return 0;
+	}
+
+	return 1;
+}
+
+static void TFTestCalendar(void){
+	TF_EXPECT(TF_DAY(1970, 1, 1) == 0);
+	TF_EXPECT(TF_DAY(2000, 3, 1) == 11017);
+	TF_EXPECT(TF_DAY(2024, 1, 1) == 19723);
+	TF_EXPECT(TF_DAY(1969, 12, 31) == -1);
+
+	// 2000 is a leap year, 1900 and 2100 are not
+	TF_EXPECT(TF_DAY(2000, 3, 1) - TF_DAY(2000, 2, 28) == 2);
+	TF_EXPECT(TF_DAY(1900, 3, 1) - TF_DAY(1900, 2, 28) == 1);
+	TF_EXPECT(TF_DAY(2100, 3, 1) - TF_DAY(2100, 2, 28) == 1);
+	TF_EXPECT(TF_DAY(2024, 3, 1) - TF_DAY(2024, 2, 28) == 2);
+
+	TF_EXPECT(AppigoRecurrenceWeekdayFromDay(0) == 4);					// Thursday
+	TF_EXPECT(AppigoRecurrenceWeekdayFromDay(TF_DAY(2024, 1, 1)) == 1);	// Monday
+	TF_EXPECT(AppigoRecurrenceWeekdayFromDay(-1) == 3);
+
+	// Round trips over four centuries, both sides of the epoch
+	int mismatches = 0;
+	for (int32_t epochDay = TF_DAY(1800, 1, 1); epochDay <= TF_DAY(2200, 12, 31); epochDay++){
+		int32_t year;
+		uint32_t month, day;
+		AppigoRecurrenceCivilFromDay(epochDay, &year, &month, &day);
+		if (TF_DAY(year, month, day) != epochDay || month < 1 || month > 12 || day < 1 || day > 31)
+			mismatches++;
+	}
+	TF_EXPECT(mismatches == 0);
+}
+
+static void TFTestRepeatCodes(void){
+	AppigoRecurrenceRule rule;
+
+	TF_EXPECT(TFCompile(0, NULL, &rule) && rule.kind == AppigoRecurrenceKindNone);
+	TF_EXPECT(TFCompile(1, NULL, &rule) && rule.kind == AppigoRecurrenceKindWeekly && rule.interval == 1 && rule.weekdayMask == 0);
+	TF_EXPECT(TFCompile(2, NULL, &rule) && rule.kind == AppigoRecurrenceKindMonthly && rule.interval == 1);
+	TF_EXPECT(TFCompile(3, NULL, &rule) && rule.kind == AppigoRecurrenceKindYearly && rule.interval == 1);
+	TF_EXPECT(TFCompile(4, NULL, &rule) && rule.kind == AppigoRecurrenceKindDaily && rule.interval == 1);
+	TF_EXPECT(TFCompile(5, NULL, &rule) && rule.kind == AppigoRecurrenceKindWeekly && rule.interval == 2);
+	TF_EXPECT(TFCompile(6, NULL, &rule) && rule.kind == AppigoRecurrenceKindMonthly && rule.interval == 2);
+	TF_EXPECT(TFCompile(7, NULL, &rule) && rule.kind == AppigoRecurrenceKindMonthly && rule.interval == 6);
+	TF_EXPECT(TFCompile(8, NULL, &rule) && rule.kind == AppigoRecurrenceKindMonthly && rule.interval == 3);
+	TF_EXPECT(TFCompile(9, NULL, &rule) && rule.kind == AppigoRecurrenceKindWithParent);
+	TF_EXPECT(rule.fromCompletion == 0);
+
+	TF_EXPECT(TFCompile(104, NULL, &rule) && rule.kind == AppigoRecurrenceKindDaily && rule.fromCompletion == 1);
+	TF_EXPECT(TFCompile(150, "every 3 days", &rule) && rule.kind == AppigoRecurrenceKindDaily && rule.interval == 3 && rule.fromCompletion == 1);
+	TF_EXPECT(TFCompile(50, "Every Weekday", &rule) && rule.weekdayMask == kAppigoRecurrenceWeekdays && rule.fromCompletion == 0);
+
+	// Validating only
+	TF_EXPECT(TFCompile(3, NULL, NULL));
+
+	// Invalid codes leave the rule alone
+	static const long invalid[] = { -1, -100, 10, 49, 51, 99, 100, 110, 149, 151, 200 };
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++){
+		rule.kind = 0xAA;
+		TF_EXPECT(!TFCompile(invalid[i], "every day", &rule));
+		TF_EXPECT(rule.kind == 0xAA);
+	}
+
+	// Advanced without a string, or with one that does not parse
+	TF_EXPECT(!TFCompile(50, NULL, &rule));
+	TF_EXPECT(!TFCompile(150, NULL, &rule));
+	TF_EXPECT(!TFCompile(50, "", &rule));
+	TF_EXPECT(!TFCompile(50, "whenever", &rule));
+}
+
+static void TFTestAdvanced(void){
+	AppigoRecurrenceRule rule;
+
+	TF_EXPECT(TFCompileAdvanced("every day", &rule) && rule.kind == AppigoRecurrenceKindDaily && rule.interval == 1);
+	TF_EXPECT(TFCompileAdvanced("  EVERY   12  Days ", &rule) && rule.kind == AppigoRecurrenceKindDaily && rule.interval == 12);
+	TF_EXPECT(TFCompileAdvanced("every other week", &rule) && rule.kind == AppigoRecurrenceKindWeekly && rule.interval == 2);
+	TF_EXPECT(TFCompileAdvanced("every 999 years", &rule) && rule.kind == AppigoRecurrenceKindYearly && rule.interval == 999);
+	TF_EXPECT(TFCompileAdvanced("every month", &rule) && rule.kind == AppigoRecurrenceKindMonthly);
+
+	TF_EXPECT(TFCompileAdvanced("every monday, wednesday and fri", &rule) && rule.kind == AppigoRecurrenceKindWeekly);
+	TF_EXPECT(rule.weekdayMask == (kAppigoRecurrenceMonday | kAppigoRecurrenceWednesday | kAppigoRecurrenceFriday));
+	TF_EXPECT(TFCompileAdvanced("every weekend", &rule) && rule.weekdayMask == kAppigoRecurrenceWeekend);
+	TF_EXPECT(TFCompileAdvanced("every 2 Tuesdays", &rule) && rule.interval == 2 && rule.weekdayMask == kAppigoRecurrenceTuesday);
+
+	TF_EXPECT(TFCompileAdvanced("on the 2nd thursday of the month", &rule) && rule.kind == AppigoRecurrenceKindMonthlyByWeekday);
+	TF_EXPECT(rule.ordinal == 2 && rule.weekday == 4);
+	TF_EXPECT(TFCompileAdvanced("on the last sun of every month", &rule) && rule.ordinal == -1 && rule.weekday == 0);
+	TF_EXPECT(TFCompileAdvanced("on fifth saturday", &rule) && rule.ordinal == 5 && rule.weekday == 6);
+
+	static const char *invalid[] = {
+		"", "   ", ",", "every", "every other", "every 0 days", "every 1000 days", "every 12345 days",
+		"every -1 days", "every day please", "every funday", "every and", "daily",
+		"on the", "on the 6th monday", "on the first funday", "on the 1st monday of the year",
+		"on the 1st monday of some month", "on the 1st monday of the month again",
+		"every mon tue wed thu fri sat sun mon tue wed thu fri sat sun mon tue",
+		"every supercalifragilistic day"
+	};
+	for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++){
+		TF_EXPECT(!TFCompileAdvanced(invalid[i], &rule));
+		if (TFCompileAdvanced(invalid[i], &rule))
+			fprintf(stderr, "  accepted \"%s\"\n", invalid[i]);
+	}
+
+	// Only length bytes are read
+	TF_EXPECT(AppigoRecurrenceCompileAdvanced("every day and then some", 9, &rule) && rule.kind == AppigoRecurrenceKindDaily);
+	TF_EXPECT(!AppigoRecurrenceCompileAdvanced(NULL, 0, &rule));
+}
+
+static void TFTestExpandSimple(void){
+	AppigoRecurrenceRule rule;
+	int32_t days[4];
+	int32_t anchor = TF_DAY(2024, 1, 1);
+
+	TFCompile(4, NULL, &rule);
+	int32_t daily[] = { anchor + 1, anchor + 2, anchor + 3 };
+	TF_EXPECT(TFExpandsTo(&rule, anchor, daily, 3));
+
+	TFCompileAdvanced("every 3 days", &rule);
+	int32_t everyThird[] = { anchor + 3, anchor + 6 };
+	TF_EXPECT(TFExpandsTo(&rule, anchor, everyThird, 2));
+
+	TFCompile(5, NULL, &rule);
+	int32_t biweekly[] = { anchor + 14, anchor + 28 };
+	TF_EXPECT(TFExpandsTo(&rule, anchor, biweekly, 2));
+
+	// Nothing to expand
+	TFCompile(0, NULL, &rule);
+	TF_EXPECT(AppigoRecurrenceExpand(&rule, anchor, days, 4) == 0);
+	TFCompile(9, NULL, &rule);
+	TF_EXPECT(AppigoRecurrenceExpand(&rule, anchor, days, 4) == 0);
+	TFCompile(4, NULL, &rule);
+	TF_EXPECT(AppigoRecurrenceExpand(&rule, anchor, days, 0) == 0);
+}
+
+static void TFTestExpandWeekdays(void){
+	AppigoRecurrenceRule rule;
+
+	// 2024-01-01 is a Monday, the anchor itself is never an occurrence
+	TFCompileAdvanced("every monday and wednesday", &rule);
+	int32_t mondayWednesday[] = { TF_DAY(2024, 1, 3), TF_DAY(2024, 1, 8), TF_DAY(2024, 1, 10), TF_DAY(2024, 1, 15) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 1), mondayWednesday, 4));
+
+	TFCompileAdvanced("every 2 tuesdays", &rule);
+	int32_t everyOtherTuesday[] = { TF_DAY(2024, 1, 2), TF_DAY(2024, 1, 16), TF_DAY(2024, 1, 30) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 1), everyOtherTuesday, 3));
+
+	// Friday, across a year boundary
+	TFCompileAdvanced("every weekday", &rule);
+	int32_t weekdays[] = { TF_DAY(2024, 1, 1), TF_DAY(2024, 1, 2), TF_DAY(2024, 1, 3) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2023, 12, 29), weekdays, 3));
+}
+
+static void TFTestExpandMonthEnds(void){
+	AppigoRecurrenceRule rule;
+
+	// The 31st falls on the last day of shorter months, then comes back
+	TFCompile(2, NULL, &rule);
+	int32_t leapYear[] = { TF_DAY(2024, 2, 29), TF_DAY(2024, 3, 31), TF_DAY(2024, 4, 30), TF_DAY(2024, 5, 31) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 31), leapYear, 4));
+	int32_t commonYear[] = { TF_DAY(2023, 2, 28), TF_DAY(2023, 3, 31) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2023, 1, 31), commonYear, 2));
+	int32_t century[] = { TF_DAY(1900, 2, 28), TF_DAY(2000, 2, 29) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(1900, 1, 30), century, 1));
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2000, 1, 30), century + 1, 1));
+
+	// Quarterly and every six months from the 31st
+	TFCompile(8, NULL, &rule);
+	int32_t quarterly[] = { TF_DAY(2024, 11, 30), TF_DAY(2025, 2, 28), TF_DAY(2025, 5, 31) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 8, 31), quarterly, 3));
+	TFCompile(7, NULL, &rule);
+	int32_t semiannual[] = { TF_DAY(2024, 2, 29), TF_DAY(2024, 8, 31) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2023, 8, 31), semiannual, 2));
+
+	// February 29th falls on the 28th until the next leap year
+	TFCompile(3, NULL, &rule);
+	int32_t leapDay[] = { TF_DAY(2025, 2, 28), TF_DAY(2026, 2, 28), TF_DAY(2027, 2, 28), TF_DAY(2028, 2, 29) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 2, 29), leapDay, 4));
+	// 2100 is not a leap year, and the 28th sticks once the anchor moved to it
+	TFCompileAdvanced("every 4 years", &rule);
+	int32_t acrossCentury[] = { TF_DAY(2100, 2, 28), TF_DAY(2104, 2, 28) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2096, 2, 29), acrossCentury, 1));
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2100, 2, 28), acrossCentury + 1, 1));
+
+	// Before the epoch
+	TFCompile(2, NULL, &rule);
+	int32_t beforeEpoch[] = { TF_DAY(1969, 2, 28), TF_DAY(1969, 3, 31) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(1969, 1, 31), beforeEpoch, 2));
+}
+
+static void TFTestExpandOrdinalWeekdays(void){
+	AppigoRecurrenceRule rule;
+
+	// Later in the anchor's month still counts
+	TFCompileAdvanced("on the 2nd thursday", &rule);
+	int32_t secondThursday[] = { TF_DAY(2024, 1, 11), TF_DAY(2024, 2, 8), TF_DAY(2024, 3, 14) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 1), secondThursday, 3));
+
+	TFCompileAdvanced("on the last monday", &rule);
+	int32_t lastMonday[] = { TF_DAY(2024, 1, 29), TF_DAY(2024, 2, 26), TF_DAY(2024, 3, 25) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 1), lastMonday, 3));
+
+	// Months without a fifth Friday are skipped
+	TFCompileAdvanced("on the fifth friday of each month", &rule);
+	int32_t fifthFriday[] = { TF_DAY(2024, 3, 29), TF_DAY(2024, 5, 31), TF_DAY(2024, 8, 30), TF_DAY(2024, 11, 29) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 1, 1), fifthFriday, 4));
+
+	// The last Thursday of February in a leap year and the year after
+	TFCompileAdvanced("on the last thursday", &rule);
+	int32_t lastThursday[] = { TF_DAY(2024, 2, 29), TF_DAY(2024, 3, 28) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2024, 2, 1), lastThursday, 2));
+	int32_t lastThursdayCommon[] = { TF_DAY(2025, 2, 27) };
+	TF_EXPECT(TFExpandsTo(&rule, TF_DAY(2025, 2, 1), lastThursdayCommon, 1));
+
+	// Every occurrence is on the right weekday and in the right week
+	int bad = 0;
+	for (int weekday = 0; weekday < 7; weekday++){
+		for (int ordinal = -1; ordinal <= 5; ordinal++){
+			if (ordinal == 0)
+				continue;
+
+			rule.kind = AppigoRecurrenceKindMonthlyByWeekday;
+			rule.interval = 1;
+			rule.weekday = (uint8_t)weekday;
+			rule.ordinal = (int8_t)ordinal;
+
+			int32_t days[16];
+			size_t count = AppigoRecurrenceExpand(&rule, TF_DAY(2023, 12, 31), days, 16);
+			if (count != 16)
+				bad++;
+
+			for (size_t i = 0; i < count; i++){
+				int32_t year;
+				uint32_t month, day;
+				AppigoRecurrenceCivilFromDay(days[i], &year, &month, &day);
+
+				uint32_t week = (day - 1) / 7 + 1;
+				uint32_t daysLeft = (uint32_t)(TF_DAY(month == 12 ? year + 1 : year, month == 12 ? 1 : month + 1, 1) - days[i]);
+				if (AppigoRecurrenceWeekdayFromDay(days[i]) != (uint32_t)weekday)
+					bad++;
+				if (ordinal > 0 && week != (uint32_t)ordinal)
+					bad++;
+				if (ordinal < 0 && daysLeft > 7)
+					bad++;
+				if (i > 0 && days[i] <= days[i - 1])
+					bad++;
+			}
+		}
+	}
+	TF_EXPECT(bad == 0);
+}
+
+int main(void){
+	TFTestCalendar();
+	TFTestRepeatCodes();
+	TFTestAdvanced();
+	TFTestExpandSimple();
+	TFTestExpandWeekdays();
+	TFTestExpandMonthEnds();
+	TFTestExpandOrdinalWeekdays();
+
+	return TFTestFinish("AppigoRecurrenceTests");
+}
@@ -0,0 +1,147 @@
+/*
+ * AppigoStringTableBenchmark.c
+ *
+ * Times the string pool's table against creating a string, for the values a
+ * decode looks up. Creating a string is stood in for by what it has to do at
+ * least, allocating and converting the UTF-8 to UTF-16, so the savings on a
+ * device, where NSString adds an object allocation, are larger. Run with
+ * "make -C tests bench".
+ */
+
+#include "AppigoStringTable.h"
+#include "TFBenchmark.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kAppigoBenchmarkLookups (4 * 1000 * 1000)
+
+static size_t _sink;
+
+// Allocates and decodes to UTF-16 like -[NSString initWithBytes:length:encoding:]
+__attribute__((noinline)) static void TFCreateString(const uint8_t *bytes, size_t length){
+	uint16_t *characters = malloc(length * sizeof(uint16_t) + 1);
+	size_t count = 0;
+
+	for (size_t i = 0; i < length; ){
+		uint8_t lead = bytes[i];
+		if (lead < 0x80){
+			characters[count++] = lead;
+			i++;
+		}
+		else if ( (lead < 0xE0) && (i + 1 < length) ){
+			characters[count++] = (uint16_t)(((lead & 0x1F) << 6) | (bytes[i + 1] & 0x3F));
+			i += 2;
+		}
+		else if (i + 2 < length){
+			characters[count++] = (uint16_t)(((lead & 0x0F) << 12) | ((bytes[i + 1] & 0x3F) << 6) | (bytes[i + 2] & 0x3F));
+			i += 3;
+		}
+		else
+			break;
+	}
+
+	_sink += characters[count / 2];
+	__asm__ __volatile__("" : : "r"(characters) : "memory");
+	free(characters);
+}
+
+__attribute__((noinline)) static const void *TFPoolLookup(const AppigoStringTable *table, const uint8_t *bytes, size_t length){
+	return AppigoStringTableLookup(table, bytes, length, AppigoStringTableHash(bytes, length));
+}
+
+static void TFFill(uint8_t *bytes, size_t length, size_t seed){
+	for (size_t i = 0; i < length; i++)
+		bytes[i] = (uint8_t)('a' + (i * 7 + seed * 13) % 26);
+}
+
+// A hit against a small pool, by value length
+static void TFBenchmarkLengths(void){
+	static const size_t lengths[] = { 5, 16, 64, 256, 1024, 4096 };
+	static uint8_t values[8][4096];
+	static const int value = 1;
+
+	printf("%-16s %10s %10s\n", "value length", "pool hit", "create");
+	for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++){
+		size_t length = lengths[i];
+		AppigoStringTable table = { 0 };
+
+		for (size_t v = 0; v < 8; v++){
+			TFFill(values[v], length, v);
+			AppigoStringTableAdd(&table, values[v], length, AppigoStringTableHash(values[v], length), &value, 4096);
+		}
+
+		double start = TFBenchmarkNow();
+		for (long lookup = 0; lookup < kAppigoBenchmarkLookups; lookup++)
+			_sink += (TFPoolLookup(&table, values[lookup & 7], length) != NULL);
+		double hit = (TFBenchmarkNow() - start) * 1e9 / kAppigoBenchmarkLookups;
+
+		start = TFBenchmarkNow();
+		for (long lookup = 0; lookup < kAppigoBenchmarkLookups; lookup++)
+			TFCreateString(values[lookup & 7], length);
+		double create = (TFBenchmarkNow() - start) * 1e9 / kAppigoBenchmarkLookups;
+
+		printf("%10zu bytes %7.1f ns %7.1f ns\n", length, hit, create);
+		AppigoStringTableFree(&table);
+	}
+}
+
+// Hits spread over every value of pools of growing size, and values that are
+// never shared, which pay for the lookup and the add on top of the string,
+// including growing the table into fresh pages
+static void TFBenchmarkCounts(void){
+	static const size_t counts[] = { 64, 512, 4096, 32768 };
+	static const int value = 1;
+	size_t largest = counts[sizeof(counts) / sizeof(counts[0]) - 1];
+	char (*values)[16] = malloc(largest * 2 * sizeof(*values));
+
+	for (size_t v = 0; v < largest * 2; v++)
+		snprintf(values[v], sizeof(values[v]), "Project %zu", v);
+
+	printf("\n%-16s %10s %10s %10s\n", "pool size", "pool hit", "unique", "create");
+	for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++){
+		size_t count = counts[i];
+		AppigoStringTable table = { 0 };
+
+		for (size_t v = 0; v < count; v++){
+			const uint8_t *bytes = (const uint8_t *)values[v];
+			AppigoStringTableAdd(&table, bytes, strlen(values[v]), AppigoStringTableHash(bytes, strlen(values[v])), &value, largest);
+		}
+
+		double start = TFBenchmarkNow();
+		for (long lookup = 0; lookup < kAppigoBenchmarkLookups; lookup++){
+			const char *text = values[(size_t)lookup % count];
+			_sink += (TFPoolLookup(&table, (const uint8_t *)text, strlen(text)) != NULL);
+		}
+		double hit = (TFBenchmarkNow() - start) * 1e9 / kAppigoBenchmarkLookups;
+
+		// Values not in the pool yet, each created and added
+		start = TFBenchmarkNow();
+		for (size_t v = count; v < count * 2; v++){
+			const uint8_t *bytes = (const uint8_t *)values[v];
+			size_t length = strlen(values[v]);
+			if (TFPoolLookup(&table, bytes, length) == NULL){
+				TFCreateString(bytes, length);
+				AppigoStringTableAdd(&table, bytes, length, AppigoStringTableHash(bytes, length), &value, largest * 2);
+			}
+		}
+		double unique = (TFBenchmarkNow() - start) * 1e9 / count;
+
+		start = TFBenchmarkNow();
+		for (size_t v = count; v < count * 2; v++)
+			TFCreateString((const uint8_t *)values[v], strlen(values[v]));
+		double create = (TFBenchmarkNow() - start) * 1e9 / count;
+
+		printf("%10zu values %6.1f ns %7.1f ns %7.1f ns\n", count, hit, unique, create);
+		AppigoStringTableFree(&table);
+	}
+
+	free(values);
+}
+
+int main(void){
+	TFBenchmarkLengths();
+	TFBenchmarkCounts();
+
+	return _sink == 0;
+}
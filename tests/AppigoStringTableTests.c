@@ -0,0 +1,120 @@
+/*
+ * AppigoStringTableTests.c
+ *
+ * The string pool's hash table: adding and finding values, equal bytes
+ * sharing one entry, probing past colliding hashes, growth, and the entry
+ * limit.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "TFTest.h"
+#include "AppigoStringTable.h"
+
+static const void *TFAdd(AppigoStringTable *table, const char *text, const void *value, size_t maximumCount){
+	return AppigoStringTableAdd(table, (const uint8_t *)text, strlen(text), AppigoStringTableHash((const uint8_t *)text, strlen(text)), value, maximumCount);
+}
+
+static const void *TFLookup(const AppigoStringTable *table, const char *text){
+	return AppigoStringTableLookup(table, (const uint8_t *)text, strlen(text), AppigoStringTableHash((const uint8_t *)text, strlen(text)));
+}
+
+static void TFTestAddAndLookup(void){
+	static const int inbox, work, errands, other;
+	AppigoStringTable table = { 0 };
+
+	TF_EXPECT(TFLookup(&table, "Inbox") == NULL);
+
+	TF_EXPECT(TFAdd(&table, "Inbox", &inbox, 16) == &inbox);
+	TF_EXPECT(TFAdd(&table, "Work", &work, 16) == &work);
+	TF_EXPECT(TFAdd(&table, "@errands", &errands, 16) == &errands);
+	TF_EXPECT(table.count == 3);
+
+	TF_EXPECT(TFLookup(&table, "Inbox") == &inbox);
+	TF_EXPECT(TFLookup(&table, "Work") == &work);
+	TF_EXPECT(TFLookup(&table, "@errands") == &errands);
+	TF_EXPECT(TFLookup(&table, "inbox") == NULL);
+	TF_EXPECT(TFLookup(&table, "Inbo") == NULL);
+	TF_EXPECT(TFLookup(&table, "") == NULL);
+
+	// Equal bytes keep the value that was added first
+	TF_EXPECT(TFAdd(&table, "Inbox", &other, 16) == &inbox);
+	TF_EXPECT(table.count == 3);
+
+	// The empty value is a value like any other
+	TF_EXPECT(TFAdd(&table, "", &other, 16) == &other);
+	TF_EXPECT(TFLookup(&table, "") == &other);
+
+	// UTF-8 is compared byte for byte
+	TF_EXPECT(TFAdd(&table, "caf\xC3\xA9", &work, 16) == &work);
+	TF_EXPECT(TFLookup(&table, "cafe\xCC\x81") == NULL);
+
+	AppigoStringTableFree(&table);
+	TF_EXPECT(table.count == 0 && table.entries == NULL && table.bytes == NULL);
+	TF_EXPECT(TFLookup(&table, "Inbox") == NULL);
+}
+
+static void TFTestCollisions(void){
+	static const int values[8];
+	AppigoStringTable table = { 0 };
+	char text[16];
+
+	// Every value under the same hash, so each one probes past all the others
+	for (int i = 0; i < 8; i++){
+		snprintf(text, sizeof(text), "v%d", i);
+		TF_EXPECT(AppigoStringTableAdd(&table, (const uint8_t *)text, strlen(text), 42, &values[i], 16) == &values[i]);
+	}
+
+	int bad = 0;
+	for (int i = 0; i < 8; i++){
+		snprintf(text, sizeof(text), "v%d", i);
+		if (AppigoStringTableLookup(&table, (const uint8_t *)text, strlen(text), 42) != &values[i])
+			bad++;
+	}
+	TF_EXPECT(bad == 0);
+	TF_EXPECT(AppigoStringTableLookup(&table, (const uint8_t *)"v8", 2, 42) == NULL);
+
+	AppigoStringTableFree(&table);
+}
+
+static void TFTestGrowthAndLimit(void){
+	enum { count = 5000 };
+	static int values[count];
+	AppigoStringTable table = { 0 };
+	char text[32];
+
+	for (int i = 0; i < count; i++){
+		snprintf(text, sizeof(text), "Project %d", i);
+		TF_EXPECT(TFAdd(&table, text, &values[i], 4096) == (i < 4096 ? &values[i] : NULL));
+	}
+	TF_EXPECT(table.count == 4096);
+	TF_EXPECT(table.count * 2 <= table.capacity);
+
+	int bad = 0;
+	for (int i = 0; i < count; i++){
+		snprintf(text, sizeof(text), "Project %d", i);
+		if (TFLookup(&table, text) != (i < 4096 ? &values[i] : NULL))
+			bad++;
+	}
+	TF_EXPECT(bad == 0);
+
+	// A full table still finds what it holds when asked to add it again
+	TF_EXPECT(TFAdd(&table, "Project 7", &values[0], 4096) == NULL);
+	TF_EXPECT(TFLookup(&table, "Project 7") == &values[7]);
+
+	AppigoStringTableFree(&table);
+
+	// A limit of 0 never adds
+	TF_EXPECT(TFAdd(&table, "Inbox", &values[0], 0) == NULL);
+	TF_EXPECT(table.entries == NULL);
+}
+
+int main(void){
+	TFTestAddAndLookup();
+	TFTestCollisions();
+	TFTestGrowthAndLimit();
+
+	return TFTestFinish("AppigoStringTableTests");
+}
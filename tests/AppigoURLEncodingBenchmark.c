@@ -0,0 +1,43 @@
+/*
+ * AppigoURLEncodingBenchmark.c
+ *
+ * Times AppigoURLEncodeBytes on task names and pasteboard names. Run with
+ * "make -C tests bench".
+ */
+
+#include "AppigoURLEncoding.h"
+#include "TFBenchmark.h"
+
+#include <string.h>
+
+#define kAppigoBenchmarkBytes (256 * 1024 * 1024)
+
+int main(void){
+	static const char *const inputs[] = {
+		"com.appigo.pasteboard.com.apple.springboard",
+		"Buy milk and eggs",
+		"Milk & eggs = breakfast? #1 / 100%",
+		"\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E\xE3\x81\xAE\xE3\x82\xBF\xE3\x82\xB9\xE3\x82\xAF caf\xC3\xA9",
+		NULL
+	};
+
+	char out[1024];
+	unsigned sink = 0;
+
+	for (int i = 0; inputs[i]; i++){
+		size_t length = strlen(inputs[i]);
+		long iterations = kAppigoBenchmarkBytes / (long)length;
+		double start = TFBenchmarkNow();
+
+		for (long iteration = 0; iteration < iterations; iteration++){
+			char *end = AppigoURLEncodeBytes(out, (const uint8_t *)inputs[i], length);
+			sink += (unsigned)(end - out);
+		}
+
+		double elapsed = TFBenchmarkNow() - start;
+		printf("%8.1f ns/call  %7.1f MB/s  %3zu bytes  \"%s\"\n",
+			   elapsed * 1e9 / iterations, (double)iterations * length / elapsed / 1e6, length, inputs[i]);
+	}
+
+	return sink == 0xFFFFFFFF;
+}
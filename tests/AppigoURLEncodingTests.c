@@ -0,0 +1,141 @@
+/*
+ * AppigoURLEncodingTests.c
+ *
+ * Correctness tests for the query component encoder used by
+ * AppigoURLBuilder. Run with "make -C tests".
+ */
+
+#include "AppigoURLEncoding.h"
+#include "TFTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kAppigoFuzzIterations 20000
+
+// Encodes text into a NUL terminated string
+static const char *AppigoEncode(const char *text, char *out){
+	char *end = AppigoURLEncodeBytes(out, (const uint8_t *)text, strlen(text));
+	*end = '\0';
+	return out;
+}
+
+static int AppigoHexValue(char c){
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+// Returns the decoded length, or -1 for anything the encoder must not produce
+static long AppigoDecode(const char *encoded, size_t length, uint8_t *out){
+	size_t decoded = 0;
+	for (size_t i = 0; i < length; i++){
+		if (encoded[i] != '%'){
+			out[decoded++] = (uint8_t)encoded[i];
+			continue;
+		}
+
+		if (i + 2 >= length)
+			return -1;
+		int high = AppigoHexValue(encoded[i + 1]);
+		int low = AppigoHexValue(encoded[i + 2]);
+		if (high < 0 || low < 0)
+			return -1;
+
+		out[decoded++] = (uint8_t)(high << 4 | low);
+		i += 2;
+	}
+	return (long)decoded;
+}
+
+static int AppigoIsUnreserved(int c){
+	return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static void AppigoTestUnreserved(void){
+	char out[512];
+	const char *unreserved = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-._~";
+	TF_EXPECT_STRING(AppigoEncode(unreserved, out), unreserved);
+	TF_EXPECT_STRING(AppigoEncode("", out), "");
+}
+
+static void AppigoTestReserved(void){
+	char out[512];
+	TF_EXPECT_STRING(AppigoEncode("a b", out), "a%20b");
+	TF_EXPECT_STRING(AppigoEncode("Milk & eggs", out), "Milk%20%26%20eggs");
+	TF_EXPECT_STRING(AppigoEncode("a=b+c", out), "a%3Db%2Bc");
+	TF_EXPECT_STRING(AppigoEncode("#1?/%", out), "%231%3F%2F%25");
+	TF_EXPECT_STRING(AppigoEncode(":@!$'()*,;[]", out), "%3A%40%21%24%27%28%29%2A%2C%3B%5B%5D");
+	TF_EXPECT_STRING(AppigoEncode("\"<>\\^`{|}", out), "%22%3C%3E%5C%5E%60%7B%7C%7D");
+	TF_EXPECT_STRING(AppigoEncode("\t\r\n\x7F", out), "%09%0D%0A%7F");
+}
+
+static void AppigoTestUnicode(void){
+	char out[512];
+	TF_EXPECT_STRING(AppigoEncode("caf\xC3\xA9", out), "caf%C3%A9");
+	TF_EXPECT_STRING(AppigoEncode("\xE6\x97\xA5\xE6\x9C\xAC", out), "%E6%97%A5%E6%9C%AC");
+	TF_EXPECT_STRING(AppigoEncode("\xF0\x9F\x9B\x92 list", out), "%F0%9F%9B%92%20list");
+}
+
+// Every byte value on its own, against the RFC 3986 rules
+static void AppigoTestEveryByte(void){
+	for (int c = 0; c < 256; c++){
+		uint8_t byte = (uint8_t)c;
+		char out[4];
+		char *end = AppigoURLEncodeBytes(out, &byte, 1);
+
+		if (AppigoIsUnreserved(c)){
+			TF_EXPECT(end - out == 1 && out[0] == (char)c);
+		}
+		else{
+			TF_EXPECT(end - out == 3 && out[0] == '%');
+			TF_EXPECT(AppigoHexValue(out[1]) == c >> 4 && AppigoHexValue(out[2]) == (c & 0x0F));
+		}
+	}
+}
+
+// AppigoURLBuilder copies the raw value to the end of the buffer and
+// encodes it in place, which has to match encoding into a separate buffer
+static void AppigoTestInPlace(void){
+	srand(2);
+	for (int iteration = 0; iteration < kAppigoFuzzIterations; iteration++){
+		size_t length = (size_t)(rand() % 300);
+		uint8_t *raw = malloc(length ? length : 1);
+		for (size_t i = 0; i < length; i++)
+			raw[i] = (uint8_t)rand();
+
+		size_t capacity = (kAppigoURLEncodedBytesPerByte + 1) * length;
+		char *separate = malloc(capacity ? capacity : 1);
+		char *shared = malloc(capacity ? capacity : 1);
+
+		char *separateEnd = AppigoURLEncodeBytes(separate, raw, length);
+		uint8_t *sharedRaw = (uint8_t *)shared + kAppigoURLEncodedBytesPerByte * length;
+		memcpy(sharedRaw, raw, length);
+		char *sharedEnd = AppigoURLEncodeBytes(shared, sharedRaw, length);
+
+		size_t encodedLength = (size_t)(separateEnd - separate);
+		TF_EXPECT(sharedEnd - shared == separateEnd - separate);
+		TF_EXPECT(memcmp(shared, separate, encodedLength) == 0);
+
+		uint8_t *decoded = malloc(encodedLength ? encodedLength : 1);
+		long decodedLength = AppigoDecode(separate, encodedLength, decoded);
+		TF_EXPECT(decodedLength == (long)length && memcmp(decoded, raw, length) == 0);
+
+		free(raw);
+		free(separate);
+		free(shared);
+		free(decoded);
+	}
+}
+
+int main(void){
+	AppigoTestUnreserved();
+	AppigoTestReserved();
+	AppigoTestUnicode();
+	AppigoTestEveryByte();
+	AppigoTestInPlace();
+
+	return TFTestFinish("AppigoURLEncodingTests");
+}
@@ -0,0 +1,95 @@
+/*
+ * AppigoWhitespaceBenchmark.c
+ *
+ * Times AppigoUTF8TrimWhitespace on field-sized text, next to the same
+ * kernel without the eight-space word skip, and a full forward scan like
+ * the one the fields used to go through. Run with "make -C tests bench".
+ */
+
+#include "AppigoWhitespace.h"
+#include "TFBenchmark.h"
+
+#include <string.h>
+
+#define kAppigoBenchmarkCalls (20 * 1000 * 1000)
+
+// Byte at a time from both ends, ASCII only, to show what the word skip buys
+__attribute__((noinline)) static void TFTrimBytes(const uint8_t *bytes, size_t length, size_t *start, size_t *end){
+	size_t s = 0, e = length;
+	while (s < e && (bytes[s] == ' ' || bytes[s] == '\t'))
+		s++;
+	while (e > s && (bytes[e - 1] == ' ' || bytes[e - 1] == '\t'))
+		e--;
+	*start = s;
+	*end = e;
+}
+
+// Visits every byte, like a scan that copies or validates the whole field
+__attribute__((noinline)) static void TFTrimFullScan(const uint8_t *bytes, size_t length, size_t *start, size_t *end){
+	size_t s = length, e = length;
+	for (size_t i = 0; i < length; i++){
+		if (bytes[i] != ' ' && bytes[i] != '\t'){
+			if (s == length)
+				s = i;
+			e = i + 1;
+		}
+	}
+	if (s == length)
+		e = s;
+	*start = s;
+	*end = e;
+}
+
+typedef void (*TFTrim)(const uint8_t *, size_t, size_t *, size_t *);
+
+static double TFTime(TFTrim trim, const uint8_t *bytes, size_t length, long calls, size_t *sink){
+	double start = TFBenchmarkNow();
+
+	for (long call = 0; call < calls; call++){
+		size_t s, e;
+		trim(bytes, length, &s, &e);
+		*sink += e - s;
+		__asm__ __volatile__("" : : "r"(bytes) : "memory");
+	}
+
+	return (TFBenchmarkNow() - start) * 1e9 / calls;
+}
+
+int main(void){
+	static char note[4096 + 1];
+	memset(note, 'n', 4096);
+
+	static char padded[128 + 8 + 1];
+	memset(padded, ' ', 128 + 8);
+	memcpy(padded + 64, "Buy milk", 8);
+
+	static const struct {
+		const char *label;
+		const char *text;
+	} inputs[] = {
+		{ "trimmed name", "Buy milk" },
+		{ "two spaces each side", "  Buy milk  " },
+		{ "64 spaces each side", padded },
+		{ "no-break spaces", "\xC2\xA0\xC2\xA0" "caf\xC3\xA9" "\xE3\x80\x80" },
+		{ "trimmed 4 KB note", note },
+		{ NULL, NULL }
+	};
+
+	size_t sink = 0;
+
+	printf("%-22s %10s %10s %10s\n", "", "kernel", "no skip", "full scan");
+	for (int i = 0; inputs[i].text; i++){
+		const uint8_t *bytes = (const uint8_t *)inputs[i].text;
+		size_t length = strlen(inputs[i].text);
+		long calls = length > 1024 ? kAppigoBenchmarkCalls / 20 : kAppigoBenchmarkCalls;
+
+		double kernel = TFTime(AppigoUTF8TrimWhitespace, bytes, length, calls, &sink);
+		double bytewise = TFTime(TFTrimBytes, bytes, length, calls, &sink);
+		double fullScan = TFTime(TFTrimFullScan, bytes, length, calls, &sink);
+
+		printf("%-22s %7.1f ns %7.1f ns %7.1f ns  %4zu bytes\n", inputs[i].label, kernel, bytewise, fullScan, length);
+	}
+	printf("(no skip and full scan only know ASCII whitespace)\n");
+
+	return sink == 0;
+}
@@ -0,0 +1,180 @@
+/*
+ * AppigoWhitespaceTests.c
+ *
+ * The whitespace test against the Unicode space separators, and the UTF-8
+ * trimming kernel against a plain forward decoder, on hand picked and
+ * generated text.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "TFTest.h"
+#include "AppigoWhitespace.h"
+
+// Unicode general category Zs, plus the tab
+static int TFIsSpaceSeparator(uint32_t c){
+	return c == 0x09 || c == 0x20 || c == 0xA0 || c == 0x1680 || (c >= 0x2000 && c <= 0x200A) || c == 0x202F || c == 0x205F || c == 0x3000;
+}
+
+// Decodes one character of valid UTF-8, the generated text is always valid
+static size_t TFDecode(const uint8_t *bytes, uint32_t *c){
+	if (bytes[0] < 0x80){
+		*c = bytes[0];
+		return 1;
+	}
+	if (bytes[0] < 0xE0){
+		*c = ((uint32_t)(bytes[0] & 0x1F) << 6) | (bytes[1] & 0x3F);
+		return 2;
+	}
+	if (bytes[0] < 0xF0){
+		*c = ((uint32_t)(bytes[0] & 0x0F) << 12) | ((uint32_t)(bytes[1] & 0x3F) << 6) | (bytes[2] & 0x3F);
+		return 3;
+	}
+	*c = ((uint32_t)(bytes[0] & 0x07) << 18) | ((uint32_t)(bytes[1] & 0x3F) << 12) | ((uint32_t)(bytes[2] & 0x3F) << 6) | (bytes[3] & 0x3F);
+	return 4;
+}
+
+// Trims by decoding every character from the front
+static void TFReferenceTrim(const uint8_t *bytes, size_t length, size_t *start, size_t *end){
+	*start = length;
+	*end = length;
+
+	int seenText = 0;
+	size_t i = 0;
+	while (i < length){
+		uint32_t c;
+		size_t sequenceLength = TFDecode(bytes + i, &c);
+		if (!TFIsSpaceSeparator(c)){
+			if (!seenText)
+				*start = i;
+			seenText = 1;
+			*end = i + sequenceLength;
+		}
+		i += sequenceLength;
+	}
+
+	if (!seenText)
+		*end = *start;
+}
+
+static int TFTrimsTo(const char *text, const char *expected){
+	size_t start, end;
+	AppigoUTF8TrimWhitespace((const uint8_t *)text, strlen(text), &start, &end);
+	return end - start == strlen(expected) && memcmp(text + start, expected, end - start) == 0;
+}
+
+static void TFTestCharacters(void){
+	int mismatches = 0;
+	for (uint32_t c = 0; c <= 0xFFFF; c++){
+		if (AppigoUnicharIsWhitespace((uint16_t)c) != TFIsSpaceSeparator(c))
+			mismatches++;
+	}
+	TF_EXPECT(mismatches == 0);
+
+	// Line breaks are not whitespace
+	TF_EXPECT(!AppigoUnicharIsWhitespace('\n'));
+	TF_EXPECT(!AppigoUnicharIsWhitespace('\r'));
+	TF_EXPECT(!AppigoUnicharIsWhitespace(0x2028));
+	TF_EXPECT(!AppigoUnicharIsWhitespace(0x200B));	// zero width space is a format character
+}
+
+static void TFTestTrim(void){
+	TF_EXPECT(TFTrimsTo("", ""));
+	TF_EXPECT(TFTrimsTo(" ", ""));
+	TF_EXPECT(TFTrimsTo(" \t \t ", ""));
+	TF_EXPECT(TFTrimsTo("Buy milk", "Buy milk"));
+	TF_EXPECT(TFTrimsTo("  Buy  milk \t", "Buy  milk"));
+	TF_EXPECT(TFTrimsTo("\nBuy milk\n", "\nBuy milk\n"));
+	TF_EXPECT(TFTrimsTo("                    x                    ", "x"));
+
+	// No-break, ideographic and hair spaces
+	TF_EXPECT(TFTrimsTo("\xC2\xA0" "caf\xC3\xA9" "\xC2\xA0", "caf\xC3\xA9"));
+	TF_EXPECT(TFTrimsTo("\xE3\x80\x80\xE3\x80\x80\xE6\x97\xA5\xE3\x80\x80", "\xE6\x97\xA5"));
+	TF_EXPECT(TFTrimsTo("\xE2\x80\x8A a \xE2\x80\x8A", "a"));
+	TF_EXPECT(TFTrimsTo("\xC2\xA0\xE3\x80\x80 \t", ""));
+
+	// Characters that only look empty, and ones outside the BMP, are kept
+	TF_EXPECT(TFTrimsTo("\xE2\x80\x8B" "a", "\xE2\x80\x8B" "a"));
+	TF_EXPECT(TFTrimsTo(" \xF0\x9F\x8D\xBC ", "\xF0\x9F\x8D\xBC"));
+	TF_EXPECT(TFTrimsTo("\xC3\xA9 ", "\xC3\xA9"));
+
+	// Invalid or cut short sequences are not whitespace
+	TF_EXPECT(TFTrimsTo(" \xC2", "\xC2"));
+	TF_EXPECT(TFTrimsTo("\xA0 ", "\xA0"));
+	TF_EXPECT(TFTrimsTo(" \xE3\x80", "\xE3\x80"));
+	TF_EXPECT(TFTrimsTo("\xC0\xA0", "\xC0\xA0"));			// overlong space
+	TF_EXPECT(TFTrimsTo("\xE0\x82\xA0", "\xE0\x82\xA0"));	// overlong no-break space
+	TF_EXPECT(TFTrimsTo("a\x80\xC2\xA0", "a\x80"));
+
+	// Only length bytes are read
+	size_t start, end;
+	AppigoUTF8TrimWhitespace((const uint8_t *)" ab  cd", 4, &start, &end);
+	TF_EXPECT(start == 1 && end == 3);
+}
+
+// Runs of spaces of every length around the word skipping boundary
+static void TFTestSpaceRuns(void){
+	char text[64];
+	int bad = 0;
+
+	for (int leading = 0; leading < 24; leading++){
+		for (int trailing = 0; trailing < 24; trailing++){
+			for (int word = 0; word < 3; word++){
+				memset(text, ' ', sizeof(text));
+				memcpy(text + leading, "xyz", (size_t)word);
+				size_t length = (size_t)(leading + word + trailing);
+
+				size_t start, end;
+				AppigoUTF8TrimWhitespace((const uint8_t *)text, length, &start, &end);
+				if (word == 0 ? (start != end) : (start != (size_t)leading || end != (size_t)(leading + word)))
+					bad++;
+			}
+		}
+	}
+
+	TF_EXPECT(bad == 0);
+}
+
+static void TFTestGenerated(void){
+	static const char *const pieces[] = {
+		" ", "\t", "\n", "a", "Z", ".", "\xC2\xA0", "\xC3\xA9", "\xE3\x80\x80", "\xE2\x80\x80",
+		"\xE2\x80\x8A", "\xE2\x80\x8B", "\xE6\x97\xA5", "\xE1\x9A\x80", "\xF0\x9F\x8D\xBC", "        "
+	};
+
+	srand(7);
+	for (int round = 0; round < 100000; round++){
+		char text[256];
+		size_t length = 0;
+		int count = rand() % 12;
+
+		for (int i = 0; i < count; i++){
+			const char *piece = pieces[rand() % (sizeof(pieces) / sizeof(pieces[0]))];
+			memcpy(text + length, piece, strlen(piece));
+			length += strlen(piece);
+		}
+
+		// Exactly length bytes, so reads past the end are caught
+		uint8_t *input = malloc(length ? length : 1);
+		memcpy(input, text, length);
+
+		size_t start, end, expectedStart, expectedEnd;
+		AppigoUTF8TrimWhitespace(input, length, &start, &end);
+		TFReferenceTrim(input, length, &expectedStart, &expectedEnd);
+		if (end > start || expectedEnd > expectedStart)
+			TF_EXPECT(start == expectedStart && end == expectedEnd);
+		else
+			TF_EXPECT(start == end);
+
+		free(input);
+	}
+}
+
+int main(void){
+	TFTestCharacters();
+	TFTestTrim();
+	TFTestSpaceRuns();
+	TFTestGenerated();
+
+	return TFTestFinish("AppigoWhitespaceTests");
+}
@@ -0,0 +1,19 @@
+/*
+ * TFBenchmark.h
+ *
+ * Monotonic clock shared by the host benchmarks.
+ */
+
+#ifndef TF_BENCHMARK_H
+#define TF_BENCHMARK_H
+
+#include <stdio.h>
+#include <time.h>
+
+static double TFBenchmarkNow(void){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+#endif
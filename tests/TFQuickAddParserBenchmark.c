@@ -0,0 +1,40 @@
+/*
+ * TFQuickAddParserBenchmark.c
+ *
+ * Times TFQuickAddParse on typical text field contents. Run with
+ * "make -C tests bench".
+ */
+
+#include "TFQuickAddParser.h"
+#include "TFBenchmark.h"
+
+#include <string.h>
+
+#define kTFBenchmarkIterations 1000000
+
+int main(void){
+	static const char *const inputs[] = {
+		"Buy milk",
+		"Call the dentist about the appointment next week",
+		"Buy milk !high #errands @store ^Home due:tomorrow 5pm every 2 weeks",
+		"Pay rent due:2024-03-01 every month !!",
+		NULL
+	};
+
+	char name[256];
+	TFQuickAddResult result;
+	unsigned sink = 0;
+
+	for (int i = 0; inputs[i]; i++){
+		size_t length = strlen(inputs[i]);
+		double start = TFBenchmarkNow();
+
+		for (int iteration = 0; iteration < kTFBenchmarkIterations; iteration++)
+			sink += TFQuickAddParse(inputs[i], length, name, &result);
+
+		double elapsed = TFBenchmarkNow() - start;
+		printf("%8.1f ns/parse  %3zu bytes  \"%s\"\n", elapsed * 1e9 / kTFBenchmarkIterations, length, inputs[i]);
+	}
+
+	return sink == 0xFFFFFFFF;
+}
@@ -0,0 +1,245 @@
+/*
+ * TFQuickAddParserTests.c
+ *
+ * Unit tests for the quick-add parser, plus a randomized run over inputs
+ * built from the syntax's own words. Run with "make -C tests".
+ */
+
+#include "TFQuickAddParser.h"
+#include "TFTest.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kTFFuzzIterations 200000
+
+typedef struct {
+	TFQuickAddResult result;
+	unsigned recognized;
+	char name[512];
+	const char *text;
+} TFParsed;
+
+static TFParsed TFParse(const char *text){
+	TFParsed parsed;
+	parsed.text = text;
+	parsed.recognized = TFQuickAddParse(text, strlen(text), parsed.name, &parsed.result);
+	return parsed;
+}
+
+static int TFSpanEquals(const TFParsed *parsed, TFQuickAddSpan span, const char *expected){
+	return span.length == strlen(expected) && memcmp(parsed->text + span.offset, expected, span.length) == 0;
+}
+
+static void TFTestPlainName(void){
+	TFParsed p = TFParse("  Buy   milk  ");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "Buy milk");
+	TF_EXPECT(p.result.nameLength == 8);
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueNone);
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatNone);
+
+	p = TFParse("");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "");
+	TF_EXPECT(p.result.nameLength == 0);
+}
+
+// Templates made only of syntax ask for a name when they are triggered
+static void TFTestSyntaxOnly(void){
+	TFParsed p = TFParse("^Home !! due:tomorrow");
+	TF_EXPECT(p.recognized == 3);
+	TF_EXPECT_STRING(p.name, "");
+	TF_EXPECT(p.result.nameLength == 0);
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 1);
+
+	p = TFParse("  @errands  #weekly  ");
+	TF_EXPECT(p.recognized > 0);
+	TF_EXPECT(p.result.nameLength == 0);
+
+	p = TFParse("^Home Call mom");
+	TF_EXPECT(p.recognized == 1);
+	TF_EXPECT_STRING(p.name, "Call mom");
+	TF_EXPECT(p.result.nameLength == 8);
+}
+
+static void TFTestFullSyntax(void){
+	TFParsed p = TFParse("Buy milk !high #errands @store ^Home due:tomorrow 5pm every 2 weeks");
+	TF_EXPECT(p.recognized == 6);
+	TF_EXPECT_STRING(p.name, "Buy milk");
+	TF_EXPECT(p.result.priority == TFQuickAddPriorityHigh);
+	TF_EXPECT(p.result.tagCount == 1 && TFSpanEquals(&p, p.result.tags[0], "errands"));
+	TF_EXPECT(TFSpanEquals(&p, p.result.context, "store"));
+	TF_EXPECT(TFSpanEquals(&p, p.result.list, "Home"));
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 1);
+	TF_EXPECT(p.result.dueHasTime && p.result.dueHour == 17 && p.result.dueMinute == 0);
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatWeeks && p.result.repeatInterval == 2);
+}
+
+static void TFTestPriorities(void){
+	TF_EXPECT(TFParse("a !!!").result.priority == TFQuickAddPriorityHigh);
+	TF_EXPECT(TFParse("a !!").result.priority == TFQuickAddPriorityMedium);
+	TF_EXPECT(TFParse("a !2").result.priority == TFQuickAddPriorityMedium);
+	TF_EXPECT(TFParse("a !LOW").result.priority == TFQuickAddPriorityLow);
+	TF_EXPECT(TFParse("a !none").result.priority == TFQuickAddPriorityNone);
+
+	// Not priorities, so part of the name
+	TFParsed p = TFParse("wow ! !urgent");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "wow ! !urgent");
+}
+
+static void TFTestTags(void){
+	char text[512] = "t";
+	for (int i = 0; i < TF_QUICKADD_MAX_TAGS + 1; i++)
+		strcat(text, " #x");
+
+	TFParsed p = TFParse(text);
+	TF_EXPECT(p.result.tagCount == TF_QUICKADD_MAX_TAGS);
+	TF_EXPECT_STRING(p.name, "t #x");
+
+	p = TFParse("# @ ^");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "# @ ^");
+}
+
+static void TFTestDueDays(void){
+	TFParsed p = TFParse("a due:today");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 0);
+
+	p = TFParse("a due:+3");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 3);
+
+	p = TFParse("a due:2w");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 14);
+
+	p = TFParse("a due: Friday");
+	TF_EXPECT(p.recognized == 1);
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueWeekday && p.result.dueWeekday == 6);
+	TF_EXPECT_STRING(p.name, "a");
+
+	p = TFParse("a due:thu at 9:30am");
+	TF_EXPECT(p.result.dueWeekday == 5 && p.result.dueHasTime && p.result.dueHour == 9 && p.result.dueMinute == 30);
+
+	p = TFParse("a due:noon");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueRelativeDays && p.result.dueDays == 0);
+	TF_EXPECT(p.result.dueHasTime && p.result.dueHour == 12);
+
+	p = TFParse("a due:12am");
+	TF_EXPECT(p.result.dueHasTime && p.result.dueHour == 0);
+
+	// A bare number after the day is part of the name
+	p = TFParse("a due:today 5");
+	TF_EXPECT(!p.result.dueHasTime);
+	TF_EXPECT_STRING(p.name, "a 5");
+
+	p = TFParse("a due:25:00 due:13pm due:someday");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "a due:25:00 due:13pm due:someday");
+}
+
+static void TFTestCalendarDates(void){
+	TFParsed p = TFParse("a due:2024-02-29");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueDate);
+	TF_EXPECT(p.result.dueYear == 2024 && p.result.dueMonth == 2 && p.result.dueDay == 29);
+
+	p = TFParse("a due:3/4");
+	TF_EXPECT(p.result.dueKind == TFQuickAddDueDate);
+	TF_EXPECT(p.result.dueYear == 0 && p.result.dueMonth == 3 && p.result.dueDay == 4);
+
+	p = TFParse("a due:12/31/25");
+	TF_EXPECT(p.result.dueYear == 2025 && p.result.dueMonth == 12 && p.result.dueDay == 31);
+
+	// Too many parts, mixed separators, out of range and malformed dates
+	const char *const rejected[] = {
+		"due:1-2-3-4", "due:1/2/3/4/5", "due:1-2-3-", "due:1/2-3", "due:13/1",
+		"due:1/32", "due:2024-1", "due:12345-1-1", "due:1//2", "due:/1/2", NULL
+	};
+	for (int i = 0; rejected[i]; i++){
+		p = TFParse(rejected[i]);
+		TF_EXPECT(p.recognized == 0);
+		TF_EXPECT(p.result.dueKind == TFQuickAddDueNone);
+		TF_EXPECT_STRING(p.name, rejected[i]);
+	}
+}
+
+static void TFTestRepeats(void){
+	TFParsed p = TFParse("a every day");
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatDays && p.result.repeatInterval == 1);
+
+	p = TFParse("a every other month");
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatMonths && p.result.repeatInterval == 2);
+
+	p = TFParse("a every weekend");
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatWeekends);
+
+	p = TFParse("a every Monday");
+	TF_EXPECT(p.result.repeatUnit == TFQuickAddRepeatDayOfWeek && p.result.repeatWeekday == 2);
+	TF_EXPECT_STRING(p.name, "a");
+
+	// A weekday takes no interval, the words stay in the name
+	p = TFParse("a every other friday");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "a every other friday");
+
+	p = TFParse("a every 0 days");
+	TF_EXPECT(p.recognized == 0);
+
+	p = TFParse("a every");
+	TF_EXPECT(p.recognized == 0);
+	TF_EXPECT_STRING(p.name, "a every");
+}
+
+// Random inputs made of the syntax's words and fragments, checked for memory
+// errors by the sanitizers and for a name that fits its buffer
+static void TFTestFuzz(void){
+	static const char *const pieces[] = {
+		"due:", "due", ":", "-", "/", "+", "1", "12", "2024", "99999", "0",
+		"pm", "am", "at", "noon", "every", "other", "fri", "week", "days",
+		"!", "!!", "!high", "#", "#t", "@", "@c", "^", "^l", "x", " ", " ", "\t"
+	};
+	const size_t pieceCount = sizeof(pieces) / sizeof(pieces[0]);
+
+	srand(1);
+	for (int iteration = 0; iteration < kTFFuzzIterations; iteration++){
+		char text[256];
+		size_t length = 0;
+		int count = rand() % 24;
+
+		for (int i = 0; i < count; i++){
+			const char *piece = pieces[rand() % pieceCount];
+			size_t pieceLength = strlen(piece);
+			if (length + pieceLength >= sizeof(text))
+				break;
+			memcpy(text + length, piece, pieceLength);
+			length += pieceLength;
+		}
+
+		// Exactly length bytes, so reads past the end are caught
+		char *input = malloc(length ? length : 1);
+		char *name = malloc(length + 1);
+		memcpy(input, text, length);
+
+		TFQuickAddResult result;
+		TFQuickAddParse(input, length, name, &result);
+		TF_EXPECT(result.nameLength <= length && name[result.nameLength] == '\0');
+		TF_EXPECT(result.tagCount <= TF_QUICKADD_MAX_TAGS);
+
+		free(input);
+		free(name);
+	}
+}
+
+int main(void){
+	TFTestPlainName();
+	TFTestSyntaxOnly();
+	TFTestFullSyntax();
+	TFTestPriorities();
+	TFTestTags();
+	TFTestDueDays();
+	TFTestCalendarDates();
+	TFTestRepeats();
+	TFTestFuzz();
+
+	return TFTestFinish("TFQuickAddParserTests");
+}
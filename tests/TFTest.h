@@ -0,0 +1,38 @@
+/*
+ * TFTest.h
+ *
+ * Minimal assertions shared by the host tests. A failed expectation is
+ * printed and counted, and the test keeps going.
+ */
+
+#ifndef TF_TEST_H
+#define TF_TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int TFTestFailures = 0;
+static int TFTestChecks = 0;
+
+#define TF_EXPECT(condition) do { \
+	TFTestChecks++; \
+	if (!(condition)){ \
+		TFTestFailures++; \
+		fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition); \
+	} \
+} while (0)
+
+#define TF_EXPECT_STRING(actual, expected) do { \
+	TFTestChecks++; \
+	if (strcmp((actual), (expected)) != 0){ \
+		TFTestFailures++; \
+		fprintf(stderr, "%s:%d: expected \"%s\", got \"%s\"\n", __FILE__, __LINE__, (expected), (actual)); \
+	} \
+} while (0)
+
+static int TFTestFinish(const char *name){
+	printf("%s: %d checks, %d failed\n", name, TFTestChecks, TFTestFailures);
+	return TFTestFailures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,157 @@
+/*
+ * AppigoBinaryCodingBenchmark.m
+ *
+ * Times binaryRepresentation and initWithBinaryData: on task trees of a
+ * growing number of tasks, on one thread and split over every core, and
+ * prints the values to pass to AppigoBinarySetParallelThresholds on the
+ * device it ran on. See Makefile for how to build and run it.
+ */
+
+#import <Foundation/Foundation.h>
+#import "AppigoTask.h"
+#import "AppigoBinaryCoding.h"
+
+#include <mach/mach_time.h>
+
+
+#define kTFBenchmarkTaskCounts		{ 16, 32, 64, 128, 256, 512, 1024, 4096, 16384 }
+#define kTFBenchmarkTasksPerSize	40000	// tasks coded per measurement, so small trees are repeated
+
+
+static double TFBenchmarkNow(void)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+}
+
+
+// Projects of four tasks each under one root, filled in like a typical import
+static AppigoTask *TFCreateTree(NSUInteger taskCount)
+{
+	AppigoTask *root = [[AppigoTask alloc] initWithName:@"Benchmark"];
+
+	for (NSUInteger i = 0; i < taskCount / 4; i++)
+	{
+		AppigoTask *project = [[AppigoTask alloc] initWithName:[NSString stringWithFormat:@"Project %lu", (unsigned long)i]];
+		project.list = (i % 3 == 0) ? @"Inbox" : @"Work";
+
+		for (NSUInteger j = 0; j < 3; j++)
+		{
+			AppigoTask *task = [[AppigoTask alloc] initWithName:[NSString stringWithFormat:@"Step %lu of project %lu", (unsigned long)j, (unsigned long)i]];
+			task.note = @"Call before noon, bring the signed copy and the receipt from last week.";
+			task.list = project.list;
+			task.context = @"@errands";
+			task.tags = @"weekly, home";
+			task.dueDate = [NSDate dateWithTimeIntervalSinceReferenceDate:400000000.0 + (i * 3 + j) * 86400.0];
+			[project addSubtask:task];
+			[task release];
+		}
+
+		[root addSubtask:project];
+		[project release];
+	}
+
+	return root;
+}
+
+
+static double TFTimeEncode(AppigoTask *root, NSUInteger iterations)
+{
+	double start = TFBenchmarkNow();
+
+	for (NSUInteger i = 0; i < iterations; i++)
+	{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[root binaryRepresentation];
+		[pool release];
+	}
+
+	return (TFBenchmarkNow() - start) / iterations;
+}
+
+
+static double TFTimeDecode(NSData *data, NSUInteger iterations)
+{
+	double start = TFBenchmarkNow();
+
+	for (NSUInteger i = 0; i < iterations; i++)
+	{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+		[[[AppigoTask alloc] initWithBinaryData:data] release];
+		[pool release];
+	}
+
+	return (TFBenchmarkNow() - start) / iterations;
+}
+
+
+int main(int argc, char **argv)
+{
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	static const NSUInteger taskCounts[] = kTFBenchmarkTaskCounts;
+	enum { sizeCount = sizeof(taskCounts) / sizeof(taskCounts[0]) };
+
+	BOOL encodeWins[sizeCount];
+	BOOL decodeWins[sizeCount];
+	NSUInteger lengths[sizeCount];
+
+	printf("%lu active processors\n", (unsigned long)[[NSProcessInfo processInfo] activeProcessorCount]);
+	printf("%6s %9s %12s %12s %12s %12s\n", "tasks", "bytes", "encode 1", "encode all", "decode 1", "decode all");
+
+	// Split every tree, to see where splitting starts to pay off
+	AppigoBinarySetParallelThresholds(1, 1);
+
+	for (NSUInteger size = 0; size < sizeCount; size++)
+	{
+		AppigoTask *root = TFCreateTree(taskCounts[size]);
+		NSData *data = [[root binaryRepresentation] retain];
+		NSUInteger iterations = MAX(kTFBenchmarkTasksPerSize / taskCounts[size], (NSUInteger)5);
+
+		AppigoBinarySetCodingConcurrency(1);
+		double serialEncode = TFTimeEncode(root, iterations);
+		double serialDecode = TFTimeDecode(data, iterations);
+
+		AppigoBinarySetCodingConcurrency(0);
+		double parallelEncode = TFTimeEncode(root, iterations);
+		double parallelDecode = TFTimeDecode(data, iterations);
+
+		encodeWins[size] = (parallelEncode < serialEncode);
+		decodeWins[size] = (parallelDecode < serialDecode);
+		lengths[size] = [data length];
+
+		printf("%6lu %9lu %9.3f ms %9.3f ms %9.3f ms %9.3f ms\n", (unsigned long)taskCounts[size], (unsigned long)[data length],
+			   serialEncode * 1e3, parallelEncode * 1e3, serialDecode * 1e3, parallelDecode * 1e3);
+
+		[data release];
+		[root release];
+	}
+
+	AppigoBinarySetParallelThresholds(kAppigoBinaryParallelMinimumTasks, kAppigoBinaryParallelMinimumLength);
+
+	// The smallest size from which splitting wins at every larger size too
+	NSInteger encodeFrom = sizeCount;
+	while ( (encodeFrom > 0) && (encodeWins[encodeFrom - 1] == YES) )
+		encodeFrom--;
+
+	NSInteger decodeFrom = sizeCount;
+	while ( (decodeFrom > 0) && (decodeWins[decodeFrom - 1] == YES) )
+		decodeFrom--;
+
+	if (encodeFrom < (NSInteger)sizeCount)
+		printf("minimum tasks:  %lu (default %d)\n", (unsigned long)taskCounts[encodeFrom], kAppigoBinaryParallelMinimumTasks);
+	else
+		printf("minimum tasks:  splitting never paid off, pass NSUIntegerMax\n");
+
+	if (decodeFrom < (NSInteger)sizeCount)
+		printf("minimum length: %lu (default %d)\n", (unsigned long)lengths[decodeFrom], kAppigoBinaryParallelMinimumLength);
+	else
+		printf("minimum length: splitting never paid off, pass NSUIntegerMax\n");
+
+	[pool release];
+
+	return 0;
+}
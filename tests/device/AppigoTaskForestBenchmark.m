@@ -0,0 +1,168 @@
+/*
+ * AppigoTaskForestBenchmark.m
+ *
+ * Builds the same project of 1,000 to 50,000 tasks as AppigoTask objects and
+ * as an AppigoTaskForest, encodes both as a binary task payload and decodes
+ * that payload back both ways. The two payloads have to be byte for byte the
+ * same. See Makefile for how to build and run it.
+ */
+
+#import <Foundation/Foundation.h>
+#import "AppigoTask.h"
+#import "AppigoTaskForest.h"
+#import "AppigoBinaryCoding.h"
+
+#include <mach/mach_time.h>
+
+
+#define kTFBenchmarkTaskCounts		{ 1000, 10000, 50000 }
+#define kTFBenchmarkRuns			5
+
+
+static double TFBenchmarkNow(void)
+{
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom == 0)
+		mach_timebase_info(&timebase);
+
+	return (double)mach_absolute_time() * timebase.numer / timebase.denom / 1e9;
+}
+
+
+static const char *const _lists[] = { "Inbox", "Work", "Home" };
+static const char _note[] = "Count the stock on the second shelf and write down anything missing.";
+
+
+// An inventory project with one item per task, as a generated import would be
+static AppigoTask *TFCreateTasks(NSUInteger taskCount)
+{
+	AppigoTask *project = [[AppigoTask alloc] initWithName:@"Inventory"];
+	[project setType:AppigoTaskTypeProject withPropertyKeys:nil withPropertyValues:nil];
+
+	NSString *note = [NSString stringWithUTF8String:_note];
+	for (NSUInteger i = 1; i < taskCount; i++)
+	{
+		NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+		AppigoTask *task = [[AppigoTask alloc] initWithName:[NSString stringWithFormat:@"Item %lu", (unsigned long)i]];
+		task.list = [NSString stringWithUTF8String:_lists[i % 3]];
+		task.note = note;
+		task.dueDate = [NSDate dateWithTimeIntervalSinceReferenceDate:400000000.0 + i * 60.0];
+		[project addSubtask:task];
+		[task release];
+
+		[pool release];
+	}
+
+	return project;
+}
+
+
+static AppigoTaskForest *TFCreateForest(NSUInteger taskCount, AppigoTaskForestIndex *projectOut)
+{
+	AppigoTaskForest *forest = [[AppigoTaskForest alloc] initWithCapacity:taskCount];
+	AppigoTaskForestIndex project = [forest addTaskWithName:@"Inventory" parent:kAppigoTaskForestNoTask];
+	[forest setType:AppigoTaskTypeProject ofTask:project];
+
+	for (NSUInteger i = 1; i < taskCount; i++)
+	{
+		char name[32];
+		int length = snprintf(name, sizeof(name), "Item %lu", (unsigned long)i);
+
+		AppigoTaskForestIndex task = [forest addTaskWithUTF8Name:name length:length parent:project];
+		[forest setUTF8String:_lists[i % 3] length:strlen(_lists[i % 3]) forField:AppigoTaskForestFieldList ofTask:task];
+		[forest setUTF8String:_note length:sizeof(_note) - 1 forField:AppigoTaskForestFieldNote ofTask:task];
+		[forest setTimeIntervalSinceReferenceDate:400000000.0 + i * 60.0 forField:AppigoTaskForestFieldDueDate ofTask:task];
+	}
+
+	*projectOut = project;
+	return forest;
+}
+
+
+int main(int argc, char **argv)
+{
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+
+	static const NSUInteger taskCounts[] = kTFBenchmarkTaskCounts;
+
+	// One thread for both, the forest encoder does not split trees
+	AppigoBinarySetCodingConcurrency(1);
+
+	printf("%6s %-10s %10s %10s %10s %10s %10s\n", "tasks", "", "build", "encode", "release", "decode", "bytes");
+	for (NSUInteger size = 0; size < sizeof(taskCounts) / sizeof(taskCounts[0]); size++)
+	{
+		NSUInteger taskCount = taskCounts[size];
+		double times[2][4] = { { 0 } };
+		NSUInteger byteSizes[2] = { 0 };
+		BOOL identical = YES;
+
+		for (int run = 0; run < kTFBenchmarkRuns; run++)
+		{
+			NSAutoreleasePool *runPool = [[NSAutoreleasePool alloc] init];
+
+			double start = TFBenchmarkNow();
+			AppigoTask *project = TFCreateTasks(taskCount);
+			double built = TFBenchmarkNow();
+			NSData *taskPayload = [[project binaryRepresentation] retain];
+			double encoded = TFBenchmarkNow();
+			[project release];
+			double released = TFBenchmarkNow();
+			[[[AppigoTask alloc] initWithBinaryData:taskPayload] release];
+			double decoded = TFBenchmarkNow();
+
+			times[0][0] += built - start;
+			times[0][1] += encoded - built;
+			times[0][2] += released - encoded;
+			times[0][3] += decoded - released;
+			byteSizes[0] = [taskPayload length];
+
+			AppigoTaskForestIndex root;
+			start = TFBenchmarkNow();
+			AppigoTaskForest *forest = TFCreateForest(taskCount, &root);
+			built = TFBenchmarkNow();
+			NSData *forestPayload = [[forest binaryRepresentationOfTask:root] retain];
+			encoded = TFBenchmarkNow();
+			byteSizes[1] = [forest byteSize];
+			[forest release];
+			released = TFBenchmarkNow();
+			AppigoTaskForest *decodedForest = [[AppigoTaskForest alloc] initWithCapacity:taskCount];
+			[decodedForest addTaskFromBinaryData:forestPayload parent:kAppigoTaskForestNoTask];
+			[decodedForest release];
+			decoded = TFBenchmarkNow();
+
+			times[1][0] += built - start;
+			times[1][1] += encoded - built;
+			times[1][2] += released - encoded;
+			times[1][3] += decoded - released;
+
+			if ([forestPayload isEqualToData:taskPayload] == NO)
+				identical = NO;
+
+			[forestPayload release];
+			[taskPayload release];
+			[runPool release];
+		}
+
+		static const char *const labels[2] = { "AppigoTask", "forest" };
+		for (int path = 0; path < 2; path++)
+		{
+			printf("%6lu %-10s %7.2f ms %7.2f ms %7.2f ms %7.2f ms %10lu\n", (unsigned long)taskCount, labels[path],
+				   times[path][0] * 1e3 / kTFBenchmarkRuns, times[path][1] * 1e3 / kTFBenchmarkRuns,
+				   times[path][2] * 1e3 / kTFBenchmarkRuns, times[path][3] * 1e3 / kTFBenchmarkRuns,
+				   (unsigned long)byteSizes[path]);
+		}
+
+		if (identical == NO)
+		{
+			printf("the forest payload differs from the AppigoTask payload\n");
+			[pool release];
+			return 1;
+		}
+	}
+	printf("bytes: the payload for AppigoTask, the forest's byteSize for the forest\n");
+
+	[pool release];
+
+	return 0;
+}